@@ -33,6 +33,11 @@
 #define TEN_SECOND_DELAY 10000
 #define FORTY_FIVE_SECOND_DELAY 45000
 
+static bool intervalTimer_timestampRunning = false;
+#ifndef INTERVAL_TIMER_HARDWARE_TIMESTAMPS
+uint64_t intervalTimer_hostEpochNs = 0;
+#endif
+
 // This function reads the value in a memory address.
 // The inputs are the base address of the timer, and an offset away from that
 // address.
@@ -64,11 +69,26 @@ uint32_t intervalTimer_determineBaseaddress(uint32_t timerNumber) {
   return timerBase;
 }
 
+// Returns true, and says so, if timerNumber is the running timestamp counter,
+// which must not be stopped, reset or re-initialized.
+static bool intervalTimer_isTimestampCounter(uint32_t timerNumber) {
+#ifdef INTERVAL_TIMER_HARDWARE_TIMESTAMPS
+  if (intervalTimer_timestampRunning &&
+      timerNumber == INTERVAL_TIMER_TIMESTAMP_TIMER) {
+    printf("Timer %d is reserved for the timestamp counter.\n", timerNumber);
+    return true;
+  }
+#endif
+  return false;
+}
+
 // This function is called whenever you want to reuse an interval timer.
 // For example, say the interval timer has been used in the past, the user
 // will call intervalTimer_reset() prior to calling intervalTimer_start().
 // timerNumber indicates which timer should reset.
 void intervalTimer_reset(uint32_t timerNumber) {
+  if (intervalTimer_isTimestampCounter(timerNumber))
+    return;
   uint32_t timerBase = intervalTimer_determineBaseaddress(timerNumber);
 
   intervalTimer_stop(timerNumber);
@@ -89,6 +109,8 @@ void intervalTimer_reset(uint32_t timerNumber) {
 // timerNumber indicates which timer should be initialized.
 // returns INTERVAL_TIMER_STATUS_OK if successful, some other value otherwise.
 intervalTimer_status_t intervalTimer_init(uint32_t timerNumber) {
+  if (intervalTimer_isTimestampCounter(timerNumber))
+    return INTERVAL_TIMER_STATUS_FAIL;
   uint32_t timerBase = intervalTimer_determineBaseaddress(timerNumber);
 
   // Clear both of the control registers TCSR0 and TCSR1 - This also defines the
@@ -119,9 +141,10 @@ intervalTimer_status_t intervalTimer_init(uint32_t timerNumber) {
 // returns INTERVAL_TIMER_STATUS_OK if successful, some other value otherwise.
 intervalTimer_status_t intervalTimer_initAll() {
   // Only returns INTERVAL_TIMER_STATUS_OK if all three initializations are
-  // successful
+  // successful. The timestamp counter is left running once started.
   if (intervalTimer_init(INTERVAL_TIMER_TIMER_0)) {
-    if (intervalTimer_init(INTERVAL_TIMER_TIMER_1)) {
+    if (intervalTimer_timestampRunning ||
+        intervalTimer_init(INTERVAL_TIMER_TIMER_1)) {
       if (intervalTimer_init(INTERVAL_TIMER_TIMER_2)) {
         return INTERVAL_TIMER_STATUS_OK;
       }
@@ -147,6 +170,8 @@ void intervalTimer_start(uint32_t timerNumber) {
 // If the interval time is currently stopped, this function does nothing.
 // timerNumber indicates which timer should stop running.
 void intervalTimer_stop(uint32_t timerNumber) {
+  if (intervalTimer_isTimestampCounter(timerNumber))
+    return;
   // Determines the correct timer and sets the enable bit ENT0 low without
   // disrupting other values in register TCSR0
   uint32_t timerBase = intervalTimer_determineBaseaddress(timerNumber);
@@ -160,7 +185,8 @@ void intervalTimer_stop(uint32_t timerNumber) {
 // Simply calls intervalTimer_reset() on all timers.
 void intervalTimer_resetAll() {
   intervalTimer_reset(INTERVAL_TIMER_TIMER_0);
-  intervalTimer_reset(INTERVAL_TIMER_TIMER_1);
+  if (!intervalTimer_timestampRunning) // Timestamps must not go backwards.
+    intervalTimer_reset(INTERVAL_TIMER_TIMER_1);
   intervalTimer_reset(INTERVAL_TIMER_TIMER_2);
 }
 
@@ -228,7 +254,8 @@ intervalTimer_status_t intervalTimer_test(uint32_t timerNumber) {
 intervalTimer_status_t intervalTimer_testAll() {
   // Only returns INTERVAL_TIMER_STATUS_OK if all timer tests are successful.
   if (intervalTimer_test(INTERVAL_TIMER_TIMER_0)) {
-    if (intervalTimer_test(INTERVAL_TIMER_TIMER_1)) {
+    if (intervalTimer_timestampRunning || // Leave the timestamps alone.
+        intervalTimer_test(INTERVAL_TIMER_TIMER_1)) {
       if (intervalTimer_test(INTERVAL_TIMER_TIMER_2)) {
         return INTERVAL_TIMER_STATUS_OK;
       }
@@ -252,7 +279,8 @@ double intervalTimer_getTotalDurationInSeconds(uint32_t timerNumber) {
   do {
     upper32 = intervalTimer_readGpioRegister(timerBase, OFFSET_TCR1);
     lower32 = intervalTimer_readGpioRegister(timerBase, OFFSET_TCR0);
-  } while (intervalTimer_readGpioRegister(timerBase, OFFSET_TCR1) != upper32);
+  } while ((uint32_t)intervalTimer_readGpioRegister(timerBase, OFFSET_TCR1) !=
+           upper32);
 
   // Concatenate the upper and lower 32 bits into a single 64 bit variable,
   // then performs floating point division to determine runtime in seconds
@@ -261,3 +289,70 @@ double intervalTimer_getTotalDurationInSeconds(uint32_t timerNumber) {
   double timerTotal = (double)registerValue / TIMER_FREQUENCY;
   return timerTotal;
 }
+
+// Initializes and starts the timestamp counter, unless it is already running.
+void intervalTimer_startTimestampCounter() {
+  if (intervalTimer_timestampRunning)
+    return;
+#ifdef INTERVAL_TIMER_HARDWARE_TIMESTAMPS
+  intervalTimer_init(INTERVAL_TIMER_TIMESTAMP_TIMER);
+  intervalTimer_start(INTERVAL_TIMER_TIMESTAMP_TIMER);
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  intervalTimer_hostEpochNs =
+      (uint64_t)now.tv_sec * INTERVAL_TIMER_NS_PER_SECOND + now.tv_nsec;
+#endif
+  intervalTimer_timestampRunning = true;
+}
+
+// Returns true once the timestamp counter has been started.
+bool intervalTimer_timestampCounterRunning() {
+  return intervalTimer_timestampRunning;
+}
+
+// Returns the number of ticks since the timestamp counter was started.
+uint64_t intervalTimer_nowTicks() { return intervalTimer_nowTicksInline(); }
+
+#define TIMESTAMP_TEST_READ_COUNT 100000
+#define TIMESTAMP_TEST_DELAY_MS 100
+#define TIMESTAMP_TEST_TOLERANCE_MS 5
+#define TIMESTAMP_TEST_ROUND_TRIP_US 1234567ULL
+
+// Checks that timestamps are monotonic, advance at the expected rate and that
+// the conversions round trip.
+intervalTimer_status_t intervalTimer_testTimestamps() {
+  printf("Testing timestamps\n");
+  intervalTimer_status_t status = INTERVAL_TIMER_STATUS_OK;
+  intervalTimer_startTimestampCounter();
+  uint64_t previous = intervalTimer_nowTicks();
+  for (uint32_t i = 0; i < TIMESTAMP_TEST_READ_COUNT; i++) {
+    uint64_t now = intervalTimer_nowTicksInline();
+    if (now < previous) {
+      printf("Timestamp went backwards: %llu after %llu.\n",
+             (unsigned long long)now, (unsigned long long)previous);
+      status = INTERVAL_TIMER_STATUS_FAIL;
+      break;
+    }
+    previous = now;
+  }
+  uint64_t start = intervalTimer_nowTicks();
+  utils_msDelay(TIMESTAMP_TEST_DELAY_MS);
+  uint64_t elapsedMs =
+      intervalTimer_ticksToMs(intervalTimer_nowTicks() - start);
+  printf("%d ms delay measured as %llu ms.\n", TIMESTAMP_TEST_DELAY_MS,
+         (unsigned long long)elapsedMs);
+  if (elapsedMs + TIMESTAMP_TEST_TOLERANCE_MS < TIMESTAMP_TEST_DELAY_MS ||
+      elapsedMs > TIMESTAMP_TEST_DELAY_MS + TIMESTAMP_TEST_TOLERANCE_MS)
+    status = INTERVAL_TIMER_STATUS_FAIL;
+  if (intervalTimer_ticksToUs(intervalTimer_usToTicks(
+          TIMESTAMP_TEST_ROUND_TRIP_US)) != TIMESTAMP_TEST_ROUND_TRIP_US ||
+      intervalTimer_ticksToNs(INTERVAL_TIMER_TICKS_PER_SECOND) !=
+          INTERVAL_TIMER_NS_PER_SECOND) {
+    printf("Timestamp conversions do not round trip.\n");
+    status = INTERVAL_TIMER_STATUS_FAIL;
+  }
+  printf("Timestamp test %s.\n",
+         status == INTERVAL_TIMER_STATUS_OK ? "passed" : "failed");
+  return status;
+}
@@ -15,8 +15,22 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #ifndef INTERVALTIMER_H_
 #define INTERVALTIMER_H_
 
+#include "xparameters.h"
+#include <stdbool.h>
 #include <stdint.h>
 
+// The board and the headless emulator (which models the AXI timers) read
+// timestamps from the timer; the Qt emulator uses the host clock.
+#if defined(ZYBO_BOARD) || defined(EMU_HEADLESS)
+#define INTERVAL_TIMER_HARDWARE_TIMESTAMPS
+#endif
+
+#ifdef INTERVAL_TIMER_HARDWARE_TIMESTAMPS
+#include "xil_io.h"
+#else
+#include <time.h>
+#endif
+
 // Used to indicate status that can be checked after invoking the function.
 typedef uint32_t
     intervalTimer_status_t; // Use this type for the return type of a function.
@@ -74,4 +88,102 @@ intervalTimer_status_t intervalTimer_testAll();
 // has been called. The timerNumber argument determines which timer is read.
 double intervalTimer_getTotalDurationInSeconds(uint32_t timerNumber);
 
+// Timestamps.
+// INTERVAL_TIMER_TIMESTAMP_TIMER runs free as a cascaded 64-bit counter once
+// intervalTimer_startTimestampCounter() has been called, and is then never
+// stopped or reset, so hit timestamps, trace events and latency measurements
+// can all share one clock. Do not use that timer for anything else: once the
+// counter is running, intervalTimer_init(), intervalTimer_reset() and
+// intervalTimer_stop() refuse it.
+// In the Qt emulator the timestamps come from clock_gettime(), in the same
+// units.
+#define INTERVAL_TIMER_TIMESTAMP_TIMER INTERVAL_TIMER_TIMER_1
+#define INTERVAL_TIMER_TIMESTAMP_BASEADDR XPAR_AXI_TIMER_1_BASEADDR
+#define INTERVAL_TIMER_TICKS_PER_SECOND XPAR_AXI_TIMER_1_CLOCK_FREQ_HZ
+#define INTERVAL_TIMER_TICKS_PER_MS (INTERVAL_TIMER_TICKS_PER_SECOND / 1000)
+#define INTERVAL_TIMER_TICKS_PER_US (INTERVAL_TIMER_TICKS_PER_SECOND / 1000000)
+#define INTERVAL_TIMER_NS_PER_SECOND 1000000000ULL
+#define INTERVAL_TIMER_NS_PER_TICK                                             \
+  (INTERVAL_TIMER_NS_PER_SECOND / INTERVAL_TIMER_TICKS_PER_SECOND)
+
+#define INTERVAL_TIMER_OFFSET_TCR0 0x08
+#define INTERVAL_TIMER_OFFSET_TCR1 0x18
+
+// Initializes and starts the timestamp counter. Does nothing if it is already
+// running.
+void intervalTimer_startTimestampCounter();
+
+// Returns true once intervalTimer_startTimestampCounter() has been called.
+bool intervalTimer_timestampCounterRunning();
+
+// Returns the number of ticks since the timestamp counter was started.
+uint64_t intervalTimer_nowTicks();
+
+#ifndef INTERVAL_TIMER_HARDWARE_TIMESTAMPS
+// Time at which the host timestamp counter was started, in ns.
+extern uint64_t intervalTimer_hostEpochNs;
+#endif
+
+// Inlineable version of intervalTimer_nowTicks() for hot paths. Reads TCR1,
+// TCR0 and TCR1 again, and retries if the upper word changed in between (TCR0
+// rolled over), so the result is always consistent.
+static inline uint64_t intervalTimer_nowTicksInline() {
+#ifdef INTERVAL_TIMER_HARDWARE_TIMESTAMPS
+  uint32_t upper32, lower32;
+  do {
+    upper32 = Xil_In32(INTERVAL_TIMER_TIMESTAMP_BASEADDR +
+                       INTERVAL_TIMER_OFFSET_TCR1);
+    lower32 = Xil_In32(INTERVAL_TIMER_TIMESTAMP_BASEADDR +
+                       INTERVAL_TIMER_OFFSET_TCR0);
+  } while (Xil_In32(INTERVAL_TIMER_TIMESTAMP_BASEADDR +
+                    INTERVAL_TIMER_OFFSET_TCR1) != upper32);
+  return ((uint64_t)upper32 << 32) | lower32;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  uint64_t ns = (uint64_t)now.tv_sec * INTERVAL_TIMER_NS_PER_SECOND +
+                now.tv_nsec - intervalTimer_hostEpochNs;
+  return ns / INTERVAL_TIMER_NS_PER_TICK;
+#endif
+}
+
+// Returns the lower 32 bits of the timestamp with a single register read, for
+// hot paths that only need intervals shorter than 2^32 ticks (about 42 seconds
+// at 100 MHz). Subtract two readings as uint32_t.
+static inline uint32_t intervalTimer_nowTicksLower32Inline() {
+#ifdef INTERVAL_TIMER_HARDWARE_TIMESTAMPS
+  return Xil_In32(INTERVAL_TIMER_TIMESTAMP_BASEADDR +
+                  INTERVAL_TIMER_OFFSET_TCR0);
+#else
+  return (uint32_t)intervalTimer_nowTicksInline();
+#endif
+}
+
+// Conversions between timestamp ticks and time, in integer arithmetic.
+static inline uint64_t intervalTimer_ticksToNs(uint64_t ticks) {
+  return ticks * INTERVAL_TIMER_NS_PER_TICK;
+}
+static inline uint64_t intervalTimer_ticksToUs(uint64_t ticks) {
+  return ticks / INTERVAL_TIMER_TICKS_PER_US;
+}
+static inline uint64_t intervalTimer_ticksToMs(uint64_t ticks) {
+  return ticks / INTERVAL_TIMER_TICKS_PER_MS;
+}
+static inline uint64_t intervalTimer_usToTicks(uint64_t us) {
+  return us * INTERVAL_TIMER_TICKS_PER_US;
+}
+static inline uint64_t intervalTimer_msToTicks(uint64_t ms) {
+  return ms * INTERVAL_TIMER_TICKS_PER_MS;
+}
+
+// For printing only.
+static inline double intervalTimer_ticksToSeconds(uint64_t ticks) {
+  return (double)ticks / INTERVAL_TIMER_TICKS_PER_SECOND;
+}
+
+// Checks that timestamps never go backwards across many reads, that they
+// advance at the expected rate and that the conversions round trip.
+// Returns INTERVAL_TIMER_STATUS_OK if successful.
+intervalTimer_status_t intervalTimer_testTimestamps();
+
 #endif /* INTERVALTIMER_H_ */
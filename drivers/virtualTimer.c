@@ -0,0 +1,203 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "virtualTimer.h"
+#include <stddef.h>
+#include <stdio.h>
+#ifdef ZYBO_BOARD
+#include "xil_exception.h"
+#include "xpseudo_asm.h"
+#endif
+
+#define LOWER_32_BITS_MASK 0xFFFFFFFFULL
+#define US_PER_SECOND 1000000.0
+
+// The counter may be read from the ISR and the main loop, so the extension to
+// 64 bits is done with IRQs masked.
+#ifdef ZYBO_BOARD
+#define VIRTUAL_TIMER_ENTER_CRITICAL()                                         \
+  uint32_t savedCpsr = mfcpsr();                                               \
+  Xil_ExceptionDisable()
+#define VIRTUAL_TIMER_EXIT_CRITICAL() mtcpsr(savedCpsr)
+#else
+#define VIRTUAL_TIMER_ENTER_CRITICAL()
+#define VIRTUAL_TIMER_EXIT_CRITICAL()
+#endif
+
+static uint64_t virtualTimer_lastCount = 0; // Last 64-bit counter value.
+static virtualTimer_t *virtualTimer_list = NULL;
+
+// Extends a 32-bit reading to 64 bits, assuming less than 2^32 counts have
+// passed since the previous reading.
+static uint64_t virtualTimer_extend(uint32_t lower32) {
+  virtualTimer_lastCount +=
+      (uint32_t)(lower32 - (uint32_t)virtualTimer_lastCount);
+  return virtualTimer_lastCount;
+}
+
+// Starts the timestamp counter if needed and empties the report list.
+void virtualTimer_initAll() {
+  intervalTimer_startTimestampCounter();
+  virtualTimer_lastCount = intervalTimer_nowTicks();
+  virtualTimer_list = NULL;
+}
+
+// Sets up a stopped, zeroed stopwatch and adds it to the report list.
+void virtualTimer_init(virtualTimer_t *timer, const char *name) {
+  timer->name = name;
+  timer->startCount = 0;
+  timer->totalCount = 0;
+  timer->intervalCount = 0;
+  timer->running = false;
+  // Don't add a timer twice if it is re-initialized.
+  for (virtualTimer_t *t = virtualTimer_list; t; t = t->next)
+    if (t == timer)
+      return;
+  timer->next = virtualTimer_list;
+  virtualTimer_list = timer;
+}
+
+// Returns the current value of the shared counter.
+uint64_t virtualTimer_getCount() {
+  VIRTUAL_TIMER_ENTER_CRITICAL();
+  uint64_t count = virtualTimer_extend(intervalTimer_nowTicksLower32Inline());
+  VIRTUAL_TIMER_EXIT_CRITICAL();
+  return count;
+}
+
+// Starts the stopwatch.
+void virtualTimer_start(virtualTimer_t *timer) {
+  if (timer->running)
+    return;
+  timer->startCount = virtualTimer_getCount();
+  timer->running = true;
+}
+
+// Stops the stopwatch and adds the time since the start to its total.
+void virtualTimer_stop(virtualTimer_t *timer) {
+  if (!timer->running)
+    return;
+  timer->totalCount += virtualTimer_getCount() - timer->startCount;
+  timer->intervalCount++;
+  timer->running = false;
+}
+
+// Stops the stopwatch and zeroes its total.
+void virtualTimer_reset(virtualTimer_t *timer) {
+  timer->running = false;
+  timer->totalCount = 0;
+  timer->intervalCount = 0;
+}
+
+// Returns the accumulated count, including the current interval.
+uint64_t virtualTimer_getTotalCount(virtualTimer_t *timer) {
+  if (!timer->running)
+    return timer->totalCount;
+  return timer->totalCount + virtualTimer_getCount() - timer->startCount;
+}
+
+// Returns the accumulated time in seconds.
+double virtualTimer_getTotalDurationInSeconds(virtualTimer_t *timer) {
+  return (double)virtualTimer_getTotalCount(timer) /
+         VIRTUAL_TIMER_COUNTS_PER_SECOND;
+}
+
+// Prints every stopwatch.
+void virtualTimer_printReport() {
+  printf("%-24s %12s %10s %12s\n\r", "virtual timer", "seconds", "intervals",
+         "mean (us)");
+  for (virtualTimer_t *timer = virtualTimer_list; timer; timer = timer->next) {
+    double seconds = virtualTimer_getTotalDurationInSeconds(timer);
+    printf("%-24s %12.6f %10ld %12.3f%s\n\r", timer->name, seconds,
+           (long)timer->intervalCount,
+           timer->intervalCount
+               ? seconds / timer->intervalCount * US_PER_SECOND
+               : 0.0,
+           timer->running ? " (running)" : "");
+  }
+}
+
+#define VIRTUAL_TIMER_TEST_TIMER_COUNT 32
+#define VIRTUAL_TIMER_TEST_DELAY_COUNTS (VIRTUAL_TIMER_COUNTS_PER_SECOND / 1000)
+#define VIRTUAL_TIMER_TEST_INTERVAL_COUNT 3
+#define VIRTUAL_TIMER_TEST_WRAP_START 0xFFFFFFF0ULL
+#define VIRTUAL_TIMER_TEST_WRAP_LOWER32 0x10
+
+// Waits until the counter has advanced by the given number of counts.
+static void virtualTimer_testDelay(uint64_t counts) {
+  uint64_t start = virtualTimer_getCount();
+  while (virtualTimer_getCount() - start < counts)
+    ;
+}
+
+// Runs nested, repeated and many simultaneous stopwatches.
+bool virtualTimer_runTest() {
+  printf("****************** virtualTimer_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  virtualTimer_initAll();
+
+  // The extension to 64 bits must carry into the upper word.
+  uint64_t savedCount = virtualTimer_lastCount;
+  virtualTimer_lastCount = VIRTUAL_TIMER_TEST_WRAP_START;
+  uint64_t extended = virtualTimer_extend(VIRTUAL_TIMER_TEST_WRAP_LOWER32);
+  virtualTimer_lastCount = savedCount;
+  if (extended != (LOWER_32_BITS_MASK + 1) + VIRTUAL_TIMER_TEST_WRAP_LOWER32) {
+    printf("Counter did not roll over: 0x%llx.\n\r",
+           (unsigned long long)extended);
+    success = false;
+  }
+
+  // A stopwatch accumulates over several intervals, and one started around
+  // all of them measures at least as much.
+  virtualTimer_t outer, inner;
+  virtualTimer_init(&outer, "test outer");
+  virtualTimer_init(&inner, "test inner");
+  virtualTimer_start(&outer);
+  for (uint16_t i = 0; i < VIRTUAL_TIMER_TEST_INTERVAL_COUNT; i++) {
+    virtualTimer_start(&inner);
+    virtualTimer_testDelay(VIRTUAL_TIMER_TEST_DELAY_COUNTS);
+    virtualTimer_stop(&inner);
+    virtualTimer_testDelay(VIRTUAL_TIMER_TEST_DELAY_COUNTS);
+  }
+  virtualTimer_stop(&outer);
+  uint64_t innerCount = virtualTimer_getTotalCount(&inner);
+  uint64_t outerCount = virtualTimer_getTotalCount(&outer);
+  if (inner.intervalCount != VIRTUAL_TIMER_TEST_INTERVAL_COUNT ||
+      innerCount <
+          VIRTUAL_TIMER_TEST_INTERVAL_COUNT * VIRTUAL_TIMER_TEST_DELAY_COUNTS ||
+      outerCount < innerCount + VIRTUAL_TIMER_TEST_INTERVAL_COUNT *
+                                    VIRTUAL_TIMER_TEST_DELAY_COUNTS) {
+    printf("Inner %llu counts over %ld intervals, outer %llu counts.\n\r",
+           (unsigned long long)innerCount, (long)inner.intervalCount,
+           (unsigned long long)outerCount);
+    success = false;
+  }
+  virtualTimer_printReport();
+
+  // Stopwatches started in order and stopped in reverse order nest, so each
+  // one measures at least as long as the next.
+  virtualTimer_t timers[VIRTUAL_TIMER_TEST_TIMER_COUNT];
+  for (uint16_t i = 0; i < VIRTUAL_TIMER_TEST_TIMER_COUNT; i++) {
+    virtualTimer_init(&timers[i], "test nested");
+    virtualTimer_start(&timers[i]);
+  }
+  for (int16_t i = VIRTUAL_TIMER_TEST_TIMER_COUNT - 1; i >= 0; i--)
+    virtualTimer_stop(&timers[i]);
+  for (uint16_t i = 0; i + 1 < VIRTUAL_TIMER_TEST_TIMER_COUNT; i++) {
+    if (timers[i].totalCount < timers[i + 1].totalCount) {
+      printf("Nested timer %d measured less than timer %d.\n\r", i, i + 1);
+      success = false;
+    }
+  }
+  virtualTimer_initAll(); // Drop the test timers from the report.
+  printf("virtualTimer_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
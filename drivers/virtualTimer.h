@@ -0,0 +1,82 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Provides any number of named software stopwatches ("virtual timers") that
+// all share one free-running hardware counter, so measurements are no longer
+// limited by the three interval timers.
+//
+// The counter is the timestamp counter of intervalTimer.h, started by
+// virtualTimer_initAll(), so counts are the same as intervalTimer_nowTicks().
+// Starting and stopping a virtual timer reads only the lower 32 bits of the
+// counter; they are extended to 64 bits using the previous reading, so the
+// counter must be read at least once every 2^32 counts (about 42 seconds at
+// 100 MHz). Any start, stop or query counts as a read.
+
+#ifndef VIRTUALTIMER_H_
+#define VIRTUALTIMER_H_
+
+#include "intervalTimer.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define VIRTUAL_TIMER_HARDWARE_TIMER INTERVAL_TIMER_TIMESTAMP_TIMER
+#define VIRTUAL_TIMER_COUNTS_PER_SECOND INTERVAL_TIMER_TICKS_PER_SECOND
+
+// A stopwatch. Owned by the caller; set up with virtualTimer_init(), which also
+// adds it to the list printed by virtualTimer_printReport(). The members are
+// private.
+typedef struct virtualTimer_t {
+  const char *name;
+  uint64_t startCount;
+  uint64_t totalCount;
+  uint32_t intervalCount; // Completed start/stop pairs.
+  bool running;
+  struct virtualTimer_t *next;
+} virtualTimer_t;
+
+// Starts the timestamp counter if needed and empties the report list. Call
+// before any virtual timer is used.
+void virtualTimer_initAll();
+
+// Sets up a stopped, zeroed stopwatch and adds it to the report list. name must
+// stay valid while the timer is in use.
+void virtualTimer_init(virtualTimer_t *timer, const char *name);
+
+// Starts the stopwatch. Does nothing if it is already running.
+void virtualTimer_start(virtualTimer_t *timer);
+
+// Stops the stopwatch and adds the time since the start to its total. Does
+// nothing if it is already stopped.
+void virtualTimer_stop(virtualTimer_t *timer);
+
+// Stops the stopwatch and zeroes its total.
+void virtualTimer_reset(virtualTimer_t *timer);
+
+// Returns the current value of the shared counter.
+uint64_t virtualTimer_getCount();
+
+// Returns the accumulated count, including the current interval if the
+// stopwatch is running.
+uint64_t virtualTimer_getTotalCount(virtualTimer_t *timer);
+
+// Same as intervalTimer_getTotalDurationInSeconds(), for a stopwatch.
+double virtualTimer_getTotalDurationInSeconds(virtualTimer_t *timer);
+
+// Prints the name, total seconds, interval count and mean interval of every
+// stopwatch.
+void virtualTimer_printReport();
+
+// Times nested and interleaved stopwatches against each other and against the
+// counter, and checks that many stopwatches can run at once. Returns true if
+// the test passes.
+bool virtualTimer_runTest();
+
+#endif /* VIRTUALTIMER_H_ */
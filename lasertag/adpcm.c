@@ -0,0 +1,261 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "adpcm.h"
+#include "intervalTimer.h"
+#include <math.h>
+#include <stdio.h>
+
+#define ADPCM_MAX_STEP_INDEX 88
+#define ADPCM_SIGN_MASK 0x8
+#define ADPCM_MAGNITUDE_MASK 0x7
+#define ADPCM_NIBBLE_MASK 0xF
+#define ADPCM_NIBBLE_SHIFT 4
+
+#define ADPCM_TEST_SAMPLE_COUNT 4800 // 0.1 s at 48 kHz.
+#define ADPCM_TEST_SAMPLE_RATE 48000.0
+#define ADPCM_TEST_TONE_HZ 440.0
+#define ADPCM_TEST_CHIRP_START_HZ 200.0
+#define ADPCM_TEST_CHIRP_END_HZ 8000.0
+#define ADPCM_TEST_AMPLITUDE 12000.0
+#define ADPCM_TEST_MIN_SNR_DB 20.0
+#define ADPCM_TEST_REFILL_SAMPLE_COUNT 8 // Stereo frames in the I2S FIFO.
+#define ADPCM_TEST_TIMING_COUNT 100      // Passes over the test signal.
+
+// Standard IMA-ADPCM tables.
+static const int16_t adpcm_stepTable[ADPCM_MAX_STEP_INDEX + 1] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+static const int8_t adpcm_indexTable[ADPCM_MAGNITUDE_MASK + 1] = {
+    -1, -1, -1, -1, 2, 4, 6, 8};
+
+// Returns the size in bytes of an encoded asset of sampleCount samples.
+uint32_t adpcm_getEncodedSize(uint32_t sampleCount) {
+  uint32_t fullBlocks = sampleCount / ADPCM_BLOCK_SAMPLE_COUNT;
+  uint32_t remainder = sampleCount % ADPCM_BLOCK_SAMPLE_COUNT;
+  return fullBlocks * ADPCM_BLOCK_SIZE +
+         (remainder ? ADPCM_BLOCK_HEADER_SIZE + (remainder + 1) / 2 : 0);
+}
+
+// Applies a 4-bit code to the predictor and step index.
+static inline void adpcm_applyCode(int32_t *predictor, int16_t *stepIndex,
+                                   uint8_t code) {
+  int32_t step = adpcm_stepTable[*stepIndex];
+  int32_t delta = step >> 3;
+  if (code & 4)
+    delta += step;
+  if (code & 2)
+    delta += step >> 1;
+  if (code & 1)
+    delta += step >> 2;
+  *predictor += (code & ADPCM_SIGN_MASK) ? -delta : delta;
+  if (*predictor > INT16_MAX)
+    *predictor = INT16_MAX;
+  else if (*predictor < INT16_MIN)
+    *predictor = INT16_MIN;
+  *stepIndex += adpcm_indexTable[code & ADPCM_MAGNITUDE_MASK];
+  if (*stepIndex < 0)
+    *stepIndex = 0;
+  else if (*stepIndex > ADPCM_MAX_STEP_INDEX)
+    *stepIndex = ADPCM_MAX_STEP_INDEX;
+}
+
+// Starts decoding an encoded asset from its first sample.
+void adpcm_initDecoder(adpcm_decoder_t *decoder, const uint8_t *data,
+                       uint32_t sampleCount) {
+  decoder->data = data;
+  decoder->sampleCount = sampleCount;
+  decoder->position = 0;
+  decoder->predictor = 0;
+  decoder->stepIndex = 0;
+}
+
+// Decodes up to count samples. Reloads the state from each block header.
+uint32_t adpcm_decode(adpcm_decoder_t *decoder, int16_t samples[],
+                      uint32_t count) {
+  uint32_t decoded = 0;
+  while (decoded < count && decoder->position < decoder->sampleCount) {
+    uint32_t block = decoder->position / ADPCM_BLOCK_SAMPLE_COUNT;
+    uint32_t inBlock = decoder->position % ADPCM_BLOCK_SAMPLE_COUNT;
+    const uint8_t *header = decoder->data + block * ADPCM_BLOCK_SIZE;
+    if (inBlock == 0) {
+      decoder->predictor = (int16_t)(header[0] | (header[1] << 8));
+      decoder->stepIndex = header[2];
+      if (decoder->stepIndex > ADPCM_MAX_STEP_INDEX)
+        decoder->stepIndex = ADPCM_MAX_STEP_INDEX;
+    }
+    // Decode to the end of the block, the asset or the request.
+    uint32_t run = ADPCM_BLOCK_SAMPLE_COUNT - inBlock;
+    if (run > decoder->sampleCount - decoder->position)
+      run = decoder->sampleCount - decoder->position;
+    if (run > count - decoded)
+      run = count - decoded;
+    const uint8_t *codes = header + ADPCM_BLOCK_HEADER_SIZE;
+    for (uint32_t i = inBlock; i < inBlock + run; i++) {
+      uint8_t code = (codes[i / 2] >> ((i & 1) * ADPCM_NIBBLE_SHIFT)) &
+                     ADPCM_NIBBLE_MASK;
+      adpcm_applyCode(&decoder->predictor, &decoder->stepIndex, code);
+      samples[decoded++] = decoder->predictor;
+    }
+    decoder->position += run;
+  }
+  return decoded;
+}
+
+// Returns the code that best moves the predictor towards the sample.
+static uint8_t adpcm_encodeSample(int32_t predictor, int16_t stepIndex,
+                                  int16_t sample) {
+  int32_t difference = sample - predictor;
+  int32_t step = adpcm_stepTable[stepIndex];
+  uint8_t code = 0;
+  if (difference < 0) {
+    code = ADPCM_SIGN_MASK;
+    difference = -difference;
+  }
+  if (difference >= step) {
+    code |= 4;
+    difference -= step;
+  }
+  step >>= 1;
+  if (difference >= step) {
+    code |= 2;
+    difference -= step;
+  }
+  step >>= 1;
+  if (difference >= step)
+    code |= 1;
+  return code;
+}
+
+// Encodes sampleCount samples into data[].
+void adpcm_encode(const int16_t samples[], uint32_t sampleCount,
+                  uint8_t data[]) {
+  int32_t predictor = 0;
+  int16_t stepIndex = 0;
+  for (uint32_t i = 0; i < sampleCount; i++) {
+    uint32_t inBlock = i % ADPCM_BLOCK_SAMPLE_COUNT;
+    uint8_t *header = data + (i / ADPCM_BLOCK_SAMPLE_COUNT) * ADPCM_BLOCK_SIZE;
+    if (inBlock == 0) {
+      header[0] = predictor & 0xFF;
+      header[1] = (predictor >> 8) & 0xFF;
+      header[2] = stepIndex;
+      header[3] = 0;
+    }
+    uint8_t code = adpcm_encodeSample(predictor, stepIndex, samples[i]);
+    adpcm_applyCode(&predictor, &stepIndex, code);
+    uint8_t *codeByte = header + ADPCM_BLOCK_HEADER_SIZE + inBlock / 2;
+    if (inBlock & 1)
+      *codeByte |= code << ADPCM_NIBBLE_SHIFT;
+    else
+      *codeByte = code;
+  }
+}
+
+static int16_t adpcm_testSamples[ADPCM_TEST_SAMPLE_COUNT];
+static int16_t adpcm_testDecoded[ADPCM_TEST_SAMPLE_COUNT];
+static uint8_t adpcm_testData[ADPCM_TEST_SAMPLE_COUNT / 2 +
+                              (ADPCM_TEST_SAMPLE_COUNT /
+                                   ADPCM_BLOCK_SAMPLE_COUNT +
+                               1) *
+                                  ADPCM_BLOCK_HEADER_SIZE];
+
+// Encodes and decodes a tone plus a chirp and checks the result.
+bool adpcm_runTest() {
+  printf("****************** adpcm_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  intervalTimer_startTimestampCounter();
+  for (uint32_t i = 0; i < ADPCM_TEST_SAMPLE_COUNT; i++) {
+    double t = i / ADPCM_TEST_SAMPLE_RATE;
+    double duration = ADPCM_TEST_SAMPLE_COUNT / ADPCM_TEST_SAMPLE_RATE;
+    double chirpRate =
+        (ADPCM_TEST_CHIRP_END_HZ - ADPCM_TEST_CHIRP_START_HZ) / duration;
+    adpcm_testSamples[i] =
+        ADPCM_TEST_AMPLITUDE * (sin(2 * M_PI * ADPCM_TEST_TONE_HZ * t) +
+                                sin(2 * M_PI * (ADPCM_TEST_CHIRP_START_HZ * t +
+                                                chirpRate * t * t / 2))) /
+        2;
+  }
+  adpcm_encode(adpcm_testSamples, ADPCM_TEST_SAMPLE_COUNT, adpcm_testData);
+
+  // Decode in refill-sized pieces, as sound_update() does.
+  adpcm_decoder_t decoder;
+  adpcm_initDecoder(&decoder, adpcm_testData, ADPCM_TEST_SAMPLE_COUNT);
+  uint32_t total = 0, decoded;
+  while ((decoded = adpcm_decode(&decoder, adpcm_testDecoded + total,
+                                 ADPCM_TEST_REFILL_SAMPLE_COUNT)) > 0)
+    total += decoded;
+  if (total != ADPCM_TEST_SAMPLE_COUNT) {
+    printf("Decoded %ld samples, expected %d.\n\r", (long)total,
+           ADPCM_TEST_SAMPLE_COUNT);
+    success = false;
+  }
+  double signal = 0.0, noise = 0.0;
+  for (uint32_t i = 0; i < ADPCM_TEST_SAMPLE_COUNT; i++) {
+    double error = adpcm_testDecoded[i] - adpcm_testSamples[i];
+    signal += (double)adpcm_testSamples[i] * adpcm_testSamples[i];
+    noise += error * error;
+  }
+  double snr = noise > 0.0 ? 10.0 * log10(signal / noise) : INFINITY;
+  printf("SNR %.1f dB, %ld bytes for %ld samples (%.2f:1).\n\r", snr,
+         (long)adpcm_getEncodedSize(ADPCM_TEST_SAMPLE_COUNT),
+         (long)ADPCM_TEST_SAMPLE_COUNT,
+         2.0 * ADPCM_TEST_SAMPLE_COUNT /
+             adpcm_getEncodedSize(ADPCM_TEST_SAMPLE_COUNT));
+  if (snr < ADPCM_TEST_MIN_SNR_DB) {
+    printf("SNR is below %.0f dB.\n\r", ADPCM_TEST_MIN_SNR_DB);
+    success = false;
+  }
+
+  // A block decodes on its own, from its header.
+  uint32_t block = ADPCM_TEST_SAMPLE_COUNT / ADPCM_BLOCK_SAMPLE_COUNT / 2;
+  uint32_t start = block * ADPCM_BLOCK_SAMPLE_COUNT;
+  int16_t blockSamples[ADPCM_TEST_REFILL_SAMPLE_COUNT];
+  adpcm_initDecoder(&decoder, adpcm_testData + block * ADPCM_BLOCK_SIZE,
+                    ADPCM_TEST_SAMPLE_COUNT - start);
+  adpcm_decode(&decoder, blockSamples, ADPCM_TEST_REFILL_SAMPLE_COUNT);
+  for (uint32_t i = 0; i < ADPCM_TEST_REFILL_SAMPLE_COUNT; i++)
+    if (blockSamples[i] != adpcm_testDecoded[start + i]) {
+      printf("Block %ld does not decode on its own.\n\r", (long)block);
+      success = false;
+      break;
+    }
+
+  // Cost of a refill: decoding against copying raw samples.
+  uint32_t refillCount = ADPCM_TEST_TIMING_COUNT *
+                         (ADPCM_TEST_SAMPLE_COUNT /
+                          ADPCM_TEST_REFILL_SAMPLE_COUNT);
+  uint64_t startTicks = intervalTimer_nowTicks();
+  for (uint32_t pass = 0; pass < ADPCM_TEST_TIMING_COUNT; pass++) {
+    adpcm_initDecoder(&decoder, adpcm_testData, ADPCM_TEST_SAMPLE_COUNT);
+    for (uint32_t i = 0; i < ADPCM_TEST_SAMPLE_COUNT;
+         i += ADPCM_TEST_REFILL_SAMPLE_COUNT)
+      adpcm_decode(&decoder, adpcm_testDecoded + i,
+                   ADPCM_TEST_REFILL_SAMPLE_COUNT);
+  }
+  uint64_t decodeTicks = intervalTimer_nowTicks() - startTicks;
+  startTicks = intervalTimer_nowTicks();
+  for (uint32_t pass = 0; pass < ADPCM_TEST_TIMING_COUNT; pass++)
+    for (uint32_t i = 0; i < ADPCM_TEST_SAMPLE_COUNT; i++)
+      ((volatile int16_t *)adpcm_testDecoded)[i] = adpcm_testSamples[i];
+  uint64_t copyTicks = intervalTimer_nowTicks() - startTicks;
+  printf("A refill of %d samples takes %ld ns to decode, %ld ns to copy "
+         "raw.\n\r",
+         ADPCM_TEST_REFILL_SAMPLE_COUNT,
+         (long)(intervalTimer_ticksToNs(decodeTicks) / refillCount),
+         (long)(intervalTimer_ticksToNs(copyTicks) / refillCount));
+  printf("adpcm_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
@@ -0,0 +1,65 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef ADPCM_H_
+#define ADPCM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// IMA-ADPCM sound assets: 4 bits per 16-bit sample. The sounds are encoded on
+// the host at build time by tools/sound_encode_adpcm.py, and decoded
+// incrementally here, so sound_update() only decodes the samples it is about
+// to mix.
+//
+// An asset is a sequence of blocks of ADPCM_BLOCK_SAMPLE_COUNT samples (the
+// last block may be shorter). A block starts with the decoder state for its
+// first sample: the predicted sample (int16, little-endian) and the step
+// index (uint8, then a pad byte). One 4-bit code per sample follows, low
+// nibble first. Decoding any block therefore only needs its header, and an
+// encoding error cannot spread past the end of a block.
+
+#define ADPCM_BLOCK_SAMPLE_COUNT 256
+#define ADPCM_BLOCK_HEADER_SIZE 4
+#define ADPCM_BLOCK_SIZE                                                       \
+  (ADPCM_BLOCK_HEADER_SIZE + ADPCM_BLOCK_SAMPLE_COUNT / 2)
+
+// State of an incremental decode.
+typedef struct {
+  const uint8_t *data; // The encoded asset.
+  uint32_t sampleCount;
+  uint32_t position; // Number of the next sample.
+  int32_t predictor;
+  int16_t stepIndex;
+} adpcm_decoder_t;
+
+// Returns the size in bytes of an encoded asset of sampleCount samples.
+uint32_t adpcm_getEncodedSize(uint32_t sampleCount);
+
+// Starts decoding an encoded asset from its first sample.
+void adpcm_initDecoder(adpcm_decoder_t *decoder, const uint8_t *data,
+                       uint32_t sampleCount);
+
+// Decodes up to count samples into samples[]. Returns the number decoded,
+// which is less than count only at the end of the asset.
+uint32_t adpcm_decode(adpcm_decoder_t *decoder, int16_t samples[],
+                      uint32_t count);
+
+// Encodes sampleCount samples into data[], which must hold
+// adpcm_getEncodedSize(sampleCount) bytes. Matches the build-time encoder;
+// used by the test.
+void adpcm_encode(const int16_t samples[], uint32_t sampleCount,
+                  uint8_t data[]);
+
+// Encodes and decodes a test signal, checks the signal-to-noise ratio and the
+// block headers, and prints the cost of decoding a FIFO refill against
+// copying raw samples. Returns true if the test passes.
+bool adpcm_runTest();
+
+#endif /* ADPCM_H_ */
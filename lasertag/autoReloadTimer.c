@@ -0,0 +1,45 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "autoReloadTimer.h"
+#include "timerWheel.h"
+#include "trigger.h"
+
+// Thin wrapper around a timerWheel timer; the callback reloads the shots.
+// The trigger calls autoReloadTimer_start() when the last shot is fired.
+
+static timerWheel_timer_t autoReloadTimer_timer;
+
+// Reloads the shots when the timer expires.
+static void autoReloadTimer_expire(__attribute__((unused)) void *context) {
+  trigger_setRemainingShotCount(AUTO_RELOAD_SHOT_VALUE);
+}
+
+// Need to init things.
+void autoReloadTimer_init() {
+  timerWheel_initTimer(&autoReloadTimer_timer, autoReloadTimer_expire, NULL);
+}
+
+// Calling this starts the timer. Does not restart a running timer.
+void autoReloadTimer_start() {
+  if (!timerWheel_running(&autoReloadTimer_timer))
+    timerWheel_start(&autoReloadTimer_timer, AUTO_RELOAD_EXPIRE_VALUE);
+}
+
+// Returns true if the timer is currently running.
+bool autoReloadTimer_running() {
+  return timerWheel_running(&autoReloadTimer_timer);
+}
+
+// Disables the autoReloadTimer and reinitializes it.
+void autoReloadTimer_cancel() { timerWheel_cancel(&autoReloadTimer_timer); }
+
+// Does nothing: isr_function() calls timerWheel_tick(), which does the
+// counting. Kept so existing callers still link.
+void autoReloadTimer_tick() {}
@@ -13,9 +13,9 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include "globalDefines.h"
 #include <stdbool.h>
 
-// The auto-reload timer is always looking at the remaining shot-count from the
-// trigger state-machine. When it goes to 0, it starts a configurable delay and
-// after the delay expires, it sets the remaining shots to a specific value.
+// The trigger state-machine calls autoReloadTimer_start() when the remaining
+// shot-count goes to 0. The timer then waits a configurable delay and, after
+// the delay expires, sets the remaining shots to a specific value.
 
 #ifndef AUTO_RELOAD_EXPIRE_VALUE
 // Default, Defined in terms of 100 kHz ticks.
@@ -39,7 +39,7 @@ bool autoReloadTimer_running();
 // Disables the autoReloadTimer and reinitializes it.
 void autoReloadTimer_cancel();
 
-// Standard tick function.
+// Does nothing; timerWheel_tick() does the counting (see timerWheel.h).
 void autoReloadTimer_tick();
 
 #endif /* AUTORELOADTIMER_H_ */
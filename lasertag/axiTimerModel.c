@@ -0,0 +1,183 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef ZYBO_BOARD
+
+#include "axiTimerModel.h"
+#include <stdio.h>
+
+// TCSR bits.
+#define AXI_TIMER_MODEL_UDT_MASK (1 << 1)
+#define AXI_TIMER_MODEL_GENT_MASK (1 << 2)
+#define AXI_TIMER_MODEL_ARHT_MASK (1 << 4)
+#define AXI_TIMER_MODEL_LOAD_MASK (1 << 5)
+#define AXI_TIMER_MODEL_ENT_MASK (1 << 7)
+#define AXI_TIMER_MODEL_TINT_MASK (1 << 8)
+#define AXI_TIMER_MODEL_PWMA_MASK (1 << 9)
+#define AXI_TIMER_MODEL_ENALL_MASK (1 << 10)
+#define AXI_TIMER_MODEL_PWM_MASK                                               \
+  (AXI_TIMER_MODEL_PWMA_MASK | AXI_TIMER_MODEL_GENT_MASK |                     \
+   AXI_TIMER_MODEL_ENT_MASK)
+
+#define AXI_TIMER_MODEL_COUNTER_COUNT 2
+
+// State of one of the two counters.
+typedef struct {
+  uint32_t tcsr;
+  uint32_t tlr;
+  uint32_t tcr;
+  bool expired; // Counter reached its terminal count on the previous clock.
+} axiTimerModel_counter_t;
+
+static axiTimerModel_counter_t
+    axiTimerModel_counters[AXI_TIMER_MODEL_COUNTER_COUNT];
+static bool axiTimerModel_pwmOutput = false;
+
+// Clears all registers and stops the counters.
+void axiTimerModel_reset() {
+  for (uint16_t i = 0; i < AXI_TIMER_MODEL_COUNTER_COUNT; i++) {
+    axiTimerModel_counters[i].tcsr = 0;
+    axiTimerModel_counters[i].tlr = 0;
+    axiTimerModel_counters[i].tcr = 0;
+    axiTimerModel_counters[i].expired = false;
+  }
+  axiTimerModel_pwmOutput = false;
+}
+
+// Returns the counter addressed by a register offset (0x00-0x0C or 0x10-0x1C).
+static axiTimerModel_counter_t *axiTimerModel_getCounter(uint32_t offset) {
+  return &axiTimerModel_counters[(offset >> 4) & 1];
+}
+
+// Returns true if both counters are enabled and set up for PWM.
+static bool axiTimerModel_isPwmMode() {
+  return (axiTimerModel_counters[0].tcsr & AXI_TIMER_MODEL_PWM_MASK) ==
+             AXI_TIMER_MODEL_PWM_MASK &&
+         (axiTimerModel_counters[1].tcsr & AXI_TIMER_MODEL_PWM_MASK) ==
+             AXI_TIMER_MODEL_PWM_MASK;
+}
+
+// Writes a timer register.
+void axiTimerModel_writeRegister(uint32_t offset, uint32_t value) {
+  axiTimerModel_counter_t *counter = axiTimerModel_getCounter(offset);
+  switch (offset & 0xF) {
+  case AXI_TIMER_MODEL_TCSR0_OFFSET:
+    // TINT is cleared by writing a 1 to it.
+    if (value & AXI_TIMER_MODEL_TINT_MASK)
+      value &= ~AXI_TIMER_MODEL_TINT_MASK;
+    else
+      value |= counter->tcsr & AXI_TIMER_MODEL_TINT_MASK;
+    counter->tcsr = value;
+    if (value & AXI_TIMER_MODEL_LOAD_MASK) {
+      counter->tcr = counter->tlr;
+      counter->expired = false;
+    }
+    // ENALL enables both counters at once.
+    if (value & AXI_TIMER_MODEL_ENALL_MASK)
+      for (uint16_t i = 0; i < AXI_TIMER_MODEL_COUNTER_COUNT; i++)
+        axiTimerModel_counters[i].tcsr |= AXI_TIMER_MODEL_ENT_MASK;
+    if (axiTimerModel_isPwmMode()) {
+      // The first period starts as soon as the counters are enabled.
+      if (!axiTimerModel_pwmOutput) {
+        axiTimerModel_pwmOutput = true;
+        axiTimerModel_counters[1].tcr = axiTimerModel_counters[1].tlr;
+      }
+    } else {
+      axiTimerModel_pwmOutput = false;
+    }
+    break;
+  case AXI_TIMER_MODEL_TLR0_OFFSET:
+    counter->tlr = value;
+    break;
+  case AXI_TIMER_MODEL_TCR0_OFFSET: // Read only.
+    break;
+  default:
+    printf("axiTimerModel: write to unknown offset 0x%lx.\n\r",
+           (unsigned long)offset);
+    break;
+  }
+}
+
+// Reads a timer register.
+uint32_t axiTimerModel_readRegister(uint32_t offset) {
+  axiTimerModel_counter_t *counter = axiTimerModel_getCounter(offset);
+  switch (offset & 0xF) {
+  case AXI_TIMER_MODEL_TCSR0_OFFSET:
+    return counter->tcsr;
+  case AXI_TIMER_MODEL_TLR0_OFFSET:
+    return counter->tlr;
+  case AXI_TIMER_MODEL_TCR0_OFFSET:
+    return counter->tcr;
+  default:
+    printf("axiTimerModel: read from unknown offset 0x%lx.\n\r",
+           (unsigned long)offset);
+    return 0;
+  }
+}
+
+// Advances one counter by a clock. Returns true if it reloaded.
+static bool axiTimerModel_clockCounter(axiTimerModel_counter_t *counter) {
+  if (!(counter->tcsr & AXI_TIMER_MODEL_ENT_MASK))
+    return false;
+  if (counter->expired) {
+    counter->expired = false;
+    if (counter->tcsr & AXI_TIMER_MODEL_ARHT_MASK) {
+      counter->tcr = counter->tlr;
+      return true;
+    }
+    counter->tcsr &= ~AXI_TIMER_MODEL_ENT_MASK; // One-shot: hold.
+    return false;
+  }
+  bool terminalCount;
+  if (counter->tcsr & AXI_TIMER_MODEL_UDT_MASK) {
+    terminalCount = (counter->tcr == 0);
+    if (!terminalCount)
+      counter->tcr--;
+  } else {
+    terminalCount = (counter->tcr == UINT32_MAX);
+    if (!terminalCount)
+      counter->tcr++;
+  }
+  if (terminalCount) {
+    counter->expired = true;
+    counter->tcsr |= AXI_TIMER_MODEL_TINT_MASK;
+  }
+  return false;
+}
+
+// Advances the timer by the given number of clocks.
+void axiTimerModel_advance(uint32_t clocks) {
+  bool pwmMode = axiTimerModel_isPwmMode();
+  axiTimerModel_counter_t *counter0 = &axiTimerModel_counters[0];
+  axiTimerModel_counter_t *counter1 = &axiTimerModel_counters[1];
+  for (uint32_t i = 0; i < clocks; i++) {
+    if (!pwmMode) {
+      axiTimerModel_clockCounter(counter0);
+      axiTimerModel_clockCounter(counter1);
+      continue;
+    }
+    // Counter 1 holds at its terminal count until counter 0 reloads it.
+    if (counter1->expired) {
+      counter1->expired = false;
+      axiTimerModel_pwmOutput = false;
+    } else if (axiTimerModel_pwmOutput) {
+      axiTimerModel_clockCounter(counter1);
+    }
+    if (axiTimerModel_clockCounter(counter0)) {
+      counter1->tcr = counter1->tlr;
+      counter1->expired = false;
+      axiTimerModel_pwmOutput = true;
+    }
+  }
+}
+
+// Returns the level of the PWM0 output.
+bool axiTimerModel_getPwmOutput() { return axiTimerModel_pwmOutput; }
+
+#endif /* ZYBO_BOARD */
@@ -0,0 +1,52 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef AXITIMERMODEL_H_
+#define AXITIMERMODEL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Register-level model of one AXI timer (PG079) for the emulator, which has no
+// timer hardware behind Xil_In32()/Xil_Out32(). Only built when ZYBO_BOARD is
+// not defined. The model covers what the transmitter PWM backend uses:
+// - TCSR0/TLR0/TCR0 and TCSR1/TLR1/TCR1, with the LOAD, ENT, ENALL, UDT, ARHT,
+//   GENT and PWMA bits.
+// - Down counting with auto-reload: a counter loaded with TLR expires after
+//   TLR + 2 clocks (count to 0, expire, reload).
+// - PWM mode (PWMA and GENT set on both counters): PWM0 goes high each time
+//   counter 0 reloads, which also reloads counter 1, and goes low the clock
+//   after counter 1 expires. The period is TLR0 + 2 clocks and the high time
+//   TLR1 + 2 clocks, as in the data sheet. PWM0 is low while the timer is
+//   disabled.
+// Register offsets are relative to the base address of the modelled timer.
+
+#define AXI_TIMER_MODEL_TCSR0_OFFSET 0x00
+#define AXI_TIMER_MODEL_TLR0_OFFSET 0x04
+#define AXI_TIMER_MODEL_TCR0_OFFSET 0x08
+#define AXI_TIMER_MODEL_TCSR1_OFFSET 0x10
+#define AXI_TIMER_MODEL_TLR1_OFFSET 0x14
+#define AXI_TIMER_MODEL_TCR1_OFFSET 0x18
+
+// Clears all registers and stops the counters.
+void axiTimerModel_reset();
+
+// Writes a timer register.
+void axiTimerModel_writeRegister(uint32_t offset, uint32_t value);
+
+// Reads a timer register.
+uint32_t axiTimerModel_readRegister(uint32_t offset);
+
+// Advances the timer by the given number of clocks.
+void axiTimerModel_advance(uint32_t clocks);
+
+// Returns the level of the PWM0 output.
+bool axiTimerModel_getPwmOutput();
+
+#endif /* AXITIMERMODEL_H_ */
@@ -0,0 +1,133 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "cicFilter.h"
+#include "filter.h"
+#include "queue.h"
+#include <math.h>
+
+// DC gain of the CIC is R^N (5^4 = 625). It is removed, together with the
+// input full-scale, by a single multiply on the decimated output.
+#define CIC_FILTER_GAIN 625
+#define CIC_FILTER_OUTPUT_SCALE                                                \
+  (1.0 / ((double)CIC_FILTER_GAIN * CIC_FILTER_INPUT_FULL_SCALE))
+
+// Least-squares design at 20 kHz: passband to 4.2 kHz shaped by the inverse of
+// the CIC response, stopband from 5.5 kHz.
+static const double
+    cicFilter_compensatingFirCoefficients
+        [CIC_FILTER_COMPENSATING_FIR_COEFFICIENT_COUNT] = {
+            -5.5476601173e-04, -1.0908283007e-02, -8.8454426644e-03,
+            1.5614313317e-02,  2.0888917081e-02,  -2.0065610871e-02,
+            -3.9915875162e-02, 2.2657947112e-02,  7.1934053853e-02,
+            -1.9373973428e-02, -1.3602796080e-01, -1.1164225578e-02,
+            3.3991718858e-01,  5.3787420768e-01,  3.3991718858e-01,
+            -1.1164225578e-02, -1.3602796080e-01, -1.9373973428e-02,
+            7.1934053853e-02,  2.2657947112e-02,  -3.9915875162e-02,
+            -2.0065610871e-02, 2.0888917081e-02,  1.5614313317e-02,
+            -8.8454426644e-03, -1.0908283007e-02, -5.5476601173e-04};
+
+// Integrator and comb state. Unsigned so that wrap-around is well defined; the
+// final comb output is correct modulo 2^32 as long as it fits in 32 bits.
+static uint32_t cicFilter_integrators[CIC_FILTER_ORDER];
+static uint32_t cicFilter_combDelays[CIC_FILTER_ORDER];
+static uint16_t cicFilter_cicDecimationCount = 0;
+static uint16_t cicFilter_firDecimationCount = 0;
+
+// FIR history is written twice so that the newest
+// CIC_FILTER_COMPENSATING_FIR_COEFFICIENT_COUNT values are always contiguous.
+static double
+    cicFilter_firHistory[2 * CIC_FILTER_COMPENSATING_FIR_COEFFICIENT_COUNT];
+static uint16_t cicFilter_firHistoryIndex = 0;
+
+static double cicFilter_output = 0.0;
+
+// Must call this prior to using any cicFilter functions.
+void cicFilter_init() {
+  for (uint16_t i = 0; i < CIC_FILTER_ORDER; i++) {
+    cicFilter_integrators[i] = 0;
+    cicFilter_combDelays[i] = 0;
+  }
+  for (uint16_t i = 0; i < 2 * CIC_FILTER_COMPENSATING_FIR_COEFFICIENT_COUNT;
+       i++)
+    cicFilter_firHistory[i] = 0.0;
+  cicFilter_cicDecimationCount = 0;
+  cicFilter_firDecimationCount = 0;
+  cicFilter_firHistoryIndex = 0;
+  cicFilter_output = 0.0;
+}
+
+// Runs the compensating FIR over the newest history values.
+static double cicFilter_compensatingFirFilter() {
+  const double *x = &cicFilter_firHistory[cicFilter_firHistoryIndex];
+  double y = 0.0;
+  for (uint16_t i = 0; i < CIC_FILTER_COMPENSATING_FIR_COEFFICIENT_COUNT; i++)
+    y += cicFilter_compensatingFirCoefficients[i] * x[i];
+  return y * CIC_FILTER_OUTPUT_SCALE;
+}
+
+// Adds one raw sample at the 100 kHz input rate. Returns true when a new
+// output has been pushed onto the yQueue.
+bool cicFilter_addNewInput(int32_t x) {
+  // Integrators run at the full input rate.
+  uint32_t value = (uint32_t)x;
+  for (uint16_t i = 0; i < CIC_FILTER_ORDER; i++) {
+    cicFilter_integrators[i] += value;
+    value = cicFilter_integrators[i];
+  }
+  if (++cicFilter_cicDecimationCount < CIC_FILTER_DECIMATION_FACTOR)
+    return false;
+  cicFilter_cicDecimationCount = 0;
+  // Combs run at the CIC output rate.
+  for (uint16_t i = 0; i < CIC_FILTER_ORDER; i++) {
+    uint32_t delayed = cicFilter_combDelays[i];
+    cicFilter_combDelays[i] = value;
+    value -= delayed;
+  }
+  // Push the CIC output into the (mirrored) compensating FIR history.
+  double cicOutput = (double)(int32_t)value;
+  if (cicFilter_firHistoryIndex == 0)
+    cicFilter_firHistoryIndex = CIC_FILTER_COMPENSATING_FIR_COEFFICIENT_COUNT;
+  cicFilter_firHistoryIndex--;
+  cicFilter_firHistory[cicFilter_firHistoryIndex] = cicOutput;
+  cicFilter_firHistory[cicFilter_firHistoryIndex +
+                       CIC_FILTER_COMPENSATING_FIR_COEFFICIENT_COUNT] =
+      cicOutput;
+  if (++cicFilter_firDecimationCount <
+      CIC_FILTER_COMPENSATING_FIR_DECIMATION_FACTOR)
+    return false;
+  cicFilter_firDecimationCount = 0;
+  cicFilter_output = cicFilter_compensatingFirFilter();
+  queue_overwritePush(filter_getYQueue(), cicFilter_output);
+  return true;
+}
+
+// Returns the most recently computed output.
+double cicFilter_getOutput() { return cicFilter_output; }
+
+// Returns the array of compensating FIR coefficients.
+const double *cicFilter_getCompensatingFirCoefficientArray() {
+  return cicFilter_compensatingFirCoefficients;
+}
+
+// Runs filter_init() and then cicFilter_init(), so that the CIC and
+// the caller's decimation count start together.
+void cicFilter_filterInit() {
+  filter_init();
+  cicFilter_init();
+}
+
+// Feeds a scaled ADC value to the CIC as signed ADC counts.
+void cicFilter_filterAddNewInput(double x) {
+  cicFilter_addNewInput(lround(x * (CIC_FILTER_INPUT_FULL_SCALE - 1)));
+}
+
+// Returns the newest output; cicFilter_addNewInput() already pushed it onto
+// the yQueue.
+double cicFilter_filterGetOutput() { return cicFilter_output; }
@@ -0,0 +1,64 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef CICFILTER_H_
+#define CICFILTER_H_
+
+#include "filter.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Optional replacement for the 100 kHz decimating FIR filter. Enabled by
+// defining FILTER_CIC_PRE_DECIMATOR in filter.h; detector.c then calls the
+// cicFilter_filter*() functions below in place of filter_init(),
+// filter_addNewInput() and filter_firFilter().
+// 1. A cascaded integrator-comb (CIC) filter runs on every raw sample and
+// decimates by CIC_FILTER_DECIMATION_FACTOR using only integer adds/subtracts.
+// 2. A short compensating FIR filter runs at the CIC output rate, flattens the
+// CIC passband droop, removes the remaining aliases and decimates by
+// CIC_FILTER_COMPENSATING_FIR_DECIMATION_FACTOR.
+// The overall decimation is FILTER_FIR_DECIMATION_FACTOR so the output rate
+// matches what the IIR filters expect. Each output is pushed onto the filter's
+// yQueue so that filter_iirFilter() can be invoked exactly as before.
+
+#define CIC_FILTER_ORDER 4 // Number of integrator and comb stages.
+#define CIC_FILTER_DECIMATION_FACTOR 5 // CIC decimates 100 kHz to 20 kHz.
+#define CIC_FILTER_COMPENSATING_FIR_DECIMATION_FACTOR                          \
+  (FILTER_FIR_DECIMATION_FACTOR /                                              \
+   CIC_FILTER_DECIMATION_FACTOR) // FIR decimates 20 kHz to 10 kHz.
+#define CIC_FILTER_COMPENSATING_FIR_COEFFICIENT_COUNT 27
+// Inputs are signed ADC counts; this input maps to an output of 1.0.
+#define CIC_FILTER_INPUT_FULL_SCALE 2048
+
+// Must call this prior to using any cicFilter functions.
+// Clears all integrator, comb and FIR state.
+void cicFilter_init();
+
+// Adds one raw sample (signed ADC counts, centered on 0) at the 100 kHz input
+// rate. Returns true once every FILTER_FIR_DECIMATION_FACTOR inputs, when a new
+// output has been computed and pushed onto the yQueue (see filter.h).
+bool cicFilter_addNewInput(int32_t x);
+
+// Returns the most recently computed output, scaled so that an input of
+// CIC_FILTER_INPUT_FULL_SCALE produces 1.0.
+double cicFilter_getOutput();
+
+// Returns the array of compensating FIR coefficients.
+const double *cicFilter_getCompensatingFirCoefficientArray();
+
+// detector.c calls these in place of filter_init(), filter_addNewInput() and
+// filter_firFilter() when FILTER_CIC_PRE_DECIMATOR is defined.
+// Runs filter_init() and then cicFilter_init().
+void cicFilter_filterInit();
+// Feeds a scaled ADC value (-1.0 to 1.0) to the CIC as signed ADC counts.
+void cicFilter_filterAddNewInput(double x);
+// Returns the newest output; it is already on the yQueue.
+double cicFilter_filterGetOutput();
+
+#endif /* CICFILTER_H_ */
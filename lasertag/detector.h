@@ -33,6 +33,21 @@ typedef uint16_t detector_hitCount_t;
 typedef detector_status_t (*sortTestFunctionPtr)(bool, uint32_t, uint32_t,
                                                  double[], double[], bool);
 
+// With FILTER_CIC_PRE_DECIMATOR defined in filter.h, detector_init() calls
+// cicFilter_filterInit() in place of filter_init(), and detector() calls
+// cicFilter_filterAddNewInput() and cicFilter_filterGetOutput() in place of
+// filter_addNewInput() and filter_firFilter() (see cicFilter.h). The IIR
+// filters and the power computation are called as before.
+
+// Shooter mode logs the player ID of each hit (playerId.h). For it to decode
+// one, detector() passes the ten filter_iirFilter() outputs of each decimated
+// sample to playerId_addIirOutputs(), right after running the IIR filters.
+
+// Shooter mode also reports hit latencies (hitLatency.h). For those, detector()
+// passes each scaled sample it removes from the ADC buffer to
+// hitLatency_sampleDequeued(), and isr.c calls hitLatency_sampleQueued() (see
+// isr.h).
+
 // Always have to init things.
 // bool array is indexed by frequency number, array location set for true to
 // ignore, false otherwise. This way you can ignore multiple frequencies.
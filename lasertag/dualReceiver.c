@@ -0,0 +1,312 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "dualReceiver.h"
+#include "detector.h"
+#include "filter.h"
+#include <stdio.h>
+
+#ifdef ZYBO_BOARD
+#include "interrupts.h"
+#include "xparameters.h"
+#include "xsysmon.h"
+#endif
+
+#define DUAL_RECEIVER_ADC_BUFFER_MASK (DUAL_RECEIVER_ADC_BUFFER_SIZE - 1)
+#define DUAL_RECEIVER_XADC_DATA_SHIFT 4 // 12-bit result is left-justified.
+#define DUAL_RECEIVER_XADC_BASEADDR XPAR_SYSMON_0_BASEADDR
+
+// Interleaved ADC buffer: pair i is stored at [2*i] (front) and [2*i+1]
+// (back). The ISR only writes indexIn, the main loop only writes indexOut.
+// The XADC results are 12 bits, so 16 bits per sample is enough.
+static uint16_t
+    dualReceiver_adcBuffer[DUAL_RECEIVER_ADC_BUFFER_SIZE * DUAL_RECEIVER_COUNT];
+static volatile uint32_t dualReceiver_adcBufferIndexIn = 0;
+static volatile uint32_t dualReceiver_adcBufferIndexOut = 0;
+
+// Filter state for one receiver: its own copy of each of filter.c's queues,
+// allocated the same size. The filter_ functions run on it while it is
+// swapped into filter.c (see dualReceiver_swapQueues()).
+typedef struct {
+  queue_t xQueue;
+  queue_t yQueue;
+  queue_t zQueues[FILTER_FREQUENCY_COUNT];
+  queue_t outputQueues[FILTER_FREQUENCY_COUNT];
+  // Kept here, as filter.c's incremental power state cannot be swapped.
+  double currentPower[FILTER_FREQUENCY_COUNT];
+} dualReceiver_receiverState_t;
+
+static dualReceiver_receiverState_t dualReceiver_receivers[DUAL_RECEIVER_COUNT];
+static bool dualReceiver_queuesAllocated = false;
+
+static dualReceiver_combining_t dualReceiver_combining =
+    dualReceiver_selectionCombining_e;
+
+#ifdef ZYBO_BOARD
+// Sets the sequencer mode in configuration register 1, keeping its other bits.
+static void dualReceiver_setSequencerMode(uint32_t mode) {
+  uint32_t cfr1 =
+      XSysMon_ReadReg(DUAL_RECEIVER_XADC_BASEADDR, XSM_CFR1_OFFSET) &
+      ~XSM_CFR1_SEQ_VALID_MASK;
+  XSysMon_WriteReg(DUAL_RECEIVER_XADC_BASEADDR, XSM_CFR1_OFFSET,
+                   cfr1 | (mode << XSM_CFR1_SEQ_SHIFT));
+}
+
+// Programs the XADC sequencer to continuously convert aux channels 14 and 15.
+// The XADC is driven by interrupts.c, whose XSysMon instance is private to
+// it, so this goes through the registers rather than a second instance. Only
+// the channel sequence changes: interrupts.c keeps its interrupts and
+// interrupts_getAdcData() still reads channel 14.
+static void dualReceiver_initXadc() {
+  dualReceiver_setSequencerMode(XSM_SEQ_MODE_SAFE);
+  XSysMon_WriteReg(DUAL_RECEIVER_XADC_BASEADDR, XSM_SEQ00_OFFSET, 0);
+  XSysMon_WriteReg(DUAL_RECEIVER_XADC_BASEADDR, XSM_SEQ01_OFFSET,
+                   (XSM_SEQ_CH_AUX14 | XSM_SEQ_CH_AUX15) >>
+                       XSM_SEQ_CH_AUX_SHIFT);
+  dualReceiver_setSequencerMode(XSM_SEQ_MODE_CONTINPASS);
+}
+
+// Returns the latest conversion of an XADC channel.
+static uint16_t dualReceiver_readXadc(uint8_t channel) {
+  return XSysMon_ReadReg(DUAL_RECEIVER_XADC_BASEADDR,
+                         XSM_TEMP_OFFSET + (channel << 2)) >>
+         DUAL_RECEIVER_XADC_DATA_SHIFT;
+}
+#endif
+
+// Allocates a receiver's queue the size of filter.c's, the first time, and
+// fills it with zeros.
+static void dualReceiver_initQueue(queue_t *q, queue_t *filterQueue) {
+  if (!dualReceiver_queuesAllocated)
+    queue_init(q, queue_size(filterQueue), queue_name(filterQueue));
+  filter_fillQueue(q, 0.0);
+}
+
+// Must call this prior to using any dualReceiver functions.
+void dualReceiver_init() {
+  for (uint16_t r = 0; r < DUAL_RECEIVER_COUNT; r++) {
+    dualReceiver_receiverState_t *rx = &dualReceiver_receivers[r];
+    dualReceiver_initQueue(&rx->xQueue, filter_getXQueue());
+    dualReceiver_initQueue(&rx->yQueue, filter_getYQueue());
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+      dualReceiver_initQueue(&rx->zQueues[f], filter_getZQueue(f));
+      dualReceiver_initQueue(&rx->outputQueues[f],
+                             filter_getIirOutputQueue(f));
+      rx->currentPower[f] = 0.0;
+    }
+  }
+  dualReceiver_queuesAllocated = true;
+  dualReceiver_adcBufferIndexIn = 0;
+  dualReceiver_adcBufferIndexOut = 0;
+#ifdef ZYBO_BOARD
+  dualReceiver_initXadc();
+#endif
+}
+
+// Selects the combining method.
+void dualReceiver_setCombining(dualReceiver_combining_t combining) {
+  dualReceiver_combining = combining;
+}
+
+// Adds one sample per receiver to the interleaved ADC buffer. When the buffer
+// is full the newest pair is dropped, as the single-channel ADC buffer does.
+void dualReceiver_addSamplePair(isr_AdcValue_t front, isr_AdcValue_t back) {
+  uint32_t indexIn = dualReceiver_adcBufferIndexIn;
+  if (indexIn - dualReceiver_adcBufferIndexOut >= DUAL_RECEIVER_ADC_BUFFER_SIZE)
+    return;
+  uint32_t slot =
+      (indexIn & DUAL_RECEIVER_ADC_BUFFER_MASK) * DUAL_RECEIVER_COUNT;
+  dualReceiver_adcBuffer[slot + DUAL_RECEIVER_FRONT] = front;
+  dualReceiver_adcBuffer[slot + DUAL_RECEIVER_BACK] = back;
+  dualReceiver_adcBufferIndexIn = indexIn + 1;
+}
+
+// Reads the latest conversion from both receivers (board only).
+void dualReceiver_sampleAdc() {
+#ifdef ZYBO_BOARD
+  dualReceiver_addSamplePair(dualReceiver_readXadc(XADC_AUX_CHANNEL_14),
+                             dualReceiver_readXadc(XADC_AUX_CHANNEL_15));
+#endif
+}
+
+// Returns the number of sample pairs waiting in the interleaved ADC buffer.
+uint32_t dualReceiver_adcBufferElementCount() {
+  return dualReceiver_adcBufferIndexIn - dualReceiver_adcBufferIndexOut;
+}
+
+// Exchanges two queues.
+static void dualReceiver_swapQueue(queue_t *a, queue_t *b) {
+  queue_t swapped = *a;
+  *a = *b;
+  *b = swapped;
+}
+
+// Exchanges a receiver's queues with filter.c's, so that the filter_
+// functions run on the receiver. A second call swaps them back.
+static void dualReceiver_swapQueues(dualReceiver_receiverState_t *rx) {
+  dualReceiver_swapQueue(filter_getXQueue(), &rx->xQueue);
+  dualReceiver_swapQueue(filter_getYQueue(), &rx->yQueue);
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    dualReceiver_swapQueue(filter_getZQueue(f), &rx->zQueues[f]);
+    dualReceiver_swapQueue(filter_getIirOutputQueue(f), &rx->outputQueues[f]);
+  }
+}
+
+// Runs one receiver's samples of the FILTER_FIR_DECIMATION_FACTOR pairs from
+// pair first through the filters, for one new set of power values.
+static void dualReceiver_runReceiver(uint16_t receiver, uint32_t first) {
+  dualReceiver_receiverState_t *rx = &dualReceiver_receivers[receiver];
+  dualReceiver_swapQueues(rx);
+  for (uint32_t i = first; i < first + FILTER_FIR_DECIMATION_FACTOR; i++)
+    filter_addNewInput(detector_getScaledAdcValue(
+        dualReceiver_adcBuffer[(i & DUAL_RECEIVER_ADC_BUFFER_MASK) *
+                                   DUAL_RECEIVER_COUNT +
+                               receiver]));
+  filter_firFilter();
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    // The output queue is full, so the new output pushes out the oldest.
+    double oldest = queue_readElementAt(filter_getIirOutputQueue(f), 0);
+    double newest = filter_iirFilter(f);
+    rx->currentPower[f] += newest * newest - oldest * oldest;
+  }
+  dualReceiver_swapQueues(rx);
+}
+
+// Drains up to DUAL_RECEIVER_BLOCK_SIZE pairs and runs the filters. Pairs
+// that do not make up a whole decimated sample are left for the next call.
+bool dualReceiver_run() {
+  uint32_t indexOut = dualReceiver_adcBufferIndexOut;
+  uint32_t available = dualReceiver_adcBufferIndexIn - indexOut;
+  if (available > DUAL_RECEIVER_BLOCK_SIZE)
+    available = DUAL_RECEIVER_BLOCK_SIZE;
+  available -= available % FILTER_FIR_DECIMATION_FACTOR;
+  for (uint32_t i = 0; i < available; i += FILTER_FIR_DECIMATION_FACTOR)
+    for (uint16_t r = 0; r < DUAL_RECEIVER_COUNT; r++)
+      dualReceiver_runReceiver(r, indexOut + i);
+  dualReceiver_adcBufferIndexOut = indexOut + available;
+  return available > 0;
+}
+
+// Copies the combined power values into powerValues[].
+void dualReceiver_getCombinedPowerValues(double powerValues[]) {
+  const double *frontPower =
+      dualReceiver_receivers[DUAL_RECEIVER_FRONT].currentPower;
+  const double *backPower =
+      dualReceiver_receivers[DUAL_RECEIVER_BACK].currentPower;
+  if (dualReceiver_combining == dualReceiver_selectionCombining_e) {
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+      powerValues[f] =
+          (frontPower[f] > backPower[f]) ? frontPower[f] : backPower[f];
+    return;
+  }
+  // Noise-weighted: the weakest channel on each receiver estimates its noise.
+  double frontNoise = frontPower[0], backNoise = backPower[0];
+  for (uint16_t f = 1; f < FILTER_FREQUENCY_COUNT; f++) {
+    if (frontPower[f] < frontNoise)
+      frontNoise = frontPower[f];
+    if (backPower[f] < backNoise)
+      backNoise = backPower[f];
+  }
+  if (frontNoise <= 0.0 || backNoise <= 0.0) { // No noise estimate yet.
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+      powerValues[f] = frontPower[f] + backPower[f];
+    return;
+  }
+  double frontWeight = 1.0 / frontNoise;
+  double backWeight = 1.0 / backNoise;
+  double normalization = 1.0 / (frontWeight + backWeight);
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+    powerValues[f] =
+        (frontWeight * frontPower[f] + backWeight * backPower[f]) *
+        normalization;
+}
+
+// Copies the power values for a single receiver into powerValues[].
+void dualReceiver_getReceiverPowerValues(uint16_t receiver,
+                                         double powerValues[]) {
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+    powerValues[f] = dualReceiver_receivers[receiver].currentPower[f];
+}
+
+// Returns the frequency number with the most power.
+static uint16_t dualReceiver_findMaxChannel(const double powerValues[]) {
+  uint16_t maxIndex = 0;
+  for (uint16_t f = 1; f < FILTER_FREQUENCY_COUNT; f++)
+    if (powerValues[f] > powerValues[maxIndex])
+      maxIndex = f;
+  return maxIndex;
+}
+
+#define DUAL_RECEIVER_TEST_FRONT_FREQUENCY 2
+#define DUAL_RECEIVER_TEST_BACK_FREQUENCY 7
+#define DUAL_RECEIVER_TEST_ADC_LOW 0
+#define DUAL_RECEIVER_TEST_ADC_HIGH 4095
+#define DUAL_RECEIVER_TEST_TICKS (FILTER_INPUT_PULSE_WIDTH * 10)
+// Feeds two synthetic square waves through the interleaved buffer.
+bool dualReceiver_runTest() {
+  printf("****************** dualReceiver_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  filter_init();
+  dualReceiver_init();
+  uint16_t frontPeriod =
+      filter_frequencyTickTable[DUAL_RECEIVER_TEST_FRONT_FREQUENCY];
+  uint16_t backPeriod =
+      filter_frequencyTickTable[DUAL_RECEIVER_TEST_BACK_FREQUENCY];
+  for (uint32_t tick = 0; tick < DUAL_RECEIVER_TEST_TICKS; tick++) {
+    isr_AdcValue_t front = ((tick % frontPeriod) < frontPeriod / 2)
+                               ? DUAL_RECEIVER_TEST_ADC_LOW
+                               : DUAL_RECEIVER_TEST_ADC_HIGH;
+    isr_AdcValue_t back = ((tick % backPeriod) < backPeriod / 2)
+                              ? DUAL_RECEIVER_TEST_ADC_LOW
+                              : DUAL_RECEIVER_TEST_ADC_HIGH;
+    dualReceiver_addSamplePair(front, back);
+    if (dualReceiver_adcBufferElementCount() >= DUAL_RECEIVER_BLOCK_SIZE)
+      dualReceiver_run();
+  }
+  while (dualReceiver_run())
+    ;
+  double powerValues[FILTER_FREQUENCY_COUNT];
+  dualReceiver_getReceiverPowerValues(DUAL_RECEIVER_FRONT, powerValues);
+  if (dualReceiver_findMaxChannel(powerValues) !=
+      DUAL_RECEIVER_TEST_FRONT_FREQUENCY) {
+    printf("front receiver did not peak on frequency %d.\n\r",
+           DUAL_RECEIVER_TEST_FRONT_FREQUENCY);
+    success = false;
+  }
+  dualReceiver_getReceiverPowerValues(DUAL_RECEIVER_BACK, powerValues);
+  if (dualReceiver_findMaxChannel(powerValues) !=
+      DUAL_RECEIVER_TEST_BACK_FREQUENCY) {
+    printf("back receiver did not peak on frequency %d.\n\r",
+           DUAL_RECEIVER_TEST_BACK_FREQUENCY);
+    success = false;
+  }
+  // Both combiners must keep both frequencies above every other channel.
+  for (uint16_t c = 0; c < 2; c++) {
+    dualReceiver_setCombining(c ? dualReceiver_noiseWeightedCombining_e
+                                : dualReceiver_selectionCombining_e);
+    dualReceiver_getCombinedPowerValues(powerValues);
+    double weaker = powerValues[DUAL_RECEIVER_TEST_FRONT_FREQUENCY];
+    if (powerValues[DUAL_RECEIVER_TEST_BACK_FREQUENCY] < weaker)
+      weaker = powerValues[DUAL_RECEIVER_TEST_BACK_FREQUENCY];
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+      if (f == DUAL_RECEIVER_TEST_FRONT_FREQUENCY ||
+          f == DUAL_RECEIVER_TEST_BACK_FREQUENCY)
+        continue;
+      if (powerValues[f] >= weaker) {
+        printf("%s combining: frequency %d is not below the received "
+               "frequencies.\n\r",
+               c ? "noise-weighted" : "selection", f);
+        success = false;
+      }
+    }
+  }
+  dualReceiver_setCombining(dualReceiver_selectionCombining_e);
+  printf("dualReceiver_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
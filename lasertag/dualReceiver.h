@@ -0,0 +1,100 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef DUALRECEIVER_H_
+#define DUALRECEIVER_H_
+
+#include "filter.h"
+#include "isr.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Receiver diversity for the 330 baseboard: XADC aux channels 14 (front) and
+// 15 (back) are both converted by the XADC sequencer. Every timer tick, the
+// ISR reads both conversions and stores them as one interleaved pair in the
+// dual-receiver ADC buffer (receiver 0, receiver 1, receiver 0, ...).
+// Enabled by defining ISR_DUAL_RECEIVER in isr.h, which says where isr.c and
+// detector.c call in.
+// The main loop drains the buffer in blocks and runs each receiver through
+// filter.c's own filter_addNewInput(), filter_firFilter() and
+// filter_iirFilter(). Each receiver has its own copy of filter.c's queues,
+// which are swapped in for the call (filter.h exposes them), so there is one
+// filter implementation and one set of coefficients. The power is kept per
+// receiver, incrementally, from the IIR output queue, which filter_iirFilter()
+// must push each output onto (as well as the zQueue). The per-channel powers
+// of the two receivers are then combined so that the detector sees a single
+// power value per user frequency.
+
+#define DUAL_RECEIVER_COUNT 2
+#define DUAL_RECEIVER_FRONT 0 // XADC aux channel 14 (JA1/JA7).
+#define DUAL_RECEIVER_BACK 1  // XADC aux channel 15 (JA3/JA9).
+
+// Pairs of samples held by the interleaved ADC buffer (must be a power of 2).
+// 164 ms at 100 kHz, more than the longest TFT update the main loop makes.
+#define DUAL_RECEIVER_ADC_BUFFER_SIZE 16384
+
+// Maximum number of pairs processed per call to dualReceiver_run(). A
+// multiple of FILTER_FIR_DECIMATION_FACTOR.
+#define DUAL_RECEIVER_BLOCK_SIZE 1000
+
+// How the per-receiver powers are combined into one value per channel.
+typedef enum {
+  // Take the larger of the two receivers' power on each channel.
+  dualReceiver_selectionCombining_e,
+  // Average the two receivers' powers, each weighted by the inverse of its
+  // noise floor (the weakest channel on that receiver).
+  dualReceiver_noiseWeightedCombining_e
+} dualReceiver_combining_t;
+
+// Must call this prior to using any dualReceiver functions.
+// filter_init() must already have been called, and sizes the receivers'
+// queues. On the board this also
+// programs the XADC sequencer to cycle continuously over aux channels 14/15;
+// interrupts_initAll() must already have set up the XADC.
+void dualReceiver_init();
+
+// Selects the combining method. Selection combining is the default.
+void dualReceiver_setCombining(dualReceiver_combining_t combining);
+
+// Call this from isr_function() in place of the single-channel ADC read.
+// Reads the latest conversion from both receivers and adds the pair to the
+// interleaved ADC buffer. Board only.
+void dualReceiver_sampleAdc();
+
+// Adds one sample per receiver to the interleaved ADC buffer.
+// Used by dualReceiver_sampleAdc() and to inject synthetic data.
+void dualReceiver_addSamplePair(isr_AdcValue_t front, isr_AdcValue_t back);
+
+// Returns the number of sample pairs waiting in the interleaved ADC buffer.
+uint32_t dualReceiver_adcBufferElementCount();
+
+// Drains up to DUAL_RECEIVER_BLOCK_SIZE pairs from the interleaved ADC buffer
+// and runs the filters for both receivers, a decimated sample at a time. The
+// buffer has a single producer (the ISR) and a single consumer, so interrupts
+// need not be disabled. Returns true if at least one new set of power values
+// was computed. filter.c's own queues are swapped out during the call, so it
+// must not be called from an interrupt that also uses the filter_ functions.
+bool dualReceiver_run();
+
+// Copies the combined power values (one per user frequency) into
+// powerValues[]. The detector uses these in place of
+// filter_getCurrentPowerValues().
+void dualReceiver_getCombinedPowerValues(double powerValues[]);
+
+// Copies the power values for a single receiver into powerValues[].
+void dualReceiver_getReceiverPowerValues(uint16_t receiver,
+                                         double powerValues[]);
+
+// Feeds two synthetic square-wave streams, one per receiver, through the
+// interleaved buffer and checks that each receiver responds on its own
+// frequency and that the combined power contains both. Runs on the board or
+// the emulator without an ADC. Returns true if the test passes.
+bool dualReceiver_runTest();
+
+#endif /* DUALRECEIVER_H_ */
@@ -20,6 +20,15 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #define FILTER_INPUT_PULSE_WIDTH                                               \
   2000 // This is the width of the pulse you are looking for, in terms of
        // decimated sample count.
+
+// Uncomment the line below to replace the decimating FIR filter with a CIC
+// pre-decimator followed by a shorter compensating FIR filter (cicFilter.h).
+//#define FILTER_CIC_PRE_DECIMATOR
+
+// With the CIC pre-decimator, detector.c calls cicFilter_filterInit(),
+// cicFilter_filterAddNewInput() and cicFilter_filterGetOutput() in place of
+// filter_init(), filter_addNewInput() and filter_firFilter() (see detector.h).
+// The functions below are unchanged.
 // These are the tick counts that are used to generate the user frequencies.
 // Not used in filter.h but are used to TEST the filter code.
 // Placed here for general access as they are essentially constant throughout
@@ -31,7 +31,13 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
  ****************************************************************************************************/
 //#define FILTER_TEST_STORE_OLD_VALUE_IN_QUEUE
 
+// The tests below check the decimating FIR filter, and use it as the
+// reference for the CIC pre-decimator (see filter.h).
+
 #include "filter.h"
+#ifdef FILTER_CIC_PRE_DECIMATOR
+#include "cicFilter.h"
+#endif
 #ifdef ADC_THROUGH_DETECTOR_FILTER_TEST
 #include "detector.h"
 #include "isr.h"
@@ -511,6 +517,93 @@ void filterTest_fillQueue(queue_t *q, double fillValue) {
   }
 }
 
+#ifdef FILTER_CIC_PRE_DECIMATOR
+// Runs the same square-wave test frequencies through the decimating FIR filter
+// and through the CIC pre-decimator + compensating FIR (cicFilter.c) and
+// compares the normalized responses. The CIC path passes if each user
+// frequency is within FILTER_TEST_CIC_PASSBAND_TOLERANCE_DB of the FIR path
+// and each frequency above the decimated Nyquist rate is attenuated at least
+// as well as the FIR path (within FILTER_TEST_CIC_ALIAS_TOLERANCE_DB). The CIC
+// response is plotted on the TFT. Returns true if the test passes.
+#define FILTER_TEST_CIC_PASSBAND_TOLERANCE_DB 2.0
+#define FILTER_TEST_CIC_ALIAS_TOLERANCE_DB 3.0
+// Frequencies with shorter periods alias after decimation.
+#define FILTER_TEST_DECIMATED_NYQUIST_TICK_COUNT                               \
+  (2 * FILTER_FIR_DECIMATION_FACTOR)
+#define FILTER_TEST_DB(x) (10.0 * log10(x))
+bool filterTest_runSquareWaveCicPowerTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n\r");
+    return false;
+  }
+  if (printMessageFlag)
+    printf("running filterTest_runSquareWaveCicPowerTest() - comparing CIC and "
+           "FIR frequency response.\n\r");
+  bool success = true; // Be optimistic.
+  double firPowerValues[FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT];
+  double cicPowerValues[FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT];
+  for (uint16_t testPeriodIndex = 0;
+       testPeriodIndex < FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT;
+       testPeriodIndex++) {
+    uint16_t currentPeriodTickCount =
+        filterTest_firTestTickCounts[testPeriodIndex];
+    filterTest_fillQueue(filter_getXQueue(), 0.0); // Start both paths clean.
+    cicFilter_init();
+    firDecimationCount = 0;
+    double firPower = 0.0;
+    double cicPower = 0.0;
+    uint32_t totalTickCount = 0;
+    while (totalTickCount < FILTER_TEST_PULSE_WIDTH_LENGTH) {
+      for (uint16_t freqTick = 0; freqTick < currentPeriodTickCount;
+           freqTick++) {
+        double filterValue =
+            computeFilterInput(freqTick, currentPeriodTickCount);
+        // FIR path.
+        filter_addNewInput(filterValue);
+        if (filterTest_decimatingFirFilter()) {
+          double firOutput =
+              filterTest_readMostRecentValueFromQueue(filter_getYQueue());
+          firPower += firOutput * firOutput;
+        }
+        // CIC path, fed with the equivalent signed ADC counts.
+        int32_t cicInput = filterValue * (CIC_FILTER_INPUT_FULL_SCALE - 1);
+        if (cicFilter_addNewInput(cicInput)) {
+          double cicOutput = cicFilter_getOutput();
+          cicPower += cicOutput * cicOutput;
+        }
+        totalTickCount++;
+      }
+    }
+    firPowerValues[testPeriodIndex] = firPower;
+    cicPowerValues[testPeriodIndex] = cicPower;
+  }
+  // Compare the normalized responses in dB.
+  double firMaxPower =
+      findMax(firPowerValues, FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT);
+  double cicMaxPower =
+      findMax(cicPowerValues, FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT);
+  for (uint16_t i = 0; i < FILTER_TEST_FIR_POWER_TEST_PERIOD_COUNT; i++) {
+    double firDb = FILTER_TEST_DB(firPowerValues[i] / firMaxPower);
+    double cicDb = FILTER_TEST_DB(cicPowerValues[i] / cicMaxPower);
+    bool pass = true;
+    if (i < FILTER_FREQUENCY_COUNT) // User frequencies must match.
+      pass = fabs(cicDb - firDb) <= FILTER_TEST_CIC_PASSBAND_TOLERANCE_DB;
+    else if (filterTest_firTestTickCounts[i] <
+             FILTER_TEST_DECIMATED_NYQUIST_TICK_COUNT) // Aliases rejected.
+      pass = cicDb <= firDb + FILTER_TEST_CIC_ALIAS_TOLERANCE_DB;
+    if (printMessageFlag || !pass)
+      printf("%5.2lf kHz: FIR %7.2lf dB, CIC %7.2lf dB %s\n\r",
+             ((double)FILTER_SAMPLE_FREQUENCY_IN_KHZ) /
+                 filterTest_firTestTickCounts[i],
+             firDb, cicDb, pass ? "" : "<-- FAILED");
+    success &= pass;
+  }
+  printf("Plotting CIC response to square-wave input.\n\r");
+  filterTest_plotFirFrequencyResponse(cicPowerValues);
+  return success;
+}
+#endif
+
 // Plots frequency response for the selected filterNumber against the 10
 // standard frequencies (square-wave). Plots the IIR power for a specific
 // filterNumber for the supplied iirPowerValues. IIR outputs are retrieved via
@@ -995,6 +1088,11 @@ bool filterTest_runTest() {
   // test frequencies. All frequencies are expressed as a square wave.
   filterTest_runSquareWaveFirPowerTest(PRINT_INFO_MESSAGES, PLOT_INPUT);
   utils_msDelay(FOUR_SECONDS); // Leave on the display for a couple of seconds.
+#ifdef FILTER_CIC_PRE_DECIMATOR
+  // Confirms that the CIC pre-decimator matches the FIR response above.
+  success &= filterTest_runSquareWaveCicPowerTest(PRINT_INFO_MESSAGES);
+  utils_msDelay(FOUR_SECONDS);
+#endif
   for (int i = 0; i < FILTER_FREQUENCY_COUNT;
        i++) { // Plot all 10 IIR filters against the test freqs.
     filterTest_runSquareWaveIirPowerTest(
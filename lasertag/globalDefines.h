@@ -0,0 +1,22 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef GLOBALDEFINES_H_
+#define GLOBALDEFINES_H_
+
+// Game-wide settings that override the defaults in the individual headers.
+// Uncomment and edit to change them.
+
+// Ticks (100 kHz) to wait before reloading the shots (see autoReloadTimer.h).
+//#define AUTO_RELOAD_EXPIRE_VALUE 300000
+
+// Shots available after a reload (see autoReloadTimer.h).
+//#define AUTO_RELOAD_SHOT_VALUE 10
+
+#endif /* GLOBALDEFINES_H_ */
@@ -0,0 +1,263 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "hitLatency.h"
+#include "intervalTimer.h"
+#include <math.h>
+#include <stdio.h>
+
+#define HIT_LATENCY_SAMPLE_RING_MASK (HIT_LATENCY_SAMPLE_RING_SIZE - 1)
+#define HIT_LATENCY_US_PER_MS 1000.0
+#define HIT_LATENCY_PERCENT 100
+
+// Queue timestamps, indexed by sequence number. Written by the ISR.
+static uint32_t hitLatency_queueTicks[HIT_LATENCY_SAMPLE_RING_SIZE];
+static volatile uint32_t hitLatency_queuedSequence = 0;
+static uint32_t hitLatency_dequeuedSequence = 0;
+
+// Pulse-start tracking, done as the detector removes samples.
+static uint32_t hitLatency_quietSampleCount = HIT_LATENCY_QUIET_SAMPLE_COUNT;
+static double hitLatency_dcLevel = 0.0; // Of the samples, a one-pole low-pass.
+static bool hitLatency_pulseStartValid = false;
+static uint32_t hitLatency_pulseStartSequence = 0;
+static uint32_t hitLatency_pulseStartQueueTick = 0;
+static uint32_t hitLatency_pulseStartDequeueTick = 0;
+
+static uint32_t hitLatency_histograms[HIT_LATENCY_KIND_COUNT]
+                                     [HIT_LATENCY_BIN_COUNT];
+static uint32_t hitLatency_measurementCount = 0;
+
+static const char *hitLatency_kindNames[HIT_LATENCY_KIND_COUNT] = {
+    "total", "queueing", "processing"};
+
+// Clears the histograms and the sample ring.
+void hitLatency_init() {
+  intervalTimer_startTimestampCounter();
+  hitLatency_queuedSequence = 0;
+  hitLatency_dequeuedSequence = 0;
+  hitLatency_quietSampleCount = HIT_LATENCY_QUIET_SAMPLE_COUNT;
+  hitLatency_dcLevel = 0.0;
+  hitLatency_pulseStartValid = false;
+  for (uint16_t kind = 0; kind < HIT_LATENCY_KIND_COUNT; kind++)
+    for (uint16_t bin = 0; bin < HIT_LATENCY_BIN_COUNT; bin++)
+      hitLatency_histograms[kind][bin] = 0;
+  hitLatency_measurementCount = 0;
+}
+
+// Timestamps the sample the ISR just queued.
+void hitLatency_sampleQueued() {
+  uint32_t sequence = hitLatency_queuedSequence;
+  hitLatency_queueTicks[sequence & HIT_LATENCY_SAMPLE_RING_MASK] =
+      intervalTimer_nowTicksLower32Inline();
+  hitLatency_queuedSequence = sequence + 1;
+}
+
+// Looks for the start of a pulse in the samples the detector removes. The
+// threshold applies to the sample less the DC level, i.e., high-passed.
+void hitLatency_sampleDequeued(double scaledValue) {
+  uint32_t sequence = hitLatency_dequeuedSequence++;
+  if (sequence == 0)
+    hitLatency_dcLevel = scaledValue; // Start from the first sample's level.
+  double acValue = scaledValue - hitLatency_dcLevel;
+  hitLatency_dcLevel += acValue / HIT_LATENCY_DC_SAMPLE_COUNT;
+  if (fabs(acValue) <= HIT_LATENCY_SAMPLE_THRESHOLD) {
+    if (hitLatency_quietSampleCount < HIT_LATENCY_QUIET_SAMPLE_COUNT)
+      hitLatency_quietSampleCount++;
+    return;
+  }
+  if (hitLatency_quietSampleCount == HIT_LATENCY_QUIET_SAMPLE_COUNT) {
+    uint32_t queueTick =
+        hitLatency_queueTicks[sequence & HIT_LATENCY_SAMPLE_RING_MASK];
+    // The ISR may have reused the slot if the ADC buffer is very deep.
+    hitLatency_pulseStartValid = hitLatency_queuedSequence - sequence <=
+                                 HIT_LATENCY_SAMPLE_RING_SIZE;
+    hitLatency_pulseStartSequence = sequence;
+    hitLatency_pulseStartQueueTick = queueTick;
+    hitLatency_pulseStartDequeueTick = intervalTimer_nowTicksLower32Inline();
+  }
+  hitLatency_quietSampleCount = 0;
+}
+
+// Returns the histogram bin for a number of ticks.
+static uint16_t hitLatency_getBin(uint32_t ticks) {
+  uint64_t bin = intervalTimer_ticksToUs(ticks) / HIT_LATENCY_BIN_WIDTH_US;
+  return bin < HIT_LATENCY_BIN_COUNT ? bin : HIT_LATENCY_BIN_COUNT - 1;
+}
+
+// Adds one measurement to the histograms.
+void hitLatency_addMeasurement(uint32_t queueingTicks,
+                               uint32_t processingTicks) {
+  hitLatency_histograms[HIT_LATENCY_TOTAL]
+                       [hitLatency_getBin(queueingTicks + processingTicks)]++;
+  hitLatency_histograms[HIT_LATENCY_QUEUEING]
+                       [hitLatency_getBin(queueingTicks)]++;
+  hitLatency_histograms[HIT_LATENCY_PROCESSING]
+                       [hitLatency_getBin(processingTicks)]++;
+  hitLatency_measurementCount++;
+}
+
+// Adds the latency of the current pulse to the histograms.
+bool hitLatency_hitDetected() {
+  if (!hitLatency_pulseStartValid)
+    return false;
+  hitLatency_pulseStartValid = false; // Only one hit per pulse.
+  uint32_t now = intervalTimer_nowTicksLower32Inline();
+  hitLatency_addMeasurement(
+      hitLatency_pulseStartDequeueTick - hitLatency_pulseStartQueueTick,
+      now - hitLatency_pulseStartDequeueTick);
+  return true;
+}
+
+// Returns the number of hits measured this session.
+uint32_t hitLatency_getMeasurementCount() {
+  return hitLatency_measurementCount;
+}
+
+// Returns a percentile of a latency kind in microseconds (the upper edge of
+// the bin it falls in).
+uint32_t hitLatency_getPercentileUs(uint16_t kind, uint16_t percentile) {
+  uint64_t target = ((uint64_t)hitLatency_measurementCount * percentile +
+                     HIT_LATENCY_PERCENT - 1) /
+                    HIT_LATENCY_PERCENT;
+  if (target == 0)
+    target = 1;
+  uint64_t count = 0;
+  for (uint16_t bin = 0; bin < HIT_LATENCY_BIN_COUNT; bin++) {
+    count += hitLatency_histograms[kind][bin];
+    if (count >= target)
+      return (bin + 1) * HIT_LATENCY_BIN_WIDTH_US;
+  }
+  return 0; // No measurements.
+}
+
+// Returns the sequence number of the sample that started the current pulse.
+uint32_t hitLatency_getPulseStartSequence() {
+  return hitLatency_pulseStartSequence;
+}
+
+// Fills buffer with a one-line summary of the total latency.
+void hitLatency_getSummary(char *buffer, uint32_t bufferSize) {
+  snprintf(buffer, bufferSize, "%ld hits, p50 %.2f p90 %.2f p99 %.2f ms",
+           (long)hitLatency_measurementCount,
+           hitLatency_getPercentileUs(HIT_LATENCY_TOTAL, 50) /
+               HIT_LATENCY_US_PER_MS,
+           hitLatency_getPercentileUs(HIT_LATENCY_TOTAL, 90) /
+               HIT_LATENCY_US_PER_MS,
+           hitLatency_getPercentileUs(HIT_LATENCY_TOTAL, 99) /
+               HIT_LATENCY_US_PER_MS);
+}
+
+// Prints the percentiles of each latency kind.
+void hitLatency_printStatistics() {
+  printf("Hit latency over %ld hits (us, to %d us):\n\r",
+         (long)hitLatency_measurementCount, HIT_LATENCY_BIN_WIDTH_US);
+  if (!hitLatency_measurementCount)
+    return;
+  printf("%-12s %8s %8s %8s %8s\n\r", "", "p50", "p90", "p99", "max");
+  for (uint16_t kind = 0; kind < HIT_LATENCY_KIND_COUNT; kind++)
+    printf("%-12s %8ld %8ld %8ld %8ld\n\r", hitLatency_kindNames[kind],
+           (long)hitLatency_getPercentileUs(kind, 50),
+           (long)hitLatency_getPercentileUs(kind, 90),
+           (long)hitLatency_getPercentileUs(kind, 99),
+           (long)hitLatency_getPercentileUs(kind, HIT_LATENCY_PERCENT));
+}
+
+#define HIT_LATENCY_TEST_QUIET_SAMPLES 1000
+#define HIT_LATENCY_TEST_PULSE_SAMPLES 500
+#define HIT_LATENCY_TEST_PULSE_AMPLITUDE 0.5
+#define HIT_LATENCY_TEST_DC_OFFSET 0.3 // Well above the threshold.
+#define HIT_LATENCY_TEST_DELAY_US 1000
+#define HIT_LATENCY_TEST_MEASUREMENTS 100
+#define HIT_LATENCY_TEST_STEP_US 100
+
+// Waits for the given number of microseconds.
+static void hitLatency_testDelay(uint32_t us) {
+  uint64_t start = intervalTimer_nowTicks();
+  while (intervalTimer_nowTicks() - start < intervalTimer_usToTicks(us))
+    ;
+}
+
+// Checks a percentile against the expected value, to one bin.
+static bool hitLatency_testPercentile(uint16_t percentile, uint32_t expected) {
+  uint32_t us = hitLatency_getPercentileUs(HIT_LATENCY_TOTAL, percentile);
+  if (us < expected || us > expected + HIT_LATENCY_BIN_WIDTH_US) {
+    printf("p%d is %ld us, expected %ld us.\n\r", percentile, (long)us,
+           (long)expected);
+    return false;
+  }
+  return true;
+}
+
+// Feeds a quiet gap and then a pulse, both around offset, through the hooks
+// and checks that exactly one hit is measured from the first pulse sample.
+static bool hitLatency_testPulse(double offset) {
+  bool success = true; // Be optimistic.
+  hitLatency_init();
+  // Quiet samples pass straight through the buffer.
+  for (uint16_t i = 0; i < HIT_LATENCY_TEST_QUIET_SAMPLES; i++) {
+    hitLatency_sampleQueued();
+    hitLatency_sampleDequeued(offset);
+  }
+  // The pulse waits in the buffer, is processed, and a hit follows later.
+  for (uint16_t i = 0; i < HIT_LATENCY_TEST_PULSE_SAMPLES; i++)
+    hitLatency_sampleQueued();
+  hitLatency_testDelay(HIT_LATENCY_TEST_DELAY_US);
+  for (uint16_t i = 0; i < HIT_LATENCY_TEST_PULSE_SAMPLES; i++) {
+    double amplitude = HIT_LATENCY_TEST_PULSE_AMPLITUDE;
+    hitLatency_sampleDequeued(offset + (i & 1 ? amplitude : -amplitude));
+  }
+  hitLatency_testDelay(HIT_LATENCY_TEST_DELAY_US);
+  if (!hitLatency_hitDetected() || hitLatency_hitDetected()) {
+    printf("Expected one measured hit for the pulse at %.2f.\n\r", offset);
+    success = false;
+  }
+  if (hitLatency_getPulseStartSequence() != HIT_LATENCY_TEST_QUIET_SAMPLES) {
+    printf("Pulse started at sample %ld, expected %d.\n\r",
+           (long)hitLatency_getPulseStartSequence(),
+           HIT_LATENCY_TEST_QUIET_SAMPLES);
+    success = false;
+  }
+  return success;
+}
+
+// Feeds synthetic samples and hits through the hooks.
+bool hitLatency_runTest() {
+  printf("****************** hitLatency_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  // The quiet gap must be found under a DC offset too.
+  success &= hitLatency_testPulse(HIT_LATENCY_TEST_DC_OFFSET);
+  success &= hitLatency_testPulse(0.0);
+  if (hitLatency_getPercentileUs(HIT_LATENCY_QUEUEING, 50) <
+          HIT_LATENCY_TEST_DELAY_US ||
+      hitLatency_getPercentileUs(HIT_LATENCY_PROCESSING, 50) <
+          HIT_LATENCY_TEST_DELAY_US) {
+    printf("Queueing %ld us and processing %ld us, expected at least %d.\n\r",
+           (long)hitLatency_getPercentileUs(HIT_LATENCY_QUEUEING, 50),
+           (long)hitLatency_getPercentileUs(HIT_LATENCY_PROCESSING, 50),
+           HIT_LATENCY_TEST_DELAY_US);
+    success = false;
+  }
+  hitLatency_printStatistics();
+
+  // Latencies of 100, 200, ... 10000 us.
+  hitLatency_init();
+  for (uint16_t i = 1; i <= HIT_LATENCY_TEST_MEASUREMENTS; i++)
+    hitLatency_addMeasurement(
+        intervalTimer_usToTicks(i * HIT_LATENCY_TEST_STEP_US), 0);
+  success &= hitLatency_testPercentile(50, 50 * HIT_LATENCY_TEST_STEP_US);
+  success &= hitLatency_testPercentile(90, 90 * HIT_LATENCY_TEST_STEP_US);
+  success &= hitLatency_testPercentile(99, 99 * HIT_LATENCY_TEST_STEP_US);
+  success &= hitLatency_testPercentile(
+      HIT_LATENCY_PERCENT,
+      HIT_LATENCY_TEST_MEASUREMENTS * HIT_LATENCY_TEST_STEP_US);
+  hitLatency_printStatistics();
+  hitLatency_init();
+  printf("hitLatency_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
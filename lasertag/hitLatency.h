@@ -0,0 +1,92 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef HITLATENCY_H_
+#define HITLATENCY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Measures how long a shot takes to register: from the first above-threshold
+// ADC sample of the pulse to detector_hitDetected(). The latency is split into
+// the queueing delay (sample waiting in the ADC buffer) and the processing
+// delay (from leaving the buffer to the hit). Latencies are collected in a
+// histogram over a session and reported as percentiles.
+//
+// Every sample gets a sequence number and a timestamp (the lower 32 bits of
+// intervalTimer_nowTicks()) when it is queued; these are kept in a ring next
+// to the ADC buffer, indexed by sequence number. Hooks:
+//  - isr_addDataToAdcBuffer() calls hitLatency_sampleQueued().
+//  - detector() calls hitLatency_sampleDequeued() with each scaled sample it
+//    removes from the ADC buffer.
+//  - The running mode calls hitLatency_hitDetected() when
+//    detector_hitDetected() returns true.
+// Shooter mode does the last one and reports the percentiles; the first two
+// go in isr.c and detector.c (see isr.h and detector.h). Without them shooter
+// mode reports no measured hits.
+// A pulse starts at the first sample that differs from the running DC level
+// by more than HIT_LATENCY_SAMPLE_THRESHOLD after at least
+// HIT_LATENCY_QUIET_SAMPLE_COUNT samples within it, so a DC offset or ambient
+// light does not hide the quiet gap before a shot.
+
+// Must be a power of two and larger than the deepest the ADC buffer gets.
+#define HIT_LATENCY_SAMPLE_RING_SIZE 4096
+#define HIT_LATENCY_SAMPLE_THRESHOLD 0.05 // Scaled ADC value, -1.0 to 1.0.
+#define HIT_LATENCY_DC_SAMPLE_COUNT 256 // Time constant of the DC level.
+#define HIT_LATENCY_QUIET_SAMPLE_COUNT 200 // 2 ms at 100 kHz.
+
+#define HIT_LATENCY_BIN_WIDTH_US 50
+#define HIT_LATENCY_BIN_COUNT 1024 // The last bin holds everything longer.
+
+// Latencies that are reported.
+#define HIT_LATENCY_TOTAL 0
+#define HIT_LATENCY_QUEUEING 1
+#define HIT_LATENCY_PROCESSING 2
+#define HIT_LATENCY_KIND_COUNT 3
+
+// Clears the histograms and the sample ring. Starts the timestamp counter.
+void hitLatency_init();
+
+// Called by the ISR each time a sample is added to the ADC buffer.
+void hitLatency_sampleQueued();
+
+// Called by the detector with each scaled sample removed from the ADC buffer.
+void hitLatency_sampleDequeued(double scaledValue);
+
+// Called when a hit is detected. Adds the latency of the current pulse to the
+// histograms. Returns false if no pulse start was seen or its timestamp has
+// already been overwritten in the ring.
+bool hitLatency_hitDetected();
+
+// Adds one measurement (in timestamp ticks) to the histograms.
+void hitLatency_addMeasurement(uint32_t queueingTicks,
+                               uint32_t processingTicks);
+
+// Returns the number of hits measured this session.
+uint32_t hitLatency_getMeasurementCount();
+
+// Returns the given percentile (0 - 100) of a latency kind in microseconds, to
+// the histogram's bin width.
+uint32_t hitLatency_getPercentileUs(uint16_t kind, uint16_t percentile);
+
+// Returns the sequence number of the sample that started the current pulse.
+uint32_t hitLatency_getPulseStartSequence();
+
+// Fills buffer with a one-line summary, e.g., for the statistics screen.
+void hitLatency_getSummary(char *buffer, uint32_t bufferSize);
+
+// Prints the percentiles of each latency kind.
+void hitLatency_printStatistics();
+
+// Feeds synthetic samples and hits through the hooks and checks the pulse
+// start, the split between queueing and processing and the percentiles.
+// Returns true if the test passes.
+bool hitLatency_runTest();
+
+#endif /* HITLATENCY_H_ */
@@ -0,0 +1,87 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "hitLedTimer.h"
+#include "drivers/buttons.h"
+#include "leds.h"
+#include "mio.h"
+#include "timerWheel.h"
+#include "utils.h"
+
+// Thin wrapper around a timerWheel timer; the callback turns the LED off.
+
+#define HIT_LED_TIMER_LED_ON 1
+#define HIT_LED_TIMER_LED_OFF 0
+#define HIT_LED_TIMER_TEST_OFF_TIME_MS 300
+
+static timerWheel_timer_t hitLedTimer_timer;
+static bool hitLedTimer_enabled = true;
+
+// Turns the LED off when the timer expires.
+static void hitLedTimer_expire(__attribute__((unused)) void *context) {
+  hitLedTimer_turnLedOff();
+}
+
+// Calling this starts the timer.
+void hitLedTimer_start() {
+  if (!hitLedTimer_enabled)
+    return;
+  hitLedTimer_turnLedOn();
+  timerWheel_start(&hitLedTimer_timer, HIT_LED_TIMER_EXPIRE_VALUE);
+}
+
+// Returns true if the timer is currently running.
+bool hitLedTimer_running() { return timerWheel_running(&hitLedTimer_timer); }
+
+// Does nothing: isr_function() calls timerWheel_tick(), which does the
+// counting. Kept so existing callers still link.
+void hitLedTimer_tick() {}
+
+// Need to init things.
+void hitLedTimer_init() {
+  mio_init(false);
+  mio_setPinAsOutput(HIT_LED_TIMER_OUTPUT_PIN);
+  timerWheel_initTimer(&hitLedTimer_timer, hitLedTimer_expire, NULL);
+  hitLedTimer_enabled = true;
+  hitLedTimer_turnLedOff();
+}
+
+// Turns the gun's hit-LED on.
+void hitLedTimer_turnLedOn() {
+  mio_writePin(HIT_LED_TIMER_OUTPUT_PIN, HIT_LED_TIMER_LED_ON);
+  leds_write(HIT_LED_TIMER_LED_ON); // LD0 mirrors the hit-LED.
+}
+
+// Turns the gun's hit-LED off.
+void hitLedTimer_turnLedOff() {
+  mio_writePin(HIT_LED_TIMER_OUTPUT_PIN, HIT_LED_TIMER_LED_OFF);
+  leds_write(HIT_LED_TIMER_LED_OFF);
+}
+
+// Disables the hitLedTimer.
+void hitLedTimer_disable() {
+  hitLedTimer_enabled = false;
+  timerWheel_cancel(&hitLedTimer_timer);
+  hitLedTimer_turnLedOff();
+}
+
+// Enables the hitLedTimer.
+void hitLedTimer_enable() { hitLedTimer_enabled = true; }
+
+// Blinks the hit-LED until BTN1 is pressed.
+void hitLedTimer_runTest() {
+  buttons_init();
+  hitLedTimer_init();
+  while (!(buttons_read() & BUTTONS_BTN1_MASK)) {
+    hitLedTimer_start();
+    while (hitLedTimer_running())
+      ;
+    utils_msDelay(HIT_LED_TIMER_TEST_OFF_TIME_MS);
+  }
+}
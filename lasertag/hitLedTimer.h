@@ -25,7 +25,7 @@ void hitLedTimer_start();
 // Returns true if the timer is currently running.
 bool hitLedTimer_running();
 
-// Standard tick function.
+// Does nothing; timerWheel_tick() does the counting (see timerWheel.h).
 void hitLedTimer_tick();
 
 // Need to init things.
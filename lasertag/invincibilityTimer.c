@@ -0,0 +1,40 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "invincibilityTimer.h"
+#include "timerWheel.h"
+
+// Thin wrapper around a timerWheel timer.
+
+#define INVINCIBILITY_TIMER_MAX_SECONDS                                        \
+  (UINT32_MAX / TIMER_WHEEL_TICKS_PER_SECOND)
+
+static timerWheel_timer_t invincibilityTimer_timer;
+
+// Calling this starts the timer.
+void invincibilityTimer_start(uint16_t seconds) {
+  if (seconds > INVINCIBILITY_TIMER_MAX_SECONDS)
+    seconds = INVINCIBILITY_TIMER_MAX_SECONDS;
+  timerWheel_start(&invincibilityTimer_timer,
+                   (uint32_t)seconds * TIMER_WHEEL_TICKS_PER_SECOND);
+}
+
+// Perform any necessary inits for the invincibility timer.
+void invincibilityTimer_init() {
+  timerWheel_initTimer(&invincibilityTimer_timer, NULL, NULL);
+}
+
+// Returns true if the timer is running.
+bool invincibilityTimer_running() {
+  return timerWheel_running(&invincibilityTimer_timer);
+}
+
+// Does nothing: isr_function() calls timerWheel_tick(), which does the
+// counting. Kept so existing callers still link.
+void invincibilityTimer_tick() {}
@@ -22,7 +22,7 @@ void invincibilityTimer_init();
 // Returns true if the timer is running.
 bool invincibilityTimer_running();
 
-// Standard tick function.
+// Does nothing; timerWheel_tick() does the counting (see timerWheel.h).
 void invincibilityTimer_tick();
 
 #endif /* INVINCIBILITYTIMER_H_ */
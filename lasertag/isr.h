@@ -14,6 +14,14 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 typedef uint32_t
     isr_AdcValue_t; // Used to represent ADC values in the ADC buffer.
 
+// Uncomment the line below to use both receivers (dualReceiver.h). isr_init()
+// then calls dualReceiver_init() and isr_function() calls
+// dualReceiver_sampleAdc() in place of
+// isr_addDataToAdcBuffer(interrupts_getAdcData()). detector() drains the
+// pairs with dualReceiver_run() and looks for hits in
+// dualReceiver_getCombinedPowerValues() in place of the filter_ power values.
+//#define ISR_DUAL_RECEIVER
+
 // isr provides the isr_function() where you will place functions that require
 // accurate timing. A buffer for storing values from the Analog to Digital
 // Converter (ADC) is implemented in isr.c Values are added to this buffer by
@@ -22,11 +30,18 @@ typedef uint32_t
 // Performs inits for anything in isr.c
 void isr_init();
 
-// This function is invoked by the timer interrupt at 100 kHz.
+// This function is invoked by the timer interrupt at 100 kHz. Call
+// sound_tick() from it on every tick: the I2S FIFO only holds 167 us of sound,
+// and sound_tick() refills it every SOUND_TICK_REFILL_PERIOD ticks (see
+// sound.h).
+// Call timerWheel_tick() from it once per tick; it runs the lockout, hit-LED,
+// auto-reload, invincibility and LED timers, whose *_tick() functions do
+// nothing (see timerWheel.h).
 void isr_function();
 
 // This adds data to the ADC queue. Data are removed from this queue and used by
-// the detector.
+// the detector. Call hitLatency_sampleQueued() after adding each value so
+// shooter mode can report hit latencies (see hitLatency.h).
 void isr_addDataToAdcBuffer(uint32_t adcData);
 
 // This removes a value from the ADC buffer.
@@ -0,0 +1,210 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "isrProfiler.h"
+#include <stdio.h>
+
+// PMCR bits.
+#define PMCR_ENABLE_MASK (1 << 0)              // Enable the counters.
+#define PMCR_CYCLE_COUNTER_RESET_MASK (1 << 2) // Zero the cycle counter.
+// PMCNTENSET bit for the cycle counter.
+#define PMCNTENSET_CYCLE_COUNTER_MASK (1U << 31)
+
+#define ISR_PROFILER_NS_PER_SECOND 1000000000.0
+
+// Statistics for one task.
+typedef struct {
+  uint32_t callCount;
+  uint32_t minCount;
+  uint32_t maxCount;
+  uint64_t totalCount;
+  uint32_t histogram[ISR_PROFILER_HISTOGRAM_BIN_COUNT];
+} isrProfiler_taskStatistics_t;
+
+static isrProfiler_taskStatistics_t
+    isrProfiler_statistics[ISR_PROFILER_TASK_COUNT];
+
+static const char *isrProfiler_taskNames[ISR_PROFILER_TASK_COUNT] = {
+    "adc push", "trigger", "transmitter", "sound", "timers"};
+
+// Starts the cycle counter (on the board) and clears the statistics.
+void isrProfiler_init() {
+#ifdef ZYBO_BOARD
+  mtcp(XREG_CP15_PERF_MONITOR_CTRL,
+       PMCR_ENABLE_MASK | PMCR_CYCLE_COUNTER_RESET_MASK);
+  mtcp(XREG_CP15_COUNT_ENABLE_SET, PMCNTENSET_CYCLE_COUNTER_MASK);
+#endif
+  isrProfiler_reset();
+}
+
+// Clears the statistics.
+void isrProfiler_reset() {
+  for (uint16_t task = 0; task < ISR_PROFILER_TASK_COUNT; task++) {
+    isrProfiler_taskStatistics_t *statistics = &isrProfiler_statistics[task];
+    statistics->callCount = 0;
+    statistics->minCount = UINT32_MAX;
+    statistics->maxCount = 0;
+    statistics->totalCount = 0;
+    for (uint16_t bin = 0; bin < ISR_PROFILER_HISTOGRAM_BIN_COUNT; bin++)
+      statistics->histogram[bin] = 0;
+  }
+}
+
+// Returns the histogram bin for a count: the index of its highest set bit.
+static uint16_t isrProfiler_getBin(uint32_t count) {
+  uint16_t bin = 0;
+  while (count >>= 1)
+    bin++;
+  return bin < ISR_PROFILER_HISTOGRAM_BIN_COUNT
+             ? bin
+             : ISR_PROFILER_HISTOGRAM_BIN_COUNT - 1;
+}
+
+// Adds one call of the given task that took count counts.
+void isrProfiler_record(uint16_t task, uint32_t count) {
+  isrProfiler_taskStatistics_t *statistics = &isrProfiler_statistics[task];
+  statistics->callCount++;
+  statistics->totalCount += count;
+  if (count < statistics->minCount)
+    statistics->minCount = count;
+  if (count > statistics->maxCount)
+    statistics->maxCount = count;
+  statistics->histogram[isrProfiler_getBin(count)]++;
+}
+
+// Returns the number of calls recorded for the task.
+uint32_t isrProfiler_getCallCount(uint16_t task) {
+  return isrProfiler_statistics[task].callCount;
+}
+
+// Returns the fewest counts a call of the task took.
+uint32_t isrProfiler_getMinCount(uint16_t task) {
+  return isrProfiler_statistics[task].callCount
+             ? isrProfiler_statistics[task].minCount
+             : 0;
+}
+
+// Returns the mean counts per call of the task.
+uint32_t isrProfiler_getMeanCount(uint16_t task) {
+  isrProfiler_taskStatistics_t *statistics = &isrProfiler_statistics[task];
+  return statistics->callCount
+             ? (uint32_t)(statistics->totalCount / statistics->callCount)
+             : 0;
+}
+
+// Returns the most counts a call of the task took.
+uint32_t isrProfiler_getMaxCount(uint16_t task) {
+  return isrProfiler_statistics[task].maxCount;
+}
+
+// Returns the number of calls that fell in the given histogram bin.
+uint32_t isrProfiler_getHistogramCount(uint16_t task, uint16_t bin) {
+  return isrProfiler_statistics[task].histogram[bin];
+}
+
+// Converts counts to nanoseconds.
+static double isrProfiler_countsToNs(uint32_t count) {
+  return count * (ISR_PROFILER_NS_PER_SECOND / ISR_PROFILER_COUNTS_PER_SECOND);
+}
+
+// Prints a row per task and its histogram.
+void isrProfiler_printStatistics() {
+  bool anyCalls = false;
+  for (uint16_t task = 0; task < ISR_PROFILER_TASK_COUNT; task++)
+    anyCalls |= isrProfiler_statistics[task].callCount != 0;
+  if (!anyCalls)
+    return;
+  printf("ISR profile (counts at %ld Hz):\n\r",
+         (long)ISR_PROFILER_COUNTS_PER_SECOND);
+  printf("%-12s %10s %8s %8s %8s %10s\n\r", "task", "calls", "min", "mean",
+         "max", "mean (ns)");
+  for (uint16_t task = 0; task < ISR_PROFILER_TASK_COUNT; task++) {
+    if (!isrProfiler_statistics[task].callCount)
+      continue;
+    printf("%-12s %10ld %8ld %8ld %8ld %10.1f\n\r", isrProfiler_taskNames[task],
+           (long)isrProfiler_getCallCount(task),
+           (long)isrProfiler_getMinCount(task),
+           (long)isrProfiler_getMeanCount(task),
+           (long)isrProfiler_getMaxCount(task),
+           isrProfiler_countsToNs(isrProfiler_getMeanCount(task)));
+  }
+  for (uint16_t task = 0; task < ISR_PROFILER_TASK_COUNT; task++) {
+    if (!isrProfiler_statistics[task].callCount)
+      continue;
+    printf("%s histogram:\n\r", isrProfiler_taskNames[task]);
+    for (uint16_t bin = 0; bin < ISR_PROFILER_HISTOGRAM_BIN_COUNT; bin++) {
+      uint32_t calls = isrProfiler_statistics[task].histogram[bin];
+      if (calls)
+        printf("  >= %8ld: %ld\n\r", bin ? 1L << bin : 0L, (long)calls);
+    }
+  }
+}
+
+#define ISR_PROFILER_TEST_TASK ISR_PROFILER_SOUND
+#define ISR_PROFILER_TEST_BUSY_LOOP_COUNT 1000
+
+// Stand-in for a task.
+static void isrProfiler_testBusyLoop() {
+  for (volatile uint32_t i = 0; i < ISR_PROFILER_TEST_BUSY_LOOP_COUNT; i++)
+    ;
+}
+
+// Checks the statistics for known counts and that a busy loop registers.
+bool isrProfiler_runTest() {
+  printf("****************** isrProfiler_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  isrProfiler_init();
+  const uint32_t counts[] = {0, 1, 100, 150, 70000};
+  const uint16_t bins[] = {0, 0, 6, 7, ISR_PROFILER_HISTOGRAM_BIN_COUNT - 1};
+  const uint16_t countCount = sizeof(counts) / sizeof(counts[0]);
+  uint64_t total = 0;
+  for (uint16_t i = 0; i < countCount; i++) {
+    isrProfiler_record(ISR_PROFILER_TEST_TASK, counts[i]);
+    total += counts[i];
+  }
+  if (isrProfiler_getCallCount(ISR_PROFILER_TEST_TASK) != countCount ||
+      isrProfiler_getMinCount(ISR_PROFILER_TEST_TASK) != 0 ||
+      isrProfiler_getMaxCount(ISR_PROFILER_TEST_TASK) != 70000 ||
+      isrProfiler_getMeanCount(ISR_PROFILER_TEST_TASK) != total / countCount) {
+    printf("Wrong statistics: calls %ld min %ld mean %ld max %ld.\n\r",
+           (long)isrProfiler_getCallCount(ISR_PROFILER_TEST_TASK),
+           (long)isrProfiler_getMinCount(ISR_PROFILER_TEST_TASK),
+           (long)isrProfiler_getMeanCount(ISR_PROFILER_TEST_TASK),
+           (long)isrProfiler_getMaxCount(ISR_PROFILER_TEST_TASK));
+    success = false;
+  }
+  uint32_t binCounts[ISR_PROFILER_HISTOGRAM_BIN_COUNT] = {0};
+  for (uint16_t i = 0; i < countCount; i++)
+    binCounts[bins[i]]++;
+  for (uint16_t bin = 0; bin < ISR_PROFILER_HISTOGRAM_BIN_COUNT; bin++) {
+    if (isrProfiler_getHistogramCount(ISR_PROFILER_TEST_TASK, bin) !=
+        binCounts[bin]) {
+      printf("Histogram bin %d holds %ld calls, expected %ld.\n\r", bin,
+             (long)isrProfiler_getHistogramCount(ISR_PROFILER_TEST_TASK, bin),
+             (long)binCounts[bin]);
+      success = false;
+    }
+  }
+
+  // A busy loop must take time and must not disturb the other tasks.
+  isrProfiler_reset();
+  uint32_t startCount = isrProfiler_readCounter();
+  isrProfiler_testBusyLoop();
+  isrProfiler_record(ISR_PROFILER_TEST_TASK,
+                     isrProfiler_readCounter() - startCount);
+  if (isrProfiler_getMinCount(ISR_PROFILER_TEST_TASK) == 0 ||
+      isrProfiler_getCallCount(ISR_PROFILER_TRIGGER) != 0) {
+    printf("Busy loop was not measured.\n\r");
+    success = false;
+  }
+  isrProfiler_printStatistics();
+  isrProfiler_reset();
+  printf("isrProfiler_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
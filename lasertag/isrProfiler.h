@@ -0,0 +1,106 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef ISRPROFILER_H_
+#define ISRPROFILER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#ifdef ZYBO_BOARD
+#include "xparameters.h"
+#include "xpseudo_asm.h"
+#include "xreg_cortexa9.h"
+#else
+#include <time.h>
+#endif
+
+// Per-task profiler for isr_function(). Each task called from the ISR is
+// wrapped in ISR_PROFILER_RUN(), e.g.,
+//   ISR_PROFILER_RUN(ISR_PROFILER_TRIGGER, trigger_tick());
+// and the profiler records the count, min, mean, max and a histogram of the
+// cost of each call. On the board the cost is read from the Cortex-A9 cycle
+// counter (CPU clocks); elsewhere it comes from clock_gettime() (ns).
+//
+// When ISR_PROFILER_ENABLED is not defined ISR_PROFILER_RUN() is just the call,
+// so there is no overhead.
+
+// Leave uncommented to profile the tasks in isr_function().
+// #define ISR_PROFILER_ENABLED
+
+// Tasks that are profiled.
+#define ISR_PROFILER_ADC_PUSH 0
+#define ISR_PROFILER_TRIGGER 1
+#define ISR_PROFILER_TRANSMITTER 2
+#define ISR_PROFILER_SOUND 3
+#define ISR_PROFILER_TIMERS 4
+#define ISR_PROFILER_TASK_COUNT 5
+
+// Histogram bin n counts the calls that took [2^n, 2^(n+1)) counts (bin 0 also
+// holds zero-length calls, the last bin everything longer).
+#define ISR_PROFILER_HISTOGRAM_BIN_COUNT 16
+
+#ifdef ZYBO_BOARD
+#define ISR_PROFILER_COUNTS_PER_SECOND XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ
+#else
+#define ISR_PROFILER_COUNTS_PER_SECOND 1000000000
+#endif
+
+#ifdef ISR_PROFILER_ENABLED
+#define ISR_PROFILER_RUN(task, call)                                           \
+  do {                                                                         \
+    uint32_t isrProfiler_startCount = isrProfiler_readCounter();               \
+    call;                                                                      \
+    isrProfiler_record(task, isrProfiler_readCounter() -                       \
+                                 isrProfiler_startCount);                      \
+  } while (0)
+#else
+#define ISR_PROFILER_RUN(task, call) call
+#endif
+
+// Returns the free-running counter used for profiling.
+static inline uint32_t isrProfiler_readCounter() {
+#ifdef ZYBO_BOARD
+  return mfcp(XREG_CP15_PERF_CYCLE_COUNTER);
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)((uint64_t)now.tv_sec * ISR_PROFILER_COUNTS_PER_SECOND +
+                    now.tv_nsec);
+#endif
+}
+
+// Starts the cycle counter (on the board) and clears the statistics.
+void isrProfiler_init();
+
+// Clears the statistics.
+void isrProfiler_reset();
+
+// Adds one call of the given task that took count counts.
+void isrProfiler_record(uint16_t task, uint32_t count);
+
+// Returns the number of calls recorded for the task.
+uint32_t isrProfiler_getCallCount(uint16_t task);
+
+// Returns the min, mean and max counts per call for the task (0 if no calls).
+uint32_t isrProfiler_getMinCount(uint16_t task);
+uint32_t isrProfiler_getMeanCount(uint16_t task);
+uint32_t isrProfiler_getMaxCount(uint16_t task);
+
+// Returns the number of calls that fell in the given histogram bin.
+uint32_t isrProfiler_getHistogramCount(uint16_t task, uint16_t bin);
+
+// Prints a table with a row per task that has been called, followed by the
+// non-empty histogram bins. Does nothing if no calls were recorded.
+void isrProfiler_printStatistics();
+
+// Checks the statistics and histogram for known counts and that a profiled
+// busy loop registers. Returns true if the test passes.
+bool isrProfiler_runTest();
+
+#endif /* ISRPROFILER_H_ */
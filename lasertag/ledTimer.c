@@ -0,0 +1,119 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "ledTimer.h"
+#include "hitLedTimer.h"
+#include "mio.h"
+#include "timerWheel.h"
+#include "utils.h"
+#include <stdio.h>
+
+// Thin wrapper around a timerWheel timer. The callback toggles the LED and
+// restarts the timer for the on or off time.
+
+#define LED_TIMER_LED_ON 1
+#define LED_TIMER_LED_OFF 0
+#define LED_TIMER_DEFAULT_ON_TIME_MS 500
+#define LED_TIMER_DEFAULT_PERIOD_MS 1000
+#define LED_TIMER_TEST_DURATION_MS 5000
+
+static timerWheel_timer_t ledTimer_timer;
+static uint32_t ledTimer_onTimeInMs = LED_TIMER_DEFAULT_ON_TIME_MS;
+static uint32_t ledTimer_periodInMs = LED_TIMER_DEFAULT_PERIOD_MS;
+static bool ledTimer_controlHitLedFlag = false;
+static bool ledTimer_ledOn = false;
+
+// Writes the LED (and the hit-LED if requested).
+static void ledTimer_writeLed(bool on) {
+  ledTimer_ledOn = on;
+  mio_writePin(LED_TIMER_LED_PIN, on ? LED_TIMER_LED_ON : LED_TIMER_LED_OFF);
+  if (ledTimer_controlHitLedFlag)
+    mio_writePin(HIT_LED_TIMER_OUTPUT_PIN,
+                 on ? LED_TIMER_LED_ON : LED_TIMER_LED_OFF);
+}
+
+// Ends the current on or off phase and starts the next one.
+static void ledTimer_expire(__attribute__((unused)) void *context) {
+  uint32_t offTimeInMs = ledTimer_periodInMs > ledTimer_onTimeInMs
+                             ? ledTimer_periodInMs - ledTimer_onTimeInMs
+                             : 0;
+  bool turnOn = !ledTimer_ledOn;
+  // Skip a phase of zero length.
+  if (turnOn ? ledTimer_onTimeInMs == 0 : offTimeInMs == 0)
+    turnOn = !turnOn;
+  ledTimer_writeLed(turnOn);
+  uint32_t phaseInMs = turnOn ? ledTimer_onTimeInMs : offTimeInMs;
+  if (phaseInMs == 0) // Always on or always off.
+    phaseInMs = ledTimer_periodInMs;
+  timerWheel_start(&ledTimer_timer, phaseInMs * TIMER_WHEEL_TICKS_PER_MS);
+}
+
+// Initialize the ledTimer before you use it.
+void ledTimer_init() {
+  mio_init(false);
+  mio_setPinAsOutput(LED_TIMER_LED_PIN);
+  timerWheel_initTimer(&ledTimer_timer, ledTimer_expire, NULL);
+  ledTimer_writeLed(false);
+}
+
+// Starts the ledTimer running, beginning with the on time.
+void ledTimer_start() {
+  ledTimer_writeLed(false);
+  ledTimer_expire(NULL);
+}
+
+// Returns true if the timer is currently running, false otherwise.
+bool ledTimer_isRunning() { return timerWheel_running(&ledTimer_timer); }
+
+// Terminates operation of the ledTimer.
+void ledTimer_stop() {
+  timerWheel_cancel(&ledTimer_timer);
+  ledTimer_writeLed(false);
+}
+
+// Specfies how long the LED is on in milliseconds.
+void ledTimer_setOnTimeInMs(uint32_t milliseconds) {
+  ledTimer_onTimeInMs = milliseconds;
+}
+
+// Specfies the period of the ledTimer.
+void ledTimer_setPeriodInMs(uint32_t milliseconds) {
+  // Minimum period is 1 millisecond.
+  ledTimer_periodInMs = milliseconds ? milliseconds : 1;
+}
+
+// Invoking this causes the led timer to also control the hit-LED.
+void ledTimer_controlHitLed(bool flag) { ledTimer_controlHitLedFlag = flag; }
+
+// Does nothing: isr_function() calls timerWheel_tick(), which does the
+// counting. Kept so existing callers still link.
+void ledTimer_tick() {}
+
+// Blinks the LED (and the hit-LED) for a few seconds.
+void ledTimer_runTest() {
+  printf("****************** ledTimer_runTest() ******************\n\r");
+  ledTimer_init();
+  ledTimer_controlHitLed(true);
+  ledTimer_setOnTimeInMs(LED_TIMER_DEFAULT_ON_TIME_MS / 2);
+  ledTimer_setPeriodInMs(LED_TIMER_DEFAULT_PERIOD_MS / 2);
+  ledTimer_start();
+  utils_msDelay(LED_TIMER_TEST_DURATION_MS);
+  ledTimer_stop();
+  ledTimer_controlHitLed(false);
+  printf("ledTimer_runTest() done\n\r");
+}
+
+// Debug function.
+void ledTimer_dumpDebugValues() {
+  printf("ledTimer: on %ld ms, period %ld ms, LED %s, %ld ticks "
+         "remaining.\n\r",
+         (long)ledTimer_onTimeInMs, (long)ledTimer_periodInMs,
+         ledTimer_ledOn ? "on" : "off",
+         (long)timerWheel_getRemainingTicks(&ledTimer_timer));
+}
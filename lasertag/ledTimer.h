@@ -39,17 +39,12 @@ void ledTimer_setOnTimeInMs(uint32_t milliseconds);
 // Specfies the period of the ledTimer.
 void ledTimer_setPeriodInMs(uint32_t milliseconds);
 
-// Specified the number of ticks per millisecond for the tick function.
-// E.G., if ticksPerMillisecond is 10, the tick function will be called 10 times
-// each millisecond.
-void ledTimer_setTicksPerMs(uint32_t ticksPerMillisecond);
-
 // Invoking this causes the led timer to also control the hit-LED.
 // Flag = true means that the ledTimer will control the hitLed.
 // Flag = false means that the ledTimer does not control the hitLed.
 void ledTimer_controlHitLed(bool flag);
 
-// Standard state-machine tick function. Call this to advance the state machine.
+// Does nothing; timerWheel_tick() does the counting (see timerWheel.h).
 void ledTimer_tick();
 
 // Standard test function.
@@ -22,11 +22,11 @@ void lockoutTimer_init();
 // Returns true if the timer is running.
 bool lockoutTimer_running();
 
-// Standard tick function.
+// Does nothing; timerWheel_tick() does the counting (see timerWheel.h).
 void lockoutTimer_tick();
 
 // Test function assumes interrupts have been completely enabled and
-// lockoutTimer_tick() function is invoked by isr_function().
+// timerWheel_tick() is invoked by isr_function().
 // Prints out pass/fail status and other info to console.
 // Returns true if passes, false otherwise.
 // This test uses the interval timer to determine correct delay for
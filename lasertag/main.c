@@ -21,6 +21,73 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 // Leave uncommented to run the sound test.
 // #define SOUND_TEST_RUN
 
+// Leave uncommented to run the dual-receiver test with synthetic inputs.
+// #define DUAL_RECEIVER_TEST_RUN
+
+// Leave uncommented to run the player-ID encode/decode test.
+// #define PLAYER_ID_TEST_RUN
+
+// Leave uncommented to check the NCO transmitter's edges against the ideal
+// waveform (does not drive the output pin).
+// #define TRANSMITTER_NCO_TEST_RUN
+
+// Leave uncommented to test the AXI timer PWM transmitter backend (on the
+// emulator this checks the waveform against a model of the timer).
+// #define TRANSMITTER_PWM_TEST_RUN
+
+// Leave uncommented to run the timer-wheel test (no interrupts needed).
+// #define TIMER_WHEEL_TEST_RUN
+
+// Leave uncommented to compare the ISR load of the slow tasks when ticked
+// every tick and when dispatched by the tickless scheduler.
+// #define SCHEDULER_TEST_RUN
+
+// Leave uncommented to test the ISR profiler's statistics.
+// #define ISR_PROFILER_TEST_RUN
+
+// Leave uncommented to test the virtual timers (stopwatches sharing one
+// hardware counter).
+// #define VIRTUAL_TIMER_TEST_RUN
+
+// Leave uncommented to test the 64-bit timestamp counter.
+// #define INTERVAL_TIMER_TIMESTAMP_TEST_RUN
+
+// Leave uncommented to test the hit-latency measurement and percentiles.
+// #define HIT_LATENCY_TEST_RUN
+
+// Leave uncommented to test the event trace ring.
+// #define TRACE_TEST_RUN
+
+// Leave uncommented to test the statistics registry and its serializers.
+// #define STATISTICS_TEST_RUN
+
+// Leave uncommented to test the ADPCM sound codec and time a FIFO refill.
+// #define ADPCM_TEST_RUN
+
+// Leave uncommented to check and print the index of the sound pack.
+// #define SOUND_PACK_TEST_RUN
+
+// Leave uncommented to test the sound mixer and time a mixed block.
+// #define SOUND_MIXER_TEST_RUN
+
+// Leave uncommented to compare I2S FIFO underruns at the old and new refill
+// periods.
+// #define SOUND_FIFO_TEST_RUN
+
+// Leave uncommented to test the sound output stage and time packing.
+// #define SOUND_OUTPUT_TEST_RUN
+
+// Leave uncommented to test the sound synthesizer and compare the gun click's
+// size with a recording.
+// #define SOUND_SYNTH_TEST_RUN
+
+// Leave uncommented to test the sound playlist queue.
+// #define SOUND_QUEUE_TEST_RUN
+
+// Leave uncommented to stream the long sounds from the SD card, check them and
+// time the card.
+// #define SOUND_STREAM_TEST_RUN
+
 // Leave uncommented to simply dump raw ADC values to the console.
 // #define JUST_DUMP_RAW_ADC_VALUES
 
@@ -37,13 +104,33 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #ifdef LASER_TAG_MAIN
 
+#include "adpcm.h"
 #include "detector.h"
 #include "drivers/buttons.h"
+#include "dualReceiver.h"
 #include "filter.h"
 #include "filterTest.h"
 #include "gameModes.h"
+#include "hitLatency.h"
+#include "intervalTimer.h"
+#include "isrProfiler.h"
+#include "playerId.h"
 #include "runningModes.h"
+#include "scheduler.h"
 #include "sound.h"
+#include "soundFifo.h"
+#include "soundMixer.h"
+#include "soundOutput.h"
+#include "soundQueue.h"
+#include "soundSynth.h"
+#include "sounds/soundPack.h"
+#include "sounds/soundStream.h"
+#include "statistics.h"
+#include "timerWheel.h"
+#include "trace.h"
+#include "transmitterNco.h"
+#include "transmitterPwm.h"
+#include "virtualTimer.h"
 #include <assert.h>
 #include <stdio.h>
 
@@ -63,6 +150,89 @@ int main() {
   sound_runTest();
 #endif
 
+#ifdef DUAL_RECEIVER_TEST_RUN
+  dualReceiver_runTest();
+#endif
+
+#ifdef PLAYER_ID_TEST_RUN
+  playerId_runTest();
+#endif
+
+#ifdef TRANSMITTER_NCO_TEST_RUN
+  transmitterNco_runTest();
+#endif
+
+#ifdef TRANSMITTER_PWM_TEST_RUN
+  transmitterPwm_runTest();
+#endif
+
+#ifdef TIMER_WHEEL_TEST_RUN
+  timerWheel_runTest();
+#endif
+
+#ifdef SCHEDULER_TEST_RUN
+  scheduler_runIsrLoadTest();
+#endif
+
+#ifdef ISR_PROFILER_TEST_RUN
+  isrProfiler_runTest();
+#endif
+
+#ifdef VIRTUAL_TIMER_TEST_RUN
+  virtualTimer_runTest();
+#endif
+
+#ifdef INTERVAL_TIMER_TIMESTAMP_TEST_RUN
+  intervalTimer_testTimestamps();
+#endif
+
+#ifdef HIT_LATENCY_TEST_RUN
+  hitLatency_runTest();
+#endif
+
+#ifdef TRACE_TEST_RUN
+  trace_runTest();
+#endif
+
+#ifdef STATISTICS_TEST_RUN
+  statistics_runTest();
+#endif
+
+#ifdef ADPCM_TEST_RUN
+  adpcm_runTest();
+#endif
+
+#ifdef SOUND_PACK_TEST_RUN
+  soundPack_runTest();
+#endif
+
+#ifdef SOUND_MIXER_TEST_RUN
+  soundMixer_runTest();
+#endif
+
+#ifdef SOUND_FIFO_TEST_RUN
+  sound_init(); // Sets up the I2S clocks and the codec.
+  while (!sound_isReady() && !sound_hasFailed())
+    sound_update();
+  soundFifo_runTest();
+#endif
+
+#ifdef SOUND_OUTPUT_TEST_RUN
+  soundOutput_runTest();
+#endif
+
+#ifdef SOUND_SYNTH_TEST_RUN
+  soundSynth_runTest();
+#endif
+
+#ifdef SOUND_QUEUE_TEST_RUN
+  soundQueue_runTest();
+#endif
+
+#ifdef SOUND_STREAM_TEST_RUN
+  soundStream_runTest();
+#endif
+
 #ifdef RUNNING_MODES_TWO_TEAMS
   gameModes_twoTeams();
 #endif
@@ -0,0 +1,287 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "playerId.h"
+#include "filter.h"
+#include "queue.h"
+#include <stdio.h>
+
+#define PLAYER_ID_PREAMBLE 0x7 // Chips 0-2 on, chip 3 off.
+#define PLAYER_ID_POSTAMBLE                                                    \
+  ((1 << PLAYER_ID_POSTAMBLE_CHIP_COUNT) - 1) // All chips on.
+#define PLAYER_ID_MANCHESTER_ONE 0x1  // Chips on, off (first chip in bit 0).
+#define PLAYER_ID_MANCHESTER_ZERO 0x2 // Chips off, on.
+
+// Decimated samples per chip.
+#define PLAYER_ID_CHIP_WIDTH_IN_SAMPLES                                        \
+  (PLAYER_ID_CHIP_WIDTH_IN_TICKS / FILTER_FIR_DECIMATION_FACTOR)
+// The chip-energy envelope is recorded every this many decimated samples,
+// which sets the resolution of the chip alignment search.
+#define PLAYER_ID_ENVELOPE_DECIMATION 10
+#define PLAYER_ID_ENVELOPE_ENTRIES_PER_CHIP                                    \
+  (PLAYER_ID_CHIP_WIDTH_IN_SAMPLES / PLAYER_ID_ENVELOPE_DECIMATION)
+#define PLAYER_ID_ENVELOPE_ENTRIES_PER_FRAME                                   \
+  (PLAYER_ID_ENVELOPE_ENTRIES_PER_CHIP * PLAYER_ID_CHIP_COUNT)
+// Two frames of envelope, so a whole frame is available however late the hit
+// is declared.
+#define PLAYER_ID_ENVELOPE_LENGTH (2 * PLAYER_ID_ENVELOPE_ENTRIES_PER_FRAME)
+// After a hit, wait this many decimated samples for the rest of the pulse.
+#define PLAYER_ID_DECODE_DELAY_IN_SAMPLES FILTER_INPUT_PULSE_WIDTH
+// Weakest chip must be below this fraction of the strongest chip.
+#define PLAYER_ID_MIN_CONTRAST 0.5
+// Preamble/postamble chips are '1' above this fraction of the chip range.
+#define PLAYER_ID_THRESHOLD_FRACTION 0.25
+
+static uint16_t playerId_id = 0;
+static playerId_frame_t playerId_frame;
+
+// Squared IIR outputs over the last chip, and their running sums.
+static double playerId_squaredOutputs[FILTER_FREQUENCY_COUNT]
+                                     [PLAYER_ID_CHIP_WIDTH_IN_SAMPLES];
+static double playerId_chipEnergy[FILTER_FREQUENCY_COUNT];
+static uint16_t playerId_squaredOutputIndex = 0;
+
+// Chip-energy envelope, sampled every PLAYER_ID_ENVELOPE_DECIMATION samples.
+static float playerId_envelope[FILTER_FREQUENCY_COUNT]
+                              [PLAYER_ID_ENVELOPE_LENGTH];
+static uint16_t playerId_envelopeIndex = 0; // Next entry to be written.
+static uint16_t playerId_envelopeDecimationCount = 0;
+
+// Decode request state.
+static bool playerId_decodePending = false;
+static bool playerId_decodeComplete = false;
+static uint16_t playerId_decodeFrequencyNumber = 0;
+static uint32_t playerId_decodeDelayCount = 0;
+static uint16_t playerId_decodedId = PLAYER_ID_INVALID;
+
+// Must call this prior to using any playerId functions.
+void playerId_init() {
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    for (uint16_t i = 0; i < PLAYER_ID_CHIP_WIDTH_IN_SAMPLES; i++)
+      playerId_squaredOutputs[f][i] = 0.0;
+    for (uint16_t i = 0; i < PLAYER_ID_ENVELOPE_LENGTH; i++)
+      playerId_envelope[f][i] = 0.0;
+    playerId_chipEnergy[f] = 0.0;
+  }
+  playerId_squaredOutputIndex = 0;
+  playerId_envelopeIndex = 0;
+  playerId_envelopeDecimationCount = 0;
+  playerId_decodePending = false;
+  playerId_decodeComplete = false;
+  playerId_decodedId = PLAYER_ID_INVALID;
+  playerId_setPlayerId(playerId_id);
+}
+
+// Returns the chips of the frame for the given ID.
+playerId_frame_t playerId_encode(uint16_t id) {
+  playerId_frame_t frame = PLAYER_ID_PREAMBLE;
+  uint16_t chip = PLAYER_ID_PREAMBLE_CHIP_COUNT;
+  for (int16_t bit = PLAYER_ID_BIT_COUNT - 1; bit >= 0; bit--) {
+    frame |= ((id >> bit) & 1 ? PLAYER_ID_MANCHESTER_ONE
+                              : PLAYER_ID_MANCHESTER_ZERO)
+             << chip;
+    chip += 2;
+  }
+  frame |= PLAYER_ID_POSTAMBLE << chip;
+  return frame;
+}
+
+// Sets the ID transmitted by this gun.
+void playerId_setPlayerId(uint16_t id) {
+  if (id > PLAYER_ID_MAX_ID) {
+    printf("playerId_setPlayerId(): id %d is larger than %d.\n\r", id,
+           PLAYER_ID_MAX_ID);
+    return;
+  }
+  playerId_id = id;
+  playerId_frame = playerId_encode(id);
+}
+
+// Returns the ID transmitted by this gun.
+uint16_t playerId_getPlayerId() { return playerId_id; }
+
+// Returns true if the carrier should be on at the given tick of the pulse.
+bool playerId_isChipOn(uint32_t pulseTick) {
+  return (playerId_frame >> (pulseTick / PLAYER_ID_CHIP_WIDTH_IN_TICKS)) & 1;
+}
+
+// Tries to decode a frame whose first envelope entry is at offset start
+// (relative to the oldest entry). Returns the decoded ID or PLAYER_ID_INVALID
+// and sets *margin to the smallest decision distance in the frame.
+// The IIR filters take a good part of a chip to ring up, so a lone '1' chip
+// is much weaker than one inside a run of '1's. The framing chips are
+// therefore compared against a low threshold and each ID bit is decided by
+// comparing the two chips of its Manchester pair.
+static uint16_t playerId_decodeAt(const float envelope[], uint16_t start,
+                                  double *margin) {
+  double chips[PLAYER_ID_CHIP_COUNT];
+  double maxChip = 0.0, minChip = 0.0;
+  for (uint16_t k = 0; k < PLAYER_ID_CHIP_COUNT; k++) {
+    // An entry holds the energy of the chip that just ended.
+    uint16_t index = playerId_envelopeIndex + start +
+                     (k + 1) * PLAYER_ID_ENVELOPE_ENTRIES_PER_CHIP - 1;
+    chips[k] = envelope[index % PLAYER_ID_ENVELOPE_LENGTH];
+    if (k == 0 || chips[k] > maxChip)
+      maxChip = chips[k];
+    if (k == 0 || chips[k] < minChip)
+      minChip = chips[k];
+  }
+  if (maxChip <= 0.0 || minChip > PLAYER_ID_MIN_CONTRAST * maxChip)
+    return PLAYER_ID_INVALID;
+  double threshold =
+      minChip + PLAYER_ID_THRESHOLD_FRACTION * (maxChip - minChip);
+  playerId_frame_t frame = 0;
+  *margin = maxChip;
+  // Preamble and postamble chips; the ID chips in between are skipped.
+  uint16_t postambleStart =
+      PLAYER_ID_CHIP_COUNT - PLAYER_ID_POSTAMBLE_CHIP_COUNT;
+  for (uint16_t k = 0; k < PLAYER_ID_CHIP_COUNT; k++) {
+    if (k == PLAYER_ID_PREAMBLE_CHIP_COUNT)
+      k = postambleStart;
+    double distance = chips[k] - threshold;
+    if (distance > 0.0)
+      frame |= 1 << k;
+    else
+      distance = -distance;
+    if (distance < *margin)
+      *margin = distance;
+  }
+  if ((frame & ((1 << PLAYER_ID_PREAMBLE_CHIP_COUNT) - 1)) !=
+          PLAYER_ID_PREAMBLE ||
+      (frame >> postambleStart) != PLAYER_ID_POSTAMBLE)
+    return PLAYER_ID_INVALID;
+  // Manchester pairs, MSB first.
+  uint16_t id = 0;
+  for (uint16_t k = PLAYER_ID_PREAMBLE_CHIP_COUNT; k < postambleStart;
+       k += 2) {
+    double difference = chips[k] - chips[k + 1];
+    id = (id << 1) | (difference > 0.0);
+    if (difference < 0.0)
+      difference = -difference;
+    if (difference < *margin)
+      *margin = difference;
+  }
+  return id;
+}
+
+// Searches the envelope of one channel for the best-aligned valid frame.
+static uint16_t playerId_decode(uint16_t frequencyNumber) {
+  uint16_t bestId = PLAYER_ID_INVALID;
+  double bestMargin = 0.0;
+  for (uint16_t start = 0; start <= PLAYER_ID_ENVELOPE_LENGTH -
+                                        PLAYER_ID_ENVELOPE_ENTRIES_PER_FRAME;
+       start++) {
+    double margin;
+    uint16_t id =
+        playerId_decodeAt(playerId_envelope[frequencyNumber], start, &margin);
+    if (id != PLAYER_ID_INVALID && margin > bestMargin) {
+      bestMargin = margin;
+      bestId = id;
+    }
+  }
+  return bestId;
+}
+
+// Adds the latest output of each IIR filter. Per channel this is one multiply,
+// two adds and two stores; the envelope is only written every
+// PLAYER_ID_ENVELOPE_DECIMATION samples.
+void playerId_addIirOutputs(const double iirOutputs[]) {
+  uint16_t index = playerId_squaredOutputIndex;
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    double squared = iirOutputs[f] * iirOutputs[f];
+    playerId_chipEnergy[f] += squared - playerId_squaredOutputs[f][index];
+    playerId_squaredOutputs[f][index] = squared;
+  }
+  playerId_squaredOutputIndex =
+      (index + 1 == PLAYER_ID_CHIP_WIDTH_IN_SAMPLES) ? 0 : index + 1;
+  if (++playerId_envelopeDecimationCount == PLAYER_ID_ENVELOPE_DECIMATION) {
+    playerId_envelopeDecimationCount = 0;
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+      playerId_envelope[f][playerId_envelopeIndex] = playerId_chipEnergy[f];
+    playerId_envelopeIndex =
+        (playerId_envelopeIndex + 1 == PLAYER_ID_ENVELOPE_LENGTH)
+            ? 0
+            : playerId_envelopeIndex + 1;
+  }
+  if (playerId_decodePending &&
+      ++playerId_decodeDelayCount >= PLAYER_ID_DECODE_DELAY_IN_SAMPLES) {
+    playerId_decodePending = false;
+    playerId_decodedId = playerId_decode(playerId_decodeFrequencyNumber);
+    playerId_decodeComplete = true;
+  }
+}
+
+// Starts decoding the ID on the given frequency.
+void playerId_requestDecode(uint16_t frequencyNumber) {
+  playerId_decodeFrequencyNumber = frequencyNumber;
+  playerId_decodeDelayCount = 0;
+  playerId_decodePending = true;
+  playerId_decodeComplete = false;
+}
+
+// Returns true once a requested decode has finished.
+bool playerId_isDecodeComplete() { return playerId_decodeComplete; }
+
+// Returns the most recently decoded ID.
+uint16_t playerId_getDecodedId() {
+  playerId_decodeComplete = false;
+  return playerId_decodedId;
+}
+
+#define PLAYER_ID_TEST_CASE_COUNT 3
+#define PLAYER_ID_TEST_LEAD_IN_TICKS 5000 // Silence before the pulse.
+// Runs one pulse through the filters and returns the decoded ID.
+static uint16_t playerId_runPulse(uint16_t frequencyNumber, uint16_t id) {
+  filter_init();
+  playerId_init();
+  playerId_setPlayerId(id);
+  uint16_t period = filter_frequencyTickTable[frequencyNumber];
+  uint32_t totalTicks = PLAYER_ID_TEST_LEAD_IN_TICKS + TRANSMITTER_PULSE_WIDTH +
+                        PLAYER_ID_DECODE_DELAY_IN_SAMPLES *
+                            FILTER_FIR_DECIMATION_FACTOR;
+  uint16_t decimationCount = 0;
+  for (uint32_t tick = 0; tick < totalTicks; tick++) {
+    double input = -1.0;
+    uint32_t pulseTick = tick - PLAYER_ID_TEST_LEAD_IN_TICKS;
+    if (tick >= PLAYER_ID_TEST_LEAD_IN_TICKS &&
+        pulseTick < TRANSMITTER_PULSE_WIDTH && playerId_isChipOn(pulseTick) &&
+        (tick % period) >= period / 2)
+      input = 1.0;
+    filter_addNewInput(input);
+    if (++decimationCount < FILTER_FIR_DECIMATION_FACTOR)
+      continue;
+    decimationCount = 0;
+    filter_firFilter();
+    double iirOutputs[FILTER_FREQUENCY_COUNT];
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+      iirOutputs[f] = filter_iirFilter(f);
+    playerId_addIirOutputs(iirOutputs);
+    // Emulate the detector declaring a hit halfway through the pulse.
+    if (tick == PLAYER_ID_TEST_LEAD_IN_TICKS + TRANSMITTER_PULSE_WIDTH / 2 - 1)
+      playerId_requestDecode(frequencyNumber);
+  }
+  return playerId_isDecodeComplete() ? playerId_getDecodedId()
+                                     : PLAYER_ID_INVALID;
+}
+
+// Encodes a few IDs and checks that they decode correctly.
+bool playerId_runTest() {
+  printf("****************** playerId_runTest() ******************\n\r");
+  const uint16_t frequencyNumbers[PLAYER_ID_TEST_CASE_COUNT] = {1, 5, 9};
+  const uint16_t ids[PLAYER_ID_TEST_CASE_COUNT] = {0, 37, PLAYER_ID_MAX_ID};
+  bool success = true; // Be optimistic.
+  for (uint16_t i = 0; i < PLAYER_ID_TEST_CASE_COUNT; i++) {
+    uint16_t decodedId = playerId_runPulse(frequencyNumbers[i], ids[i]);
+    printf("frequency %d: sent player %d, decoded %d\n\r", frequencyNumbers[i],
+           ids[i], decodedId);
+    success &= (decodedId == ids[i]);
+  }
+  printf("playerId_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
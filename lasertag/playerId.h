@@ -0,0 +1,86 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef PLAYERID_H_
+#define PLAYERID_H_
+
+#include "filter.h"
+#include "transmitter.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Pulse-coded player IDs carried on top of the carrier frequencies.
+// Each TRANSMITTER_PULSE_WIDTH pulse is divided into PLAYER_ID_CHIP_COUNT
+// chips. The transmitter sends the carrier during a '1' chip and holds the
+// output low during a '0' chip. A frame is:
+//   preamble (1110) + 6-bit player ID, Manchester coded (1 -> 10, 0 -> 01),
+//   MSB first + postamble (1111).
+// Manchester coding never produces three equal chips in a row, so the
+// preamble cannot occur inside the ID, and at least 65% of each pulse carries
+// the carrier so hit detection is largely unaffected.
+//
+// Transmitter side: call playerId_setPlayerId() once and gate the output with
+// playerId_isChipOn() while the pulse is being sent.
+// Detector side: call playerId_addIirOutputs() every time the IIR bank runs.
+// The decoder keeps a short-window energy envelope per channel, updated with
+// a few adds per decimated sample. When a hit is detected, call
+// playerId_requestDecode(); the ID is decoded once the rest of the pulse has
+// arrived (see playerId_isDecodeComplete()).
+
+#define PLAYER_ID_BIT_COUNT 6 // Up to 64 players per session.
+#define PLAYER_ID_MAX_ID ((1 << PLAYER_ID_BIT_COUNT) - 1)
+#define PLAYER_ID_INVALID 0xFFFF // Returned when no ID could be decoded.
+#define PLAYER_ID_PREAMBLE_CHIP_COUNT 4
+#define PLAYER_ID_POSTAMBLE_CHIP_COUNT 4
+#define PLAYER_ID_CHIP_COUNT                                                   \
+  (PLAYER_ID_PREAMBLE_CHIP_COUNT + 2 * PLAYER_ID_BIT_COUNT +                   \
+   PLAYER_ID_POSTAMBLE_CHIP_COUNT)
+#define PLAYER_ID_CHIP_WIDTH_IN_TICKS                                          \
+  (TRANSMITTER_PULSE_WIDTH / PLAYER_ID_CHIP_COUNT) // 100 kHz ticks per chip.
+
+// Chips of a frame, chip 0 in bit 0.
+typedef uint32_t playerId_frame_t;
+
+// Must call this prior to using any playerId functions.
+void playerId_init();
+
+// Sets the ID transmitted by this gun.
+void playerId_setPlayerId(uint16_t id);
+
+// Returns the ID transmitted by this gun.
+uint16_t playerId_getPlayerId();
+
+// Returns the chips of the frame for the given ID.
+playerId_frame_t playerId_encode(uint16_t id);
+
+// Returns true if the carrier should be on at the given tick of the pulse
+// (0 to TRANSMITTER_PULSE_WIDTH-1) for this gun's ID.
+bool playerId_isChipOn(uint32_t pulseTick);
+
+// Adds the latest output of each IIR filter (indexed by frequency number).
+// Call once per decimated sample, after the IIR filters have run.
+void playerId_addIirOutputs(const double iirOutputs[]);
+
+// Starts decoding the ID on the given frequency. The result is available once
+// the remainder of the pulse has been received.
+void playerId_requestDecode(uint16_t frequencyNumber);
+
+// Returns true once a requested decode has finished.
+bool playerId_isDecodeComplete();
+
+// Returns the most recently decoded ID, or PLAYER_ID_INVALID.
+// Clears the decode-complete flag.
+uint16_t playerId_getDecodedId();
+
+// Encodes a few IDs, runs them through the FIR and IIR filters on their
+// carrier frequency and checks that they decode correctly. Returns true if
+// the test passes.
+bool playerId_runTest();
+
+#endif /* PLAYERID_H_ */
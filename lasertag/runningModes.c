@@ -12,21 +12,30 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include "display.h"
 #include "drivers/buttons.h"
 #include "drivers/switches.h"
+#include "dualReceiver.h"
 #include "filter.h"
 #include "histogram.h"
+#include "hitLatency.h"
 #include "hitLedTimer.h"
 #include "interrupts.h"
 #include "intervalTimer.h"
 #include "isr.h"
+#include "isrProfiler.h"
 #include "ledTimer.h"
 #include "leds.h"
 #include "lockoutTimer.h"
 #include "mio.h"
+#include "playerId.h"
 #include "queue.h"
+#include "scheduler.h"
 #include "sound.h"
+#include "statistics.h"
+#include "timerWheel.h"
+#include "trace.h"
 #include "transmitter.h"
 #include "trigger.h"
 #include "utils.h"
+#include "virtualTimer.h"
 #include "xparameters.h"
 #include <stdbool.h>
 #include <stdint.h>
@@ -51,9 +60,9 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #define ISR_CUMULATIVE_TIMER INTERVAL_TIMER_TIMER_0 // Used by the ISR.
 #define TOTAL_RUNTIME_TIMER                                                    \
-  INTERVAL_TIMER_TIMER_1 // Used to compute total run-time.
+  (&runningModes_totalRuntimeTimer) // Used to compute total run-time.
 #define MAIN_CUMULATIVE_TIMER                                                  \
-  INTERVAL_TIMER_TIMER_2 // Used to compute cumulative run-time in main.
+  (&runningModes_mainCumulativeTimer) // Cumulative run-time in main.
 
 #define SYSTEM_TICKS_PER_HISTOGRAM_UPDATE                                      \
   30000 // Update the histogram about 3 times per second.
@@ -71,12 +80,43 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 // good performance.
 #define SUGGESTED_REMAINING_ELEMENT_COUNT 500
 
+// Run-time statistics are also exported in machine-readable form (see
+// statistics.h): a final snapshot when a mode exits and, if
+// RUNNING_MODES_PERIODIC_STATISTICS is defined, one every
+// RUNNING_MODES_STATISTICS_PERIOD_MS while it runs. A CSV line takes about
+// 15 ms to print at 115200 baud, during which the main loop is blocked, so
+// periodic snapshots are off unless you are graphing a game.
+//#define RUNNING_MODES_PERIODIC_STATISTICS
+#define RUNNING_MODES_STATISTICS_FORMAT STATISTICS_FORMAT_CSV
+#define RUNNING_MODES_STATISTICS_SINK STATISTICS_SINK_UART
+#define RUNNING_MODES_STATISTICS_PERIOD_MS 1000
+#define RUNNING_MODES_HIT_NAME_SIZE 12
+#define RUNNING_MODES_HIT_LATENCY_PERCENTILE 95
+
+// Samples waiting for detector(), in whichever ADC buffer isr.c fills.
+#ifdef ISR_DUAL_RECEIVER
+#define RUNNING_MODES_ADC_BACKLOG() dualReceiver_adcBufferElementCount()
+#else
+#define RUNNING_MODES_ADC_BACKLOG() isr_adcBufferElementCount()
+#endif
+
 // Defined to make things more readable.
 #define INTERRUPTS_CURRENTLY_ENABLED true
 #define INTERRUPTS_CURRENTLY_DISABLE false
 
-// Keep track of detector invocations.
-static uint32_t detectorInvocationCount = 0;
+static virtualTimer_t runningModes_totalRuntimeTimer;
+static virtualTimer_t runningModes_mainCumulativeTimer;
+
+// Registered statistics. The hit counters have consecutive ids, one per
+// frequency, starting at runningModes_firstHitStatistic.
+static statistics_id_t runningModes_detectorInvocationStatistic;
+static statistics_id_t runningModes_detectorRateStatistic;
+static statistics_id_t runningModes_adcBacklogStatistic;
+static statistics_id_t runningModes_isrShareStatistic;
+static statistics_id_t runningModes_hitLatencyStatistic;
+static statistics_id_t runningModes_firstHitStatistic;
+static char runningModes_hitStatisticNames[FILTER_FREQUENCY_COUNT]
+                                          [RUNNING_MODES_HIT_NAME_SIZE];
 
 // This array is indexed by frequency number. If array-element[freq_no] == true,
 // the frequency is ignored, e.g., no hit will ever occur at that frequency.
@@ -93,6 +133,8 @@ static uint32_t detectorInvocationCount = 0;
 // self-explanatory.
 void runningModes_printRunTimeStatistics() {
   char sprintfBuffer[MAX_BUFFER_SIZE]; // Generic message buffer.
+  uint32_t detectorInvocationCount =
+      statistics_getValue(runningModes_detectorInvocationStatistic);
   // Setup the screen.
   display_setTextSize(RUNNING_MODE_NORMAL_TEXT_SIZE);
   display_setTextColor(RUNNING_MODE_NORMAL_TEXT_COLOR);
@@ -105,11 +147,11 @@ void runningModes_printRunTimeStatistics() {
   }
   // Print out the number of unprocessed elements in ADC queue.
   display_print("Unprocessed elements in ADC queue:");
-  uint32_t remainingElementCount = isr_adcBufferElementCount();
+  uint32_t remainingElementCount = RUNNING_MODES_ADC_BACKLOG();
   display_printlnDecimalInt(remainingElementCount);
   display_printChar('\n');
   double runningSeconds, isrRunningSeconds, mainLoopRunningSeconds;
-  runningSeconds = intervalTimer_getTotalDurationInSeconds(TOTAL_RUNTIME_TIMER);
+  runningSeconds = virtualTimer_getTotalDurationInSeconds(TOTAL_RUNTIME_TIMER);
   // Print out total running time in seconds.
   display_print("Measured run time in seconds: ");
   sprintf(sprintfBuffer, "%5.2f", runningSeconds);
@@ -128,7 +170,7 @@ void runningModes_printRunTimeStatistics() {
   display_println("%)");
   display_printChar('\n');
   mainLoopRunningSeconds =
-      intervalTimer_getTotalDurationInSeconds(MAIN_CUMULATIVE_TIMER);
+      virtualTimer_getTotalDurationInSeconds(MAIN_CUMULATIVE_TIMER);
   // Print out cumulative spent in detector.
   display_print("Cumulative run-time in detector: ");
   sprintf(sprintfBuffer, "%5.2f", mainLoopRunningSeconds / runningSeconds);
@@ -150,6 +192,11 @@ void runningModes_printRunTimeStatistics() {
   display_print(sprintfBuffer);
   display_printChar('\n');
   display_printChar('\n');
+  // Print out the hit latency percentiles.
+  display_print("Hit latency: ");
+  hitLatency_getSummary(sprintfBuffer, MAX_BUFFER_SIZE);
+  display_println(sprintfBuffer);
+  display_printChar('\n');
   // If the detector invocation rate is too low, inform the user.
   if (detectorInvocationCount / runningSeconds <
       SUGGESTED_DETECTOR_INVOCATIONS_PER_SECOND) {
@@ -169,6 +216,62 @@ void runningModes_printRunTimeStatistics() {
     display_printDecimalInt(SUGGESTED_REMAINING_ELEMENT_COUNT);
     display_println(" elements.");
   }
+  isrProfiler_printStatistics(); // Per-task ISR costs, if they were profiled.
+  hitLatency_printStatistics();  // Hit latency percentiles, over UART.
+  virtualTimer_printReport();    // Every stopwatch, over UART.
+  statistics_stopPeriodicSnapshots();
+#ifndef RUNNING_MODES_PERIODIC_STATISTICS
+  statistics_writeHeader(); // Periodic snapshots wrote it when the mode began.
+#endif
+  statistics_writeSnapshot(); // Final values, for tools/statistics_to_csv.py.
+#ifdef TRACE_ENABLED
+  trace_dump(); // For tools/trace_to_chrome.py.
+#endif
+}
+
+// Sets the statistics that are derived from other values, before each
+// snapshot.
+static void runningModes_updateStatistics() {
+  double runningSeconds =
+      virtualTimer_getTotalDurationInSeconds(TOTAL_RUNTIME_TIMER);
+  if (runningSeconds > 0) {
+    statistics_setGauge(
+        runningModes_detectorRateStatistic,
+        statistics_getValue(runningModes_detectorInvocationStatistic) /
+            runningSeconds);
+    statistics_setGauge(
+        runningModes_isrShareStatistic,
+        intervalTimer_getTotalDurationInSeconds(ISR_CUMULATIVE_TIMER) /
+            runningSeconds * 100);
+  }
+  statistics_setGauge(
+      runningModes_hitLatencyStatistic,
+      hitLatency_getPercentileUs(HIT_LATENCY_TOTAL,
+                                 RUNNING_MODES_HIT_LATENCY_PERCENTILE));
+}
+
+// Registers the run-time statistics. The ADC backlog gauge is set before each
+// detector() call, so its maximum is the high-water mark of the ADC buffer.
+static void runningModes_initStatistics() {
+  statistics_init();
+  runningModes_detectorInvocationStatistic =
+      statistics_addCounter("detector_invocations");
+  runningModes_detectorRateStatistic = statistics_addGauge("detector_per_s");
+  runningModes_adcBacklogStatistic = statistics_addGauge("adc_backlog");
+  runningModes_isrShareStatistic = statistics_addGauge("isr_share_pct");
+  runningModes_hitLatencyStatistic = statistics_addGauge("hit_latency_p95_us");
+  statistics_addTimer("run_s", TOTAL_RUNTIME_TIMER);
+  statistics_addTimer("main_loop_s", MAIN_CUMULATIVE_TIMER);
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    sprintf(runningModes_hitStatisticNames[i], "hits_ch%d", i);
+    statistics_id_t id =
+        statistics_addCounter(runningModes_hitStatisticNames[i]);
+    if (i == 0)
+      runningModes_firstHitStatistic = id;
+  }
+  statistics_setUpdateCallback(runningModes_updateStatistics);
+  statistics_setOutput(RUNNING_MODES_STATISTICS_FORMAT,
+                       RUNNING_MODES_STATISTICS_SINK);
 }
 
 // Group all of the inits together to reduce visual clutter.
@@ -177,11 +280,21 @@ void runningModes_initAll() {
   switches_init();
   mio_init(false);
   intervalTimer_initAll();
+  virtualTimer_initAll(); // Shares INTERVAL_TIMER_TIMER_1 between stopwatches.
+  virtualTimer_init(TOTAL_RUNTIME_TIMER, "total run-time");
+  virtualTimer_init(MAIN_CUMULATIVE_TIMER, "main loop");
+  runningModes_initStatistics();
   histogram_init(HISTOGRAM_BAR_COUNT);
   leds_init(true);
   transmitter_init();
   filter_init();
   isr_init();
+  isrProfiler_init();
+  hitLatency_init();
+  trace_init();
+  timerWheel_init(); // Shared by the hit-LED and lockout timers.
+  scheduler_init();
+  scheduler_addLasertagTasks(); // Run from the main loops.
   hitLedTimer_init();
   trigger_init();
   lockoutTimer_init();
@@ -226,39 +339,51 @@ void runningModes_continuous() {
       0; // Only update the histogram display every so many ticks.
   intervalTimer_reset(
       ISR_CUMULATIVE_TIMER); // Used to measure ISR execution time.
-  intervalTimer_reset(
+  virtualTimer_reset(
       TOTAL_RUNTIME_TIMER); // Used to measure total program execution time.
-  intervalTimer_reset(
+  virtualTimer_reset(
       MAIN_CUMULATIVE_TIMER); // Used to measure main-loop execution time.
-  intervalTimer_start(
+  virtualTimer_start(
       TOTAL_RUNTIME_TIMER);            // Start measuring total execution time.
   transmitter_setContinuousMode(true); // Run the transmitter continuously.
   interrupts_enableArmInts();  // The ARM will start seeing interrupts after
                                // this.
   transmitter_run();           // Start the transmitter.
-  detectorInvocationCount = 0; // Keep track of detector invocations.
+  statistics_resetValues();    // Keep track of detector invocations, etc.
+#ifdef RUNNING_MODES_PERIODIC_STATISTICS
+  statistics_startPeriodicSnapshots(RUNNING_MODES_STATISTICS_PERIOD_MS);
+#endif
   while (!(buttons_read() &
            BUTTONS_BTN3_MASK)) { // Run until you detect btn3 pressed.
     transmitter_setFrequencyNumber(runningModes_getFrequencySetting());
-    detectorInvocationCount++; // Used for run-time statistics.
-    histogramSystemTicks++;    // Keep track of ticks so you know when to update
-                               // the histogram.
+    // Used for run-time statistics.
+    statistics_increment(runningModes_detectorInvocationStatistic);
+    statistics_setGauge(runningModes_adcBacklogStatistic,
+                        RUNNING_MODES_ADC_BACKLOG());
+    histogramSystemTicks++; // Keep track of ticks so you know when to update
+                            // the histogram.
     // Run filters, compute power, etc.
-    intervalTimer_start(MAIN_CUMULATIVE_TIMER); // Measure run-time when you are
-                                                // doing something.
+    virtualTimer_start(MAIN_CUMULATIVE_TIMER); // Measure run-time when you are
+                                               // doing something.
+    TRACE_LOG(TRACE_EVENT_DETECTOR_BEGIN, 0);
     detector(INTERRUPTS_CURRENTLY_ENABLED); // Interrupts are currently enabled.
-    intervalTimer_stop(MAIN_CUMULATIVE_TIMER);
+    TRACE_LOG(TRACE_EVENT_DETECTOR_END, 0);
+    virtualTimer_stop(MAIN_CUMULATIVE_TIMER);
     // If enough ticks have transpired, update the histogram.
     if (histogramSystemTicks >= SYSTEM_TICKS_PER_HISTOGRAM_UPDATE) {
       double powerValues[FILTER_FREQUENCY_COUNT]; // Copy the current power
                                                   // values to here.
       filter_getCurrentPowerValues(
           powerValues); // Copy the current power values.
+      TRACE_LOG(TRACE_EVENT_DISPLAY_DRAW_BEGIN, TRACE_DISPLAY_DRAW_POWER);
       histogram_plotUserFrequencyPower(
           powerValues); // Plot the power values on the TFT.
+      TRACE_LOG(TRACE_EVENT_DISPLAY_DRAW_END, TRACE_DISPLAY_DRAW_POWER);
       histogramSystemTicks =
           0; // Reset the tick count and wait for the next update time.
     }
+    statistics_poll(); // Writes a snapshot when one is due.
+    scheduler_run(scheduler_getNowTick()); // Slow tasks, when they are due.
   }
   interrupts_disableArmInts();           // Stop interrupts.
   runningModes_printRunTimeStatistics(); // Print the run-time statistics.
@@ -275,8 +400,11 @@ void runningModes_shooter() {
   ignoredFrequencies[runningModes_getFrequencySetting()] = true;
 #endif
   detector_init(ignoredFrequencies);
+  playerId_init(); // detector() feeds it the IIR outputs (see detector.h).
+  hitLatency_init(); // Measure this session's hits only.
   uint16_t hitCount = 0;
-  detectorInvocationCount = 0; // Keep track of detector invocations.
+  uint16_t hitFrequencyNumber = 0; // Channel whose player ID is being decoded.
+  statistics_resetValues(); // Keep track of detector invocations, hits, etc.
   sound_init();
   trigger_enable();         // Makes the trigger state machine responsive to the
                             // trigger.
@@ -288,38 +416,64 @@ void runningModes_shooter() {
       0; // Only update the histogram display every so many ticks.
   intervalTimer_reset(
       ISR_CUMULATIVE_TIMER); // Used to measure ISR execution time.
-  intervalTimer_reset(
+  virtualTimer_reset(
       TOTAL_RUNTIME_TIMER); // Used to measure total program execution time.
-  intervalTimer_reset(
+  virtualTimer_reset(
       MAIN_CUMULATIVE_TIMER); // Used to measure main-loop execution time.
-  intervalTimer_start(
+  virtualTimer_start(
       TOTAL_RUNTIME_TIMER);   // Start measuring total execution time.
   interrupts_enableArmInts(); // The ARM will start seeing interrupts after
                               // this.
   lockoutTimer_start(); // Ignore erroneous hits at startup (when all power
                         // values are essentially 0).
+#ifdef RUNNING_MODES_PERIODIC_STATISTICS
+  statistics_startPeriodicSnapshots(RUNNING_MODES_STATISTICS_PERIOD_MS);
+#endif
   while ((!(buttons_read() & BUTTONS_BTN3_MASK)) &&
          hitCount < MAX_HIT_COUNT) { // Run until you detect btn3 pressed.
     transmitter_setFrequencyNumber(
         runningModes_getFrequencySetting());    // Read the switches and switch
                                                 // frequency as required.
-    intervalTimer_start(MAIN_CUMULATIVE_TIMER); // Measure run-time when you are
-                                                // doing something.
+    virtualTimer_start(MAIN_CUMULATIVE_TIMER); // Measure run-time when you are
+                                               // doing something.
     histogramSystemTicks++; // Keep track of ticks so you know when to update
                             // the histogram.
     // Run filters, compute power, run hit-detection.
-    detectorInvocationCount++;              // Used for run-time statistics.
+    // Used for run-time statistics.
+    statistics_increment(runningModes_detectorInvocationStatistic);
+    statistics_setGauge(runningModes_adcBacklogStatistic,
+                        RUNNING_MODES_ADC_BACKLOG());
+    TRACE_LOG(TRACE_EVENT_DETECTOR_BEGIN, 0);
     detector(INTERRUPTS_CURRENTLY_ENABLED); // Interrupts are currently enabled.
+    TRACE_LOG(TRACE_EVENT_DETECTOR_END, 0);
     if (detector_hitDetected()) {           // Hit detected
+      hitLatency_hitDetected();             // Time from pulse start to here.
       hitCount++;                           // increment the hit count.
       detector_clearHit();                  // Clear the hit.
       detector_hitCount_t
           hitCounts[DETECTOR_HIT_ARRAY_SIZE]; // Store the hit-counts here.
       detector_getHitCounts(hitCounts);       // Get the current hit counts.
-      histogram_plotUserHits(hitCounts);      // Plot the hit counts on the TFT.
+      hitFrequencyNumber = detector_getFrequencyNumberOfLastHit();
+      statistics_increment(runningModes_firstHitStatistic + hitFrequencyNumber);
+      TRACE_LOG(TRACE_EVENT_HIT, hitFrequencyNumber);
+      TRACE_LOG(TRACE_EVENT_DISPLAY_DRAW_BEGIN, TRACE_DISPLAY_DRAW_HITS);
+      histogram_plotUserHits(hitCounts); // Plot the hit counts on the TFT.
+      TRACE_LOG(TRACE_EVENT_DISPLAY_DRAW_END, TRACE_DISPLAY_DRAW_HITS);
+      playerId_requestDecode(hitFrequencyNumber); // Decode who shot us.
+    }
+    if (playerId_isDecodeComplete()) { // Log the shooter's ID.
+      uint16_t id = playerId_getDecodedId();
+      if (id == PLAYER_ID_INVALID)
+        printf("Hit on frequency %d, player ID not decoded.\n\r",
+               hitFrequencyNumber);
+      else
+        printf("Hit by player %d on frequency %d.\n\r", id,
+               hitFrequencyNumber);
     }
-    intervalTimer_stop(
+    virtualTimer_stop(
         MAIN_CUMULATIVE_TIMER); // All done with actual processing.
+    statistics_poll();          // Writes a snapshot when one is due.
+    scheduler_run(scheduler_getNowTick()); // Slow tasks, when they are due.
   }
   interrupts_disableArmInts(); // Done with loop, disable the interrupts.
   hitLedTimer_turnLedOff();    // Save power :-)
@@ -0,0 +1,282 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "scheduler.h"
+#include "sound.h"
+#ifdef LASERTAG_BLUETOOTH
+#include "bluetooth/bluetooth.h"
+#endif
+#include <stdio.h>
+#include <string.h>
+#ifdef ZYBO_BOARD
+#include "xtime_l.h"
+#else
+#include <time.h>
+#endif
+
+// Book-keeping for one task.
+typedef struct {
+  const char *name;
+  scheduler_taskFunction_t function;             // Periodic tasks.
+  scheduler_deadlineFunction_t deadlineFunction; // Deadline tasks.
+  uint32_t periodTicks;
+  uint32_t nextDeadline;
+  uint32_t lastRunTick;
+  uint32_t runCount;
+  bool idle; // Deadline task with no deadline; waits for scheduler_wake().
+} scheduler_task_t;
+
+static scheduler_task_t scheduler_tasks[SCHEDULER_MAX_TASK_COUNT];
+static uint16_t scheduler_taskCount = 0;
+static uint32_t scheduler_nextDeadline = 0;
+static uint32_t scheduler_lastNowTick = 0;
+
+// Returns true if tick a is at or after tick b.
+static bool scheduler_isAtOrAfter(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) >= 0;
+}
+
+// Removes all tasks.
+void scheduler_init() {
+  scheduler_taskCount = 0;
+  scheduler_nextDeadline = 0;
+  scheduler_lastNowTick = 0;
+}
+
+// Returns a cleared task slot, or NULL if the table is full.
+static scheduler_task_t *scheduler_newTask(const char *name) {
+  if (scheduler_taskCount == SCHEDULER_MAX_TASK_COUNT) {
+    printf("scheduler: no room for task %s.\n\r", name);
+    return NULL;
+  }
+  scheduler_task_t *task = &scheduler_tasks[scheduler_taskCount++];
+  task->name = name;
+  task->function = NULL;
+  task->deadlineFunction = NULL;
+  task->periodTicks = 0;
+  task->lastRunTick = scheduler_lastNowTick;
+  task->runCount = 0;
+  task->idle = false;
+  return task;
+}
+
+// Adds a task that runs every periodTicks ticks.
+bool scheduler_addPeriodicTask(const char *name,
+                               scheduler_taskFunction_t function,
+                               uint32_t periodTicks) {
+  scheduler_task_t *task = scheduler_newTask(name);
+  if (!task)
+    return false;
+  task->function = function;
+  task->periodTicks = periodTicks ? periodTicks : 1;
+  task->nextDeadline = scheduler_lastNowTick + task->periodTicks;
+  if (!scheduler_isAtOrAfter(task->nextDeadline, scheduler_nextDeadline) ||
+      scheduler_taskCount == 1)
+    scheduler_nextDeadline = task->nextDeadline;
+  return true;
+}
+
+// Adds a task that schedules itself; it runs on the next scheduler_run().
+bool scheduler_addDeadlineTask(const char *name,
+                               scheduler_deadlineFunction_t function) {
+  scheduler_task_t *task = scheduler_newTask(name);
+  if (!task)
+    return false;
+  task->deadlineFunction = function;
+  task->nextDeadline = scheduler_lastNowTick;
+  scheduler_nextDeadline = scheduler_lastNowTick;
+  return true;
+}
+
+// Makes the named deadline task run on the next call to scheduler_run().
+void scheduler_wake(const char *name) {
+  for (uint16_t i = 0; i < scheduler_taskCount; i++) {
+    if (strcmp(scheduler_tasks[i].name, name) == 0) {
+      scheduler_tasks[i].idle = false;
+      scheduler_tasks[i].nextDeadline = scheduler_lastNowTick;
+      scheduler_nextDeadline = scheduler_lastNowTick;
+    }
+  }
+}
+
+// Mixes ahead while a sound plays, or checks now and then for one to start.
+static uint32_t
+scheduler_soundTask(__attribute__((unused)) uint32_t elapsedTicks) {
+  sound_update();
+  return sound_isPlaying() ? SCHEDULER_SOUND_MIX_PERIOD
+                           : SCHEDULER_SOUND_PERIOD;
+}
+
+// Adds the lasertag tasks. The timer wheel is not one of them: isr_function()
+// calls timerWheel_tick().
+void scheduler_addLasertagTasks() {
+  scheduler_addDeadlineTask("sound", scheduler_soundTask);
+#ifdef LASERTAG_BLUETOOTH
+  scheduler_addPeriodicTask("bluetooth", bluetooth_poll,
+                            SCHEDULER_BLUETOOTH_PERIOD);
+#endif
+}
+
+// Returns the current time in ticks.
+uint32_t scheduler_getNowTick() {
+#ifdef ZYBO_BOARD
+  XTime now;
+  XTime_GetTime(&now);
+  return (uint32_t)(now / (COUNTS_PER_SECOND / SCHEDULER_TICKS_PER_SECOND));
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)((uint64_t)now.tv_sec * SCHEDULER_TICKS_PER_SECOND +
+                    now.tv_nsec / (1000000000 / SCHEDULER_TICKS_PER_SECOND));
+#endif
+}
+
+// Runs one task that is due and sets its next deadline.
+static void scheduler_runTask(scheduler_task_t *task, uint32_t nowTick) {
+  task->runCount++;
+  if (task->function) {
+    task->function();
+    task->nextDeadline += task->periodTicks;
+    // If the scheduler fell behind, skip the missed runs.
+    if (scheduler_isAtOrAfter(nowTick, task->nextDeadline))
+      task->nextDeadline = nowTick + task->periodTicks;
+  } else {
+    uint32_t ticks = task->deadlineFunction(nowTick - task->lastRunTick);
+    task->idle = (ticks == SCHEDULER_NO_DEADLINE);
+    task->nextDeadline = nowTick + ticks;
+  }
+  task->lastRunTick = nowTick;
+}
+
+// Runs the tasks that are due at nowTick.
+uint16_t scheduler_run(uint32_t nowTick) {
+  scheduler_lastNowTick = nowTick;
+  if (!scheduler_isAtOrAfter(nowTick, scheduler_nextDeadline))
+    return 0; // Nothing is due; this is the common case.
+  uint16_t runCount = 0;
+  bool deadlineFound = false;
+  for (uint16_t i = 0; i < scheduler_taskCount; i++) {
+    scheduler_task_t *task = &scheduler_tasks[i];
+    if (task->idle)
+      continue;
+    if (scheduler_isAtOrAfter(nowTick, task->nextDeadline)) {
+      scheduler_runTask(task, nowTick);
+      runCount++;
+      if (task->idle)
+        continue;
+    }
+    if (!deadlineFound ||
+        !scheduler_isAtOrAfter(task->nextDeadline, scheduler_nextDeadline)) {
+      scheduler_nextDeadline = task->nextDeadline;
+      deadlineFound = true;
+    }
+  }
+  if (!deadlineFound) // Everything is idle; wait as long as possible.
+    scheduler_nextDeadline = nowTick + INT32_MAX;
+  return runCount;
+}
+
+// Returns the number of ticks from nowTick to the next deadline.
+uint32_t scheduler_getTicksUntilNextDeadline(uint32_t nowTick) {
+  if (scheduler_isAtOrAfter(nowTick, scheduler_nextDeadline))
+    return 0;
+  return scheduler_nextDeadline - nowTick;
+}
+
+// Prints the name, run count and next deadline of each task.
+void scheduler_printStatistics() {
+  for (uint16_t i = 0; i < scheduler_taskCount; i++) {
+    scheduler_task_t *task = &scheduler_tasks[i];
+    printf("%-12s runs: %8ld next: %ld%s\n\r", task->name,
+           (long)task->runCount, (long)task->nextDeadline,
+           task->idle ? " (idle)" : "");
+  }
+}
+
+#define SCHEDULER_TEST_TICK_COUNT 200000 // Two seconds of 100 kHz ticks.
+#define SCHEDULER_TEST_TASK_COUNT 2
+#define SCHEDULER_TEST_WORK_LOOP_COUNT 8 // Rough cost of a state machine tick.
+#define SCHEDULER_TEST_NS_PER_TICK 10000.0
+
+// Stand-in for the work a state machine tick does.
+static volatile uint32_t scheduler_testWork;
+static void scheduler_testTask() {
+  for (uint16_t i = 0; i < SCHEDULER_TEST_WORK_LOOP_COUNT; i++)
+    scheduler_testWork += i;
+}
+
+// Stand-in for the sound task while no sound plays.
+static uint32_t
+scheduler_testSoundTask(__attribute__((unused)) uint32_t elapsedTicks) {
+  scheduler_testTask();
+  return SCHEDULER_SOUND_PERIOD;
+}
+
+// Returns a high-resolution time in nanoseconds.
+static double scheduler_getTimeInNs() {
+#ifdef ZYBO_BOARD
+  XTime now;
+  XTime_GetTime(&now);
+  return (double)now * (1000000000.0 / COUNTS_PER_SECOND);
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000.0 + now.tv_nsec;
+#endif
+}
+
+// Measures the per-tick cost of the scheduled tasks before and after.
+bool scheduler_runIsrLoadTest() {
+  printf("****************** scheduler_runIsrLoadTest() ******************\n\r");
+  // The sound task runs on tick 0 and then every period; bluetooth runs at
+  // the end of each period.
+  const uint32_t expectedRunCounts[SCHEDULER_TEST_TASK_COUNT] = {
+      SCHEDULER_TEST_TICK_COUNT / SCHEDULER_SOUND_PERIOD + 1,
+      SCHEDULER_TEST_TICK_COUNT / SCHEDULER_BLUETOOTH_PERIOD};
+
+  // Before: every task is ticked on every tick.
+  double start = scheduler_getTimeInNs();
+  for (uint32_t tick = 1; tick <= SCHEDULER_TEST_TICK_COUNT; tick++)
+    for (uint16_t i = 0; i < SCHEDULER_TEST_TASK_COUNT; i++)
+      scheduler_testTask();
+  double beforeNs =
+      (scheduler_getTimeInNs() - start) / SCHEDULER_TEST_TICK_COUNT;
+
+  // After: the scheduler dispatches the tasks at their own rates.
+  scheduler_init();
+  scheduler_addDeadlineTask("sound", scheduler_testSoundTask);
+  scheduler_addPeriodicTask("bluetooth", scheduler_testTask,
+                            SCHEDULER_BLUETOOTH_PERIOD);
+  start = scheduler_getTimeInNs();
+  for (uint32_t tick = 0; tick <= SCHEDULER_TEST_TICK_COUNT; tick++)
+    scheduler_run(tick);
+  double afterNs =
+      (scheduler_getTimeInNs() - start) / SCHEDULER_TEST_TICK_COUNT;
+
+  printf("Scheduled tasks per 10 us tick: before %.1f ns (%.2f%%), after "
+         "%.1f ns (%.2f%%).\n\r",
+         beforeNs, beforeNs / SCHEDULER_TEST_NS_PER_TICK * 100, afterNs,
+         afterNs / SCHEDULER_TEST_NS_PER_TICK * 100);
+  printf("The trigger, timerWheel_tick() and sound_tick() stay in the ISR and "
+         "are not included. sound_tick() refills the I2S FIFO every %d ticks; "
+         "soundFifo_runTest() prints its cost per tick.\n\r",
+         SOUND_TICK_REFILL_PERIOD);
+  scheduler_printStatistics();
+  bool success = true; // Be optimistic.
+  for (uint16_t i = 0; i < SCHEDULER_TEST_TASK_COUNT; i++) {
+    if (scheduler_tasks[i].runCount != expectedRunCounts[i]) {
+      printf("Task %s ran %ld times, expected %ld.\n\r",
+             scheduler_tasks[i].name, (long)scheduler_tasks[i].runCount,
+             (long)expectedRunCounts[i]);
+      success = false;
+    }
+  }
+  printf("scheduler_runIsrLoadTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
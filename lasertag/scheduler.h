@@ -0,0 +1,103 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Tickless scheduler for the slow lasertag tasks that do not need the 100 kHz
+// ISR: the sound task and, when the bluetooth code is linked, bluetooth
+// polling. The runningModes main loops call scheduler_run() on every pass.
+// The ISR keeps the trigger, timerWheel_tick() (see timerWheel.h) and
+// sound_tick(), which refills the I2S FIFO from what the sound task mixes
+// (see sound.h).
+//
+// Each task has a deadline. scheduler_run() compares the current time with
+// the earliest deadline (one compare when nothing is due), runs the tasks
+// that are due and computes the next deadline across all tasks. A task is
+// either periodic, or reports its own next deadline (e.g., the sound task
+// mixes every few milliseconds while a sound plays and checks more often for
+// one to start).
+//
+// scheduler_run() is called from the main loop, which already runs tens of
+// thousands of times per second, or from a one-shot timer interrupt programmed
+// with scheduler_getTicksUntilNextDeadline(). The interrupt setup in libzybo
+// does not expose the GIC, so the main-loop form is the one used here.
+//
+// The bluetooth code is linked, and LASERTAG_BLUETOOTH defined, by the lines
+// at the end of lasertag/CMakeLists.txt.
+//
+// Time is in 100 kHz ticks from scheduler_getNowTick(), which reads the ARM
+// global timer on the board and the monotonic clock elsewhere. Comparisons
+// are wrap-safe.
+
+#define SCHEDULER_MAX_TASK_COUNT 8
+#define SCHEDULER_TICKS_PER_SECOND 100000
+#define SCHEDULER_NO_DEADLINE UINT32_MAX // Returned by deadline functions.
+
+// Periods for the lasertag tasks, in ticks.
+#define SCHEDULER_SOUND_PERIOD 50        // Wait for a sound to start.
+#define SCHEDULER_SOUND_MIX_PERIOD 500   // 5 ms; the mix ring holds 43 ms.
+#define SCHEDULER_BLUETOOTH_PERIOD 1000  // 10 ms.
+
+// A periodic task.
+typedef void (*scheduler_taskFunction_t)();
+
+// A task that is passed the number of ticks since it last ran and returns the
+// number of ticks until it next needs to run (or SCHEDULER_NO_DEADLINE).
+typedef uint32_t (*scheduler_deadlineFunction_t)(uint32_t elapsedTicks);
+
+// Removes all tasks.
+void scheduler_init();
+
+// Adds a task that runs every periodTicks ticks. Returns false if the task
+// table is full.
+bool scheduler_addPeriodicTask(const char *name,
+                               scheduler_taskFunction_t function,
+                               uint32_t periodTicks);
+
+// Adds a task that schedules itself. It first runs on the next call to
+// scheduler_run(). Returns false if the task table is full.
+bool scheduler_addDeadlineTask(const char *name,
+                               scheduler_deadlineFunction_t function);
+
+// Makes the named deadline task run on the next call to scheduler_run(), e.g.,
+// after starting a timer that is due before the task's reported deadline.
+void scheduler_wake(const char *name);
+
+// Adds the lasertag tasks: sound_update() and, if LASERTAG_BLUETOOTH is
+// defined, bluetooth_poll().
+void scheduler_addLasertagTasks();
+
+// Returns the current time in ticks.
+uint32_t scheduler_getNowTick();
+
+// Runs the tasks that are due at nowTick. Returns the number of tasks run.
+uint16_t scheduler_run(uint32_t nowTick);
+
+// Returns the number of ticks from nowTick to the next deadline (0 if a task
+// is already due), for programming a one-shot timer.
+uint32_t scheduler_getTicksUntilNextDeadline(uint32_t nowTick);
+
+// Prints the name, run count and next deadline of each task.
+void scheduler_printStatistics();
+
+// Measures the processor time the scheduled tasks (sound and bluetooth) take
+// when each is ticked every 100 kHz tick ("before") and when they are
+// dispatched by scheduler_run() once per tick ("after"), and prints both as a
+// share of the 10 us tick. The trigger, timerWheel_tick() and sound_tick()
+// stay in the ISR and are not measured (soundFifo_runTest() measures
+// sound_tick()). Uses stand-in tasks of similar cost so it runs
+// without interrupts or peripherals, and checks each task ran the expected
+// number of times. Returns true if the test passes.
+bool scheduler_runIsrLoadTest();
+
+#endif /* SCHEDULER_H_ */
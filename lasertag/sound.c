@@ -8,16 +8,14 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 */
 
 #include "sound.h"
-#include "interrupts.h" // Just for sound_runTest().
-#include "sounds/bcfire01_48k.wav.h"
-#include "sounds/gameBoyStartup.wav.h"
-#include "sounds/gameOver48k.wav.h"
-#include "sounds/gunEmpty48k.wav.h"
-#include "sounds/ouch48k.wav.h"
-#include "sounds/pacmanDeath.wav.h"
-#include "sounds/powerUp48k.wav.h"
-#include "sounds/screamAndDie48k.wav.h"
-#include "timer_ps.h"
+#include "intervalTimer.h"
+#include "soundFifo.h"
+#include "soundMixer.h"
+#include "soundOutput.h"
+#include "soundQueue.h"
+#include "soundSynth.h"
+#include "sounds/soundPack.h"
+#include "sounds/soundStream.h"
 #include "xiicps.h"
 #include "xil_printf.h"
 #include "xil_types.h"
@@ -37,14 +35,14 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #define SCU_TIMER_ID XPAR_SCUTIMER_DEVICE_ID
 #define UART_BASEADDR XPAR_PS7_UART_1_BASEADDR
 
-#define SOUND_MULTIPLIER INT16_MAX / 3 // Primitive volume control.
+#define SOUND_RING_MASK (SOUND_RING_FRAME_COUNT - 1)
 
-#define ONE_SECOND_OF_SOUND_ARRAY_SIZE                                         \
-  48000 // The sample rate is 48k so that is 1 second's worth.
-uint16_t soundOfSilence[ONE_SECOND_OF_SOUND_ARRAY_SIZE];
+#define SOUND_TEST_QUEUE_DELAY_MS 500
 
 // Declared below the sound state-machine code.
-int AudioInitialize(u16 timerID, u16 iicID, u32 i2sAddr);
+static sound_status_t sound_codecInit();
+static void sound_codecTick();
+static bool sound_codecIsIdle();
 
 /****************************************************************
  *                 sound state machine code                     *
@@ -52,70 +50,116 @@ int AudioInitialize(u16 timerID, u16 iicID, u32 i2sAddr);
 // True if sound_init() has been called, false otherwise.
 static bool sound_initFlag = false;
 
-// True if a sound should be played, false otherwise.
-// Note that the state-machine sets this back to false once it has completed
-// playing a sound.
-static volatile bool sound_playSoundFlag = false;
-
-// Keep track of the base pointer to the sound array with current sample-rate
-// and sample count.
-static uint16_t *sound_array; // Base pointer to the sound array.
-
-// static uint32_t sound_sampleRate;  // Sample rate for this sound.
-static uint32_t sound_sampleCount; // Number of samples in this sound.
-
-// Keep track of the current volume setting.
-static sound_volume_t sound_currentVolume = sound_minimumVolume_e;
+// The sound that sound_startSound() plays.
+static sound_sounds_t sound_selectedSound = sound_oneSecondSilence_e;
+
+// Priority of each sound when all the mixer voices are busy: a sound can only
+// cut off one of the same or lower priority.
+static const uint8_t sound_priorities[] = {
+    [sound_gameStart_e] = 2,    [sound_gunFire_e] = 1,
+    [sound_hit_e] = 2,          [sound_gunClick_e] = 1,
+    [sound_gunReload_e] = 1,    [sound_loseLife_e] = 3,
+    [sound_gameOver_e] = 3,     [sound_returnToBase_e] = 2,
+    [sound_oneSecondSilence_e] = 0};
+
+// Patches of the sounds that are synthesized, which the pack marks as
+// SOUND_PACK_FORMAT_SYNTH.
+static const soundSynth_patch_t *const sound_patches[] = {
+    [sound_gunClick_e] = &soundSynth_gunClickPatch};
+
+// The sequence that chained commands from the queue follow on from: the
+// voice it plays on, identified by its start number, and the command whose
+// repeats are still to be chained on to it.
+static int8_t sound_sequenceVoice = SOUND_MIXER_NO_VOICE;
+static uint32_t sound_sequenceStartNumber = 0;
+static soundQueue_command_t sound_sequenceCommand;
+static uint8_t sound_sequenceRepeatCount = 0; // Repeats not yet chained.
+
+// Mixed frames waiting for the I2S FIFO, already scaled to FIFO words.
+// sound_update() mixes blocks into the ring from the main loop and
+// sound_tick() sends them from the ISR. Like the playlist (see soundQueue.h)
+// it has one producer and one consumer, each of which only writes its own
+// count and publishes it with a release store, so it needs no locks.
+static uint32_t sound_ring[SOUND_RING_FRAME_COUNT];
+// Numbers of frames ever mixed and ever sent; the slot is the lower bits.
+static volatile uint32_t sound_ringMixedCount = 0;
+static volatile uint32_t sound_ringSentCount = 0;
+// Set while the transmitter runs, so sound_tick() may refill the FIFO. Only
+// the main loop changes it, and the ring, while it is clear.
+static volatile bool sound_fifoRunning = false;
+// Calls of sound_tick() since the last refill.
+static uint8_t sound_tickCount = 0;
 
 // Sound state-machine states.
 typedef enum {
-  sound_init_st, // Waiting for sound_init() to be invoked.
+  sound_init_st, // Waiting for sound_init() and the codec set-up.
   sound_wait_st, // Waiting for enable to play sound.
   sound_play_st  // In the process of playing the sound.
 } sound_st_t;
 
-// Reset the TX FIFO.
-void sound_resetTxFifo() {
-  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_RESET_REG, 0b010); // Reset TX Fifo
-}
+static sound_st_t currentState = sound_init_st;
 
-// Enable the TX FIFO.
-void sound_enableTxFifo() {
-  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_CTRL_REG,
-            0b001); // Enable TX Fifo, disable mute
+// Mixes the next block into the ring and scales it to FIFO words, so that
+// the refills that send it are only stores. The ring holds a whole number of
+// blocks, so a block never wraps.
+static void sound_mixBlock() {
+  int16_t samples[SOUND_MIXER_BLOCK_SIZE];
+  uint32_t mixed = sound_ringMixedCount;
+  soundMixer_mix(samples, SOUND_MIXER_BLOCK_SIZE); // Mix the voices.
+  soundOutput_pack(samples, &sound_ring[mixed & SOUND_RING_MASK],
+                   SOUND_MIXER_BLOCK_SIZE); // Volume.
+  __atomic_store_n(&sound_ringMixedCount, mixed + SOUND_MIXER_BLOCK_SIZE,
+                   __ATOMIC_RELEASE);
 }
 
-// Disables the TX FIFO.
-void sound_disableTxFifo() {
-  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_CTRL_REG, 0b00); // Disable TX FIFO.
+// Mixes ahead until the ring is full or every voice has finished.
+static void sound_fillRing() {
+  while (sound_isBusy() &&
+         SOUND_RING_FRAME_COUNT -
+                 (sound_ringMixedCount -
+                  __atomic_load_n(&sound_ringSentCount, __ATOMIC_ACQUIRE)) >=
+             SOUND_MIXER_BLOCK_SIZE)
+    sound_mixBlock();
 }
 
-// sampleValue is sent to both the left and right channels.
-void sound_sendDataToBothChannels(uint32_t sampleValue) {
-  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_TX_FIFO_REG,
-            sampleValue); // add to left Channel.
-  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_TX_FIFO_REG,
-            sampleValue); // add to right Channel.
+// Stops the transmitter and drops the frames that were not sent.
+static void sound_stopFifo() {
+  sound_fifoRunning = false; // sound_tick() leaves the ring alone from here.
+  soundFifo_stop();
+  sound_ringSentCount = sound_ringMixedCount;
 }
 
-// Used to set the volume. Use one of the provided values.
-void sound_setVolume(sound_volume_t volume) { sound_currentVolume = volume; }
+// Used to set the volume. Use one of the provided values. The volume ramps
+// to the new level over a few milliseconds.
+void sound_setVolume(sound_volume_t volume) { soundOutput_setGain(volume); }
 
 // Must be called before using the sound state machine.
 sound_status_t sound_init() {
-  // Setup the audio CODEC.
-  AudioInitialize(SCU_TIMER_ID, AUDIO_IIC_ID, AUDIO_CTRL_BASEADDR);
+  // Stop anything still playing; sounds are held until the set-up below is
+  // done again.
+  sound_stopFifo();
+  sound_initFlag = false;
+  currentState = sound_init_st;
+  // Find the sounds. sound_update() looks for the stream pack; without it
+  // the long sounds play their fallbacks.
+  if (!soundPack_init())
+    return SOUND_STATUS_FAIL;
+  soundStream_init();
+  // Start setting up the audio CODEC; sound_update() finishes it.
+  if (sound_codecInit() != SOUND_STATUS_OK)
+    return SOUND_STATUS_FAIL;
+  soundMixer_init();
+  soundQueue_init();
+  sound_ringMixedCount = 0;
+  sound_ringSentCount = 0;
+  sound_sequenceVoice = SOUND_MIXER_NO_VOICE;
+  sound_sequenceRepeatCount = 0;
+  soundOutput_init(0); // Fade in from silence...
   sound_initFlag = true;
-  // Initialize the silence array.
-  for (uint32_t i = 0; i < ONE_SECOND_OF_SOUND_ARRAY_SIZE; i++)
-    soundOfSilence[i] = NO_SOUND;
-  sound_setVolume(sound_minimumVolume_e); // Init the volume level.
+  sound_setVolume(sound_minimumVolume_e); // ...to the initial volume level.
   return SOUND_STATUS_OK;
 }
 
-// Standard tick function.
-static sound_st_t currentState = sound_init_st;
-
 // This is a debug state print routine. It will print the names of the states
 // each time tick() is called. It only prints states if they are different than
 // the previous state.
@@ -145,9 +189,42 @@ void debugStatePrint() {
   }
 }
 
+// Declared below with the rest of the playlist code.
+static void sound_runQueue();
+
+// Sends mixed frames to the I2S FIFO until it is full; the mixing is done in
+// sound_update().
+static void sound_refillFifo() {
+  if (!sound_fifoRunning)
+    return;
+  uint32_t sent = sound_ringSentCount;
+  uint32_t count =
+      __atomic_load_n(&sound_ringMixedCount, __ATOMIC_ACQUIRE) - sent;
+  uint32_t index = sent & SOUND_RING_MASK;
+  if (count > SOUND_RING_FRAME_COUNT - index)
+    count = SOUND_RING_FRAME_COUNT - index; // Up to the end of the ring.
+  if (count)
+    __atomic_store_n(&sound_ringSentCount,
+                     sent + soundFifo_write(&sound_ring[index], count),
+                     __ATOMIC_RELEASE);
+}
+
+// Standard tick function, called from isr_function() on every tick. Refills
+// the FIFO on every SOUND_TICK_REFILL_PERIOD-th call.
 void sound_tick() {
+  if (++sound_tickCount < SOUND_TICK_REFILL_PERIOD)
+    return;
+  sound_tickCount = 0;
+  sound_refillFifo();
+}
+
+// Does the work of the sound state machine that is too slow for the ISR.
+void sound_update() {
   //  debugStatePrint();
-  static uint32_t arrayIndex = 0;
+  sound_codecTick(); // Send the next codec register write, if any.
+  soundStream_tick(); // Keep the streamed sounds' buffers filled.
+  if (currentState != sound_init_st)
+    sound_runQueue(); // Start or chain queued sounds.
   // Action switch statement.
   switch (currentState) {
   case sound_init_st:
@@ -163,119 +240,203 @@ void sound_tick() {
   // Transistion switch statement.
   switch (currentState) {
   case sound_init_st:
-    if (sound_initFlag) {
+    if (sound_isReady()) { // Sounds started before now play from here.
       currentState = sound_wait_st;
     }
     break;
   case sound_wait_st:
-    if (sound_playSoundFlag) {
-      arrayIndex = 0;
+    if (sound_isBusy()) { // A voice has been started.
+      sound_fillRing();   // Mix ahead before the FIFO starts draining.
       currentState = sound_play_st;
-      sound_resetTxFifo();  // Reset the TX FIFO.
-      sound_enableTxFifo(); // Enable the TX FIFO, disable mute.
+      soundFifo_start(); // Reset and enable the TX FIFO, disable mute.
+      sound_fifoRunning = true; // sound_tick() sends the frames from here.
     }
     break;
   case sound_play_st:
-    // Each time you enter this state, add as many samples as will fit in the
-    // FIFO.
-    if (sound_array == NULL) {
-      printf("ERROR, sound_tick: sound array has not been set.\n");
-      return;
-    }
-    // This while-loop continues to load sound-data into the FIFOs until it is
-    // full or the sound data are exhausted.
-    while (!(Xil_In32(AUDIO_CTRL_BASEADDR + I2S_FIFO_STS_REG) &
-             0b0010)) { // while room in FIFO.
-      uint32_t sampleValue =
-          sound_array[arrayIndex] * sound_currentVolume; // Scale by volume.
-      sound_sendDataToBothChannels(
-          sampleValue); // Send the sound data to the left and right channels.
-      arrayIndex++;     // Go to next sample.
-      if (arrayIndex == sound_sampleCount) { // All done?
-        sound_playSoundFlag = false;         // Yes.
-        sound_disableTxFifo();               // Disable the TX FIFO.
-        currentState = sound_wait_st;        // Go back to the wait state.
-      }
+    // Each time you enter this state, mix as far ahead as the ring allows.
+    // sound_tick() sends the frames to the FIFO as it drains.
+    sound_fillRing();
+    if (!sound_isBusy() &&
+        __atomic_load_n(&sound_ringSentCount, __ATOMIC_ACQUIRE) ==
+            sound_ringMixedCount) { // All mixed and sent?
+      sound_stopFifo();             // Yes, disable the TX FIFO.
+      currentState = sound_wait_st; // Go back to the wait state.
     }
     break;
   }
 }
 
-// Returns true if the sound state machine is not back in its initial state.
-bool sound_isBusy() {
-  return (sound_playSoundFlag); // Busy if NOT in the wait state.
+// Returns true once sound_init() has been called, the codec is set up and
+// the stream pack has been looked for.
+bool sound_isReady() {
+  return sound_initFlag && sound_codecIsIdle() && !soundStream_isOpening();
 }
 
-// Stops the sound and resets the state-machine to the wait state.
+// Returns true while any sound is playing.
+bool sound_isBusy() { return soundMixer_getActiveVoiceCount() > 0; }
+
+// Returns true while sound_update() is mixing or the FIFO is being fed.
+bool sound_isPlaying() {
+  return sound_isBusy() || currentState == sound_play_st;
+}
+
+// Stops all sounds, drops the playlist and resets the state-machine to the
+// wait state.
 void sound_stopSound() {
-  sound_playSoundFlag = false; // disable the state-machine.
+  while (soundQueue_getCount()) // Drop the queued sounds.
+    soundQueue_pop();
+  sound_sequenceRepeatCount = 0;
+  soundMixer_stopAll(); // Free every voice.
+  sound_stopFifo();      // Disable the TX FIFO and drop what was mixed.
   currentState =
       sound_wait_st; // Force the state-machine back to the wait state.
 }
 
-// Use this to set the base address for the array containing sound data.
-// Allow sounds to be interrupted.
-void sound_setSound(sound_sounds_t sound) {
-  if (sound_isBusy()) { // You are currently playing some sound.
-    sound_stopSound(); // Stop the sound and reset the state-machine, FIFO, etc.
+// Selects the sound that sound_startSound() plays. Sounds that are already
+// playing carry on.
+void sound_setSound(sound_sounds_t sound) { sound_selectedSound = sound; }
+
+// Finds what the mixer plays for a sound. Returns false if there is none.
+static bool sound_getSource(sound_sounds_t sound,
+                            soundMixer_source_t *source) {
+  // The pack has one entry per sound, in sound_sounds_t order.
+  const soundPack_entry_t *entry = soundPack_getEntry(sound);
+  if (entry == NULL) {
+    printf("sound_playSound(): bogus sound value(%d)\n", sound);
+    return false;
   }
-  sound_array =
-      NULL; // Set the pointer to NULL so you can detect it never being set.
-  switch (sound) {
-  case sound_gameStart_e:
-    sound_array = gameBoyStartup_wav; // Set the array holding the data.
-    sound_sampleCount =
-        GAMEBOYSTARTUP_WAV_NUMBER_OF_SAMPLES; // Size of the array.
-    break;
-  case sound_gunFire_e:
-    sound_array = bcfire01_48k_wav; // Set the array holding the data.
-    sound_sampleCount =
-        BCFIRE01_48K_WAV_NUMBER_OF_SAMPLES; // Size of the array.
-    break;
-  case sound_hit_e:
-    sound_array = ouch48k_wav; // You get the idea...
-    sound_sampleCount = OUCH48K_WAV_NUMBER_OF_SAMPLES;
-    break;
-  case sound_gunClick_e:
-    sound_array = gunEmpty48k_wav;
-    sound_sampleCount = GUNEMPTY48K_WAV_NUMBER_OF_SAMPLES;
-    break;
-  case sound_gunReload_e:
-    sound_array = powerUp48k_wav;
-    sound_sampleCount = POWERUP48K_WAV_NUMBER_OF_SAMPLES;
-    break;
-  case sound_loseLife_e:
-    sound_array = screamAndDie48k_wav;
-    sound_sampleCount = SCREAMANDDIE48K_WAV_NUMBER_OF_SAMPLES;
-    break;
-  case sound_gameOver_e:
-    sound_array = pacmanDeath_wav;
-    sound_sampleCount = PACMANDEATH_WAV_NUMBER_OF_SAMPLES;
-    break;
-  case sound_returnToBase_e:
-    sound_array = gameOver48k_wav;
-    sound_sampleCount = GAMEOVER48K_WAV_NUMBER_OF_SAMPLES;
-    break;
-  case sound_oneSecondSilence_e:
-    sound_array = soundOfSilence;
-    sound_sampleCount = ONE_SECOND_OF_SOUND_ARRAY_SIZE;
-    break;
-  default:
-    printf("sound_setSound(): bogus sound value(%d)\n", sound);
+  source->format = entry->format;
+  source->data = soundPack_getData(entry);
+  source->sampleCount = entry->sampleCount;
+  source->patch = NULL;
+  source->streamOffset = entry->offset;
+  if (entry->format == SOUND_PACK_FORMAT_STREAM)
+    source->data = NULL; // On the SD card.
+  if (entry->format == SOUND_PACK_FORMAT_STREAM &&
+      !soundStream_hasSound(entry->offset, entry->sampleCount)) {
+    source->format = SOUND_PACK_FORMAT_ADPCM; // Play the start from the pack.
+    source->data = soundPack_getFallbackData(entry);
+    source->sampleCount = entry->fallbackSampleCount;
   }
+  if (entry->format == SOUND_PACK_FORMAT_SYNTH) {
+    if (sound >= sizeof(sound_patches) / sizeof(sound_patches[0]) ||
+        sound_patches[sound] == NULL) {
+      printf("sound_playSound(): no patch for sound(%d)\n", sound);
+      return false;
+    }
+    source->patch = sound_patches[sound];
+    source->sampleCount = source->patch->sampleCount;
+  }
+  return true;
+}
+
+// Returns the usual priority of a sound.
+static uint8_t sound_getPriority(sound_sounds_t sound) {
+  return sound < sizeof(sound_priorities) ? sound_priorities[sound] : 0;
+}
+
+// Starts a sound on a mixer voice, alongside any sounds already playing.
+bool sound_playSoundWithPriority(sound_sounds_t sound, uint16_t volume,
+                                 uint8_t priority) {
+  soundMixer_source_t source;
+  if (!sound_getSource(sound, &source))
+    return false;
+  return soundMixer_start(&source, volume, priority) != SOUND_MIXER_NO_VOICE;
 }
 
 // Tell the state machine to start playing the sound.
-void sound_startSound() { sound_playSoundFlag = true; }
+void sound_startSound() { sound_playSound(sound_selectedSound); }
 
-// Returns true if the sound has been played. State machine will have returned
-// to its initial state.
-bool sound_isSoundComplete() { return (!sound_isBusy()); }
+// Returns true if the sound has been played, and nothing is left in the
+// playlist. State machine will have returned to its initial state.
+bool sound_isSoundComplete() {
+  return !sound_isPlaying() && soundQueue_getCount() == 0 &&
+         sound_sequenceRepeatCount == 0;
+}
 
-// Sets the sound and starts playing the sound immediately.
+// Starts playing the sound immediately, at full volume and its usual
+// priority.
 void sound_playSound(sound_sounds_t sound) {
-  sound_setSound(sound); // Set the sound to be played.
-  sound_startSound();    // Start playing the sound.
+  sound_playSoundWithPriority(sound, SOUND_MIXER_FULL_VOLUME,
+                              sound_getPriority(sound));
+}
+
+/****************************************************************
+ *                         playlist                             *
+ ****************************************************************/
+
+// Adds a command for a sound to the queue, at full volume and its usual
+// priority.
+static bool sound_queueCommand(sound_sounds_t sound, uint8_t repeatCount,
+                               bool chained, uint64_t startTicks) {
+  soundQueue_command_t command = {.sound = sound,
+                                  .repeatCount = repeatCount,
+                                  .priority = sound_getPriority(sound),
+                                  .chained = chained,
+                                  .volume = SOUND_MIXER_FULL_VOLUME,
+                                  .startTicks = startTicks};
+  return soundQueue_push(&command);
+}
+
+// Adds a sound to the playlist, to start a new sequence at startTicks.
+bool sound_queueSound(sound_sounds_t sound, uint8_t repeatCount,
+                      uint64_t startTicks) {
+  return sound_queueCommand(sound, repeatCount, false, startTicks);
+}
+
+// Adds a sound to the playlist, to play straight after the one before it.
+bool sound_queueNextSound(sound_sounds_t sound, uint8_t repeatCount) {
+  return sound_queueCommand(sound, repeatCount, true, SOUND_QUEUE_NOW);
+}
+
+// Works through the playlist as far as it can. A sound that follows on from
+// the sequence is handed to its voice as soon as the voice has room for it,
+// which is as soon as the sound before it has started, so its first block is
+// decoded well before it is needed. A sound whose sequence has ended, or was
+// cut off by a more important sound, starts on a voice of its own.
+static void sound_runQueue() {
+  soundQueue_command_t command;
+  while (true) {
+    bool repeat = sound_sequenceRepeatCount > 0;
+    if (repeat)
+      command = sound_sequenceCommand;
+    else if (!soundQueue_peek(&command))
+      return; // Nothing to do.
+    bool follows = repeat || command.chained;
+    soundMixer_source_t source;
+    if (!sound_getSource(command.sound, &source)) {
+      // Dropped; sound_getSource() says why.
+    } else if (follows && soundMixer_isPlaying(sound_sequenceVoice,
+                                               sound_sequenceStartNumber)) {
+      if (!soundMixer_setNext(sound_sequenceVoice, &source, command.volume,
+                              command.priority))
+        return; // The voice has a sound waiting already.
+    } else {
+      if (!follows && command.startTicks > intervalTimer_nowTicks())
+        return; // Not time yet.
+      sound_sequenceVoice =
+          soundMixer_start(&source, command.volume, command.priority);
+      if (sound_sequenceVoice != SOUND_MIXER_NO_VOICE)
+        sound_sequenceStartNumber =
+            soundMixer_getStartNumber(sound_sequenceVoice);
+    }
+    if (repeat) {
+      sound_sequenceRepeatCount--;
+    } else {
+      sound_sequenceCommand = command;
+      sound_sequenceRepeatCount = command.repeatCount;
+      soundQueue_pop();
+    }
+  }
+}
+
+// Plays 1 second of silence. The mixer generates it; nothing is stored.
+void sound_playOneSecondSilence() { sound_playSound(sound_oneSecondSilence_e); }
+
+// Does what the main loop and the ISR would, for sound_runTest().
+static void sound_testTick() {
+  sound_update();
+  sound_refillFifo(); // The loop is not timed, so refill on every pass.
 }
 
 // Plays several sounds.
@@ -284,13 +445,27 @@ void sound_playSound(sound_sounds_t sound) {
 void sound_runTest() {
   printf("****************** sound_runTest() ****************** \n");
 
+  intervalTimer_startTimestampCounter();
+  uint64_t startTicks = intervalTimer_nowTicks();
   sound_init();
-  sound_tick();
+  uint64_t initTicks = intervalTimer_nowTicks() - startTicks;
+  while (!sound_isReady()) {
+    if (sound_hasFailed()) {
+      printf("The codec could not be set up.\n");
+      return;
+    }
+    sound_testTick();
+  }
+  printf("sound_init() took %lu us; the codec was ready after %lu us.\n",
+         (unsigned long)(initTicks / INTERVAL_TIMER_TICKS_PER_US),
+         (unsigned long)((intervalTimer_nowTicks() - startTicks) /
+                         INTERVAL_TIMER_TICKS_PER_US));
+  sound_testTick();
   sound_setSound(sound_gunClick_e);
   printf("playing gunClick_e\n");
   sound_startSound();
   while (1) {
-    sound_tick();
+    sound_testTick();
     if (!sound_isBusy())
       break;
   }
@@ -298,7 +473,7 @@ void sound_runTest() {
   printf("playing gunFire_e\n");
   sound_startSound();
   while (1) {
-    sound_tick();
+    sound_testTick();
     if (!sound_isBusy())
       break;
   }
@@ -306,7 +481,7 @@ void sound_runTest() {
   printf("playing gunReload_e\n");
   sound_startSound();
   while (1) {
-    sound_tick();
+    sound_testTick();
     if (!sound_isBusy())
       break;
   }
@@ -314,7 +489,7 @@ void sound_runTest() {
   printf("playing loseLife_e\n");
   sound_startSound();
   while (1) {
-    sound_tick();
+    sound_testTick();
     if (!sound_isBusy())
       break;
   }
@@ -322,10 +497,30 @@ void sound_runTest() {
   printf("playing gameOver_e\n");
   sound_startSound();
   while (1) {
-    sound_tick();
+    sound_testTick();
     if (!sound_isBusy())
       break;
   }
+  // The mixer plays these together; the hit is not cut off.
+  printf("playing hit_e under gunFire_e\n");
+  sound_playSound(sound_hit_e);
+  sound_playSound(sound_gunFire_e);
+  while (1) {
+    sound_testTick();
+    if (!sound_isBusy())
+      break;
+  }
+  // One sequence with no gaps, and three clicks over it from half a second
+  // in.
+  printf("queueing hit_e, loseLife_e, returnToBase_e, then gunClick_e x3\n");
+  sound_queueSound(sound_hit_e, 0, SOUND_QUEUE_NOW);
+  sound_queueNextSound(sound_loseLife_e, 0);
+  sound_queueNextSound(sound_returnToBase_e, 0);
+  sound_queueSound(sound_gunClick_e, 2,
+                   intervalTimer_nowTicks() +
+                       SOUND_TEST_QUEUE_DELAY_MS * INTERVAL_TIMER_TICKS_PER_MS);
+  while (!sound_isSoundComplete())
+    sound_testTick();
   printf("done.\n");
 }
 
@@ -339,174 +534,167 @@ void sound_runTest() {
 static XIicPs Iic; /* Instance of the IIC Device */
 
 /***************************************************************************
- * Procedural definitions from the original audio_demo files from digilent.
+ * Codec bring-up. The SSM2603 is set up by a queue of register writes that
+ * sound_update() works through: each write is started on the IIC controller
+ * and checked on a later tick, and the settling delays are deadlines on the
+ * timestamp counter, so nothing here waits.
  ***************************************************************************/
 
-/***  AudioRegSet(XIicPs *IIcPtr, u8 regAddr, u16 regData)
-**
-**  Parameters:
-**    IIcPtr - Pointer to the initialized XIicPs struct
-**    regAddr - Register in the SSM2603 to write to
-**    regData - Data to write to the register (lower 9 bits are used)
-**
-**  Return Value: int
-**    XST_SUCCESS if successful
-**
-**  Errors:
-**
-**  Description:
-**    Writes a value to a register in the SSM2603 device over IIC.
-**
-*/
+#define SOUND_CODEC_QUEUE_SIZE 16
+#define SOUND_CODEC_SETTLE_US 75000 // After the reset and before activating.
+#define SOUND_CODEC_WRITE_ATTEMPTS 3 // Before the set-up is given up.
+#define SOUND_CODEC_IIC_ERROR_MASK                                             \
+  (XIICPS_IXR_ARB_LOST_MASK | XIICPS_IXR_TO_MASK | XIICPS_IXR_NACK_MASK)
 
-#define SEND_BUFFER_SIZE 2
-int AudioRegSet(XIicPs *IIcPtr, u8 regAddr, u16 regData) {
-  int Status;
-  //  u8 SendBuffer[2];
-  u8 SendBuffer[SEND_BUFFER_SIZE]; // We will send 2 bytes at a time.
-  // Register address is stored in bits 7 - 1.
-  SendBuffer[0] = regAddr << 1;
-  // Store data bit 9 in bit 7 of 0th word.
-  SendBuffer[0] = SendBuffer[0] | ((regData >> 8) & 0b1);
-  // Bits 7-0 of data are stored in 8 bits of 1th word.
-  SendBuffer[1] = regData & 0xFF;
-  // Send 2 bytes to the IIC controller attached to the audio CODEC.
-  Status = XIicPs_MasterSendPolled(IIcPtr, SendBuffer, 2, IIC_SLAVE_ADDR);
-  // Always check for success.
-  if (Status != XST_SUCCESS) {
-    printf("IIC send failed\n\r");
-    return XST_FAILURE;
-  }
-  // This function blocks until the IIC is idle.
-  /*
-   * Wait until bus is idle to start another transfer.
-   */
-  volatile int no_op;
-  while (1) {
-    no_op = XIicPs_BusIsBusy(IIcPtr);
-    if (!no_op)
-      break;
-  }
+// One codec register write, and how long the codec needs after it.
+typedef struct {
+  uint8_t regAddr;
+  uint16_t regData; // Lower 9 bits are used.
+  uint32_t delayUs;
+} sound_codecWrite_t;
 
-  // while (XIicPs_BusIsBusy(IIcPtr)) {
-  //   /* NOP */
-  // }
-  // return XST_SUCCESS;
+// Codec states.
+typedef enum {
+  sound_codecIdle_st,  // Waiting for a write to be queued.
+  sound_codecWrite_st, // Waiting for the IIC write to finish.
+  sound_codecDelay_st, // Waiting for the codec to settle after a write.
+  sound_codecError_st  // A write kept failing; waiting for sound_init().
+} sound_codecSt_t;
+
+static sound_codecWrite_t sound_codecQueue[SOUND_CODEC_QUEUE_SIZE];
+static uint8_t sound_codecQueueHead = 0; // Write being sent.
+static uint8_t sound_codecQueueCount = 0;
+static sound_codecSt_t sound_codecState = sound_codecIdle_st;
+static uint8_t sound_codecAttemptCount = 0; // Of the write being sent.
+static uint64_t sound_codecDeadline; // End of the delay, in timestamp ticks.
+
+// Adds a register write to the queue. Returns false if the queue is full.
+static bool sound_codecQueueWrite(u8 regAddr, u16 regData, u32 delayUs) {
+  if (sound_codecQueueCount == SOUND_CODEC_QUEUE_SIZE)
+    return false;
+  sound_codecWrite_t *write =
+      &sound_codecQueue[(sound_codecQueueHead + sound_codecQueueCount) %
+                        SOUND_CODEC_QUEUE_SIZE];
+  write->regAddr = regAddr;
+  write->regData = regData;
+  write->delayUs = delayUs;
+  sound_codecQueueCount++;
+  return true;
 }
 
-/***  AudioInitialize(u16 timerID,  u16 iicID, u32 i2sAddr)
-**
-**  Parameters:
-**    timerID - DEVICE_ID for the SCU timer
-**    iicID   - DEVICE_ID for the PS IIC controller connected to the SSM2603
-**    i2sAddr - Physical Base address of the I2S controller
-**
-**  Return Value: int
-**    XST_SUCCESS if successful
-**
-**  Errors:
-**
-**  Description:
-**    Initializes the Audio demo. Must be called once and only once before
-*calling
-**    AudioRunDemo
-**
-*/
-int AudioInitialize(u16 timerID, u16 iicID, u32 i2sAddr) {
-  int Status;            // Return status value.
-  XIicPs_Config *Config; // Keep track of the config. value.
-  u32 i2sClkDiv;         // Used to help compute the sampling frequency.
-
-  TimerInitialize(
-      timerID); // This is a timer that is used to create precise delays.
-
-  /*
-   * Initialize the IIC driver so that it's ready to use
-   * Look up the configuration in the config table,
-   * then initialize it.
-   */
-  Config = XIicPs_LookupConfig(iicID);
-  if (NULL == Config) {
-    return XST_FAILURE;
-  }
+// Starts sending the write at the head of the queue to the codec. This is
+// XIicPs_MasterSendPolled() without the wait: two bytes fit in the IIC FIFO,
+// and writing the address register starts the transfer.
+static void sound_codecStartWrite() {
+  sound_codecWrite_t *write = &sound_codecQueue[sound_codecQueueHead];
+  u32 baseAddress = Iic.Config.BaseAddress;
+  u32 control = XIicPs_ReadReg(baseAddress, XIICPS_CR_OFFSET);
+  control |= XIICPS_CR_ACKEN_MASK | XIICPS_CR_CLR_FIFO_MASK |
+             XIICPS_CR_NEA_MASK | XIICPS_CR_MS_MASK;
+  control &= ~XIICPS_CR_RD_WR_MASK; // Master transmitter.
+  XIicPs_WriteReg(baseAddress, XIICPS_CR_OFFSET, control);
+  XIicPs_WriteReg(baseAddress, XIICPS_ISR_OFFSET,
+                  XIicPs_ReadReg(baseAddress, XIICPS_ISR_OFFSET)); // Clear.
+  // Register address is stored in bits 7 - 1, with data bit 8 in bit 0.
+  XIicPs_WriteReg(baseAddress, XIICPS_DATA_OFFSET,
+                  (write->regAddr << 1) | ((write->regData >> 8) & 0b1));
+  // Bits 7-0 of data are sent in the second byte.
+  XIicPs_WriteReg(baseAddress, XIICPS_DATA_OFFSET, write->regData & 0xFF);
+  XIicPs_WriteReg(baseAddress, XIICPS_ADDR_OFFSET, IIC_SLAVE_ADDR);
+}
 
-  Status = XIicPs_CfgInitialize(&Iic, Config, Config->BaseAddress);
-  if (Status != XST_SUCCESS) {
-    return XST_FAILURE;
+// Moves the codec bring-up along. Called on every sound_update(). A write
+// that fails is sent again; if it fails SOUND_CODEC_WRITE_ATTEMPTS times the
+// set-up stops in the error state, and the codec is never reported ready.
+static void sound_codecTick() {
+  u32 baseAddress = Iic.Config.BaseAddress;
+  switch (sound_codecState) {
+  case sound_codecWrite_st: {
+    u32 status = XIicPs_ReadReg(baseAddress, XIICPS_ISR_OFFSET);
+    if (status & SOUND_CODEC_IIC_ERROR_MASK) {
+      if (++sound_codecAttemptCount < SOUND_CODEC_WRITE_ATTEMPTS) {
+        sound_codecStartWrite(); // Try the same write again.
+        break;
+      }
+      printf("sound_update(): IIC send to codec register %d failed %d "
+             "times; the codec is not set up.\n\r",
+             sound_codecQueue[sound_codecQueueHead].regAddr,
+             sound_codecAttemptCount);
+      sound_codecState = sound_codecError_st;
+      break;
+    } else if (!(status & XIICPS_IXR_COMP_MASK) ||
+               XIicPs_BusIsBusy(&Iic)) {
+      break; // Still sending.
+    }
+    sound_codecAttemptCount = 0;
+    uint32_t delayUs = sound_codecQueue[sound_codecQueueHead].delayUs;
+    sound_codecQueueHead = (sound_codecQueueHead + 1) % SOUND_CODEC_QUEUE_SIZE;
+    sound_codecQueueCount--;
+    sound_codecDeadline =
+        intervalTimer_nowTicks() + delayUs * INTERVAL_TIMER_TICKS_PER_US;
+    sound_codecState = sound_codecDelay_st;
+  } // Fall through: most writes need no delay.
+  case sound_codecDelay_st:
+    if (intervalTimer_nowTicks() < sound_codecDeadline)
+      break;
+    sound_codecState = sound_codecIdle_st;
+    // Fall through to start the next write.
+  case sound_codecIdle_st:
+    if (sound_codecQueueCount) {
+      sound_codecStartWrite();
+      sound_codecState = sound_codecWrite_st;
+    }
+    break;
+  case sound_codecError_st:
+    break; // Until sound_init() starts the set-up again.
   }
+}
 
-  /*
-   * Perform a self-test to ensure that the hardware was built correctly.
-   */
-  Status = XIicPs_SelfTest(&Iic);
-  if (Status != XST_SUCCESS) {
-    return XST_FAILURE;
-  }
+// Returns true when every queued write has been sent.
+static bool sound_codecIsIdle() {
+  return sound_codecState == sound_codecIdle_st && !sound_codecQueueCount;
+}
 
-  /*
-   * Set the IIC serial clock rate.
-   */
-  Status = XIicPs_SetSClk(&Iic, IIC_SCLK_RATE);
-  if (Status != XST_SUCCESS) {
-    return XST_FAILURE;
+// Returns true if the codec set-up was given up.
+bool sound_hasFailed() { return sound_codecState == sound_codecError_st; }
+
+// Sets up the IIC controller and queues the codec register writes. The I2S
+// clocks are set straight away. Returns SOUND_STATUS_FAIL if the IIC
+// controller cannot be set up.
+static sound_status_t sound_codecInit() {
+  intervalTimer_startTimestampCounter(); // For the settling delays.
+  XIicPs_Config *Config = XIicPs_LookupConfig(AUDIO_IIC_ID);
+  if (NULL == Config ||
+      XIicPs_CfgInitialize(&Iic, Config, Config->BaseAddress) != XST_SUCCESS ||
+      XIicPs_SelfTest(&Iic) != XST_SUCCESS ||
+      XIicPs_SetSClk(&Iic, IIC_SCLK_RATE) != XST_SUCCESS) {
+    printf("sound_init(): IIC setup failed\n\r");
+    return SOUND_STATUS_FAIL;
   }
+  sound_codecQueueHead = 0;
+  sound_codecQueueCount = 0;
+  sound_codecState = sound_codecIdle_st;
+  sound_codecAttemptCount = 0;
 
   /*
    * Write to the SSM2603 audio codec registers to configure the device. Refer
    * to the SSM2603 Audio Codec data sheet for information on what these writes
    * do.
    */
-
-  // Perform Reset
-  Status = AudioRegSet(&Iic, 15, 0b000000000);
-  if (Status)
-    printf("Status1:%d\n", Status);
-  TimerDelay(75000);
-  // Power up
-  Status |= AudioRegSet(&Iic, 6, 0b000110000);
-  if (Status)
-    printf("Status2:%d\n", Status);
-  // Left-channel ADC input volume.
-  Status |= AudioRegSet(&Iic, 0, 0b000010111);
-  if (Status)
-    printf("Status3:%d\n", Status);
-  // Right-channel ADC input volume.
-  AudioRegSet(&Iic, 1, 0b000010111);
-  // Left-channel DAC volume. Also set
-  Status |= AudioRegSet(&Iic, 2, 0b101111001);
-  if (Status)
-    printf("Status4:%d\n", Status);
-  // right volume to same value.
-  Status |= AudioRegSet(&Iic, 4, 0b000010000); // Analog audio path.
-  if (Status)
-    printf("Status5:%d\n", Status);
-  Status |= AudioRegSet(&Iic, 5, 0b000000000); // Digital audio path.
-  if (Status)
-    printf("Status6:%d\n", Status);
-  // Changed so Word length is 24  Status |= AudioRegSet(&Iic,
-  // 8, 0b000000000); //Changed so no CLKDIV2
-  Status |= AudioRegSet(&Iic, 7, 0b000001010);
-  if (Status)
-    printf("Status7:%d\n", Status);
-  // Changed so no CLKDIV2
-  Status |= AudioRegSet(&Iic, 8, 0b000000000);
-  if (Status)
-    printf("Status8:%d\n", Status);
-  // Wait for things to settle down.
-  TimerDelay(75000);
-  // Make things active.
-  Status |= AudioRegSet(&Iic, 9, 0b000000001);
-  if (Status)
-    printf("Status9:%d\n", Status);
-  // Power-up the ouput (OSC is left
-  // disabled as MCLK pin provides clock).
-  Status |= AudioRegSet(&Iic, 6, 0b000100000);
-  if (Status)
-    printf("Status10:%d\n", Status);
-
-  if (Status != XST_SUCCESS) {
-    return XST_FAILURE;
-  }
+  sound_codecQueueWrite(15, 0b000000000, SOUND_CODEC_SETTLE_US); // Reset.
+  sound_codecQueueWrite(6, 0b000110000, 0); // Power up.
+  sound_codecQueueWrite(0, 0b000010111, 0); // Left-channel ADC input volume.
+  sound_codecQueueWrite(1, 0b000010111, 0); // Right-channel ADC input volume.
+  // Left-channel DAC volume. Also set right volume to same value.
+  sound_codecQueueWrite(2, 0b101111001, 0);
+  sound_codecQueueWrite(4, 0b000010000, 0); // Analog audio path.
+  sound_codecQueueWrite(5, 0b000000000, 0); // Digital audio path.
+  sound_codecQueueWrite(7, 0b000001010, 0); // Changed so Word length is 24.
+  // Changed so no CLKDIV2. Wait for things to settle down.
+  sound_codecQueueWrite(8, 0b000000000, SOUND_CODEC_SETTLE_US);
+  sound_codecQueueWrite(9, 0b000000001, 0); // Make things active.
+  // Power-up the ouput (OSC is left disabled as MCLK pin provides clock).
+  sound_codecQueueWrite(6, 0b000100000, 0);
 
   // BLH: This is the original value used by digilent.
   //  i2sClkDiv = 1; //Set the BCLK to be MCLK / 4
@@ -514,13 +702,12 @@ int AudioInitialize(u16 timerID, u16 iicID, u32 i2sAddr) {
   // Not sure what the problem is, perhaps the DLL is not running at the correct
   // frequency? or, there is a bug in the IP that drives the CODEC. In any case,
   // the sampling rate is 48k.
-  i2sClkDiv = 3;
+  u32 i2sClkDiv = 3;
   // Set the LRCLK's to be BCLK / 64
   i2sClkDiv = i2sClkDiv | (31 << 16);
   // Write clock div register
-  Xil_Out32(i2sAddr + I2S_CLK_CTRL_REG, i2sClkDiv);
-
-  return XST_SUCCESS;
+  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_CLK_CTRL_REG, i2sClkDiv);
+  return SOUND_STATUS_OK;
 }
 
 /* ------------------------------------------------------------ */
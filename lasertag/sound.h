@@ -29,7 +29,7 @@ typedef uint32_t sound_status_t;
 #define IIC_SLAVE_ADDR 0b0011010
 #define IIC_SCLK_RATE 100000
 
-// Sound levels.
+// Sound levels, as Q15 gains (see soundOutput.h).
 #define SOUND_VOLUME_3 (INT16_MAX) // Max volume
 #define SOUND_VOLUME_2 (INT16_MAX / 8)
 #define SOUND_VOLUME_1 (INT16_MAX / 32)
@@ -37,6 +37,21 @@ typedef uint32_t sound_status_t;
 
 #define NO_SOUND 0 // A zero generates no sound.
 
+// The work is split between the ISR and the main loop. The I2S FIFO holds
+// only 167 us of sound, less than a pass of the main loop while detector()
+// runs or the display is drawn, so sound_tick() refills it from
+// isr_function(), on every SOUND_TICK_REFILL_PERIOD-th tick. Mixing and
+// decoding are too slow for the ISR, so sound_update() does them from the
+// main loop (the scheduler's sound task), mixing up to SOUND_RING_FRAME_COUNT
+// frames ahead into a ring that sound_tick() sends from. The main loop may
+// stall for that long without a gap in the sound, and a sound started while
+// others play is heard after the frames already mixed.
+#define SOUND_RING_FRAME_COUNT 2048 // 43 ms at 48 kHz; a power of two.
+// 80 us between refills: the FIFO is still about half full at each one, which
+// leaves 80 us for the ISR to be late. A refill sends about four frames; on
+// the other ticks sound_tick() only counts.
+#define SOUND_TICK_REFILL_PERIOD 8
+
 // sound-specific defines.
 typedef enum {
   sound_gameStart_e,       // Play a sound when the game starts.
@@ -59,20 +74,44 @@ typedef enum {
   sound_maximumVolume_e = SOUND_VOLUME_3     // Really loud.
 } sound_volume_t;
 
-// Must be called before using the sound state machine.
+// Must be called before using the sound state machine. Returns at once: the
+// codec is set up over IIC, and the SD card that the long sounds are streamed
+// from is looked for (see soundStream.h), by later calls to sound_update(),
+// which take about 150 ms. Sounds started before then play once it is ready.
+// Without the card, or the stream pack on it, the long sounds play the
+// fallback kept in the sound pack, their first second, as does one started
+// with sound_playSound() before the card has been found.
 sound_status_t sound_init();
 
-// Standard tick function.
+// Returns true once the codec has been set up and the SD card looked for.
+bool sound_isReady();
+
+// Returns true if the codec could not be set up over IIC: a register write
+// failed even when retried. sound_isReady() then stays false and nothing is
+// heard; call sound_init() to start the set-up again.
+bool sound_hasFailed();
+
+// Standard tick function. Call it from isr_function() on every tick: every
+// SOUND_TICK_REFILL_PERIOD ticks it sends the mixed frames to the I2S FIFO,
+// which costs a few register accesses per frame. soundFifo_runTest() prints
+// what that costs per tick.
 void sound_tick();
 
-// Returns true if the sound state machine is not back in its initial state.
+// Mixes ahead, moves the codec set-up, the streamed sounds and the playlist
+// along. Call it from the main loop, at least every SCHEDULER_SOUND_MIX_PERIOD
+// while sound_isPlaying(); scheduler_addLasertagTasks() adds a task for it.
+void sound_update();
+
+// Returns true while any sound is playing.
 bool sound_isBusy();
 
-// Use this to set the base address for the array containing sound data.
-void sound_setSound(sound_sounds_t sound);
+// Returns true while sound_update() is mixing or the I2S FIFO is being fed,
+// and so sound_update() needs to be called every SCHEDULER_SOUND_MIX_PERIOD.
+bool sound_isPlaying();
 
-// Set the sample rate. Should only do this when no sound is currently playing.
-sound_status_t sound_setSampleRate(uint32_t sampleRate);
+// Selects the sound that sound_startSound() plays. Sounds that are already
+// playing carry on.
+void sound_setSound(sound_sounds_t sound);
 
 // Used to set the volume. Use one of the provided values.
 void sound_setVolume(sound_volume_t);
@@ -80,19 +119,43 @@ void sound_setVolume(sound_volume_t);
 // Tell the state machine to start playing the sound.
 void sound_startSound();
 
-// Tell the state machine to stop playing the sound.
+// Stops every sound that is playing and empties the playlist. Call it from
+// the main loop, as sound_update() is.
 void sound_stopSound();
 
-// Returns true if the sound has been played. State machine will have returned
-// to its initial state.
+// Returns true if the sound has been played and the playlist is empty. State
+// machine will have returned to its initial state.
 bool sound_isSoundComplete();
 
-// Sets the sound and starts playing it immediately.
+// Starts playing the sound immediately, mixed with any sounds already
+// playing, at full volume and its usual priority.
 void sound_playSound(sound_sounds_t sound);
 
+// Starts playing the sound on a mixer voice with the given volume (Q15, see
+// soundMixer.h) and priority. If every voice is busy it replaces the oldest of
+// the lowest-priority sounds, unless that priority is higher. Returns false if
+// the sound could not be started.
+bool sound_playSoundWithPriority(sound_sounds_t sound, uint16_t volume,
+                                 uint8_t priority);
+
 // Plays 1 second of silence.
 void sound_playOneSecondSilence();
 
+// The playlist: sound_update() starts the sounds queued here itself, so game
+// code does not have to wait for one sound to finish to start the next (see
+// soundQueue.h). Sounds play at full volume and their usual priority, 1 +
+// repeatCount times in a row. These return false if the playlist is full.
+
+// Adds a sound that starts a new sequence at startTicks, a time on
+// intervalTimer_nowTicks(), or at once if startTicks is SOUND_QUEUE_NOW (0).
+// It plays alongside any sounds already playing.
+bool sound_queueSound(sound_sounds_t sound, uint8_t repeatCount,
+                      uint64_t startTicks);
+
+// Adds a sound that plays straight after the one queued before it, from the
+// very next sample.
+bool sound_queueNextSound(sound_sounds_t sound, uint8_t repeatCount);
+
 // Used to test sounds.
 void sound_runTest();
 
@@ -0,0 +1,157 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "soundFifo.h"
+#include "intervalTimer.h"
+#include "sound.h"
+#include "xil_io.h"
+#include "xparameters.h"
+#include <math.h>
+#include <stdio.h>
+
+#define SOUND_FIFO_BASEADDR XPAR_AXI_I2S_ADI_1_S_AXI_BASEADDR
+#define SOUND_FIFO_TX_EMPTY_MASK 0b0001
+#define SOUND_FIFO_TX_FULL_MASK 0b0010
+#define SOUND_FIFO_RESET_TX 0b010
+#define SOUND_FIFO_ENABLE_TX 0b001 // Also turns mute off.
+#define SOUND_FIFO_DISABLE 0b000
+
+#define SOUND_FIFO_TEST_MS 250
+#define SOUND_FIFO_TEST_TONE_FRAMES 48 // One cycle of 1 kHz.
+#define SOUND_FIFO_TEST_WORD_SHIFT 16  // A 16-bit sample in bits 31-16.
+#define SOUND_FIFO_TEST_AMPLITUDE 8000.0
+#define SOUND_FIFO_TEST_ISR_TICK_US 10 // The timer interrupt.
+#define SOUND_FIFO_TEST_ISR_PERIOD_US                                          \
+  (SOUND_FIFO_TEST_ISR_TICK_US * SOUND_TICK_REFILL_PERIOD) // As sound_tick().
+#define SOUND_FIFO_TEST_MAIN_LOOP_PERIOD_US 1000 // A main loop that is busy.
+
+static bool soundFifo_playing = false; // Frames written since it last ran dry.
+static bool soundFifo_rightPending = false; // A frame's right word is held.
+static uint32_t soundFifo_rightWord;
+static uint32_t soundFifo_underrunCount = 0;
+
+// Returns true if the TX FIFO has no room for another word.
+static bool soundFifo_isFull() {
+  return Xil_In32(SOUND_FIFO_BASEADDR + I2S_FIFO_STS_REG) &
+         SOUND_FIFO_TX_FULL_MASK;
+}
+
+// Resets the TX FIFO and enables the transmitter.
+void soundFifo_start() {
+  Xil_Out32(SOUND_FIFO_BASEADDR + I2S_RESET_REG, SOUND_FIFO_RESET_TX);
+  Xil_Out32(SOUND_FIFO_BASEADDR + I2S_CTRL_REG, SOUND_FIFO_ENABLE_TX);
+  soundFifo_playing = false;
+  soundFifo_rightPending = false;
+}
+
+// Disables the transmitter.
+void soundFifo_stop() {
+  Xil_Out32(SOUND_FIFO_BASEADDR + I2S_CTRL_REG, SOUND_FIFO_DISABLE);
+  soundFifo_playing = false;
+}
+
+// Writes up to count frames, until the FIFO is full. Returns the number
+// taken.
+uint32_t soundFifo_write(const uint32_t frames[], uint32_t count) {
+  uint32_t status = Xil_In32(SOUND_FIFO_BASEADDR + I2S_FIFO_STS_REG);
+  if ((status & SOUND_FIFO_TX_EMPTY_MASK) && soundFifo_playing) {
+    soundFifo_underrunCount++; // It ran dry before this refill.
+    soundFifo_playing = false; // Count each dry spell once.
+  }
+  if (status & SOUND_FIFO_TX_FULL_MASK)
+    return 0;
+  if (soundFifo_rightPending) { // Finish the frame from the last refill.
+    Xil_Out32(SOUND_FIFO_BASEADDR + I2S_TX_FIFO_REG, soundFifo_rightWord);
+    soundFifo_rightPending = false;
+    if (soundFifo_isFull())
+      return 0;
+  }
+  uint32_t taken = 0;
+  while (taken < count) {
+    uint32_t word = frames[taken++];
+    Xil_Out32(SOUND_FIFO_BASEADDR + I2S_TX_FIFO_REG, word); // Left.
+    soundFifo_playing = true;
+    if (soundFifo_isFull()) {
+      soundFifo_rightWord = word; // Sent first on the next refill.
+      soundFifo_rightPending = true;
+      break;
+    }
+    Xil_Out32(SOUND_FIFO_BASEADDR + I2S_TX_FIFO_REG, word); // Right.
+    if (soundFifo_isFull())
+      break;
+  }
+  return taken;
+}
+
+// Returns the number of times the FIFO ran dry while a sound was playing.
+uint32_t soundFifo_getUnderrunCount() { return soundFifo_underrunCount; }
+
+// Plays the tone for SOUND_FIFO_TEST_MS, refilling the FIFO every periodUs
+// microseconds, and returns the number of underruns. Sets refillNs to the
+// mean cost of a refill.
+static uint32_t soundFifo_testPeriod(const char *name, uint32_t periodUs,
+                                     const uint32_t tone[],
+                                     uint64_t *refillNs) {
+  uint64_t period = intervalTimer_usToTicks(periodUs);
+  uint32_t underrunCount = soundFifo_underrunCount;
+  uint64_t refillTicks = 0;
+  uint32_t refillCount = 0;
+  uint32_t toneIndex = 0;
+  intervalTimer_startTimestampCounter();
+  soundFifo_start();
+  uint64_t wakeTick = intervalTimer_nowTicks();
+  uint64_t endTick =
+      wakeTick + SOUND_FIFO_TEST_MS * INTERVAL_TIMER_TICKS_PER_MS;
+  while (wakeTick < endTick) {
+    while (intervalTimer_nowTicks() < wakeTick)
+      ; // Sleep until the next refill.
+    uint64_t startTick = intervalTimer_nowTicks();
+    toneIndex += soundFifo_write(&tone[toneIndex], SOUND_FIFO_TEST_TONE_FRAMES);
+    toneIndex %= SOUND_FIFO_TEST_TONE_FRAMES;
+    refillTicks += intervalTimer_nowTicks() - startTick;
+    refillCount++;
+    wakeTick += period;
+  }
+  soundFifo_stop();
+  underrunCount = soundFifo_underrunCount - underrunCount;
+  *refillNs = intervalTimer_ticksToNs(refillTicks / refillCount);
+  printf("%s: refilled every %lu us, %lu underruns, %lu ns per refill.\n\r",
+         name, (unsigned long)(period / INTERVAL_TIMER_TICKS_PER_US),
+         (unsigned long)underrunCount, (unsigned long)*refillNs);
+  return underrunCount;
+}
+
+// Plays a tone refilled from the timer interrupt and from a busy main loop.
+bool soundFifo_runTest() {
+  printf("****************** soundFifo_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  // Two cycles, so that a refill can start anywhere in the first.
+  uint32_t tone[2 * SOUND_FIFO_TEST_TONE_FRAMES];
+  for (uint32_t i = 0; i < 2 * SOUND_FIFO_TEST_TONE_FRAMES; i++)
+    tone[i] = (uint32_t)(int32_t)(SOUND_FIFO_TEST_AMPLITUDE *
+                                  sin(2 * M_PI * i /
+                                      SOUND_FIFO_TEST_TONE_FRAMES))
+              << SOUND_FIFO_TEST_WORD_SHIFT;
+  uint64_t refillNs;
+  soundFifo_testPeriod("Main loop", SOUND_FIFO_TEST_MAIN_LOOP_PERIOD_US, tone,
+                       &refillNs);
+  if (soundFifo_testPeriod("Interrupt", SOUND_FIFO_TEST_ISR_PERIOD_US, tone,
+                           &refillNs)) {
+    printf("The FIFO ran dry when refilled from the interrupt.\n\r");
+    success = false;
+  }
+  // sound_tick() refills on one tick in SOUND_TICK_REFILL_PERIOD and only
+  // counts on the others.
+  uint64_t tickNs = refillNs / SOUND_TICK_REFILL_PERIOD;
+  printf("sound_tick() costs the ISR about %lu ns per %d us tick (%.1f%%).\n\r",
+         (unsigned long)tickNs, SOUND_FIFO_TEST_ISR_TICK_US,
+         tickNs / (SOUND_FIFO_TEST_ISR_TICK_US * 10.0));
+  printf("soundFifo_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
@@ -0,0 +1,63 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SOUNDFIFO_H_
+#define SOUNDFIFO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Refills the I2S transmit FIFO (axi_i2s_adi, platforms/hw/ip/axi_i2s_adi_1.2).
+//
+// The IP has no interrupt output, and the FIFO holds only 8 stereo frames
+// (167 us at 48 kHz), so it is refilled from the 100 kHz timer interrupt:
+// every SOUND_TICK_REFILL_PERIOD ticks (80 us), sound_tick() calls
+// soundFifo_write() with the frames that sound_update() has mixed ahead. The
+// status register only says whether the TX FIFO is empty or full, which is
+// the only occupancy the IP exposes, so a refill writes until the FIFO
+// reports full. That tracks the codec's own frame
+// clock, whatever its drift against the processor's timers. A refill every
+// 80 us finds room for about four frames, and costs a few register accesses
+// per frame.
+//
+// The left and right words of a frame drain at different times, so the FIFO
+// can fill up after the left word. The right word is then held and written
+// first on the next refill, so the channels never swap.
+//
+// Frames are FIFO words that are already scaled, so a refill is only stores.
+// Each word is sent to both the left and the right channel.
+
+#define SOUND_FIFO_WORD_COUNT 16 // C_NUM_CH * 8 entries in the IP.
+#define SOUND_FIFO_FRAME_COUNT (SOUND_FIFO_WORD_COUNT / 2) // Stereo frames.
+#define SOUND_FIFO_SAMPLE_RATE 48000
+
+// Resets the TX FIFO and enables the transmitter.
+void soundFifo_start();
+
+// Disables the transmitter.
+void soundFifo_stop();
+
+// Writes up to count frames, as many as fit. Returns the number taken: a
+// frame whose right word did not fit is taken, and the word sent on the next
+// call.
+uint32_t soundFifo_write(const uint32_t frames[], uint32_t count);
+
+// Returns the number of times the FIFO ran dry while a sound was playing,
+// since the program started.
+uint32_t soundFifo_getUnderrunCount();
+
+// Plays a tone refilled every SOUND_TICK_REFILL_PERIOD ticks, as by
+// sound_tick(), and every millisecond, as from a busy main loop, and prints
+// the underruns and the cost of a refill for each, and the ISR time that
+// sound_tick() takes per tick. On the board, call sound_init() first so that
+// the I2S clocks are set up. Returns true if the FIFO never runs dry when
+// refilled as by sound_tick().
+bool soundFifo_runTest();
+
+#endif /* SOUNDFIFO_H_ */
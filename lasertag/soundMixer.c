@@ -0,0 +1,454 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "soundMixer.h"
+#include "adpcm.h"
+#include "intervalTimer.h"
+#include "sounds/soundPack.h"
+#include <math.h>
+#include <stdio.h>
+
+#define SOUND_MIXER_TEST_SAMPLE_COUNT 4800 // 0.1 s at 48 kHz.
+#define SOUND_MIXER_TEST_SAMPLE_RATE 48000.0
+#define SOUND_MIXER_TEST_AMPLITUDE 16000.0
+#define SOUND_MIXER_TEST_BASE_HZ 300.0
+#define SOUND_MIXER_TEST_LOUD 30000
+#define SOUND_MIXER_TEST_SHORT_COUNT 5
+#define SOUND_MIXER_TEST_TIMING_COUNT 20 // Passes over the test sounds.
+
+// A source being played, and how far it has got.
+typedef struct {
+  uint8_t format;
+  uint8_t priority;
+  uint16_t volume;
+  const uint8_t *data;
+  uint32_t sampleCount;
+  uint32_t position; // Number of the next sample to decode.
+  union {            // Only one is in use, depending on the format.
+    adpcm_decoder_t decoder;
+    soundSynth_voice_t synth;
+    soundStream_t *reader;
+  };
+  // Samples decoded before the stream started playing, which are played
+  // before any more are decoded.
+  int16_t staged[SOUND_MIXER_BLOCK_SIZE];
+  uint8_t stagedIndex;
+  uint8_t stagedCount;
+} soundMixer_stream_t;
+
+typedef struct {
+  bool active;
+  bool hasNext;         // next plays straight after stream.
+  uint32_t startNumber; // Orders the voices by age.
+  soundMixer_stream_t stream;
+  soundMixer_stream_t next;
+} soundMixer_voice_t;
+
+static soundMixer_voice_t soundMixer_voices[SOUND_MIXER_VOICE_COUNT];
+static uint8_t soundMixer_activeVoiceCount = 0;
+static uint32_t soundMixer_startCount = 0;
+
+// Stops all voices.
+void soundMixer_init() { soundMixer_stopAll(); }
+
+// Returns the voice to use for a sound of the given priority, or
+// SOUND_MIXER_NO_VOICE.
+static int8_t soundMixer_findVoice(uint8_t priority) {
+  int8_t victim = SOUND_MIXER_NO_VOICE;
+  for (int8_t i = 0; i < SOUND_MIXER_VOICE_COUNT; i++) {
+    soundMixer_voice_t *voice = &soundMixer_voices[i];
+    if (!voice->active)
+      return i;
+    if (victim == SOUND_MIXER_NO_VOICE ||
+        voice->stream.priority < soundMixer_voices[victim].stream.priority ||
+        (voice->stream.priority ==
+             soundMixer_voices[victim].stream.priority &&
+         (int32_t)(voice->startNumber -
+                   soundMixer_voices[victim].startNumber) < 0))
+      victim = i;
+  }
+  return soundMixer_voices[victim].stream.priority <= priority
+             ? victim
+             : SOUND_MIXER_NO_VOICE;
+}
+
+// Sets a stream up to play a source from its first sample.
+static void soundMixer_initStream(soundMixer_stream_t *stream,
+                                  const soundMixer_source_t *source,
+                                  uint16_t volume, uint8_t priority) {
+  stream->format = source->format;
+  stream->priority = priority;
+  stream->volume = volume;
+  stream->data = source->data;
+  stream->sampleCount = source->sampleCount;
+  stream->position = 0;
+  stream->stagedIndex = 0;
+  stream->stagedCount = 0;
+  if (source->format == SOUND_PACK_FORMAT_ADPCM)
+    adpcm_initDecoder(&stream->decoder, source->data, source->sampleCount);
+  else if (source->format == SOUND_PACK_FORMAT_SYNTH)
+    soundSynth_start(&stream->synth, source->patch);
+  else if (source->format == SOUND_PACK_FORMAT_STREAM) {
+    stream->reader =
+        soundStream_open(source->streamOffset, source->sampleCount);
+    if (stream->reader == NULL) // soundMixer_canPlay() was not asked.
+      stream->sampleCount = 0;  // End at once.
+  }
+}
+
+// Returns true if a source can be played now: a streamed one needs a reader,
+// and the stream pack must hold it.
+static bool soundMixer_canPlay(const soundMixer_source_t *source) {
+  return source->format != SOUND_PACK_FORMAT_STREAM ||
+         (soundStream_isAvailable() &&
+          soundStream_hasSound(source->streamOffset, source->sampleCount));
+}
+
+// Frees a voice's streams, giving back any readers they hold.
+static void soundMixer_releaseVoice(soundMixer_voice_t *voice) {
+  if (voice->stream.format == SOUND_PACK_FORMAT_STREAM)
+    soundStream_close(voice->stream.reader);
+  if (voice->hasNext && voice->next.format == SOUND_PACK_FORMAT_STREAM)
+    soundStream_close(voice->next.reader);
+  voice->hasNext = false;
+}
+
+// Starts playing the source on a voice.
+int8_t soundMixer_start(const soundMixer_source_t *source, uint16_t volume,
+                        uint8_t priority) {
+  if (!soundMixer_canPlay(source))
+    return SOUND_MIXER_NO_VOICE;
+  int8_t number = soundMixer_findVoice(priority);
+  if (number == SOUND_MIXER_NO_VOICE)
+    return SOUND_MIXER_NO_VOICE;
+  soundMixer_voice_t *voice = &soundMixer_voices[number];
+  if (!voice->active)
+    soundMixer_activeVoiceCount++;
+  else
+    soundMixer_releaseVoice(voice); // Stolen.
+  voice->active = true;
+  voice->hasNext = false;
+  voice->startNumber = soundMixer_startCount++;
+  soundMixer_initStream(&voice->stream, source, volume, priority);
+  return number;
+}
+
+// Returns the start number of the sound on a voice.
+uint32_t soundMixer_getStartNumber(int8_t voice) {
+  return soundMixer_voices[voice].startNumber;
+}
+
+// Returns true while a voice is still playing the sound it was given by the
+// start that returned startNumber.
+bool soundMixer_isPlaying(int8_t voice, uint32_t startNumber) {
+  return voice >= 0 && voice < SOUND_MIXER_VOICE_COUNT &&
+         soundMixer_voices[voice].active &&
+         soundMixer_voices[voice].startNumber == startNumber;
+}
+
+// Reads up to count samples of a stream. Declared here for staging.
+static uint32_t soundMixer_read(soundMixer_stream_t *stream, int16_t samples[],
+                                uint32_t count);
+
+// Queues a source to play on a voice straight after its current one, and
+// decodes its first block now.
+bool soundMixer_setNext(int8_t voice, const soundMixer_source_t *source,
+                        uint16_t volume, uint8_t priority) {
+  if (voice < 0 || voice >= SOUND_MIXER_VOICE_COUNT ||
+      !soundMixer_voices[voice].active || soundMixer_voices[voice].hasNext ||
+      !soundMixer_canPlay(source))
+    return false;
+  soundMixer_stream_t *next = &soundMixer_voices[voice].next;
+  soundMixer_initStream(next, source, volume, priority);
+  next->stagedCount =
+      soundMixer_read(next, next->staged, SOUND_MIXER_BLOCK_SIZE);
+  soundMixer_voices[voice].hasNext = true;
+  return true;
+}
+
+// Returns true if a voice has a source queued by soundMixer_setNext() that
+// has not started yet.
+bool soundMixer_hasNext(int8_t voice) {
+  return voice >= 0 && voice < SOUND_MIXER_VOICE_COUNT &&
+         soundMixer_voices[voice].active && soundMixer_voices[voice].hasNext;
+}
+
+// Stops a voice.
+void soundMixer_stop(int8_t voice) {
+  if (voice < 0 || voice >= SOUND_MIXER_VOICE_COUNT ||
+      !soundMixer_voices[voice].active)
+    return;
+  soundMixer_releaseVoice(&soundMixer_voices[voice]);
+  soundMixer_voices[voice].active = false;
+  soundMixer_activeVoiceCount--;
+}
+
+// Stops all voices.
+void soundMixer_stopAll() {
+  for (int8_t i = 0; i < SOUND_MIXER_VOICE_COUNT; i++) {
+    if (soundMixer_voices[i].active)
+      soundMixer_releaseVoice(&soundMixer_voices[i]);
+    soundMixer_voices[i].active = false;
+  }
+  soundMixer_activeVoiceCount = 0;
+}
+
+// Returns the number of voices that are playing.
+uint8_t soundMixer_getActiveVoiceCount() { return soundMixer_activeVoiceCount; }
+
+// Reads up to count samples of a stream, staged ones first. Returns the
+// number read; silence returns its count without writing anything.
+static uint32_t soundMixer_read(soundMixer_stream_t *stream, int16_t samples[],
+                                uint32_t count) {
+  uint32_t staged = 0;
+  for (; staged < count && stream->stagedIndex < stream->stagedCount; staged++)
+    samples[staged] = stream->staged[stream->stagedIndex++];
+  samples += staged;
+  count -= staged;
+  uint32_t remaining = stream->sampleCount - stream->position;
+  if (count > remaining)
+    count = remaining;
+  switch (stream->format) {
+  case SOUND_PACK_FORMAT_ADPCM:
+    count = adpcm_decode(&stream->decoder, samples, count);
+    break;
+  case SOUND_PACK_FORMAT_SYNTH:
+    count = soundSynth_render(&stream->synth, samples, count);
+    break;
+  case SOUND_PACK_FORMAT_STREAM:
+    count = soundStream_read(stream->reader, samples, count);
+    if (!count && !soundStream_isOpen())
+      stream->sampleCount = stream->position; // Given up on; end it here.
+    break;
+  case SOUND_PACK_FORMAT_PCM16: {
+    const int16_t *pcm = (const int16_t *)stream->data + stream->position;
+    for (uint32_t i = 0; i < count; i++)
+      samples[i] = pcm[i];
+    break;
+  }
+  default:
+    break;
+  }
+  stream->position += count;
+  return staged + count;
+}
+
+// Returns true once every sample of a stream has been read.
+static bool soundMixer_isFinished(const soundMixer_stream_t *stream) {
+  return stream->position == stream->sampleCount &&
+         stream->stagedIndex == stream->stagedCount;
+}
+
+// Mixes the next count samples of all voices into samples[].
+void soundMixer_mix(int16_t samples[], uint32_t count) {
+  int32_t sum[SOUND_MIXER_BLOCK_SIZE] = {0};
+  int16_t voiceSamples[SOUND_MIXER_BLOCK_SIZE];
+  if (count > SOUND_MIXER_BLOCK_SIZE)
+    count = SOUND_MIXER_BLOCK_SIZE;
+  for (int8_t v = 0; v < SOUND_MIXER_VOICE_COUNT; v++) {
+    soundMixer_voice_t *voice = &soundMixer_voices[v];
+    if (!voice->active)
+      continue;
+    uint32_t done = 0;
+    while (true) {
+      soundMixer_stream_t *stream = &voice->stream;
+      uint32_t read = soundMixer_read(stream, voiceSamples, count - done);
+      if (stream->format != SOUND_PACK_FORMAT_SILENCE) {
+        int32_t volume = stream->volume;
+        for (uint32_t i = 0; i < read; i++)
+          sum[done + i] +=
+              (voiceSamples[i] * volume) >> SOUND_MIXER_VOLUME_SHIFT;
+      }
+      done += read;
+      if (!soundMixer_isFinished(stream))
+        break; // The block is full, or a streamed source has run dry.
+      if (!voice->hasNext) {
+        soundMixer_releaseVoice(voice);
+        voice->active = false; // Finished; free the voice.
+        soundMixer_activeVoiceCount--;
+        break;
+      }
+      if (stream->format == SOUND_PACK_FORMAT_STREAM)
+        soundStream_close(stream->reader);
+      voice->stream = voice->next; // Carry on from the very next sample.
+      voice->hasNext = false;
+      if (done == count)
+        break;
+    }
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    int32_t value = sum[i];
+    if (value > INT16_MAX)
+      value = INT16_MAX;
+    else if (value < INT16_MIN)
+      value = INT16_MIN;
+    samples[i] = value;
+  }
+}
+
+static int16_t soundMixer_testPcm[SOUND_MIXER_TEST_SAMPLE_COUNT];
+static uint8_t soundMixer_testAdpcm[SOUND_MIXER_VOICE_COUNT]
+                                   [SOUND_MIXER_TEST_SAMPLE_COUNT / 2 +
+                                    (SOUND_MIXER_TEST_SAMPLE_COUNT /
+                                         ADPCM_BLOCK_SAMPLE_COUNT +
+                                     1) *
+                                        ADPCM_BLOCK_HEADER_SIZE];
+
+// Fills soundMixer_testPcm with a constant.
+static void soundMixer_testFill(int16_t value) {
+  for (uint32_t i = 0; i < SOUND_MIXER_TEST_SAMPLE_COUNT; i++)
+    soundMixer_testPcm[i] = value;
+}
+
+// Mixes one block and checks its first sample.
+static bool soundMixer_testMix(const char *what, int16_t expected) {
+  int16_t block[SOUND_MIXER_BLOCK_SIZE];
+  soundMixer_mix(block, SOUND_MIXER_BLOCK_SIZE);
+  if (block[0] != expected) {
+    printf("%s: mixed %d, expected %d.\n\r", what, block[0], expected);
+    return false;
+  }
+  return true;
+}
+
+// Checks mixing, saturation and voice stealing, and times a busy block.
+bool soundMixer_runTest() {
+  printf("****************** soundMixer_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  intervalTimer_startTimestampCounter();
+  soundMixer_source_t pcm = {SOUND_PACK_FORMAT_PCM16,
+                             (const uint8_t *)soundMixer_testPcm,
+                             SOUND_MIXER_TEST_SAMPLE_COUNT, NULL, 0};
+  soundMixer_source_t silence = {SOUND_PACK_FORMAT_SILENCE, NULL,
+                                 SOUND_MIXER_TEST_SAMPLE_COUNT, NULL, 0};
+
+  // Sums and volumes.
+  soundMixer_init();
+  soundMixer_testFill(1000);
+  soundMixer_start(&pcm, SOUND_MIXER_FULL_VOLUME, 0);
+  soundMixer_start(&pcm, SOUND_MIXER_FULL_VOLUME, 0);
+  soundMixer_start(&pcm, SOUND_MIXER_FULL_VOLUME / 2, 0);
+  success &= soundMixer_testMix("Sum", 2500);
+
+  // Saturation, both ways.
+  soundMixer_init();
+  soundMixer_testFill(SOUND_MIXER_TEST_LOUD);
+  soundMixer_start(&pcm, SOUND_MIXER_FULL_VOLUME, 0);
+  soundMixer_start(&pcm, SOUND_MIXER_FULL_VOLUME, 0);
+  success &= soundMixer_testMix("Positive saturation", INT16_MAX);
+  soundMixer_init();
+  soundMixer_testFill(-SOUND_MIXER_TEST_LOUD);
+  soundMixer_start(&pcm, SOUND_MIXER_FULL_VOLUME, 0);
+  soundMixer_start(&pcm, SOUND_MIXER_FULL_VOLUME, 0);
+  success &= soundMixer_testMix("Negative saturation", INT16_MIN);
+
+  // A voice is freed at its end, part way through a block.
+  soundMixer_init();
+  soundMixer_source_t shortPcm = pcm;
+  shortPcm.sampleCount = SOUND_MIXER_TEST_SHORT_COUNT;
+  soundMixer_start(&shortPcm, SOUND_MIXER_FULL_VOLUME, 0);
+  int16_t block[SOUND_MIXER_BLOCK_SIZE];
+  soundMixer_mix(block, SOUND_MIXER_BLOCK_SIZE);
+  if (soundMixer_getActiveVoiceCount() != 0 ||
+      block[SOUND_MIXER_TEST_SHORT_COUNT - 1] != -SOUND_MIXER_TEST_LOUD ||
+      block[SOUND_MIXER_TEST_SHORT_COUNT] != 0) {
+    printf("A short voice was not ended correctly.\n\r");
+    success = false;
+  }
+
+  // A queued source follows on from the very next sample, mid-block, with
+  // its own volume, and the voice is freed when it ends.
+  soundMixer_init();
+  soundMixer_testFill(SOUND_MIXER_TEST_LOUD);
+  int8_t chained = soundMixer_start(&shortPcm, SOUND_MIXER_FULL_VOLUME, 0);
+  uint32_t startNumber = soundMixer_getStartNumber(chained);
+  soundMixer_source_t nextPcm = pcm;
+  nextPcm.sampleCount = SOUND_MIXER_BLOCK_SIZE;
+  if (!soundMixer_setNext(chained, &nextPcm, SOUND_MIXER_FULL_VOLUME / 2, 0) ||
+      soundMixer_setNext(chained, &nextPcm, SOUND_MIXER_FULL_VOLUME, 0)) {
+    printf("A voice did not take exactly one next source.\n\r");
+    success = false;
+  }
+  // The next source was decoded when it was queued, so it is not changed.
+  soundMixer_testFill(-SOUND_MIXER_TEST_LOUD);
+  soundMixer_mix(block, SOUND_MIXER_BLOCK_SIZE);
+  if (block[SOUND_MIXER_TEST_SHORT_COUNT - 1] != -SOUND_MIXER_TEST_LOUD ||
+      block[SOUND_MIXER_TEST_SHORT_COUNT] != SOUND_MIXER_TEST_LOUD / 2 ||
+      !soundMixer_isPlaying(chained, startNumber) ||
+      soundMixer_hasNext(chained)) {
+    printf("A sequence had a gap: %d then %d, expected %d then %d.\n\r",
+           block[SOUND_MIXER_TEST_SHORT_COUNT - 1],
+           block[SOUND_MIXER_TEST_SHORT_COUNT], -SOUND_MIXER_TEST_LOUD,
+           SOUND_MIXER_TEST_LOUD / 2);
+    success = false;
+  }
+  // The rest of the next source: as many samples as the first one had.
+  soundMixer_mix(block, SOUND_MIXER_BLOCK_SIZE);
+  if (soundMixer_isPlaying(chained, startNumber) ||
+      block[SOUND_MIXER_TEST_SHORT_COUNT - 1] != SOUND_MIXER_TEST_LOUD / 2 ||
+      block[SOUND_MIXER_TEST_SHORT_COUNT] != 0) {
+    printf("A sequence was not ended correctly.\n\r");
+    success = false;
+  }
+
+  // Stealing: priorities 1, 2, 1, 3 on voices 0 to 3.
+  soundMixer_init();
+  uint8_t priorities[SOUND_MIXER_VOICE_COUNT] = {1, 2, 1, 3};
+  for (int8_t i = 0; i < SOUND_MIXER_VOICE_COUNT; i++)
+    soundMixer_start(&silence, SOUND_MIXER_FULL_VOLUME, priorities[i]);
+  int8_t lower = soundMixer_start(&silence, SOUND_MIXER_FULL_VOLUME, 0);
+  int8_t first = soundMixer_start(&silence, SOUND_MIXER_FULL_VOLUME, 1);
+  int8_t second = soundMixer_start(&silence, SOUND_MIXER_FULL_VOLUME, 1);
+  int8_t third = soundMixer_start(&silence, SOUND_MIXER_FULL_VOLUME, 1);
+  if (lower != SOUND_MIXER_NO_VOICE || first != 0 || second != 2 ||
+      third != 0) {
+    printf("Stealing chose voices %d %d %d %d, expected -1 0 2 0.\n\r", lower,
+           first, second, third);
+    success = false;
+  }
+  if (soundMixer_getActiveVoiceCount() != SOUND_MIXER_VOICE_COUNT) {
+    printf("%d voices active after stealing, expected %d.\n\r",
+           soundMixer_getActiveVoiceCount(), SOUND_MIXER_VOICE_COUNT);
+    success = false;
+  }
+
+  // Cost of a block with every voice decoding ADPCM.
+  for (int8_t v = 0; v < SOUND_MIXER_VOICE_COUNT; v++) {
+    for (uint32_t i = 0; i < SOUND_MIXER_TEST_SAMPLE_COUNT; i++)
+      soundMixer_testPcm[i] =
+          SOUND_MIXER_TEST_AMPLITUDE *
+          sin(2 * M_PI * SOUND_MIXER_TEST_BASE_HZ * (v + 1) * i /
+              SOUND_MIXER_TEST_SAMPLE_RATE);
+    adpcm_encode(soundMixer_testPcm, SOUND_MIXER_TEST_SAMPLE_COUNT,
+                 soundMixer_testAdpcm[v]);
+  }
+  uint32_t blockCount = 0;
+  uint64_t startTicks = intervalTimer_nowTicks();
+  for (uint32_t pass = 0; pass < SOUND_MIXER_TEST_TIMING_COUNT; pass++) {
+    soundMixer_init();
+    for (int8_t v = 0; v < SOUND_MIXER_VOICE_COUNT; v++) {
+      soundMixer_source_t adpcm = {SOUND_PACK_FORMAT_ADPCM,
+                                   soundMixer_testAdpcm[v],
+                                   SOUND_MIXER_TEST_SAMPLE_COUNT, NULL, 0};
+      soundMixer_start(&adpcm, SOUND_MIXER_FULL_VOLUME / 2, 0);
+    }
+    while (soundMixer_getActiveVoiceCount()) {
+      soundMixer_mix(block, SOUND_MIXER_BLOCK_SIZE);
+      blockCount++;
+    }
+  }
+  uint64_t elapsedNs =
+      intervalTimer_ticksToNs(intervalTimer_nowTicks() - startTicks);
+  printf("Mixing %d ADPCM voices takes %ld ns per block of %d samples.\n\r",
+         SOUND_MIXER_VOICE_COUNT, (long)(elapsedNs / blockCount),
+         SOUND_MIXER_BLOCK_SIZE);
+  soundMixer_init();
+  printf("soundMixer_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
@@ -0,0 +1,105 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SOUNDMIXER_H_
+#define SOUNDMIXER_H_
+
+#include "soundSynth.h"
+#include "sounds/soundStream.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Fixed-point mixer for concurrent sound effects. sound_update() asks for a
+// block of SOUND_MIXER_BLOCK_SIZE samples whenever its ring has room;
+// every active voice is decoded for that block, scaled by its volume and
+// summed, and the sum is saturated to 16 bits.
+//
+// There are SOUND_MIXER_VOICE_COUNT voices. Each has its own position, volume
+// and priority. Starting a sound takes a free voice; if there is none, it
+// steals the voice with the lowest priority (the oldest of those, on a tie),
+// but only if that priority is not higher than the new sound's. All functions
+// are called from the main loop (the scheduler's sound task and the game
+// code), never from the ISR.
+//
+// A voice can also be given the next source to play, for gapless sequences:
+// its first block is decoded as soon as it is queued, and it carries on from
+// the sample after the current source's last one, in the same block. The
+// voice keeps its start number across the change.
+//
+// A streamed source is read from the SD card through a soundStream.h reader,
+// which the voice holds until it finishes or is stopped. It cannot be started
+// or queued while every reader is busy. If its reader runs dry the voice
+// plays silence until the data arrives, or ends if streaming has stopped.
+
+#define SOUND_MIXER_VOICE_COUNT 4
+#define SOUND_MIXER_BLOCK_SIZE 8 // Stereo frames in the I2S TX FIFO.
+#define SOUND_MIXER_FULL_VOLUME 0x8000 // Volumes are Q15; this is 1.0.
+#define SOUND_MIXER_VOLUME_SHIFT 15
+#define SOUND_MIXER_NO_VOICE -1
+
+// What a voice plays. format is one of the SOUND_PACK_FORMAT_* values; data
+// is not read for silence, a synthesized sound is generated from patch
+// instead, and a streamed sound is read from streamOffset in the stream pack.
+typedef struct {
+  uint8_t format;
+  const uint8_t *data;
+  uint32_t sampleCount;
+  const soundSynth_patch_t *patch; // For SOUND_PACK_FORMAT_SYNTH only.
+  uint32_t streamOffset;           // For SOUND_PACK_FORMAT_STREAM only.
+} soundMixer_source_t;
+
+// Stops all voices.
+void soundMixer_init();
+
+// Starts playing the source on a voice. Returns the voice number, or
+// SOUND_MIXER_NO_VOICE if every voice is playing something more important or
+// the source is streamed and no reader is free or the stream pack does not
+// hold it (see soundStream_hasSound()).
+int8_t soundMixer_start(const soundMixer_source_t *source, uint16_t volume,
+                        uint8_t priority);
+
+// Returns the start number of the sound on a voice: it identifies the start
+// that returned the voice, for soundMixer_isPlaying().
+uint32_t soundMixer_getStartNumber(int8_t voice);
+
+// Returns true while a voice is still playing the sound (or the sequence
+// queued after it) from the start with the given start number, that is,
+// until it finishes or is stopped or stolen.
+bool soundMixer_isPlaying(int8_t voice, uint32_t startNumber);
+
+// Queues a source to play on a voice straight after its current one, with the
+// given volume and priority, and decodes its first block now. Returns false
+// if the voice is not playing or already has a source queued, or the source
+// cannot be streamed, as for soundMixer_start().
+bool soundMixer_setNext(int8_t voice, const soundMixer_source_t *source,
+                        uint16_t volume, uint8_t priority);
+
+// Returns true if a voice has a queued source that has not started yet.
+bool soundMixer_hasNext(int8_t voice);
+
+// Stops a voice. Does nothing if it has already finished.
+void soundMixer_stop(int8_t voice);
+
+// Stops all voices.
+void soundMixer_stopAll();
+
+// Returns the number of voices that are playing.
+uint8_t soundMixer_getActiveVoiceCount();
+
+// Mixes the next count (at most SOUND_MIXER_BLOCK_SIZE) samples of all
+// voices into samples[]. Voices that reach their end are freed. Writes zeros
+// when no voice is playing.
+void soundMixer_mix(int16_t samples[], uint32_t count);
+
+// Checks mixing, saturation, gapless sequences and voice stealing, and prints
+// the cost of mixing a block with every voice busy. Returns true if the test
+// passes.
+bool soundMixer_runTest();
+
+#endif /* SOUNDMIXER_H_ */
@@ -0,0 +1,175 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "soundOutput.h"
+#include "intervalTimer.h"
+#include <stdio.h>
+
+// The gain is kept with this many extra fraction bits so that a ramp can
+// move it by less than one Q15 step per sample.
+#define SOUND_OUTPUT_RAMP_SHIFT 16
+
+#define SOUND_OUTPUT_TEST_SAMPLE_COUNT 4800 // 0.1 s at 48 kHz.
+#define SOUND_OUTPUT_TEST_TIMING_COUNT 100  // Passes over the test samples.
+#define SOUND_OUTPUT_TEST_RAMP_LEVEL 16384
+#define SOUND_OUTPUT_TEST_LOW_GAIN 0x0400
+#define SOUND_OUTPUT_TEST_HIGH_GAIN 0x6000
+#define SOUND_OUTPUT_NS_PER_US 1000.0
+
+static uint32_t soundOutput_gain = 0; // Q15 << SOUND_OUTPUT_RAMP_SHIFT.
+static int32_t soundOutput_step = 0;  // Added to the gain per ramp sample.
+static uint32_t soundOutput_rampCount = 0; // Ramp samples left.
+static uint16_t soundOutput_targetGain = 0;
+
+// Scales, saturates and packs one sample.
+static inline uint32_t soundOutput_packSample(int16_t sample, int32_t gain) {
+  int32_t value = (sample * gain) >> SOUND_OUTPUT_GAIN_SHIFT;
+  value = value > SOUND_OUTPUT_SAMPLE_MAX ? SOUND_OUTPUT_SAMPLE_MAX : value;
+  value = value < SOUND_OUTPUT_SAMPLE_MIN ? SOUND_OUTPUT_SAMPLE_MIN : value;
+  return (uint32_t)value << SOUND_OUTPUT_WORD_SHIFT;
+}
+
+// Sets the gain straight away, without a ramp.
+void soundOutput_init(uint16_t gain) {
+  soundOutput_gain = (uint32_t)gain << SOUND_OUTPUT_RAMP_SHIFT;
+  soundOutput_targetGain = gain;
+  soundOutput_step = 0;
+  soundOutput_rampCount = 0;
+}
+
+// Ramps the gain from where it is now to the new value.
+void soundOutput_setGain(uint16_t gain) {
+  soundOutput_targetGain = gain;
+  int64_t distance = ((int64_t)gain << SOUND_OUTPUT_RAMP_SHIFT) -
+                     (int64_t)soundOutput_gain;
+  soundOutput_step = distance / SOUND_OUTPUT_RAMP_FRAMES;
+  soundOutput_rampCount = SOUND_OUTPUT_RAMP_FRAMES;
+}
+
+// Returns the gain that is being applied now.
+uint16_t soundOutput_getGain() {
+  return soundOutput_gain >> SOUND_OUTPUT_RAMP_SHIFT;
+}
+
+// Scales count samples by the gain and writes them to words[] as FIFO words.
+void soundOutput_pack(const int16_t *restrict samples, uint32_t *restrict words,
+                      uint32_t count) {
+  uint32_t i = 0;
+  for (; i < count && soundOutput_rampCount; i++) {
+    words[i] = soundOutput_packSample(
+        samples[i], soundOutput_gain >> SOUND_OUTPUT_RAMP_SHIFT);
+    soundOutput_gain += soundOutput_step;
+    if (--soundOutput_rampCount == 0) // Land exactly on the new gain.
+      soundOutput_gain = (uint32_t)soundOutput_targetGain
+                         << SOUND_OUTPUT_RAMP_SHIFT;
+  }
+  // Steady gain: this is the loop that is vectorized.
+  int32_t gain = soundOutput_gain >> SOUND_OUTPUT_RAMP_SHIFT;
+  for (; i < count; i++)
+    words[i] = soundOutput_packSample(samples[i], gain);
+}
+
+// Test input and output.
+static int16_t soundOutput_testSamples[SOUND_OUTPUT_TEST_SAMPLE_COUNT];
+static uint32_t soundOutput_testWords[SOUND_OUTPUT_TEST_SAMPLE_COUNT];
+
+// Returns the 24-bit sample in a FIFO word.
+static int32_t soundOutput_testUnpack(uint32_t word) {
+  return (int32_t)word >> SOUND_OUTPUT_WORD_SHIFT;
+}
+
+// Packs one sample and checks the word.
+static bool soundOutput_testWord(const char *what, int16_t sample,
+                                 uint32_t expected) {
+  uint32_t word;
+  soundOutput_pack(&sample, &word, 1);
+  if (word != expected) {
+    printf("%s: packed %d as 0x%08lx, expected 0x%08lx.\n\r", what, sample,
+           (unsigned long)word, (unsigned long)expected);
+    return false;
+  }
+  return true;
+}
+
+// Times packing the test samples, ramping from one gain to another in each
+// pass if ramp is true, and returns the samples packed per microsecond.
+static double soundOutput_testRate(bool ramp) {
+  uint32_t count =
+      ramp ? SOUND_OUTPUT_RAMP_FRAMES : SOUND_OUTPUT_TEST_SAMPLE_COUNT;
+  soundOutput_init(SOUND_OUTPUT_TEST_LOW_GAIN);
+  uint64_t startTicks = intervalTimer_nowTicks();
+  for (uint32_t pass = 0; pass < SOUND_OUTPUT_TEST_TIMING_COUNT; pass++) {
+    if (ramp)
+      soundOutput_setGain(pass & 1 ? SOUND_OUTPUT_TEST_LOW_GAIN
+                                   : SOUND_OUTPUT_TEST_HIGH_GAIN);
+    soundOutput_pack(soundOutput_testSamples, soundOutput_testWords, count);
+  }
+  uint64_t elapsedNs =
+      intervalTimer_ticksToNs(intervalTimer_nowTicks() - startTicks);
+  return elapsedNs ? (double)count * SOUND_OUTPUT_TEST_TIMING_COUNT *
+                         SOUND_OUTPUT_NS_PER_US / elapsedNs
+                   : 0.0;
+}
+
+// Checks the word format, saturation and ramps, and times packing.
+bool soundOutput_runTest() {
+  printf("****************** soundOutput_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  intervalTimer_startTimestampCounter();
+
+  // At unity gain a 16-bit sample ends up in bits 31-16.
+  soundOutput_init(SOUND_OUTPUT_UNITY_GAIN);
+  success &= soundOutput_testWord("Unity", 1, 0x00010000);
+  success &= soundOutput_testWord("Unity", -1, 0xFFFF0000);
+  success &= soundOutput_testWord("Unity", INT16_MIN, 0x80000000);
+  soundOutput_init(SOUND_OUTPUT_UNITY_GAIN / 2);
+  success &= soundOutput_testWord("Half", 0x1000, 0x08000000);
+
+  // Boosted samples saturate at the 24-bit limits.
+  soundOutput_init(UINT16_MAX);
+  success &= soundOutput_testWord("Boost", INT16_MAX, 0x7FFFFF00);
+  success &= soundOutput_testWord("Boost", INT16_MIN, 0x80000000);
+
+  // A ramp rises smoothly and lands on the new gain.
+  for (uint32_t i = 0; i < SOUND_OUTPUT_TEST_SAMPLE_COUNT; i++)
+    soundOutput_testSamples[i] = SOUND_OUTPUT_TEST_RAMP_LEVEL;
+  soundOutput_init(0);
+  soundOutput_setGain(SOUND_OUTPUT_UNITY_GAIN);
+  soundOutput_pack(soundOutput_testSamples, soundOutput_testWords,
+                   SOUND_OUTPUT_RAMP_FRAMES + 1);
+  int32_t full = SOUND_OUTPUT_TEST_RAMP_LEVEL << SOUND_OUTPUT_WORD_SHIFT;
+  int32_t maxStep = full / SOUND_OUTPUT_RAMP_FRAMES + 1;
+  int32_t previous = 0;
+  for (uint32_t i = 0; i <= SOUND_OUTPUT_RAMP_FRAMES; i++) {
+    int32_t value = soundOutput_testUnpack(soundOutput_testWords[i]);
+    if (value < previous || value - previous > maxStep) {
+      printf("Ramp steps from %ld to %ld at sample %ld.\n\r", (long)previous,
+             (long)value, (long)i);
+      success = false;
+      break;
+    }
+    previous = value;
+  }
+  if (previous != full || soundOutput_getGain() != SOUND_OUTPUT_UNITY_GAIN) {
+    printf("Ramp ended at %ld with gain 0x%x, expected %ld and 0x%x.\n\r",
+           (long)previous, soundOutput_getGain(), (long)full,
+           SOUND_OUTPUT_UNITY_GAIN);
+    success = false;
+  }
+
+  // Throughput, on a sawtooth.
+  for (uint32_t i = 0; i < SOUND_OUTPUT_TEST_SAMPLE_COUNT; i++)
+    soundOutput_testSamples[i] = (int16_t)(i * 64);
+  printf("Packing: %.1f samples/us with a steady gain, %.1f while "
+         "ramping.\n\r",
+         soundOutput_testRate(false), soundOutput_testRate(true));
+  soundOutput_init(0);
+  printf("soundOutput_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
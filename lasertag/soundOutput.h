@@ -0,0 +1,56 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SOUNDOUTPUT_H_
+#define SOUNDOUTPUT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Output stage between the mixer and the I2S FIFO: applies the volume to a
+// block of mixed samples and packs them as I2S TX FIFO words.
+//
+// The codec is set up for 24-bit two's complement samples, and the FIFO keeps
+// bits 31-8 of each word written to it, so a word is the 24-bit sample shifted
+// left by 8. The gain is Q15, so a 16-bit sample times the gain, shifted right
+// by SOUND_OUTPUT_GAIN_SHIFT, is already a 24-bit sample; it is then saturated
+// to 24 bits. The loop over a block has no branches and no loop-carried state
+// when the gain is steady, so the compiler vectorizes it (SSE on the host,
+// NEON on the board; see CMakeLists.txt).
+//
+// A change of gain is ramped linearly over SOUND_OUTPUT_RAMP_FRAMES samples
+// instead of being applied at once, which would click.
+
+#define SOUND_OUTPUT_UNITY_GAIN 0x8000 // Q15 1.0; gains up to 0xFFFF boost.
+#define SOUND_OUTPUT_GAIN_SHIFT 7      // Q15 x 16 bits -> 24 bits.
+#define SOUND_OUTPUT_WORD_SHIFT 8      // The FIFO keeps bits 31-8.
+#define SOUND_OUTPUT_SAMPLE_MAX ((1 << 23) - 1)
+#define SOUND_OUTPUT_SAMPLE_MIN (-(1 << 23))
+#define SOUND_OUTPUT_RAMP_FRAMES 256 // 5.3 ms at 48 kHz.
+
+// Sets the gain straight away, without a ramp.
+void soundOutput_init(uint16_t gain);
+
+// Ramps the gain to a new value over the next SOUND_OUTPUT_RAMP_FRAMES
+// samples.
+void soundOutput_setGain(uint16_t gain);
+
+// Returns the gain that is being applied now.
+uint16_t soundOutput_getGain();
+
+// Scales count samples by the gain and writes them to words[] as FIFO words.
+void soundOutput_pack(const int16_t samples[], uint32_t words[],
+                      uint32_t count);
+
+// Checks the word format, saturation and ramps, and prints how many samples
+// per microsecond are packed, with a steady gain and while ramping. Returns
+// true if the test passes.
+bool soundOutput_runTest();
+
+#endif /* SOUNDOUTPUT_H_ */
@@ -0,0 +1,112 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "soundQueue.h"
+#include "intervalTimer.h"
+#include <stdio.h>
+
+#define SOUND_QUEUE_MASK (SOUND_QUEUE_SIZE - 1)
+
+#define SOUND_QUEUE_TEST_PASS_COUNT 3 // Times round the ring.
+#define SOUND_QUEUE_TEST_TIMING_COUNT 1000
+
+static soundQueue_command_t soundQueue_ring[SOUND_QUEUE_SIZE];
+// Numbers of commands ever taken and ever added; the slot is the lower bits.
+static volatile uint32_t soundQueue_head = 0;
+static volatile uint32_t soundQueue_tail = 0;
+
+// Empties the queue.
+void soundQueue_init() {
+  soundQueue_head = 0;
+  soundQueue_tail = 0;
+}
+
+// Adds a command at the tail. The slot is written before the tail is moved
+// past it, so the consumer only ever reads whole commands.
+bool soundQueue_push(const soundQueue_command_t *command) {
+  uint32_t tail = soundQueue_tail;
+  if (tail - __atomic_load_n(&soundQueue_head, __ATOMIC_ACQUIRE) ==
+      SOUND_QUEUE_SIZE)
+    return false; // Full.
+  soundQueue_ring[tail & SOUND_QUEUE_MASK] = *command;
+  __atomic_store_n(&soundQueue_tail, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+// Copies the command at the head without taking it.
+bool soundQueue_peek(soundQueue_command_t *command) {
+  uint32_t head = soundQueue_head;
+  if (head == __atomic_load_n(&soundQueue_tail, __ATOMIC_ACQUIRE))
+    return false; // Empty.
+  *command = soundQueue_ring[head & SOUND_QUEUE_MASK];
+  return true;
+}
+
+// Takes the command at the head, which frees its slot for the producer.
+void soundQueue_pop() {
+  uint32_t head = soundQueue_head;
+  if (head != __atomic_load_n(&soundQueue_tail, __ATOMIC_ACQUIRE))
+    __atomic_store_n(&soundQueue_head, head + 1, __ATOMIC_RELEASE);
+}
+
+// Returns the number of commands in the queue.
+uint32_t soundQueue_getCount() { return soundQueue_tail - soundQueue_head; }
+
+// Checks ordering, wrapping and a full queue, and times a push and a pop.
+bool soundQueue_runTest() {
+  printf("****************** soundQueue_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  intervalTimer_startTimestampCounter();
+  soundQueue_init();
+  soundQueue_command_t command = {0};
+  soundQueue_command_t taken;
+
+  // Fill it, overfill it, and empty it, a few times round the ring.
+  uint32_t pushed = 0;
+  uint32_t popped = 0;
+  for (uint32_t pass = 0; pass < SOUND_QUEUE_TEST_PASS_COUNT; pass++) {
+    for (uint32_t i = 0; i < SOUND_QUEUE_SIZE; i++) {
+      command.startTicks = pushed++;
+      success &= soundQueue_push(&command);
+    }
+    if (soundQueue_push(&command) ||
+        soundQueue_getCount() != SOUND_QUEUE_SIZE) {
+      printf("A full queue took another command.\n\r");
+      success = false;
+    }
+    while (soundQueue_peek(&taken)) {
+      if (taken.startTicks != popped) {
+        printf("Took command %ld, expected %ld.\n\r", (long)taken.startTicks,
+               (long)popped);
+        success = false;
+      }
+      soundQueue_pop();
+      popped++;
+    }
+  }
+  if (popped != pushed || soundQueue_getCount() != 0) {
+    printf("Took %ld commands of %ld.\n\r", (long)popped, (long)pushed);
+    success = false;
+  }
+
+  // Cost of a push and a pop.
+  uint64_t startTicks = intervalTimer_nowTicks();
+  for (uint32_t i = 0; i < SOUND_QUEUE_TEST_TIMING_COUNT; i++) {
+    soundQueue_push(&command);
+    soundQueue_peek(&taken);
+    soundQueue_pop();
+  }
+  uint64_t elapsedNs =
+      intervalTimer_ticksToNs(intervalTimer_nowTicks() - startTicks);
+  printf("A push, peek and pop take %ld ns.\n\r",
+         (long)(elapsedNs / SOUND_QUEUE_TEST_TIMING_COUNT));
+  soundQueue_init();
+  printf("soundQueue_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
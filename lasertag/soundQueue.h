@@ -0,0 +1,62 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SOUNDQUEUE_H_
+#define SOUNDQUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Queue of sound requests from the game code to the sound engine, which
+// works through it in sound_update(). It is a ring with one producer and one
+// consumer and needs no locks: the producer only writes the tail index and
+// the consumer only the head index, and each publishes its index with a
+// release store after touching the slot, so the other side never sees a
+// half-written command. The producer may be the main loop or the ISR, but
+// only one of them.
+//
+// A command either starts a new sequence, at its start time, or is chained:
+// it plays straight after the sound before it, with no gap. Either way it
+// plays 1 + repeatCount times in a row. Commands are taken in order, so one
+// that is waiting for its start time holds back those behind it.
+
+#define SOUND_QUEUE_SIZE 16 // Commands; a power of two.
+#define SOUND_QUEUE_NOW 0   // Start time of a sequence that starts at once.
+
+typedef struct {
+  uint8_t sound;       // A sound_sounds_t value.
+  uint8_t repeatCount; // Plays after the first.
+  uint8_t priority;    // See sound_playSoundWithPriority().
+  bool chained;        // Follows the previous command instead of startTicks.
+  uint16_t volume;     // Q15.
+  uint64_t startTicks; // On intervalTimer_nowTicks(), or SOUND_QUEUE_NOW.
+} soundQueue_command_t;
+
+// Empties the queue. Neither side may be using it.
+void soundQueue_init();
+
+// Adds a command at the tail. Returns false if the queue is full. Producer
+// only.
+bool soundQueue_push(const soundQueue_command_t *command);
+
+// Copies the command at the head without taking it. Returns false if the
+// queue is empty. Consumer only.
+bool soundQueue_peek(soundQueue_command_t *command);
+
+// Takes the command at the head. Consumer only.
+void soundQueue_pop();
+
+// Returns the number of commands in the queue.
+uint32_t soundQueue_getCount();
+
+// Checks ordering, wrapping and a full queue, and prints the cost of a push
+// and a pop. Returns true if the test passes.
+bool soundQueue_runTest();
+
+#endif /* SOUNDQUEUE_H_ */
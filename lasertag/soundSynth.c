@@ -0,0 +1,226 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "soundSynth.h"
+#include "adpcm.h"
+#include "intervalTimer.h"
+#include "sounds/soundPack.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SOUND_SYNTH_FULL_LEVEL 0x8000 // Q15 1.0.
+#define SOUND_SYNTH_LEVEL_SHIFT 15
+#define SOUND_SYNTH_ENVELOPE_SHIFT 16 // Extra fraction bits of the envelope.
+#define SOUND_SYNTH_FULL_ENVELOPE                                              \
+  ((uint32_t)SOUND_SYNTH_FULL_LEVEL << SOUND_SYNTH_ENVELOPE_SHIFT)
+#define SOUND_SYNTH_NOISE_SEED 0x2545F491 // Any value but zero.
+#define SOUND_SYNTH_TRIANGLE_OFFSET 32768
+
+#define SOUND_SYNTH_TEST_SAMPLE_COUNT 4800 // 0.1 s at 48 kHz.
+#define SOUND_SYNTH_TEST_HZ 1000
+#define SOUND_SYNTH_TEST_CYCLES 100 // At 1 kHz, or 500 to 1500 Hz, in 0.1 s.
+#define SOUND_SYNTH_TEST_SWEEP_START_HZ 500
+#define SOUND_SYNTH_TEST_SWEEP_END_HZ 1500
+#define SOUND_SYNTH_TEST_RAMP_COUNT 480
+#define SOUND_SYNTH_TEST_BLOCK_SIZE 8
+#define SOUND_SYNTH_TEST_TIMING_COUNT 20 // Passes over the gun click.
+
+// A short noise burst over a falling square wave, 40 ms long.
+const soundSynth_patch_t soundSynth_gunClickPatch = {
+    .waveform = soundSynth_square_e,
+    .startHz = 1600,
+    .endHz = 400,
+    .toneLevel = 0x3000,
+    .noiseLevel = 0x4000,
+    .attackCount = 24,
+    .releaseCount = 1800,
+    .sampleCount = 1920};
+
+// Returns the phase step of a pitch.
+static uint32_t soundSynth_getPhaseStep(uint16_t hz) {
+  return ((uint64_t)hz << 32) / SOUND_PACK_SAMPLE_RATE;
+}
+
+// Starts playing a patch from its first sample.
+void soundSynth_start(soundSynth_voice_t *voice,
+                      const soundSynth_patch_t *patch) {
+  voice->patch = patch;
+  voice->position = 0;
+  voice->phase = 0;
+  voice->phaseStep = soundSynth_getPhaseStep(patch->startHz);
+  voice->phaseSweep = 0;
+  if (patch->sampleCount)
+    voice->phaseSweep = ((int64_t)soundSynth_getPhaseStep(patch->endHz) -
+                         (int64_t)voice->phaseStep) /
+                        (int64_t)patch->sampleCount;
+  voice->noise = SOUND_SYNTH_NOISE_SEED;
+  voice->envelope = patch->attackCount ? 0 : SOUND_SYNTH_FULL_ENVELOPE;
+  voice->attackStep =
+      patch->attackCount ? SOUND_SYNTH_FULL_ENVELOPE / patch->attackCount : 0;
+  voice->releaseStep =
+      patch->releaseCount ? SOUND_SYNTH_FULL_ENVELOPE / patch->releaseCount
+                          : 0;
+}
+
+// Returns the oscillator's sample at a phase.
+static inline int32_t soundSynth_oscillator(uint8_t waveform, uint32_t phase) {
+  int32_t x = (int32_t)phase;
+  switch (waveform) {
+  case soundSynth_triangle_e:
+    x >>= 15; // -65536 to 65535, folded to 0 to 65535.
+    return (x < 0 ? ~x : x) - SOUND_SYNTH_TRIANGLE_OFFSET;
+  case soundSynth_sawtooth_e:
+    return x >> 16;
+  default:
+    return x < 0 ? -INT16_MAX : INT16_MAX;
+  }
+}
+
+// Generates up to count samples into samples[].
+uint32_t soundSynth_render(soundSynth_voice_t *voice, int16_t samples[],
+                           uint32_t count) {
+  const soundSynth_patch_t *patch = voice->patch;
+  uint32_t remaining = patch->sampleCount - voice->position;
+  if (count > remaining)
+    count = remaining;
+  uint32_t releaseStart = patch->sampleCount > patch->releaseCount
+                              ? patch->sampleCount - patch->releaseCount
+                              : 0;
+  int32_t toneLevel = patch->toneLevel;
+  int32_t noiseLevel = patch->noiseLevel;
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t position = voice->position + i;
+    // The release is stepped before use, so the last sample is silent.
+    if (position >= releaseStart)
+      voice->envelope = voice->envelope > voice->releaseStep
+                            ? voice->envelope - voice->releaseStep
+                            : 0;
+    int32_t tone = soundSynth_oscillator(patch->waveform, voice->phase);
+    voice->noise ^= voice->noise << 13; // xorshift32.
+    voice->noise ^= voice->noise >> 17;
+    voice->noise ^= voice->noise << 5;
+    int32_t noise = (int32_t)voice->noise >> 16;
+    int32_t mix =
+        (tone * toneLevel + noise * noiseLevel) >> SOUND_SYNTH_LEVEL_SHIFT;
+    int32_t envelope = voice->envelope >> SOUND_SYNTH_ENVELOPE_SHIFT;
+    samples[i] = (mix * envelope) >> SOUND_SYNTH_LEVEL_SHIFT;
+    // The attack is stepped after use, so the first sample is silent.
+    if (position < patch->attackCount)
+      voice->envelope = position + 1 == patch->attackCount
+                            ? SOUND_SYNTH_FULL_ENVELOPE
+                            : voice->envelope + voice->attackStep;
+    voice->phase += voice->phaseStep;
+    voice->phaseStep += voice->phaseSweep;
+  }
+  voice->position += count;
+  return count;
+}
+
+static int16_t soundSynth_testSamples[SOUND_SYNTH_TEST_SAMPLE_COUNT];
+
+// Generates the whole of a patch into soundSynth_testSamples, in blocks as
+// the mixer does. Returns false if the length is wrong.
+static bool soundSynth_testRender(const char *what,
+                                  const soundSynth_patch_t *patch) {
+  soundSynth_voice_t voice;
+  soundSynth_start(&voice, patch);
+  uint32_t total = 0;
+  uint32_t read;
+  do {
+    read = soundSynth_render(&voice, &soundSynth_testSamples[total],
+                             SOUND_SYNTH_TEST_BLOCK_SIZE);
+    total += read;
+  } while (read == SOUND_SYNTH_TEST_BLOCK_SIZE);
+  if (total != patch->sampleCount) {
+    printf("%s: generated %ld samples, expected %ld.\n\r", what, (long)total,
+           (long)patch->sampleCount);
+    return false;
+  }
+  return true;
+}
+
+// Counts the cycles in soundSynth_testSamples, by rising zero crossings, and
+// checks the count.
+static bool soundSynth_testCycles(const char *what, uint32_t expected) {
+  uint32_t cycles = 0;
+  for (uint32_t i = 1; i < SOUND_SYNTH_TEST_SAMPLE_COUNT; i++)
+    cycles += (soundSynth_testSamples[i - 1] < 0 &&
+               soundSynth_testSamples[i] >= 0);
+  if (cycles + 1 < expected || cycles > expected + 1) {
+    printf("%s: %ld cycles, expected %ld.\n\r", what, (long)cycles,
+           (long)expected);
+    return false;
+  }
+  return true;
+}
+
+// Checks the pitch, level and envelope, and reports the cost and the space
+// saved.
+bool soundSynth_runTest() {
+  printf("****************** soundSynth_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  intervalTimer_startTimestampCounter();
+
+  // A steady square wave, at full level.
+  soundSynth_patch_t patch = {.waveform = soundSynth_square_e,
+                              .startHz = SOUND_SYNTH_TEST_HZ,
+                              .endHz = SOUND_SYNTH_TEST_HZ,
+                              .toneLevel = SOUND_SYNTH_FULL_LEVEL,
+                              .sampleCount = SOUND_SYNTH_TEST_SAMPLE_COUNT};
+  success &= soundSynth_testRender("Square", &patch);
+  success &= soundSynth_testCycles("Square", SOUND_SYNTH_TEST_CYCLES);
+  if (soundSynth_testSamples[0] != INT16_MAX) {
+    printf("Square: peak %d, expected %d.\n\r", soundSynth_testSamples[0],
+           INT16_MAX);
+    success = false;
+  }
+
+  // A triangle sweeping from 500 to 1500 Hz averages 1 kHz.
+  patch.waveform = soundSynth_triangle_e;
+  patch.startHz = SOUND_SYNTH_TEST_SWEEP_START_HZ;
+  patch.endHz = SOUND_SYNTH_TEST_SWEEP_END_HZ;
+  success &= soundSynth_testRender("Sweep", &patch);
+  success &= soundSynth_testCycles("Sweep", SOUND_SYNTH_TEST_CYCLES);
+
+  // The envelope starts and ends silent and is halfway up mid-attack.
+  patch.waveform = soundSynth_square_e;
+  patch.startHz = patch.endHz = SOUND_SYNTH_TEST_HZ;
+  patch.attackCount = patch.releaseCount = SOUND_SYNTH_TEST_RAMP_COUNT;
+  success &= soundSynth_testRender("Envelope", &patch);
+  // Mid-attack falls on a cycle boundary, so the square may be either sign.
+  int32_t middle =
+      abs(soundSynth_testSamples[SOUND_SYNTH_TEST_RAMP_COUNT / 2]);
+  int16_t last = soundSynth_testSamples[SOUND_SYNTH_TEST_SAMPLE_COUNT - 1];
+  if (soundSynth_testSamples[0] != 0 || last != 0 ||
+      middle < INT16_MAX / 2 - INT16_MAX / SOUND_SYNTH_TEST_RAMP_COUNT ||
+      middle > INT16_MAX / 2 + INT16_MAX / SOUND_SYNTH_TEST_RAMP_COUNT) {
+    printf("Envelope: first %d, middle %ld, last %d; expected 0, %d, 0.\n\r",
+           soundSynth_testSamples[0], (long)middle, last, INT16_MAX / 2);
+    success = false;
+  }
+
+  // Cost of the gun click, and what it would take stored.
+  const soundSynth_patch_t *click = &soundSynth_gunClickPatch;
+  uint64_t startTicks = intervalTimer_nowTicks();
+  for (uint32_t pass = 0; pass < SOUND_SYNTH_TEST_TIMING_COUNT; pass++)
+    success &= soundSynth_testRender("Gun click", click);
+  uint64_t elapsedNs =
+      intervalTimer_ticksToNs(intervalTimer_nowTicks() - startTicks);
+  uint32_t blockCount = SOUND_SYNTH_TEST_TIMING_COUNT *
+                        (click->sampleCount / SOUND_SYNTH_TEST_BLOCK_SIZE);
+  printf("Gun click: %ld ns per block of %d samples.\n\r",
+         (long)(elapsedNs / blockCount), SOUND_SYNTH_TEST_BLOCK_SIZE);
+  printf("Gun click: %ld bytes of flash as a patch and %ld bytes of RAM in "
+         "its voice, against %ld bytes as ADPCM or %ld as PCM.\n\r",
+         (long)sizeof(soundSynth_patch_t), (long)sizeof(soundSynth_voice_t),
+         (long)adpcm_getEncodedSize(click->sampleCount),
+         (long)(click->sampleCount * sizeof(int16_t)));
+  printf("soundSynth_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
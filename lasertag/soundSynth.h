@@ -0,0 +1,76 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SOUNDSYNTH_H_
+#define SOUNDSYNTH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Synthesized sound effects. Short effects such as the gun click are
+// described by a patch of a few bytes instead of being stored as samples, and
+// a mixer voice generates them a block at a time as the FIFO is refilled, so
+// they take no space in the sound pack and no RAM beyond the voice.
+//
+// A patch is one oscillator, whose pitch sweeps linearly from startHz to
+// endHz over the sound, mixed with white noise. The mix is shaped by an
+// envelope that rises linearly from zero over attackCount samples, holds, and
+// falls linearly back to zero over the last releaseCount samples. The
+// oscillator is a 32-bit phase accumulator, so its pitch is exact to a
+// fraction of a hertz; the noise is a 32-bit xorshift generator.
+
+// Oscillator waveforms.
+typedef enum {
+  soundSynth_square_e,
+  soundSynth_triangle_e,
+  soundSynth_sawtooth_e
+} soundSynth_waveform_t;
+
+typedef struct {
+  uint8_t waveform;      // One of soundSynth_waveform_t.
+  uint16_t startHz;      // Oscillator pitch at the first sample...
+  uint16_t endHz;        // ...and at the last.
+  uint16_t toneLevel;    // Q15. toneLevel + noiseLevel must not exceed 1.0,
+  uint16_t noiseLevel;   // so the sum cannot overflow.
+  uint32_t attackCount;  // Samples.
+  uint32_t releaseCount; // Samples.
+  uint32_t sampleCount;  // Length of the sound.
+} soundSynth_patch_t;
+
+// State of a voice that is playing a patch.
+typedef struct {
+  const soundSynth_patch_t *patch;
+  uint32_t position;  // Number of the next sample.
+  uint32_t phase;     // Oscillator phase; 2^32 is one cycle.
+  uint32_t phaseStep; // Added to the phase per sample.
+  int32_t phaseSweep; // Added to phaseStep per sample.
+  uint32_t noise;     // Generator state; never zero.
+  uint32_t envelope;  // Q15, with 16 more fraction bits.
+  uint32_t attackStep;  // Added to the envelope per attack sample.
+  uint32_t releaseStep; // Taken from it per release sample.
+} soundSynth_voice_t;
+
+// The patches of the synthesized effects.
+extern const soundSynth_patch_t soundSynth_gunClickPatch;
+
+// Starts playing a patch from its first sample.
+void soundSynth_start(soundSynth_voice_t *voice,
+                      const soundSynth_patch_t *patch);
+
+// Generates up to count samples into samples[]. Returns the number generated,
+// which is less than count only at the end of the sound.
+uint32_t soundSynth_render(soundSynth_voice_t *voice, int16_t samples[],
+                           uint32_t count);
+
+// Checks the pitch, level and envelope of generated sounds, and prints the
+// cost of generating a block and the flash and RAM the gun click takes as a
+// patch against storing it. Returns true if the test passes.
+bool soundSynth_runTest();
+
+#endif /* SOUNDSYNTH_H_ */
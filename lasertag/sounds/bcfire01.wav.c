@@ -1,24646 +0,0 @@
-// This file was generated by executing this statement: wav2c bcfire01.wav
-
-#include <stdint.h>
-
-int16_t bcfire01_wav[24640] = {
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
--32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767
-};
@@ -0,0 +1,178 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "soundPack.h"
+#include "lasertag/adpcm.h"
+#include <stddef.h>
+#include <stdio.h>
+
+#ifndef SOUND_PACK_PATH
+#error "SOUND_PACK_PATH must be defined by the build (see CMakeLists.txt)."
+#endif
+
+#define SOUND_PACK_STRINGIFY(x) #x
+#define SOUND_PACK_XSTRINGIFY(x) SOUND_PACK_STRINGIFY(x)
+
+#ifdef ZYBO_BOARD
+// Link the pack into .rodata. The object is rebuilt when the pack changes.
+__asm__(".section .rodata\n"
+        ".balign " SOUND_PACK_XSTRINGIFY(SOUND_PACK_ALIGNMENT) "\n"
+        ".global soundPack_blob\n"
+        "soundPack_blob:\n"
+        ".incbin \"" SOUND_PACK_PATH "\"\n"
+        ".previous\n");
+extern const uint8_t soundPack_blob[];
+#else
+// Map the pack read-only. SOUND_PACK in the environment overrides the path
+// of the pack in the build tree.
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const uint8_t *soundPack_data = NULL;
+
+#ifdef ZYBO_BOARD
+static const uint8_t *soundPack_find() { return soundPack_blob; }
+#else
+static const uint8_t *soundPack_find() {
+  const char *path = getenv("SOUND_PACK");
+  if (path == NULL)
+    path = SOUND_PACK_PATH;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return NULL;
+  }
+  struct stat status;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &status) == 0 &&
+      (size_t)status.st_size >= sizeof(soundPack_header_t))
+    data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    printf("soundPack: cannot map %s.\n\r", path);
+    return NULL;
+  }
+  return data;
+}
+#endif
+
+// Finds the pack and checks its header.
+bool soundPack_init() {
+  if (soundPack_data != NULL)
+    return true;
+  const uint8_t *data = soundPack_find();
+  if (data == NULL)
+    return false;
+  const soundPack_header_t *header = (const soundPack_header_t *)data;
+  if (header->magic != SOUND_PACK_MAGIC ||
+      header->version != SOUND_PACK_VERSION) {
+    printf("soundPack: not a version %d sound pack.\n\r", SOUND_PACK_VERSION);
+    return false;
+  }
+  soundPack_data = data;
+  return true;
+}
+
+// Returns the entry for a sound, or NULL.
+const soundPack_entry_t *soundPack_getEntry(uint32_t sound) {
+  const soundPack_header_t *header = (const soundPack_header_t *)soundPack_data;
+  if (header == NULL || sound >= header->entryCount)
+    return NULL;
+  return &header->entries[sound];
+}
+
+// Returns the data of an entry.
+const uint8_t *soundPack_getData(const soundPack_entry_t *entry) {
+  return soundPack_data + entry->offset;
+}
+
+// Returns the streamPackId of the stream pack built with this pack.
+uint32_t soundPack_getStreamPackId() {
+  const soundPack_header_t *header = (const soundPack_header_t *)soundPack_data;
+  return header == NULL ? 0 : header->streamPackId;
+}
+
+// Returns the fallback of a streamed entry.
+const uint8_t *soundPack_getFallbackData(const soundPack_entry_t *entry) {
+  return soundPack_data + entry->fallbackOffset;
+}
+
+// Returns the offset of the data of an entry that is in the pack: of its
+// fallback, for a streamed entry.
+static uint32_t soundPack_getDataOffset(const soundPack_entry_t *entry) {
+  return entry->format == SOUND_PACK_FORMAT_STREAM ? entry->fallbackOffset
+                                                   : entry->offset;
+}
+
+// Returns the number of bytes of data of an entry that are in the pack.
+static uint32_t soundPack_getDataSize(const soundPack_entry_t *entry) {
+  switch (entry->format) {
+  case SOUND_PACK_FORMAT_ADPCM:
+    return adpcm_getEncodedSize(entry->sampleCount);
+  case SOUND_PACK_FORMAT_STREAM:
+    return adpcm_getEncodedSize(entry->fallbackSampleCount);
+  case SOUND_PACK_FORMAT_PCM16:
+    return entry->sampleCount * sizeof(int16_t);
+  default:
+    return 0;
+  }
+}
+
+// Checks the index and prints it.
+bool soundPack_runTest() {
+  printf("****************** soundPack_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  if (!soundPack_init()) {
+    printf("soundPack_runTest() failed\n\r");
+    return false;
+  }
+  const soundPack_header_t *header = (const soundPack_header_t *)soundPack_data;
+  // End of the index, then of each entry's data in turn.
+  uint32_t previousEnd = sizeof(soundPack_header_t) +
+                         header->entryCount * sizeof(soundPack_entry_t);
+  printf("%ld bytes, %d entries.\n\r", (long)header->size, header->entryCount);
+  for (uint32_t i = 0; i < header->entryCount; i++) {
+    const soundPack_entry_t *entry = soundPack_getEntry(i);
+    uint32_t offset = soundPack_getDataOffset(entry);
+    uint32_t size = soundPack_getDataSize(entry);
+    printf("%2ld %-16.16s format %d, %6ld samples at %5ld Hz, %6ld bytes at "
+           "%ld\n\r",
+           (long)i, entry->name, entry->format, (long)entry->sampleCount,
+           (long)entry->sampleRate, (long)size, (long)offset);
+    if (entry->format > SOUND_PACK_FORMAT_STREAM ||
+        entry->sampleRate != SOUND_PACK_SAMPLE_RATE) {
+      printf("Entry %ld has a bad format or sample rate.\n\r", (long)i);
+      success = false;
+    }
+    if (entry->format == SOUND_PACK_FORMAT_STREAM &&
+        (entry->fallbackSampleCount == 0 ||
+         entry->fallbackSampleCount > entry->sampleCount)) {
+      printf("Entry %ld has a bad fallback.\n\r", (long)i);
+      success = false;
+    }
+    if (size == 0)
+      continue;
+    if (offset % SOUND_PACK_ALIGNMENT || offset + size > header->size) {
+      printf("Entry %ld is misaligned or outside the pack.\n\r", (long)i);
+      success = false;
+    }
+    if (offset < previousEnd) {
+      printf("Entry %ld overlaps the index or the previous entry.\n\r",
+             (long)i);
+      success = false;
+    }
+    previousEnd = offset + size;
+  }
+  printf("soundPack_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
@@ -0,0 +1,100 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SOUNDPACK_H_
+#define SOUNDPACK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The sound pack: every sound effect in one binary blob, built on the host by
+// tools/sound_pack.py. On the board the blob is linked into the ELF with
+// .incbin; on the host and in the emulator the same file is memory-mapped.
+//
+// The blob starts with a header and an index with one entry per
+// sound_sounds_t value, in the same order, so a sound is found with one array
+// lookup. Each entry gives the offset of its data in the blob (aligned to
+// SOUND_PACK_ALIGNMENT), its sample count, its sample rate and its format.
+// Every sound is stored at SOUND_PACK_SAMPLE_RATE, the rate the codec runs at:
+// tools/sound_pack.py resamples any source at another rate as it packs it, so
+// the firmware never converts rates. All fields are little-endian.
+// tools/sound_pack.py reads the SOUND_PACK_ defines below, so keep them simple
+// numbers.
+//
+// Long sounds can be left out of the pack and streamed instead: they go into
+// a second pack, the stream pack, which has the same layout but its data
+// aligned to SD card sectors, and which is read from the card as they play
+// (see soundStream.h). Their entry here has format SOUND_PACK_FORMAT_STREAM
+// and gives the offset of their data in the stream pack. So that they are
+// still heard without the card, their entry also gives the first
+// SOUND_PACK_FALLBACK_MS of them, as ADPCM in this pack, which is played in
+// their place when they cannot be streamed. Both packs' headers carry the
+// same streamPackId, so a stream pack left on the card from another build is
+// not read with this pack's index.
+
+#define SOUND_PACK_MAGIC 0x4B415053 // "SPAK"
+#define SOUND_PACK_VERSION 2
+#define SOUND_PACK_ALIGNMENT 32 // A cache line.
+#define SOUND_PACK_STREAM_ALIGNMENT 512 // An SD card sector.
+#define SOUND_PACK_NAME_SIZE 16
+#define SOUND_PACK_SAMPLE_RATE 48000
+#define SOUND_PACK_FALLBACK_MS 1000 // Of a streamed sound, kept in the pack.
+
+// Formats of the entries.
+#define SOUND_PACK_FORMAT_SILENCE 0 // No data; sampleCount zeros.
+#define SOUND_PACK_FORMAT_ADPCM 1   // IMA-ADPCM, see adpcm.h.
+#define SOUND_PACK_FORMAT_PCM16 2   // Signed 16-bit samples.
+#define SOUND_PACK_FORMAT_SYNTH 3   // No data; generated, see soundSynth.h.
+#define SOUND_PACK_FORMAT_STREAM 4  // IMA-ADPCM in the stream pack.
+
+typedef struct {
+  char name[SOUND_PACK_NAME_SIZE]; // For printing; NUL-padded.
+  uint32_t offset;                 // Of the data, in the pack or stream pack.
+  uint32_t sampleCount;
+  uint32_t sampleRate; // In Hz.
+  uint8_t format;      // One of SOUND_PACK_FORMAT_*.
+  uint8_t pad[3];
+  uint32_t fallbackOffset;      // Of a streamed sound's fallback, in the pack.
+  uint32_t fallbackSampleCount; // Zero for the other formats.
+} soundPack_entry_t;
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t entryCount;
+  uint32_t size;         // Of the whole pack, in bytes.
+  uint32_t streamPackId; // CRC-32 of the stream pack with this field zero.
+  soundPack_entry_t entries[];
+} soundPack_header_t;
+
+// Finds the pack (maps it on the host) and checks its header. Returns false
+// and prints why if the pack cannot be used. Safe to call more than once.
+bool soundPack_init();
+
+// Returns the entry for a sound (a sound_sounds_t value), or NULL if the pack
+// has no such entry.
+const soundPack_entry_t *soundPack_getEntry(uint32_t sound);
+
+// Returns the data of an entry.
+const uint8_t *soundPack_getData(const soundPack_entry_t *entry);
+
+// Returns the streamPackId of the stream pack built with this pack, or 0 if
+// the pack has not been found.
+uint32_t soundPack_getStreamPackId();
+
+// Returns the fallback of a streamed entry: fallbackSampleCount samples of
+// ADPCM.
+const uint8_t *soundPack_getFallbackData(const soundPack_entry_t *entry);
+
+// Checks that the data of every entry, or its fallback, lies inside the pack,
+// is aligned and does not overlap the next, and prints the index. Returns
+// true if the test passes.
+bool soundPack_runTest();
+
+#endif /* SOUNDPACK_H_ */
@@ -0,0 +1,618 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "soundStream.h"
+#include "intervalTimer.h"
+#include "soundPack.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef SOUND_STREAM_PATH
+#error "SOUND_STREAM_PATH must be defined by the build (see CMakeLists.txt)."
+#endif
+
+#ifdef ZYBO_BOARD
+#include "xil_cache.h"
+#include "xparameters.h"
+#include "xsdps.h"
+#else
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+#define SOUND_STREAM_SECTORS_PER_BUFFER                                        \
+  (SOUND_STREAM_BUFFER_SIZE / SOUND_STREAM_SECTOR_SIZE)
+
+#define SOUND_STREAM_TEST_REFILL_SIZE 8 // Samples, as sound_update() mixes.
+#define SOUND_STREAM_TEST_WAIT_LIMIT 1000000 // Ticks without a sample.
+#define SOUND_STREAM_TEST_HASH_MULTIPLIER 31
+#define SOUND_STREAM_TEST_BYTES_PER_KB 1024
+#define SOUND_STREAM_TEST_NS_PER_MS 1000000
+
+// What has become of the read in flight.
+typedef enum {
+  soundStream_busy_e,
+  soundStream_done_e,
+  soundStream_failed_e
+} soundStream_status_t;
+
+// Stream states.
+typedef enum {
+  soundStream_closed_st, // Waiting for soundStream_init().
+  soundStream_medium_st, // Setting up the card, or opening the file.
+  soundStream_header_st, // Reading the stream pack's header.
+  soundStream_open_st,   // Streaming.
+  soundStream_failed_st  // No stream pack, or reads kept failing.
+} soundStream_st_t;
+
+static soundStream_t soundStream_readers[SOUND_STREAM_READER_COUNT];
+static soundStream_st_t soundStream_state = soundStream_closed_st;
+static uint32_t soundStream_packSize = 0;
+static bool soundStream_headerReading = false; // The header read is in flight.
+static soundStream_t *soundStream_pending = NULL; // Whose read is in flight.
+static uint32_t soundStream_failedReadCount = 0;  // In a row.
+static uint32_t soundStream_underrunCount = 0;
+static uint32_t soundStream_errorCount = 0;
+
+/****************************************************************
+ *                     SD card, on the board                    *
+ ****************************************************************/
+#ifdef ZYBO_BOARD
+// Multiple-block read, with DMA, stopped by the controller with CMD12.
+#define SOUND_STREAM_SD_COMMAND (CMD18 | RESP_R1 | XSDPS_DAT_PRESENT_SEL_MASK)
+#define SOUND_STREAM_SD_MODE                                                   \
+  (XSDPS_TM_DMA_EN_MASK | XSDPS_TM_BLK_CNT_EN_MASK |                           \
+   XSDPS_TM_AUTO_CMD12_EN_MASK | XSDPS_TM_DAT_DIR_SEL_MASK |                   \
+   XSDPS_TM_MUL_SIN_BLK_SEL_MASK)
+#define SOUND_STREAM_SD_COMMAND_SHIFT 16 // In the transfer mode register.
+
+static XSdPs soundStream_sd;
+static bool soundStream_cardReady = false; // Set up and identified.
+// One descriptor covers a whole buffer. The controller reads it from memory,
+// so it is flushed from the cache before each read.
+static XSdPs_Adma2Descriptor32 soundStream_descriptor
+    __attribute__((aligned(32)));
+
+// Sets up the controller and identifies the card, unless that was done
+// already. The driver waits for the card to answer each command, so this
+// takes a while; nothing plays yet.
+static bool soundStream_openMedium() {
+  if (soundStream_cardReady)
+    return true;
+  XSdPs_Config *config = XSdPs_LookupConfig(XPAR_XSDPS_0_DEVICE_ID);
+  if (config == NULL ||
+      XSdPs_CfgInitialize(&soundStream_sd, config, config->BaseAddress) !=
+          XST_SUCCESS ||
+      XSdPs_CardInitialize(&soundStream_sd) != XST_SUCCESS) {
+    printf("soundStream: no SD card.\n\r");
+    return false;
+  }
+  soundStream_cardReady = true;
+  return true;
+}
+
+// Has the next soundStream_openMedium() identify the card again, which may
+// have been swapped.
+static void soundStream_closeMedium() { soundStream_cardReady = false; }
+
+// Returns the command argument for a sector-aligned offset in the stream
+// pack: a sector number on a high-capacity card, a byte address otherwise.
+static u32 soundStream_getAddress(uint32_t offset) {
+  u32 sector = SOUND_STREAM_FIRST_SECTOR + offset / SOUND_STREAM_SECTOR_SIZE;
+  return soundStream_sd.HCS ? sector : sector * SOUND_STREAM_SECTOR_SIZE;
+}
+
+// Reads whole sectors and waits for them. Only used when nothing is in
+// flight.
+static bool soundStream_readNow(uint32_t offset, uint8_t *buffer,
+                                uint32_t size) {
+  Xil_DCacheInvalidateRange((INTPTR)buffer, size);
+  bool success =
+      XSdPs_ReadPolled(&soundStream_sd, soundStream_getAddress(offset),
+                       size / SOUND_STREAM_SECTOR_SIZE, buffer) == XST_SUCCESS;
+  Xil_DCacheInvalidateRange((INTPTR)buffer, size);
+  return success;
+}
+
+// Starts reading a buffer's worth. Returns false if the controller is still
+// busy.
+static bool soundStream_startRead(uint32_t offset, uint8_t *buffer) {
+  u32 base = soundStream_sd.Config.BaseAddress;
+  if (XSdPs_ReadReg(base, XSDPS_PRES_STATE_OFFSET) &
+      (XSDPS_PSR_INHIBIT_CMD_MASK | XSDPS_PSR_INHIBIT_DAT_MASK))
+    return false;
+  soundStream_descriptor.Attribute =
+      XSDPS_DESC_TRAN | XSDPS_DESC_END | XSDPS_DESC_VALID;
+  soundStream_descriptor.Length = SOUND_STREAM_BUFFER_SIZE;
+  soundStream_descriptor.Address = (u32)(UINTPTR)buffer;
+  Xil_DCacheFlushRange((INTPTR)&soundStream_descriptor,
+                       sizeof(soundStream_descriptor));
+  // No line of the buffer may be written back over the data.
+  Xil_DCacheInvalidateRange((INTPTR)buffer, SOUND_STREAM_BUFFER_SIZE);
+  XSdPs_WriteReg(base, XSDPS_ADMA_SAR_OFFSET,
+                 (u32)(UINTPTR)&soundStream_descriptor);
+  XSdPs_WriteReg8(base, XSDPS_HOST_CTRL1_OFFSET,
+                  (XSdPs_ReadReg8(base, XSDPS_HOST_CTRL1_OFFSET) &
+                   ~XSDPS_HC_DMA_MASK) |
+                      XSDPS_HC_DMA_ADMA2_32_MASK);
+  XSdPs_WriteReg16(base, XSDPS_BLK_SIZE_OFFSET, XSDPS_BLK_SIZE_512_MASK);
+  XSdPs_WriteReg16(base, XSDPS_BLK_CNT_OFFSET,
+                   SOUND_STREAM_SECTORS_PER_BUFFER);
+  XSdPs_WriteReg16(base, XSDPS_NORM_INTR_STS_OFFSET, XSDPS_NORM_INTR_ALL_MASK);
+  XSdPs_WriteReg16(base, XSDPS_ERR_INTR_STS_OFFSET, XSDPS_ERROR_INTR_ALL_MASK);
+  XSdPs_WriteReg(base, XSDPS_ARGMT_OFFSET, soundStream_getAddress(offset));
+  // Writing the command register sends the command.
+  XSdPs_WriteReg(base, XSDPS_XFER_MODE_OFFSET,
+                 (SOUND_STREAM_SD_COMMAND << SOUND_STREAM_SD_COMMAND_SHIFT) |
+                     SOUND_STREAM_SD_MODE);
+  return true;
+}
+
+// Checks on the read in flight.
+static soundStream_status_t soundStream_checkRead() {
+  u32 base = soundStream_sd.Config.BaseAddress;
+  u16 status = XSdPs_ReadReg16(base, XSDPS_NORM_INTR_STS_OFFSET);
+  if (status & XSDPS_INTR_ERR_MASK) {
+    XSdPs_WriteReg16(base, XSDPS_ERR_INTR_STS_OFFSET,
+                     XSDPS_ERROR_INTR_ALL_MASK);
+    XSdPs_WriteReg16(base, XSDPS_NORM_INTR_STS_OFFSET,
+                     XSDPS_NORM_INTR_ALL_MASK);
+    // Free the lines for the next command.
+    XSdPs_WriteReg8(base, XSDPS_SW_RST_OFFSET,
+                    XSDPS_SWRST_CMD_LINE_MASK | XSDPS_SWRST_DAT_LINE_MASK);
+    return soundStream_failed_e;
+  }
+  if (!(status & XSDPS_INTR_TC_MASK))
+    return soundStream_busy_e;
+  XSdPs_WriteReg16(base, XSDPS_NORM_INTR_STS_OFFSET, XSDPS_NORM_INTR_ALL_MASK);
+  // Drop any lines of the buffer fetched while the controller was writing.
+  Xil_DCacheInvalidateRange((INTPTR)soundStream_descriptor.Address,
+                            SOUND_STREAM_BUFFER_SIZE);
+  return soundStream_done_e;
+}
+
+/****************************************************************
+ *                 regular file, on the host                    *
+ ****************************************************************/
+#else
+static int soundStream_file = -1;
+static bool soundStream_fileReadSucceeded = false;
+
+// Opens the stream pack, unless it is open already.
+static bool soundStream_openMedium() {
+  if (soundStream_file >= 0)
+    return true;
+  const char *path = getenv("SOUND_STREAM");
+  if (path == NULL)
+    path = SOUND_STREAM_PATH;
+  soundStream_file = open(path, O_RDONLY);
+  if (soundStream_file < 0) {
+    perror(path);
+    return false;
+  }
+  return true;
+}
+
+// Has the next soundStream_openMedium() open the file again.
+static void soundStream_closeMedium() {
+  close(soundStream_file);
+  soundStream_file = -1;
+}
+
+// Reads and waits. Past the end of the file reads as zeros.
+static bool soundStream_readNow(uint32_t offset, uint8_t *buffer,
+                                uint32_t size) {
+  ssize_t read = pread(soundStream_file, buffer, size, offset);
+  if (read < 0)
+    return false;
+  memset(buffer + read, 0, size - read);
+  return true;
+}
+
+// Reads a buffer's worth. It is done at once, but only picked up by the next
+// check, as on the board.
+static bool soundStream_startRead(uint32_t offset, uint8_t *buffer) {
+  soundStream_fileReadSucceeded =
+      soundStream_readNow(offset, buffer, SOUND_STREAM_BUFFER_SIZE);
+  return true;
+}
+
+// Checks on the read in flight.
+static soundStream_status_t soundStream_checkRead() {
+  return soundStream_fileReadSucceeded ? soundStream_done_e
+                                       : soundStream_failed_e;
+}
+#endif
+
+/****************************************************************
+ *                          readers                             *
+ ****************************************************************/
+
+// Starts looking for the stream pack. The card stays set up from the last
+// call, so usually only the header is read again.
+void soundStream_init() {
+  for (uint32_t i = 0; i < SOUND_STREAM_READER_COUNT; i++)
+    soundStream_readers[i].open = false;
+  while (soundStream_pending != NULL ||
+         soundStream_headerReading) // Let the read in flight finish.
+    soundStream_tick();
+  soundStream_failedReadCount = 0;
+  soundStream_state = soundStream_medium_st;
+}
+
+// Returns true until the stream pack has been found or given up on.
+bool soundStream_isOpening() {
+  return soundStream_state == soundStream_medium_st ||
+         soundStream_state == soundStream_header_st;
+}
+
+// Returns true while sounds can be streamed.
+bool soundStream_isOpen() { return soundStream_state == soundStream_open_st; }
+
+// Returns a free reader, or NULL. A closed reader with a read still in flight
+// is not free yet.
+static soundStream_t *soundStream_findReader() {
+  if (soundStream_state != soundStream_open_st)
+    return NULL;
+  for (uint32_t i = 0; i < SOUND_STREAM_READER_COUNT; i++)
+    if (!soundStream_readers[i].open && !soundStream_readers[i].reading)
+      return &soundStream_readers[i];
+  return NULL;
+}
+
+// Returns true if a sound can be streamed now.
+bool soundStream_isAvailable() { return soundStream_findReader() != NULL; }
+
+// Returns true if the stream is open and holds the sound.
+bool soundStream_hasSound(uint32_t offset, uint32_t sampleCount) {
+  return soundStream_state == soundStream_open_st &&
+         offset % SOUND_STREAM_SECTOR_SIZE == 0 &&
+         offset + adpcm_getEncodedSize(sampleCount) <= soundStream_packSize;
+}
+
+// Starts streaming a sound from offset in the stream pack.
+soundStream_t *soundStream_open(uint32_t offset, uint32_t sampleCount) {
+  soundStream_t *reader = soundStream_findReader();
+  if (reader == NULL || !soundStream_hasSound(offset, sampleCount))
+    return NULL;
+  reader->open = true;
+  reader->readOffset = offset;
+  reader->endOffset = offset + adpcm_getEncodedSize(sampleCount);
+  reader->filledCount = 0;
+  reader->emptiedCount = 0;
+  reader->consumed = 0;
+  reader->sampleCount = sampleCount;
+  reader->position = 0;
+  adpcm_initDecoder(&reader->decoder, reader->block, 0); // No block yet.
+  soundStream_tick(); // Start reading straight away.
+  return reader;
+}
+
+// Frees a reader. Does nothing for NULL.
+void soundStream_close(soundStream_t *reader) {
+  if (reader != NULL)
+    reader->open = false;
+}
+
+// Returns the number of full buffers in a reader's ring.
+static uint32_t soundStream_getFullCount(const soundStream_t *reader) {
+  return reader->filledCount - reader->emptiedCount;
+}
+
+// Counts a failed read. Returns false, and gives up on the card, once too
+// many have failed in a row: the sounds being streamed are cut short, and
+// later ones play their fallback (see soundPack.h). The next soundStream_init()
+// then sets up the card from scratch.
+static bool soundStream_countFailedRead() {
+  soundStream_errorCount++;
+  if (++soundStream_failedReadCount < SOUND_STREAM_READ_ATTEMPTS)
+    return true;
+  printf("soundStream: %d reads failed in a row; not streaming any more.\n\r",
+         SOUND_STREAM_READ_ATTEMPTS);
+  soundStream_closeMedium();
+  soundStream_state = soundStream_failed_st;
+  return false;
+}
+
+// Reads the stream pack's header into the first buffer, which is free until
+// the pack is open, and checks it.
+static void soundStream_readHeader() {
+  uint8_t *buffer = soundStream_readers[0].buffers[0];
+  if (!soundStream_headerReading) {
+    soundStream_headerReading = soundStream_startRead(0, buffer);
+    return;
+  }
+  soundStream_status_t status = soundStream_checkRead();
+  if (status == soundStream_busy_e)
+    return;
+  soundStream_headerReading = false;
+  if (status == soundStream_failed_e) {
+    soundStream_countFailedRead(); // Tried again on the next tick.
+    return;
+  }
+  soundStream_failedReadCount = 0;
+  const soundPack_header_t *header = (const soundPack_header_t *)buffer;
+  if (header->magic != SOUND_PACK_MAGIC ||
+      header->version != SOUND_PACK_VERSION ||
+      header->size > SOUND_STREAM_SECTOR_COUNT * SOUND_STREAM_SECTOR_SIZE) {
+    printf("soundStream: no version %d stream pack.\n\r", SOUND_PACK_VERSION);
+    soundStream_state = soundStream_failed_st;
+    return;
+  }
+  if (header->streamPackId != soundPack_getStreamPackId()) {
+    printf("soundStream: the stream pack was not built with sounds.pack.\n\r");
+    soundStream_state = soundStream_failed_st;
+    return;
+  }
+  soundStream_packSize = header->size;
+  soundStream_state = soundStream_open_st;
+}
+
+// Finishes the read in flight, if it is done, and starts the next one.
+static void soundStream_fillReaders() {
+  if (soundStream_pending != NULL) {
+    soundStream_t *reader = soundStream_pending;
+    soundStream_status_t status = soundStream_checkRead();
+    if (status == soundStream_busy_e)
+      return;
+    soundStream_pending = NULL;
+    reader->reading = false;
+    if (status == soundStream_done_e) {
+      soundStream_failedReadCount = 0;
+      reader->filledCount++;
+      reader->readOffset += SOUND_STREAM_BUFFER_SIZE;
+    } else if (!soundStream_countFailedRead()) {
+      return;
+    } // Otherwise tried again below.
+  }
+  // The reader with least data waiting goes first.
+  soundStream_t *next = NULL;
+  for (uint32_t i = 0; i < SOUND_STREAM_READER_COUNT; i++) {
+    soundStream_t *reader = &soundStream_readers[i];
+    if (reader->open && reader->readOffset < reader->endOffset &&
+        soundStream_getFullCount(reader) < SOUND_STREAM_BUFFER_COUNT &&
+        (next == NULL ||
+         soundStream_getFullCount(reader) < soundStream_getFullCount(next)))
+      next = reader;
+  }
+  if (next != NULL &&
+      soundStream_startRead(
+          next->readOffset,
+          next->buffers[next->filledCount % SOUND_STREAM_BUFFER_COUNT])) {
+    soundStream_pending = next;
+    next->reading = true;
+  }
+}
+
+// Opens the stream pack, then keeps the readers' rings filled.
+void soundStream_tick() {
+  switch (soundStream_state) {
+  case soundStream_medium_st:
+    if (soundStream_openMedium()) {
+      soundStream_state = soundStream_header_st;
+    } else {
+      soundStream_state = soundStream_failed_st;
+    }
+    break;
+  case soundStream_header_st:
+    soundStream_readHeader();
+    break;
+  case soundStream_open_st:
+    soundStream_fillReaders();
+    break;
+  default:
+    break;
+  }
+}
+
+// Copies the next ADPCM block out of the ring, freeing the buffers it
+// empties, and starts decoding it. A block can straddle two buffers, so it is
+// always copied whole. Returns false if the ring does not hold all of it yet.
+static bool soundStream_loadBlock(soundStream_t *reader) {
+  uint32_t count = reader->sampleCount - reader->position;
+  if (count > ADPCM_BLOCK_SAMPLE_COUNT)
+    count = ADPCM_BLOCK_SAMPLE_COUNT;
+  uint32_t size = adpcm_getEncodedSize(count);
+  if (soundStream_getFullCount(reader) * SOUND_STREAM_BUFFER_SIZE -
+          reader->consumed <
+      size)
+    return false;
+  for (uint32_t copied = 0; copied < size;) {
+    const uint8_t *buffer =
+        reader->buffers[reader->emptiedCount % SOUND_STREAM_BUFFER_COUNT];
+    uint32_t chunk = SOUND_STREAM_BUFFER_SIZE - reader->consumed;
+    if (chunk > size - copied)
+      chunk = size - copied;
+    memcpy(&reader->block[copied], &buffer[reader->consumed], chunk);
+    copied += chunk;
+    reader->consumed += chunk;
+    if (reader->consumed == SOUND_STREAM_BUFFER_SIZE) {
+      reader->consumed = 0;
+      reader->emptiedCount++;
+    }
+  }
+  adpcm_initDecoder(&reader->decoder, reader->block, count);
+  return true;
+}
+
+// Decodes up to count samples into samples[].
+uint32_t soundStream_read(soundStream_t *reader, int16_t samples[],
+                          uint32_t count) {
+  uint32_t done = 0;
+  if (reader == NULL)
+    return 0;
+  while (done < count && reader->position < reader->sampleCount) {
+    if (reader->decoder.position == reader->decoder.sampleCount &&
+        !soundStream_loadBlock(reader)) {
+      // Not just waiting for the first read, nor given up on.
+      if (reader->position > 0 && soundStream_isOpen())
+        soundStream_underrunCount++;
+      break;
+    }
+    uint32_t decoded =
+        adpcm_decode(&reader->decoder, &samples[done], count - done);
+    done += decoded;
+    reader->position += decoded;
+  }
+  return done;
+}
+
+// Returns the number of reads that found a ring dry part way through a sound.
+uint32_t soundStream_getUnderrunCount() { return soundStream_underrunCount; }
+
+static uint8_t soundStream_testSectors[2 * SOUND_STREAM_SECTOR_SIZE]
+    __attribute__((aligned(32)));
+static int16_t soundStream_testSamples[ADPCM_BLOCK_SAMPLE_COUNT];
+
+// Returns a hash of count samples, carrying on from hash.
+static uint32_t soundStream_testHash(uint32_t hash, const int16_t samples[],
+                                     uint32_t count) {
+  for (uint32_t i = 0; i < count; i++)
+    hash = hash * SOUND_STREAM_TEST_HASH_MULTIPLIER + (uint16_t)samples[i];
+  return hash;
+}
+
+// Checks that the stream pack's index agrees with the pack about a sound.
+static bool soundStream_testIndex(const soundPack_entry_t *entry) {
+  const soundPack_header_t *header =
+      (const soundPack_header_t *)soundStream_testSectors;
+  if (!soundStream_readNow(0, soundStream_testSectors,
+                           sizeof(soundStream_testSectors)))
+    return false;
+  for (uint32_t i = 0; i < header->entryCount &&
+                       (const uint8_t *)&header->entries[i + 1] <=
+                           soundStream_testSectors +
+                               sizeof(soundStream_testSectors);
+       i++) {
+    const soundPack_entry_t *streamed = &header->entries[i];
+    if (strncmp(streamed->name, entry->name, SOUND_PACK_NAME_SIZE) == 0)
+      return streamed->format == SOUND_PACK_FORMAT_ADPCM &&
+             streamed->offset == entry->offset &&
+             streamed->sampleCount == entry->sampleCount;
+  }
+  return false;
+}
+
+// Streams a sound a FIFO refill at a time, ticking before each refill as
+// sound_update() does, and returns a hash of its samples.
+static bool soundStream_testStream(const soundPack_entry_t *entry,
+                                   uint32_t *hash) {
+  soundStream_t *reader =
+      soundStream_open(entry->offset, entry->sampleCount);
+  if (reader == NULL)
+    return false;
+  int16_t samples[SOUND_STREAM_TEST_REFILL_SIZE];
+  uint32_t waits = 0;
+  while (reader->position < entry->sampleCount &&
+         waits < SOUND_STREAM_TEST_WAIT_LIMIT) {
+    soundStream_tick();
+    uint32_t read =
+        soundStream_read(reader, samples, SOUND_STREAM_TEST_REFILL_SIZE);
+    *hash = soundStream_testHash(*hash, samples, read);
+    waits = read ? 0 : waits + 1;
+  }
+  bool success = reader->position == entry->sampleCount;
+  soundStream_close(reader);
+  while (soundStream_pending != NULL) // Leave the card idle.
+    soundStream_tick();
+  return success;
+}
+
+// Decodes a sound straight from the card, a block at a time, and returns a
+// hash of its samples.
+static bool soundStream_testReference(const soundPack_entry_t *entry,
+                                      uint32_t *hash) {
+  for (uint32_t position = 0; position < entry->sampleCount;
+       position += ADPCM_BLOCK_SAMPLE_COUNT) {
+    uint32_t count = entry->sampleCount - position;
+    if (count > ADPCM_BLOCK_SAMPLE_COUNT)
+      count = ADPCM_BLOCK_SAMPLE_COUNT;
+    uint32_t offset = entry->offset +
+                      position / ADPCM_BLOCK_SAMPLE_COUNT * ADPCM_BLOCK_SIZE;
+    uint32_t sector = offset / SOUND_STREAM_SECTOR_SIZE *
+                      SOUND_STREAM_SECTOR_SIZE; // A block spans at most two.
+    if (!soundStream_readNow(sector, soundStream_testSectors,
+                             sizeof(soundStream_testSectors)))
+      return false;
+    adpcm_decoder_t decoder;
+    adpcm_initDecoder(&decoder, &soundStream_testSectors[offset - sector],
+                      count);
+    adpcm_decode(&decoder, soundStream_testSamples, count);
+    *hash = soundStream_testHash(*hash, soundStream_testSamples, count);
+  }
+  return true;
+}
+
+// Streams every streamed sound and checks it against a direct read.
+bool soundStream_runTest() {
+  printf("****************** soundStream_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  intervalTimer_startTimestampCounter();
+  bool packFound = soundPack_init(); // Before the header is checked.
+  soundStream_init();
+  while (soundStream_isOpening())
+    soundStream_tick();
+  if (!packFound || !soundStream_isOpen()) {
+    printf("soundStream_runTest() failed\n\r");
+    return false;
+  }
+  uint32_t errorCount = soundStream_errorCount;
+  uint32_t streamedBytes = 0;
+  uint32_t fallbackBytes = 0;
+  uint64_t streamedNs = 0;
+  const soundPack_entry_t *entry;
+  for (uint32_t i = 0; (entry = soundPack_getEntry(i)) != NULL; i++) {
+    if (entry->format != SOUND_PACK_FORMAT_STREAM)
+      continue;
+    uint32_t streamedHash = 0;
+    uint32_t referenceHash = 0;
+    if (!soundStream_testIndex(entry)) {
+      printf("%-16.16s is not in the stream pack.\n\r", entry->name);
+      success = false;
+      continue;
+    }
+    uint64_t startTicks = intervalTimer_nowTicks();
+    bool streamed = soundStream_testStream(entry, &streamedHash);
+    streamedNs +=
+        intervalTimer_ticksToNs(intervalTimer_nowTicks() - startTicks);
+    streamedBytes += adpcm_getEncodedSize(entry->sampleCount);
+    fallbackBytes += adpcm_getEncodedSize(entry->fallbackSampleCount);
+    if (!streamed || !soundStream_testReference(entry, &referenceHash) ||
+        streamedHash != referenceHash) {
+      printf("%-16.16s did not stream correctly.\n\r", entry->name);
+      success = false;
+      continue;
+    }
+    printf("%-16.16s %6ld samples streamed.\n\r", entry->name,
+           (long)entry->sampleCount);
+  }
+  if (soundStream_errorCount != errorCount) {
+    printf("%ld reads failed.\n\r",
+           (long)(soundStream_errorCount - errorCount));
+    success = false;
+  }
+
+  // How fast the card keeps the rings filled, against how fast sounds play.
+  // The loop above does little but wait for the card, so this is about the
+  // card's rate.
+  uint32_t msStreamed = streamedNs / SOUND_STREAM_TEST_NS_PER_MS;
+  printf("Streamed %ld KB in %ld ms; playing takes %ld KB/s.\n\r",
+         (long)(streamedBytes / SOUND_STREAM_TEST_BYTES_PER_KB),
+         (long)msStreamed,
+         (long)(adpcm_getEncodedSize(SOUND_PACK_SAMPLE_RATE) /
+                SOUND_STREAM_TEST_BYTES_PER_KB));
+  printf("%ld bytes of sounds kept off the flash, less %ld bytes of "
+         "fallbacks, for %ld bytes of RAM in readers.\n\r",
+         (long)streamedBytes, (long)fallbackBytes,
+         (long)sizeof(soundStream_readers));
+  printf("soundStream_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
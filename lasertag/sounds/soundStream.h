@@ -0,0 +1,122 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SOUNDSTREAM_H_
+#define SOUNDSTREAM_H_
+
+#include "lasertag/adpcm.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Streaming of the long sounds, which are kept out of the sound pack and off
+// the board's flash and RAM (see soundPack.h). They are in the stream pack,
+// which tools/sound_pack.py builds as sounds_stream.pack. The BSP has the SD
+// driver but no file system, so the stream pack is written to the card as
+// raw sectors, between the partition table and the first partition:
+//
+//   dd if=sounds_stream.pack of=/dev/sdX bs=512 seek=8 conv=notrunc
+//
+// On the host and in the emulator the same reader reads the file in the
+// build tree instead; SOUND_STREAM in the environment overrides its path.
+//
+// A sound plays through a reader, which holds a ring of
+// SOUND_STREAM_BUFFER_COUNT buffers. soundStream_tick() keeps the rings
+// topped up, one read of SOUND_STREAM_BUFFER_SIZE bytes at a time: on the
+// board it starts an ADMA transfer on the SD controller and returns, and a
+// later tick picks up the finished buffer, so sound_update() never waits for
+// the card. The mixer decodes the ADPCM out of the ring a block at a time.
+// If the ring runs dry the sound is held up, not cut short, and carries on
+// once the next buffer arrives. All functions are called from the main loop.
+//
+// soundStream_tick() also opens the stream pack after soundStream_init(): on
+// the board it sets up the SD controller and identifies the card, in one
+// call to the BSP's driver that waits for the card, then reads the header
+// like any other buffer. The card is only set up the first time; later
+// soundStream_init() calls just read the header again, unless reads had kept
+// failing. The header must carry the streamPackId of the sound
+// pack (see soundPack.h), so call soundPack_init() first. If there is no card
+// or matching stream pack, or SOUND_STREAM_READ_ATTEMPTS reads fail in a row,
+// streaming stops: sounds being streamed end early, and the pack's fallbacks
+// are played instead (see soundPack.h).
+
+#define SOUND_STREAM_SECTOR_SIZE 512
+#define SOUND_STREAM_FIRST_SECTOR 8 // Of the stream pack on the card.
+#define SOUND_STREAM_SECTOR_COUNT 2040 // Up to where partitions usually start.
+#define SOUND_STREAM_BUFFER_SIZE 2048 // Bytes per read; 83 ms of ADPCM.
+#define SOUND_STREAM_BUFFER_COUNT 3   // Per reader.
+#define SOUND_STREAM_READER_COUNT 2   // Sounds that can stream at once.
+#define SOUND_STREAM_READ_ATTEMPTS 3  // Failing in a row, to give up.
+
+// A sound being streamed. The buffers are whole cache lines, as the SD
+// controller writes them behind the cache.
+typedef struct {
+  bool open;
+  bool reading;          // A read into the ring is in flight.
+  uint32_t readOffset;   // In the stream pack, of the next read.
+  uint32_t endOffset;    // Of the end of the sound's data.
+  uint32_t filledCount;  // Buffers ever filled, and ever emptied; a buffer's
+  uint32_t emptiedCount; // place in the ring is its count modulo the size.
+  uint32_t consumed;     // Bytes taken from the oldest full buffer.
+  uint32_t sampleCount;
+  uint32_t position; // Number of the next sample to decode.
+  adpcm_decoder_t decoder;
+  uint8_t block[ADPCM_BLOCK_SIZE]; // Being decoded; copied out of the ring.
+  uint8_t buffers[SOUND_STREAM_BUFFER_COUNT][SOUND_STREAM_BUFFER_SIZE]
+      __attribute__((aligned(32)));
+} soundStream_t;
+
+// Closes every reader and starts looking for the stream pack. Returns at
+// once; soundStream_tick() does the rest.
+void soundStream_init();
+
+// Returns true until the stream pack has been found, or found missing.
+bool soundStream_isOpening();
+
+// Returns true while sounds can be streamed: the stream pack was found and
+// reads have not kept failing. Prints why not when it becomes false.
+bool soundStream_isOpen();
+
+// Returns true if a sound can be streamed now: the stream is open and a
+// reader is free.
+bool soundStream_isAvailable();
+
+// Returns true if the stream is open and the sound whose data is at offset,
+// sampleCount samples of it, lies inside the stream pack.
+bool soundStream_hasSound(uint32_t offset, uint32_t sampleCount);
+
+// Starts streaming the sound whose data is at offset in the stream pack, and
+// starts reading ahead. Returns NULL if no reader is free or
+// !soundStream_hasSound().
+soundStream_t *soundStream_open(uint32_t offset, uint32_t sampleCount);
+
+// Frees a reader. A read still in flight into it is let finish first. Does
+// nothing for NULL.
+void soundStream_close(soundStream_t *reader);
+
+// Decodes up to count samples into samples[]. Returns the number decoded,
+// which is less than count at the end of the sound or if the ring has run
+// dry, and 0 for a NULL reader. Once the stream has stopped
+// (!soundStream_isOpen()) a ring that runs dry stays dry.
+uint32_t soundStream_read(soundStream_t *reader, int16_t samples[],
+                          uint32_t count);
+
+// Opens the stream pack, a step at a time. Then finishes the read in flight,
+// if it is done, and starts the next one for the reader that has least data
+// waiting. Called on every sound_update().
+void soundStream_tick();
+
+// Returns the number of reads that found a ring dry part way through a sound.
+uint32_t soundStream_getUnderrunCount();
+
+// Streams every streamed sound, a FIFO refill at a time, checks it against
+// the same sound read sector by sector, and prints how fast the card reads
+// against how fast the sounds play. Returns true if the test passes.
+bool soundStream_runTest();
+
+#endif /* SOUNDSTREAM_H_ */
@@ -0,0 +1,446 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "statistics.h"
+#include "intervalTimer.h"
+#ifdef LASERTAG_BLUETOOTH
+#include "bluetooth/bluetooth.h"
+#endif
+#include <stdio.h>
+#include <string.h>
+
+// Large enough for the header of a full registry with 24-character names.
+#define STATISTICS_FRAME_BUFFER_SIZE 1024
+#define STATISTICS_FRAME_OVERHEAD 6 // Sync (2), type, length (2), checksum.
+#define STATISTICS_FRAME_PAYLOAD_OFFSET 5
+
+typedef struct {
+  const char *name;
+  uint16_t kind;
+  uint32_t count;         // Counters.
+  double value;           // Gauges.
+  double maximum;         // Gauges.
+  virtualTimer_t *timer;  // Timers.
+} statistics_entry_t;
+
+static statistics_entry_t statistics_entries[STATISTICS_MAX_ENTRY_COUNT];
+static uint16_t statistics_entryCount = 0;
+static statistics_updateCallback_t statistics_updateCallback = NULL;
+
+static uint16_t statistics_format = STATISTICS_FORMAT_CSV;
+static uint16_t statistics_sink = STATISTICS_SINK_UART;
+static uint8_t *statistics_outputBuffer = NULL;
+static uint32_t statistics_outputBufferSize = 0;
+static uint32_t statistics_outputBufferCount = 0;
+static uint32_t statistics_droppedByteCount = 0;
+
+// Snapshot times are relative to statistics_init().
+static uint64_t statistics_startTicks = 0;
+static bool statistics_periodic = false;
+static uint64_t statistics_periodTicks = 0;
+static uint64_t statistics_nextSnapshotTicks = 0;
+
+// Frames and CSV lines are built here before being written.
+static uint8_t statistics_frame[STATISTICS_FRAME_BUFFER_SIZE];
+
+// Empties the registry, stops periodic snapshots and selects CSV to the UART.
+void statistics_init() {
+  intervalTimer_startTimestampCounter();
+  statistics_entryCount = 0;
+  statistics_updateCallback = NULL;
+  statistics_format = STATISTICS_FORMAT_CSV;
+  statistics_sink = STATISTICS_SINK_UART;
+  statistics_droppedByteCount = 0;
+  statistics_periodic = false;
+  statistics_startTicks = intervalTimer_nowTicks();
+}
+
+// Adds an entry of the given kind. Returns its id.
+static statistics_id_t statistics_addEntry(const char *name, uint16_t kind,
+                                           virtualTimer_t *timer) {
+  if (statistics_entryCount >= STATISTICS_MAX_ENTRY_COUNT) {
+    printf("statistics: registry full, %s not added.\n\r", name);
+    return STATISTICS_INVALID_ID;
+  }
+  statistics_entry_t *entry = &statistics_entries[statistics_entryCount];
+  entry->name = name;
+  entry->kind = kind;
+  entry->count = 0;
+  entry->value = 0.0;
+  entry->maximum = 0.0;
+  entry->timer = timer;
+  return statistics_entryCount++;
+}
+
+statistics_id_t statistics_addCounter(const char *name) {
+  return statistics_addEntry(name, STATISTICS_KIND_COUNTER, NULL);
+}
+
+statistics_id_t statistics_addGauge(const char *name) {
+  return statistics_addEntry(name, STATISTICS_KIND_GAUGE, NULL);
+}
+
+statistics_id_t statistics_addTimer(const char *name, virtualTimer_t *timer) {
+  return statistics_addEntry(name, STATISTICS_KIND_TIMER, timer);
+}
+
+// Adds one to a counter.
+void statistics_increment(statistics_id_t id) {
+  if (id < statistics_entryCount)
+    statistics_entries[id].count++;
+}
+
+// Adds amount to a counter.
+void statistics_add(statistics_id_t id, uint32_t amount) {
+  if (id < statistics_entryCount)
+    statistics_entries[id].count += amount;
+}
+
+// Sets a gauge and updates its maximum.
+void statistics_setGauge(statistics_id_t id, double value) {
+  if (id >= statistics_entryCount)
+    return;
+  statistics_entry_t *entry = &statistics_entries[id];
+  entry->value = value;
+  if (value > entry->maximum)
+    entry->maximum = value;
+}
+
+// Returns the current value of an entry.
+double statistics_getValue(statistics_id_t id) {
+  if (id >= statistics_entryCount)
+    return 0.0;
+  statistics_entry_t *entry = &statistics_entries[id];
+  switch (entry->kind) {
+  case STATISTICS_KIND_COUNTER:
+    return entry->count;
+  case STATISTICS_KIND_TIMER:
+    return virtualTimer_getTotalDurationInSeconds(entry->timer);
+  default:
+    return entry->value;
+  }
+}
+
+// Returns the largest value a gauge was set to.
+double statistics_getMaximum(statistics_id_t id) {
+  return id < statistics_entryCount ? statistics_entries[id].maximum : 0.0;
+}
+
+uint16_t statistics_getEntryCount() { return statistics_entryCount; }
+
+// Zeroes counters, gauges and their maxima.
+void statistics_resetValues() {
+  for (uint16_t i = 0; i < statistics_entryCount; i++) {
+    statistics_entries[i].count = 0;
+    statistics_entries[i].value = 0.0;
+    statistics_entries[i].maximum = 0.0;
+  }
+}
+
+void statistics_setUpdateCallback(statistics_updateCallback_t callback) {
+  statistics_updateCallback = callback;
+}
+
+void statistics_setOutput(uint16_t format, uint16_t sink) {
+  statistics_format = format;
+  statistics_sink = sink;
+}
+
+// Sets the memory used by STATISTICS_SINK_BUFFER and empties it.
+void statistics_setOutputBuffer(uint8_t *buffer, uint32_t size) {
+  statistics_outputBuffer = buffer;
+  statistics_outputBufferSize = size;
+  statistics_outputBufferCount = 0;
+}
+
+uint32_t statistics_getOutputBufferCount() {
+  return statistics_outputBufferCount;
+}
+
+uint32_t statistics_getDroppedByteCount() {
+  return statistics_droppedByteCount;
+}
+
+// Sends bytes to the selected sink, counting any that do not fit.
+static void statistics_write(uint8_t *data, uint32_t size) {
+  uint32_t written = 0;
+  switch (statistics_sink) {
+  case STATISTICS_SINK_UART:
+    for (written = 0; written < size; written++)
+      putchar(data[written]);
+    break;
+  case STATISTICS_SINK_BLUETOOTH: // Dropped if bluetooth is not linked in.
+#ifdef LASERTAG_BLUETOOTH
+    written = bluetooth_transmitQueueWrite(data, size);
+#endif
+    break;
+  case STATISTICS_SINK_BUFFER: {
+    uint32_t space = statistics_outputBufferSize - statistics_outputBufferCount;
+    written = size < space ? size : space;
+    memcpy(&statistics_outputBuffer[statistics_outputBufferCount], data,
+           written);
+    statistics_outputBufferCount += written;
+    break;
+  }
+  }
+  statistics_droppedByteCount += size - written;
+}
+
+// Appends a 32-bit value to the frame, least-significant byte first.
+static uint32_t statistics_putUint32(uint32_t index, uint32_t value) {
+  for (uint16_t i = 0; i < sizeof(uint32_t); i++)
+    statistics_frame[index++] = (value >> (8 * i)) & 0xFF;
+  return index;
+}
+
+// Appends a value as an IEEE float.
+static uint32_t statistics_putFloat(uint32_t index, double value) {
+  float f = value;
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  return statistics_putUint32(index, bits);
+}
+
+// Adds the sync bytes, length and checksum around the payload already in the
+// frame buffer, then writes the frame.
+static void statistics_writeFrame(uint8_t type, uint32_t payloadSize) {
+  statistics_frame[0] = STATISTICS_FRAME_SYNC_0;
+  statistics_frame[1] = STATISTICS_FRAME_SYNC_1;
+  statistics_frame[2] = type;
+  statistics_frame[3] = payloadSize & 0xFF;
+  statistics_frame[4] = (payloadSize >> 8) & 0xFF;
+  uint8_t checksum = 0;
+  uint32_t end = STATISTICS_FRAME_PAYLOAD_OFFSET + payloadSize;
+  for (uint32_t i = STATISTICS_FRAME_PAYLOAD_OFFSET; i < end; i++)
+    checksum += statistics_frame[i];
+  statistics_frame[end] = checksum;
+  statistics_write(statistics_frame, payloadSize + STATISTICS_FRAME_OVERHEAD);
+}
+
+// Appends text to the CSV line in the frame buffer. Returns the new length.
+static uint32_t statistics_putText(uint32_t length, const char *text) {
+  int count = snprintf((char *)&statistics_frame[length],
+                       STATISTICS_FRAME_BUFFER_SIZE - length, "%s", text);
+  length += count;
+  return length < STATISTICS_FRAME_BUFFER_SIZE
+             ? length
+             : STATISTICS_FRAME_BUFFER_SIZE - 1;
+}
+
+// Writes the CSV header line or the binary header frame.
+void statistics_writeHeader() {
+  if (statistics_format == STATISTICS_FORMAT_CSV) {
+    uint32_t length = statistics_putText(0, STATISTICS_CSV_PREFIX ",time_s");
+    for (uint16_t i = 0; i < statistics_entryCount; i++) {
+      length = statistics_putText(length, ",");
+      length = statistics_putText(length, statistics_entries[i].name);
+      if (statistics_entries[i].kind == STATISTICS_KIND_GAUGE) {
+        length = statistics_putText(length, ",");
+        length = statistics_putText(length, statistics_entries[i].name);
+        length = statistics_putText(length, "_max");
+      }
+    }
+    length = statistics_putText(length, "\n\r");
+    statistics_write(statistics_frame, length);
+    return;
+  }
+  const uint32_t payloadLimit =
+      STATISTICS_FRAME_BUFFER_SIZE - STATISTICS_FRAME_OVERHEAD;
+  uint32_t index = STATISTICS_FRAME_PAYLOAD_OFFSET;
+  for (uint16_t i = 0; i < statistics_entryCount; i++) {
+    uint32_t nameSize = strlen(statistics_entries[i].name) + 1;
+    if (index + 1 + nameSize > STATISTICS_FRAME_PAYLOAD_OFFSET + payloadLimit)
+      break; // Names that do not fit are left out.
+    statistics_frame[index++] = statistics_entries[i].kind;
+    memcpy(&statistics_frame[index], statistics_entries[i].name, nameSize);
+    index += nameSize;
+  }
+  statistics_writeFrame(STATISTICS_FRAME_TYPE_HEADER,
+                        index - STATISTICS_FRAME_PAYLOAD_OFFSET);
+}
+
+// Calls the update callback and writes the current values.
+void statistics_writeSnapshot() {
+  if (statistics_updateCallback)
+    statistics_updateCallback();
+  uint64_t elapsedTicks = intervalTimer_nowTicks() - statistics_startTicks;
+  if (statistics_format == STATISTICS_FORMAT_CSV) {
+    char text[32];
+    uint32_t length = statistics_putText(0, STATISTICS_CSV_PREFIX);
+    sprintf(text, ",%.3f", intervalTimer_ticksToSeconds(elapsedTicks));
+    length = statistics_putText(length, text);
+    for (uint16_t i = 0; i < statistics_entryCount; i++) {
+      statistics_entry_t *entry = &statistics_entries[i];
+      if (entry->kind == STATISTICS_KIND_COUNTER)
+        sprintf(text, ",%lu", (unsigned long)entry->count);
+      else if (entry->kind == STATISTICS_KIND_GAUGE)
+        sprintf(text, ",%g,%g", entry->value, entry->maximum);
+      else
+        sprintf(text, ",%.6f", statistics_getValue(i));
+      length = statistics_putText(length, text);
+    }
+    length = statistics_putText(length, "\n\r");
+    statistics_write(statistics_frame, length);
+    return;
+  }
+  uint32_t index = statistics_putUint32(
+      STATISTICS_FRAME_PAYLOAD_OFFSET,
+      (uint32_t)intervalTimer_ticksToMs(elapsedTicks));
+  for (uint16_t i = 0; i < statistics_entryCount; i++) {
+    statistics_entry_t *entry = &statistics_entries[i];
+    if (entry->kind == STATISTICS_KIND_COUNTER) {
+      index = statistics_putUint32(index, entry->count);
+    } else if (entry->kind == STATISTICS_KIND_GAUGE) {
+      index = statistics_putFloat(index, entry->value);
+      index = statistics_putFloat(index, entry->maximum);
+    } else {
+      index = statistics_putFloat(index, statistics_getValue(i));
+    }
+  }
+  statistics_writeFrame(STATISTICS_FRAME_TYPE_SNAPSHOT,
+                        index - STATISTICS_FRAME_PAYLOAD_OFFSET);
+}
+
+// Writes the header, then a snapshot every periodMs from statistics_poll().
+void statistics_startPeriodicSnapshots(uint32_t periodMs) {
+  statistics_writeHeader();
+  statistics_periodTicks = intervalTimer_msToTicks(periodMs);
+  statistics_nextSnapshotTicks =
+      intervalTimer_nowTicksInline() + statistics_periodTicks;
+  statistics_periodic = true;
+}
+
+void statistics_stopPeriodicSnapshots() { statistics_periodic = false; }
+
+// Writes a snapshot if one is due. Missed periods are skipped rather than
+// written back to back.
+void statistics_poll() {
+  if (!statistics_periodic)
+    return;
+  uint64_t now = intervalTimer_nowTicksInline();
+  if (now < statistics_nextSnapshotTicks)
+    return;
+  statistics_writeSnapshot();
+  statistics_nextSnapshotTicks += statistics_periodTicks;
+  if (statistics_nextSnapshotTicks <= now)
+    statistics_nextSnapshotTicks = now + statistics_periodTicks;
+}
+
+#define STATISTICS_TEST_BUFFER_SIZE 2048
+#define STATISTICS_TEST_COUNTER_ADDS 1000
+#define STATISTICS_TEST_PERIOD_MS 10
+#define STATISTICS_TEST_POLL_MS 55
+
+// Reads a little-endian 32-bit value from a frame.
+static uint32_t statistics_testGetUint32(const uint8_t *data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// Returns true if the frame at data is well formed.
+static bool statistics_testCheckFrame(const uint8_t *data, uint32_t size,
+                                      uint8_t type) {
+  if (size < STATISTICS_FRAME_OVERHEAD || data[0] != STATISTICS_FRAME_SYNC_0 ||
+      data[1] != STATISTICS_FRAME_SYNC_1 || data[2] != type)
+    return false;
+  uint32_t payloadSize = data[3] | (data[4] << 8);
+  if (payloadSize + STATISTICS_FRAME_OVERHEAD != size)
+    return false;
+  uint8_t checksum = 0;
+  for (uint32_t i = 0; i < payloadSize; i++)
+    checksum += data[STATISTICS_FRAME_PAYLOAD_OFFSET + i];
+  return checksum == data[size - 1];
+}
+
+// Checks counters, gauge maxima and both formats using the buffer sink.
+bool statistics_runTest() {
+  printf("****************** statistics_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  static uint8_t buffer[STATISTICS_TEST_BUFFER_SIZE];
+  virtualTimer_t timer;
+  virtualTimer_initAll();
+  virtualTimer_init(&timer, "statistics test");
+  statistics_init();
+  statistics_id_t counter = statistics_addCounter("events");
+  statistics_id_t gauge = statistics_addGauge("backlog");
+  statistics_addTimer("busy_s", &timer);
+  for (uint32_t i = 0; i < STATISTICS_TEST_COUNTER_ADDS; i++)
+    statistics_increment(counter);
+  statistics_add(counter, STATISTICS_TEST_COUNTER_ADDS);
+  statistics_setGauge(gauge, 7);
+  statistics_setGauge(gauge, 3);
+  statistics_increment(STATISTICS_INVALID_ID); // Must be ignored.
+  if (statistics_getValue(counter) != 2 * STATISTICS_TEST_COUNTER_ADDS ||
+      statistics_getValue(gauge) != 3 || statistics_getMaximum(gauge) != 7) {
+    printf("Counter %g, gauge %g, maximum %g.\n\r",
+           statistics_getValue(counter), statistics_getValue(gauge),
+           statistics_getMaximum(gauge));
+    success = false;
+  }
+
+  // CSV.
+  statistics_setOutput(STATISTICS_FORMAT_CSV, STATISTICS_SINK_BUFFER);
+  statistics_setOutputBuffer(buffer, sizeof(buffer) - 1);
+  statistics_writeHeader();
+  statistics_writeSnapshot();
+  buffer[statistics_getOutputBufferCount()] = '\0';
+  const char *expectedHeader =
+      STATISTICS_CSV_PREFIX ",time_s,events,backlog,backlog_max,busy_s\n\r";
+  if (strncmp((char *)buffer, expectedHeader, strlen(expectedHeader)) ||
+      !strstr((char *)buffer, ",2000,3,7,0.000000\n\r")) {
+    printf("Unexpected CSV:\n\r%s", buffer);
+    success = false;
+  }
+
+  // Binary.
+  statistics_setOutput(STATISTICS_FORMAT_BINARY, STATISTICS_SINK_BUFFER);
+  statistics_setOutputBuffer(buffer, sizeof(buffer));
+  statistics_writeSnapshot();
+  // Time, counter, gauge and its maximum, timer.
+  const uint32_t snapshotSize = STATISTICS_FRAME_OVERHEAD + 5 * 4;
+  if (!statistics_testCheckFrame(buffer, statistics_getOutputBufferCount(),
+                                 STATISTICS_FRAME_TYPE_SNAPSHOT) ||
+      statistics_getOutputBufferCount() != snapshotSize ||
+      statistics_testGetUint32(&buffer[STATISTICS_FRAME_PAYLOAD_OFFSET + 4]) !=
+          2 * STATISTICS_TEST_COUNTER_ADDS) {
+    printf("Bad binary snapshot (%ld bytes).\n\r",
+           (long)statistics_getOutputBufferCount());
+    success = false;
+  }
+  statistics_setOutputBuffer(buffer, sizeof(buffer));
+  statistics_writeHeader();
+  if (!statistics_testCheckFrame(buffer, statistics_getOutputBufferCount(),
+                                 STATISTICS_FRAME_TYPE_HEADER) ||
+      buffer[STATISTICS_FRAME_PAYLOAD_OFFSET] != STATISTICS_KIND_COUNTER ||
+      strcmp((char *)&buffer[STATISTICS_FRAME_PAYLOAD_OFFSET + 1], "events")) {
+    printf("Bad binary header.\n\r");
+    success = false;
+  }
+
+  // Periodic snapshots: one header and one snapshot per elapsed period.
+  statistics_setOutputBuffer(buffer, sizeof(buffer));
+  statistics_startPeriodicSnapshots(STATISTICS_TEST_PERIOD_MS);
+  uint64_t end = intervalTimer_nowTicks() +
+                 intervalTimer_msToTicks(STATISTICS_TEST_POLL_MS);
+  while (intervalTimer_nowTicks() < end)
+    statistics_poll();
+  statistics_stopPeriodicSnapshots();
+  uint32_t headerSize = STATISTICS_FRAME_OVERHEAD + (1 + strlen("events") + 1) +
+                        (1 + strlen("backlog") + 1) +
+                        (1 + strlen("busy_s") + 1);
+  uint32_t snapshotCount =
+      (statistics_getOutputBufferCount() - headerSize) / snapshotSize;
+  if (snapshotCount != STATISTICS_TEST_POLL_MS / STATISTICS_TEST_PERIOD_MS) {
+    printf("%ld periodic snapshots, expected %d.\n\r", (long)snapshotCount,
+           STATISTICS_TEST_POLL_MS / STATISTICS_TEST_PERIOD_MS);
+    success = false;
+  }
+  statistics_init();
+  printf("statistics_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
@@ -0,0 +1,148 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef STATISTICS_H_
+#define STATISTICS_H_
+
+#include "virtualTimer.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Registry of run-time statistics that can be exported in a machine-readable
+// form, so that runs can be collected from many guns and compared.
+//  - A counter counts events (e.g., detector invocations, hits on a channel).
+//  - A gauge is set to the current value of something (e.g., the number of
+//    samples in the ADC buffer) and remembers the largest value it was set to,
+//    which is the high-water mark for a queue.
+//  - A timer reports the total duration of a virtualTimer_t in seconds.
+// Entries are registered once, at start-up, and keep their id until the next
+// statistics_init(). Values are only updated from the main loop.
+//
+// A snapshot writes every value in registration order, either as a CSV line
+// or as a binary frame, to the console UART, the bluetooth transmit queue or
+// a memory buffer:
+//  - CSV: "STATS,<seconds>,<value>,..." after a "STATS,time_s,<name>,..."
+//    header. Gauges have two columns, the value and "<name>_max". The prefix
+//    lets the lines be picked out of the rest of the console output.
+//  - Binary: frames of STATISTICS_FRAME_SYNC_0/1, a type byte, a 16-bit
+//    payload length, the payload and an 8-bit checksum (the sum of the
+//    payload bytes). The header frame holds the kind and the NUL-terminated
+//    name of each entry; a snapshot frame holds the time in milliseconds
+//    followed by a 32-bit value per entry (gauges are followed by their
+//    maximum). Multi-byte fields are little-endian; gauges and timers are
+//    IEEE floats.
+// tools/statistics_to_csv.py turns either form, captured from the UART or
+// bluetooth, into a plain CSV file.
+//
+// In periodic mode statistics_poll() writes a snapshot every period, so values
+// can be graphed over a game rather than just read at the end. The bluetooth
+// UART runs at 9600 baud (about 960 bytes/s), so keep the period long enough
+// for a snapshot to drain before the next one. The bluetooth sink only works
+// when LASERTAG_BLUETOOTH is defined (see scheduler.h); otherwise its output
+// is counted as dropped.
+
+#define STATISTICS_MAX_ENTRY_COUNT 32
+#define STATISTICS_INVALID_ID 0xFFFF
+
+// Kinds of entry.
+#define STATISTICS_KIND_COUNTER 0
+#define STATISTICS_KIND_GAUGE 1
+#define STATISTICS_KIND_TIMER 2
+
+// Output formats.
+#define STATISTICS_FORMAT_CSV 0
+#define STATISTICS_FORMAT_BINARY 1
+
+// Where the output goes.
+#define STATISTICS_SINK_UART 0
+#define STATISTICS_SINK_BLUETOOTH 1
+#define STATISTICS_SINK_BUFFER 2 // See statistics_setOutputBuffer().
+
+// Binary framing.
+#define STATISTICS_FRAME_SYNC_0 0xA5
+#define STATISTICS_FRAME_SYNC_1 0x5A
+#define STATISTICS_FRAME_TYPE_HEADER 'H'
+#define STATISTICS_FRAME_TYPE_SNAPSHOT 'S'
+
+#define STATISTICS_CSV_PREFIX "STATS"
+
+typedef uint16_t statistics_id_t;
+
+// Called before each snapshot, e.g., to set gauges that are derived from
+// other values.
+typedef void (*statistics_updateCallback_t)();
+
+// Empties the registry, stops periodic snapshots and selects CSV to the UART.
+// Starts the timestamp counter; snapshot times are relative to this call.
+void statistics_init();
+
+// Register an entry. The name must stay valid (e.g., a string literal).
+// Return STATISTICS_INVALID_ID if the registry is full; updating that id does
+// nothing.
+statistics_id_t statistics_addCounter(const char *name);
+statistics_id_t statistics_addGauge(const char *name);
+statistics_id_t statistics_addTimer(const char *name, virtualTimer_t *timer);
+
+// Adds to a counter.
+void statistics_increment(statistics_id_t id);
+void statistics_add(statistics_id_t id, uint32_t amount);
+
+// Sets a gauge and updates its maximum.
+void statistics_setGauge(statistics_id_t id, double value);
+
+// Returns the current value of an entry (a timer's duration in seconds).
+double statistics_getValue(statistics_id_t id);
+
+// Returns the largest value a gauge was set to.
+double statistics_getMaximum(statistics_id_t id);
+
+// Returns the number of registered entries.
+uint16_t statistics_getEntryCount();
+
+// Zeroes counters, gauges and their maxima, e.g., at the start of a run.
+// Timers are reset by their owners.
+void statistics_resetValues();
+
+// Sets the function called before each snapshot (NULL for none).
+void statistics_setUpdateCallback(statistics_updateCallback_t callback);
+
+// Selects the format and sink used by the write functions.
+void statistics_setOutput(uint16_t format, uint16_t sink);
+
+// Sets the memory used by STATISTICS_SINK_BUFFER and empties it. Output that
+// does not fit is dropped.
+void statistics_setOutputBuffer(uint8_t *buffer, uint32_t size);
+
+// Returns the number of bytes written to the output buffer.
+uint32_t statistics_getOutputBufferCount();
+
+// Returns the number of bytes dropped because the sink was full.
+uint32_t statistics_getDroppedByteCount();
+
+// Writes the CSV header line or the binary header frame.
+void statistics_writeHeader();
+
+// Calls the update callback and writes the current values.
+void statistics_writeSnapshot();
+
+// Writes the header, then a snapshot every periodMs from statistics_poll().
+void statistics_startPeriodicSnapshots(uint32_t periodMs);
+
+// Stops periodic snapshots.
+void statistics_stopPeriodicSnapshots();
+
+// Call from the main loop. Writes a snapshot if one is due. Costs one timer
+// read when none is.
+void statistics_poll();
+
+// Checks counters, gauge maxima and both formats using the buffer sink.
+// Returns true if the test passes.
+bool statistics_runTest();
+
+#endif /* STATISTICS_H_ */
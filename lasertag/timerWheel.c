@@ -0,0 +1,298 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "timerWheel.h"
+#include <stddef.h>
+#include <stdio.h>
+#ifdef ZYBO_BOARD
+#include "xil_exception.h"
+#include "xpseudo_asm.h"
+#endif
+
+#define TIMER_WHEEL_SLOT_MASK (TIMER_WHEEL_SLOT_COUNT - 1)
+
+static timerWheel_timer_t
+    *timerWheel_slots[TIMER_WHEEL_LEVEL_COUNT][TIMER_WHEEL_SLOT_COUNT];
+static volatile uint32_t timerWheel_currentTick = 0;
+
+// Start and cancel may be called from the main loop while the ISR is ticking
+// the wheel, so the list updates are done with IRQs masked. The previous mask
+// is restored so this also works from within a callback.
+#ifdef ZYBO_BOARD
+#define TIMER_WHEEL_ENTER_CRITICAL()                                           \
+  uint32_t savedCpsr = mfcpsr();                                               \
+  Xil_ExceptionDisable()
+#define TIMER_WHEEL_EXIT_CRITICAL() mtcpsr(savedCpsr)
+#else
+#define TIMER_WHEEL_ENTER_CRITICAL()
+#define TIMER_WHEEL_EXIT_CRITICAL()
+#endif
+
+// Empties the wheel and resets the tick count.
+void timerWheel_init() {
+  for (uint16_t level = 0; level < TIMER_WHEEL_LEVEL_COUNT; level++)
+    for (uint16_t slot = 0; slot < TIMER_WHEEL_SLOT_COUNT; slot++)
+      timerWheel_slots[level][slot] = NULL;
+  timerWheel_currentTick = 0;
+}
+
+// Sets up a timer that calls callback(context) when it expires.
+void timerWheel_initTimer(timerWheel_timer_t *timer,
+                          timerWheel_callback_t callback, void *context) {
+  timer->next = NULL;
+  timer->previous = NULL;
+  timer->slot = NULL;
+  timer->expireTick = 0;
+  timer->callback = callback;
+  timer->context = context;
+  timer->running = false;
+}
+
+// Returns the slot list a running timer belongs in. The level is chosen by how
+// far away the expiry is, the slot by the expiry's bits at that level, so a
+// timer is always moved down before (or on) its expiry tick.
+static timerWheel_timer_t **timerWheel_getSlot(uint32_t expireTick) {
+  uint32_t delta = expireTick - timerWheel_currentTick;
+  uint16_t level = 0;
+  while (level < TIMER_WHEEL_LEVEL_COUNT - 1 &&
+         (delta >> (TIMER_WHEEL_SLOT_BITS * (level + 1))) != 0)
+    level++;
+  uint16_t slot =
+      (expireTick >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK;
+  return &timerWheel_slots[level][slot];
+}
+
+// Adds a timer to the front of the slot for its expiry tick.
+static void timerWheel_insert(timerWheel_timer_t *timer) {
+  timerWheel_timer_t **head = timerWheel_getSlot(timer->expireTick);
+  timer->slot = head;
+  timer->previous = NULL;
+  timer->next = *head;
+  if (*head)
+    (*head)->previous = timer;
+  *head = timer;
+}
+
+// Removes a timer from whichever slot it is in.
+static void timerWheel_remove(timerWheel_timer_t *timer) {
+  if (timer->previous)
+    timer->previous->next = timer->next;
+  else
+    *timer->slot = timer->next;
+  if (timer->next)
+    timer->next->previous = timer->previous;
+  timer->next = NULL;
+  timer->previous = NULL;
+}
+
+// Starts (or restarts) a timer that expires after the given number of ticks.
+void timerWheel_start(timerWheel_timer_t *timer, uint32_t ticks) {
+  if (ticks == 0)
+    ticks = 1; // Expire on the next tick.
+  TIMER_WHEEL_ENTER_CRITICAL();
+  if (timer->running)
+    timerWheel_remove(timer);
+  timer->expireTick = timerWheel_currentTick + ticks;
+  timer->running = true;
+  timerWheel_insert(timer);
+  TIMER_WHEEL_EXIT_CRITICAL();
+}
+
+// Stops a timer without calling its callback.
+void timerWheel_cancel(timerWheel_timer_t *timer) {
+  TIMER_WHEEL_ENTER_CRITICAL();
+  if (timer->running) {
+    timerWheel_remove(timer);
+    timer->running = false;
+  }
+  TIMER_WHEEL_EXIT_CRITICAL();
+}
+
+// Returns true if the timer is running.
+bool timerWheel_running(const timerWheel_timer_t *timer) {
+  return timer->running;
+}
+
+// Returns the number of ticks until the timer expires, or 0.
+uint32_t timerWheel_getRemainingTicks(const timerWheel_timer_t *timer) {
+  return timer->running ? timer->expireTick - timerWheel_currentTick : 0;
+}
+
+// Returns the number of ticks since timerWheel_init().
+uint32_t timerWheel_getCurrentTick() { return timerWheel_currentTick; }
+
+// Moves every timer in one slot to the slot its expiry now belongs in, which
+// is always on a lower level.
+static void timerWheel_cascade(uint16_t level) {
+  uint16_t slot = (timerWheel_currentTick >> (TIMER_WHEEL_SLOT_BITS * level)) &
+                  TIMER_WHEEL_SLOT_MASK;
+  timerWheel_timer_t *timer = timerWheel_slots[level][slot];
+  timerWheel_slots[level][slot] = NULL;
+  while (timer) {
+    timerWheel_timer_t *next = timer->next;
+    timerWheel_insert(timer);
+    timer = next;
+  }
+}
+
+// Advances the wheel by one tick and runs the callbacks of expired timers.
+void timerWheel_tick() {
+  uint32_t now = ++timerWheel_currentTick;
+  // When a level wraps, pull the next slot of the level above down, highest
+  // level first so its timers can continue down to level 0 this tick.
+  if ((now & TIMER_WHEEL_SLOT_MASK) == 0) {
+    uint16_t level = 1;
+    while (level < TIMER_WHEEL_LEVEL_COUNT - 1 &&
+           ((now >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_SLOT_MASK) ==
+               0)
+      level++;
+    for (; level > 0; level--)
+      timerWheel_cascade(level);
+  }
+  // Everything in the current level-0 slot expires now. Detach the list first
+  // so callbacks can restart their own timers.
+  timerWheel_timer_t **head =
+      &timerWheel_slots[0][now & TIMER_WHEEL_SLOT_MASK];
+  if (!*head)
+    return;
+  timerWheel_timer_t *timer = *head;
+  *head = NULL;
+  while (timer) {
+    timerWheel_timer_t *next = timer->next;
+    timer->next = NULL;
+    timer->previous = NULL;
+    timer->running = false;
+    if (next)
+      next->previous = NULL;
+    if (timer->callback)
+      timer->callback(timer->context);
+    timer = next;
+  }
+}
+
+// Returns a number of ticks within which the next timer may expire.
+uint32_t timerWheel_getTicksUntilNextExpiry() {
+  uint32_t now = timerWheel_currentTick;
+  // Level 0 holds every timer that expires before the next cascade.
+  for (uint32_t ticks = 1; ticks <= TIMER_WHEEL_SLOT_COUNT; ticks++)
+    if (timerWheel_slots[0][(now + ticks) & TIMER_WHEEL_SLOT_MASK])
+      return ticks;
+  // Timers on higher levels cannot expire before the next cascade.
+  for (uint16_t level = 1; level < TIMER_WHEEL_LEVEL_COUNT; level++)
+    for (uint16_t slot = 0; slot < TIMER_WHEEL_SLOT_COUNT; slot++)
+      if (timerWheel_slots[level][slot])
+        return TIMER_WHEEL_SLOT_COUNT - (now & TIMER_WHEEL_SLOT_MASK);
+  return TIMER_WHEEL_NO_EXPIRY;
+}
+
+#define TIMER_WHEEL_TEST_TIMER_COUNT 14
+#define TIMER_WHEEL_TEST_START_OFFSET 100  // Start away from a slot boundary.
+#define TIMER_WHEEL_TEST_CANCELLED_TIMER 5 // Cancelled halfway.
+#define TIMER_WHEEL_TEST_RESTARTED_TIMER 6 // Restarted with a new delay.
+#define TIMER_WHEEL_TEST_RESTART_TICKS 12345
+// The periodic test timer restarts itself from its callback.
+#define TIMER_WHEEL_TEST_PERIODIC_TICKS 777
+#define TIMER_WHEEL_TEST_PERIODIC_COUNT 5
+#define TIMER_WHEEL_TEST_EXTRA_TICKS 10
+
+// Book-keeping for one test timer.
+typedef struct {
+  timerWheel_timer_t timer;
+  uint32_t expectedTick;
+  uint32_t firedTick;
+  uint16_t fireCount;
+} timerWheel_testTimer_t;
+
+static timerWheel_testTimer_t
+    timerWheel_testTimers[TIMER_WHEEL_TEST_TIMER_COUNT];
+static timerWheel_testTimer_t timerWheel_periodicTestTimer;
+
+// Records when a test timer fired.
+static void timerWheel_testCallback(void *context) {
+  timerWheel_testTimer_t *testTimer = context;
+  testTimer->firedTick = timerWheel_getCurrentTick();
+  testTimer->fireCount++;
+}
+
+// Records a firing and restarts the timer until it has fired enough times.
+static void timerWheel_periodicTestCallback(void *context) {
+  timerWheel_testCallback(context);
+  timerWheel_testTimer_t *testTimer = context;
+  if (testTimer->fireCount < TIMER_WHEEL_TEST_PERIODIC_COUNT)
+    timerWheel_start(&testTimer->timer, TIMER_WHEEL_TEST_PERIODIC_TICKS);
+}
+
+// Checks that each timer fires once, on its expiry tick.
+bool timerWheel_runTest() {
+  printf("****************** timerWheel_runTest() ******************\n\r");
+  // Delays around each slot and level boundary.
+  const uint32_t delays[TIMER_WHEEL_TEST_TIMER_COUNT] = {
+      1,      2,      255,     256,      257,      1000,     50000,
+      65535,  65536,  65537,   300000,   16777215, 16777216, 16777217};
+  timerWheel_init();
+  for (uint16_t i = 0; i < TIMER_WHEEL_TEST_START_OFFSET; i++)
+    timerWheel_tick();
+  uint32_t startTick = timerWheel_getCurrentTick();
+  uint32_t lastTick = startTick;
+  for (uint16_t i = 0; i < TIMER_WHEEL_TEST_TIMER_COUNT; i++) {
+    timerWheel_testTimer_t *testTimer = &timerWheel_testTimers[i];
+    timerWheel_initTimer(&testTimer->timer, timerWheel_testCallback, testTimer);
+    testTimer->fireCount = 0;
+    testTimer->expectedTick = startTick + delays[i];
+    timerWheel_start(&testTimer->timer, delays[i]);
+    if (testTimer->expectedTick > lastTick)
+      lastTick = testTimer->expectedTick;
+  }
+  timerWheel_testTimer_t *periodic = &timerWheel_periodicTestTimer;
+  timerWheel_initTimer(&periodic->timer, timerWheel_periodicTestCallback,
+                       periodic);
+  periodic->fireCount = 0;
+  periodic->expectedTick = startTick + TIMER_WHEEL_TEST_PERIODIC_TICKS *
+                                           TIMER_WHEEL_TEST_PERIODIC_COUNT;
+  timerWheel_start(&periodic->timer, TIMER_WHEEL_TEST_PERIODIC_TICKS);
+  // Cancel one timer and restart another, both halfway to their expiry.
+  timerWheel_testTimer_t *cancelled =
+      &timerWheel_testTimers[TIMER_WHEEL_TEST_CANCELLED_TIMER];
+  timerWheel_testTimer_t *restarted =
+      &timerWheel_testTimers[TIMER_WHEEL_TEST_RESTARTED_TIMER];
+  uint32_t cancelTick =
+      startTick + delays[TIMER_WHEEL_TEST_CANCELLED_TIMER] / 2;
+  uint32_t restartTick =
+      startTick + delays[TIMER_WHEEL_TEST_RESTARTED_TIMER] / 2;
+  restarted->expectedTick = restartTick + TIMER_WHEEL_TEST_RESTART_TICKS;
+  uint32_t endTick = lastTick + TIMER_WHEEL_TEST_EXTRA_TICKS;
+  while (timerWheel_getCurrentTick() != endTick) {
+    if (timerWheel_getCurrentTick() == cancelTick)
+      timerWheel_cancel(&cancelled->timer);
+    if (timerWheel_getCurrentTick() == restartTick)
+      timerWheel_start(&restarted->timer, TIMER_WHEEL_TEST_RESTART_TICKS);
+    timerWheel_tick();
+  }
+  bool success = true; // Be optimistic.
+  for (uint16_t i = 0; i <= TIMER_WHEEL_TEST_TIMER_COUNT; i++) {
+    timerWheel_testTimer_t *testTimer = (i < TIMER_WHEEL_TEST_TIMER_COUNT)
+                                            ? &timerWheel_testTimers[i]
+                                            : periodic;
+    uint16_t expectedCount = (testTimer == cancelled) ? 0
+                             : (testTimer == periodic)
+                                 ? TIMER_WHEEL_TEST_PERIODIC_COUNT
+                                 : 1;
+    if (testTimer->fireCount != expectedCount ||
+        (expectedCount && testTimer->firedTick != testTimer->expectedTick) ||
+        timerWheel_running(&testTimer->timer)) {
+      printf("timer %d fired %d times, last at tick %ld, expected %d at tick "
+             "%ld.\n\r",
+             i, testTimer->fireCount, (long)testTimer->firedTick,
+             expectedCount, (long)testTimer->expectedTick);
+      success = false;
+    }
+  }
+  printf("timerWheel_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
@@ -0,0 +1,99 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef TIMERWHEEL_H_
+#define TIMERWHEEL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Hierarchical timer wheel shared by the lockout, hit-LED, auto-reload,
+// invincibility and LED timers. Times are in 100 kHz ticks.
+// isr_function() calls timerWheel_tick() once per tick in place of
+// lockoutTimer_tick(), hitLedTimer_tick(), autoReloadTimer_tick(),
+// invincibilityTimer_tick() and ledTimer_tick(), which now do nothing (see
+// isr.h).
+//
+// There are TIMER_WHEEL_LEVEL_COUNT levels of TIMER_WHEEL_SLOT_COUNT slots.
+// A slot on level n covers 256^n ticks, so delays up to 2^32 - 1 ticks (about
+// 11.9 hours) are supported. Each slot holds a doubly-linked list of timers,
+// so starting and cancelling a timer are O(1). On most ticks the wheel checks
+// a single level-0 slot; every 256 ticks the timers in one slot of the next
+// level are moved down a level.
+//
+// Expiry callbacks run from timerWheel_tick(), i.e., in the ISR, and may start
+// or cancel timers (including their own).
+
+#define TIMER_WHEEL_SLOT_BITS 8
+#define TIMER_WHEEL_SLOT_COUNT (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_LEVEL_COUNT 4
+#define TIMER_WHEEL_TICKS_PER_SECOND 100000
+#define TIMER_WHEEL_TICKS_PER_MS (TIMER_WHEEL_TICKS_PER_SECOND / 1000)
+
+#define TIMER_WHEEL_NO_EXPIRY UINT32_MAX
+
+typedef void (*timerWheel_callback_t)(void *context);
+
+// A timer. Owned by the caller and must stay valid while it is running.
+// Set up with timerWheel_initTimer(); the other members are private.
+typedef struct timerWheel_timer_t {
+  struct timerWheel_timer_t *next;
+  struct timerWheel_timer_t *previous;
+  struct timerWheel_timer_t **slot; // Head of the list the timer is in.
+  uint32_t expireTick;
+  timerWheel_callback_t callback;
+  void *context;
+  bool running;
+} timerWheel_timer_t;
+
+// Empties the wheel and resets the tick count. Any running timers are lost.
+void timerWheel_init();
+
+// Sets up a timer that calls callback(context) when it expires. callback may be
+// NULL if only timerWheel_running() is needed.
+void timerWheel_initTimer(timerWheel_timer_t *timer,
+                          timerWheel_callback_t callback, void *context);
+
+// Starts (or restarts) a timer that expires after the given number of ticks
+// (at least 1). Safe to call from the main loop or from a callback.
+void timerWheel_start(timerWheel_timer_t *timer, uint32_t ticks);
+
+// Stops a timer without calling its callback. Does nothing if it is not
+// running.
+void timerWheel_cancel(timerWheel_timer_t *timer);
+
+// Returns true if the timer has been started and has not expired or been
+// cancelled.
+bool timerWheel_running(const timerWheel_timer_t *timer);
+
+// Returns the number of ticks until the timer expires, or 0 if it is not
+// running.
+uint32_t timerWheel_getRemainingTicks(const timerWheel_timer_t *timer);
+
+// Returns the number of ticks since timerWheel_init() (wraps after 2^32).
+uint32_t timerWheel_getCurrentTick();
+
+// Advances the wheel by one tick and runs the callbacks of expired timers.
+// Called once per tick by isr_function().
+void timerWheel_tick();
+
+// Returns a number of ticks within which the next timer may expire, or
+// TIMER_WHEEL_NO_EXPIRY if no timer is running. Exact for timers due within
+// TIMER_WHEEL_SLOT_COUNT ticks; otherwise it is the next level-1 cascade, after
+// which the wheel can be asked again.
+uint32_t timerWheel_getTicksUntilNextExpiry();
+
+// Starts timers with delays that exercise every level of the wheel, cancels
+// and restarts some of them, and checks that each callback runs exactly once
+// on the expected tick. Drives the wheel directly so it runs without
+// interrupts. Returns true if the test passes.
+bool timerWheel_runTest();
+
+#endif /* TIMERWHEEL_H_ */
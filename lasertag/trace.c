@@ -0,0 +1,150 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "trace.h"
+#include "intervalTimer.h"
+#include <stdio.h>
+#ifdef ZYBO_BOARD
+#include "xpseudo_asm.h"
+#include "xreg_cortexa9.h"
+#endif
+
+#define TRACE_RECORD_MASK (TRACE_RECORD_COUNT - 1)
+
+static trace_record_t trace_ring[TRACE_RECORD_COUNT];
+// Number of records ever reserved; the ring slot is the lower bits.
+static volatile uint32_t trace_writeIndex = 0;
+static volatile bool trace_enabled = false;
+
+// Returns true if called from the IRQ handler.
+static bool trace_inIsr() {
+#ifdef ZYBO_BOARD
+  return (mfcpsr() & XREG_CPSR_MODE_BITS) == XREG_CPSR_IRQ_MODE;
+#else
+  return false;
+#endif
+}
+
+// Empties the ring and enables logging.
+void trace_init() {
+  intervalTimer_startTimestampCounter();
+  trace_writeIndex = 0;
+  trace_enabled = true;
+}
+
+// Turns logging on or off.
+void trace_enable(bool enable) { trace_enabled = enable; }
+
+// Adds a record. The slot is reserved with an atomic increment (LDREX/STREX
+// on the ARM), so the ISR can interrupt a log call in the main loop without
+// either record being lost.
+void trace_log(uint16_t eventId, uint16_t argument) {
+  if (!trace_enabled)
+    return;
+  uint32_t timestamp = intervalTimer_nowTicksLower32Inline();
+  uint32_t index = __atomic_fetch_add(&trace_writeIndex, 1, __ATOMIC_RELAXED);
+  trace_record_t *record = &trace_ring[index & TRACE_RECORD_MASK];
+  record->timestamp = timestamp;
+  record->eventId = trace_inIsr() ? eventId | TRACE_ISR_CONTEXT_FLAG : eventId;
+  record->argument = argument;
+}
+
+// Returns the number of records in the ring.
+uint32_t trace_getRecordCount() {
+  uint32_t writeIndex = trace_writeIndex;
+  return writeIndex < TRACE_RECORD_COUNT ? writeIndex : TRACE_RECORD_COUNT;
+}
+
+// Copies the index-th oldest record in the ring.
+bool trace_getRecord(uint32_t index, trace_record_t *record) {
+  uint32_t count = trace_getRecordCount();
+  if (index >= count)
+    return false;
+  uint32_t oldest = trace_writeIndex - count;
+  *record = trace_ring[(oldest + index) & TRACE_RECORD_MASK];
+  return true;
+}
+
+// Prints the ring over UART, oldest first, then empties it.
+void trace_dump() {
+  bool wasEnabled = trace_enabled;
+  trace_enabled = false;
+  uint32_t count = trace_getRecordCount();
+  printf("TRACE BEGIN %ld %ld\n\r", (long)count,
+         (long)INTERVAL_TIMER_TICKS_PER_SECOND);
+  trace_record_t record;
+  for (uint32_t i = 0; i < count; i++) {
+    if (!trace_getRecord(i, &record))
+      break;
+    printf("%08lx%04x%04x\n\r", (unsigned long)record.timestamp,
+           record.eventId, record.argument);
+  }
+  printf("TRACE END\n\r");
+  trace_writeIndex = 0;
+  trace_enabled = wasEnabled;
+}
+
+#define TRACE_TEST_EXTRA_RECORDS 100
+#define TRACE_TEST_TIMING_COUNT 100000
+#define TRACE_TEST_HIT_FREQUENCY 3
+
+// Fills the ring past capacity and checks what is kept.
+bool trace_runTest() {
+  printf("****************** trace_runTest() ******************\n\r");
+  bool success = true; // Be optimistic.
+  trace_init();
+  const uint32_t logCount = TRACE_RECORD_COUNT + TRACE_TEST_EXTRA_RECORDS;
+  for (uint32_t i = 0; i < logCount; i++)
+    trace_log(TRACE_EVENT_USER, i);
+  if (trace_getRecordCount() != TRACE_RECORD_COUNT) {
+    printf("Ring holds %ld records, expected %d.\n\r",
+           (long)trace_getRecordCount(), TRACE_RECORD_COUNT);
+    success = false;
+  }
+  trace_record_t previous = {0}, record = {0};
+  trace_getRecord(0, &previous);
+  for (uint32_t i = 0; i < TRACE_RECORD_COUNT && success; i++) {
+    trace_getRecord(i, &record);
+    if (record.eventId != TRACE_EVENT_USER ||
+        record.argument != (uint16_t)(TRACE_TEST_EXTRA_RECORDS + i) ||
+        (int32_t)(record.timestamp - previous.timestamp) < 0) {
+      printf("Record %ld: event %d argument %d timestamp %lu.\n\r", (long)i,
+             record.eventId, record.argument, (unsigned long)record.timestamp);
+      success = false;
+    }
+    previous = record;
+  }
+  if (trace_getRecord(TRACE_RECORD_COUNT, &record)) {
+    printf("Read past the newest record.\n\r");
+    success = false;
+  }
+
+  // Cost of a log call.
+  trace_init();
+  uint64_t start = intervalTimer_nowTicks();
+  for (uint32_t i = 0; i < TRACE_TEST_TIMING_COUNT; i++)
+    trace_log(TRACE_EVENT_USER, i);
+  uint64_t elapsed = intervalTimer_nowTicks() - start;
+  printf("trace_log() takes %ld ns.\n\r",
+         (long)(intervalTimer_ticksToNs(elapsed) / TRACE_TEST_TIMING_COUNT));
+
+  // A short dump, as the converter sees it.
+  trace_init();
+  trace_log(TRACE_EVENT_DETECTOR_BEGIN, 0);
+  trace_log(TRACE_EVENT_HIT, TRACE_TEST_HIT_FREQUENCY);
+  trace_log(TRACE_EVENT_DETECTOR_END, 0);
+  trace_dump();
+  if (trace_getRecordCount() != 0) {
+    printf("Ring not emptied by the dump.\n\r");
+    success = false;
+  }
+  trace_enable(false);
+  printf("trace_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
@@ -0,0 +1,98 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Binary event trace for looking at timing without printf. TRACE_LOG() stores
+// an 8-byte record (timestamp, event id, argument) in a fixed-size ring; the
+// ISR and the main loop can both log, without locks. When the ring is full the
+// oldest records are overwritten, so the ring always holds the most recent
+// TRACE_RECORD_COUNT events.
+//
+// trace_dump() prints the ring over UART as hex, between "TRACE BEGIN" and
+// "TRACE END" lines. tools/trace_to_chrome.py converts a captured UART log to
+// Chrome trace-event JSON that can be opened in Perfetto (ui.perfetto.dev) or
+// chrome://tracing. The converter reads the TRACE_EVENT_ names below from this
+// file: events ending in _BEGIN/_END become slices, the others instants.
+//
+// Timestamps are the lower 32 bits of intervalTimer_nowTicks(). Records logged
+// from the IRQ handler are marked and shown on their own track.
+//
+// isr_function() should log TRACE_EVENT_ISR_BEGIN/END on entry and exit.
+
+// Leave uncommented to log events. Otherwise TRACE_LOG() compiles to nothing.
+// #define TRACE_ENABLED
+
+// Number of records in the ring; must be a power of two.
+#define TRACE_RECORD_COUNT 4096
+
+// Predefined events. Keep the numbers stable; dumps only store the numbers.
+#define TRACE_EVENT_ISR_BEGIN 1
+#define TRACE_EVENT_ISR_END 2
+#define TRACE_EVENT_DETECTOR_BEGIN 3
+#define TRACE_EVENT_DETECTOR_END 4
+#define TRACE_EVENT_DETECTOR_FILTERS_BEGIN 5
+#define TRACE_EVENT_DETECTOR_FILTERS_END 6
+#define TRACE_EVENT_DETECTOR_POWER_BEGIN 7
+#define TRACE_EVENT_DETECTOR_POWER_END 8
+#define TRACE_EVENT_DISPLAY_DRAW_BEGIN 9 // Argument: what is drawn.
+#define TRACE_EVENT_DISPLAY_DRAW_END 10
+#define TRACE_EVENT_HIT 11 // Argument: frequency number.
+#define TRACE_EVENT_SOUND_PLAY 12
+#define TRACE_EVENT_USER 13 // Free for ad-hoc use.
+
+// Arguments for TRACE_EVENT_DISPLAY_DRAW_BEGIN.
+#define TRACE_DISPLAY_DRAW_HITS 0
+#define TRACE_DISPLAY_DRAW_POWER 1
+
+// Set in the event id of records logged from the IRQ handler.
+#define TRACE_ISR_CONTEXT_FLAG 0x8000
+
+typedef struct {
+  uint32_t timestamp;
+  uint16_t eventId;
+  uint16_t argument;
+} trace_record_t;
+
+#ifdef TRACE_ENABLED
+#define TRACE_LOG(eventId, argument) trace_log(eventId, argument)
+#else
+#define TRACE_LOG(eventId, argument)
+#endif
+
+// Empties the ring and enables logging. Starts the timestamp counter.
+void trace_init();
+
+// Turns logging on or off (e.g., while dumping).
+void trace_enable(bool enable);
+
+// Adds a record. Safe to call from the ISR and the main loop.
+void trace_log(uint16_t eventId, uint16_t argument);
+
+// Returns the number of records in the ring (at most TRACE_RECORD_COUNT).
+uint32_t trace_getRecordCount();
+
+// Copies the index-th oldest record in the ring. Returns false if there is no
+// such record.
+bool trace_getRecord(uint32_t index, trace_record_t *record);
+
+// Prints the ring over UART, oldest first, then empties it. Logging is paused
+// while dumping.
+void trace_dump();
+
+// Logs more records than fit in the ring, checks that the newest ones are kept
+// in order, and reports the cost of a log call. Returns true if the test
+// passes.
+bool trace_runTest();
+
+#endif /* TRACE_H_ */
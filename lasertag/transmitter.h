@@ -36,7 +36,10 @@ void transmitter_setFrequencyNumber(uint16_t frequencyNumber);
 // Returns the current frequency setting.
 uint16_t transmitter_getFrequencyNumber();
 
-// Standard tick function.
+// Standard tick function. To send this gun's player ID (playerId.h), drive
+// the output low whenever !playerId_isChipOn(tick) for the tick of the pulse
+// being sent (0 to TRANSMITTER_PULSE_WIDTH-1), as well as during the low half
+// of each carrier period.
 void transmitter_tick();
 
 // Tests the transmitter.
@@ -0,0 +1,279 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "transmitterNco.h"
+#include "filter.h"
+#include "mio.h"
+#include <math.h>
+#include <stdio.h>
+
+#define TRANSMITTER_NCO_PHASE_RANGE 4294967296.0 // 2^32.
+#define TRANSMITTER_NCO_OUTPUT_MASK 0x80000000   // Phase MSB.
+#define TRANSMITTER_NCO_HIGH_VALUE 1
+#define TRANSMITTER_NCO_LOW_VALUE 0
+
+// States for the controller state machine.
+enum transmitterNco_st_t {
+  init_st,  // Start here, transition out of this state on the first tick.
+  idle_st,  // Output is low, waiting for transmitterNco_run().
+  pulse_st, // Generating the waveform for TRANSMITTER_PULSE_WIDTH ticks.
+};
+static enum transmitterNco_st_t currentState;
+
+static uint32_t transmitterNco_phase = 0;
+static uint32_t transmitterNco_phaseIncrement = 0; // Used by the current pulse.
+static uint32_t transmitterNco_nextPhaseIncrement = 0;
+static uint32_t transmitterNco_pulseTickCount = 0;
+static uint32_t transmitterNco_output = 0; // Masked phase MSB.
+static volatile bool transmitterNco_runFlag = false;
+static bool transmitterNco_continuousMode = false;
+static bool transmitterNco_pinOutputEnabled = true;
+
+// Phase increments for the hop sequence.
+static uint32_t transmitterNco_hopIncrements[TRANSMITTER_NCO_MAX_HOP_COUNT];
+static uint16_t transmitterNco_hopCount = 0;
+static uint16_t transmitterNco_hopIndex = 0;
+
+// Writes the output pin, unless disabled.
+static void transmitterNco_writePin(uint8_t value) {
+  if (transmitterNco_pinOutputEnabled)
+    mio_writePin(TRANSMITTER_OUTPUT_PIN, value);
+}
+
+// Standard init function.
+void transmitterNco_init() {
+  mio_init(false);
+  mio_setPinAsOutput(TRANSMITTER_OUTPUT_PIN);
+  currentState = init_st;
+  transmitterNco_phase = 0;
+  transmitterNco_output = 0;
+  transmitterNco_runFlag = false;
+  transmitterNco_continuousMode = false;
+  transmitterNco_hopCount = 0;
+  transmitterNco_hopIndex = 0;
+  transmitterNco_setFrequencyNumber(0);
+}
+
+// Returns the phase increment used for the given frequency.
+uint32_t transmitterNco_computePhaseIncrement(double frequencyHz) {
+  if (frequencyHz < 0.0 || frequencyHz > TRANSMITTER_NCO_TICK_RATE_HZ / 2) {
+    printf("transmitterNco: %f Hz is out of range.\n\r", frequencyHz);
+    return 0;
+  }
+  return (uint32_t)llround(frequencyHz / TRANSMITTER_NCO_TICK_RATE_HZ *
+                           TRANSMITTER_NCO_PHASE_RANGE);
+}
+
+// Sets the frequency (in Hz) of the next pulse. Clears any hop sequence.
+void transmitterNco_setFrequencyHz(double frequencyHz) {
+  transmitterNco_hopCount = 0;
+  transmitterNco_nextPhaseIncrement =
+      transmitterNco_computePhaseIncrement(frequencyHz);
+}
+
+// Sets the frequency of the next pulse to that of a user frequency number.
+void transmitterNco_setFrequencyNumber(uint16_t frequencyNumber) {
+  if (frequencyNumber >= FILTER_FREQUENCY_COUNT) {
+    printf("transmitterNco: frequency number %d is out of range.\n\r",
+           frequencyNumber);
+    return;
+  }
+  transmitterNco_setFrequencyHz(TRANSMITTER_NCO_TICK_RATE_HZ /
+                                filter_frequencyTickTable[frequencyNumber]);
+}
+
+// Sets a sequence of frequencies (in Hz); successive pulses step through it.
+void transmitterNco_setHopSequenceHz(const double frequenciesHz[],
+                                     uint16_t count) {
+  if (count > TRANSMITTER_NCO_MAX_HOP_COUNT) {
+    printf("transmitterNco: hop sequence truncated to %d entries.\n\r",
+           TRANSMITTER_NCO_MAX_HOP_COUNT);
+    count = TRANSMITTER_NCO_MAX_HOP_COUNT;
+  }
+  transmitterNco_hopCount = 0; // Not used by the tick while being rewritten.
+  for (uint16_t i = 0; i < count; i++)
+    transmitterNco_hopIncrements[i] =
+        transmitterNco_computePhaseIncrement(frequenciesHz[i]);
+  transmitterNco_hopIndex = 0;
+  transmitterNco_hopCount = count;
+}
+
+// Starts a pulse.
+void transmitterNco_run() { transmitterNco_runFlag = true; }
+
+// Returns true while a pulse is being sent.
+bool transmitterNco_running() {
+  return transmitterNco_runFlag || currentState == pulse_st;
+}
+
+// When true, pulses are sent back to back.
+void transmitterNco_setContinuousMode(bool continuousModeFlag) {
+  transmitterNco_continuousMode = continuousModeFlag;
+}
+
+// When false, the output pin is not written.
+void transmitterNco_enablePinOutput(bool enableFlag) {
+  transmitterNco_pinOutputEnabled = enableFlag;
+}
+
+// Returns the current output level.
+bool transmitterNco_getOutput() { return transmitterNco_output != 0; }
+
+// Loads the frequency for the next pulse and restarts the phase.
+static void transmitterNco_startPulse() {
+  transmitterNco_runFlag = false;
+  if (transmitterNco_hopCount) {
+    transmitterNco_phaseIncrement =
+        transmitterNco_hopIncrements[transmitterNco_hopIndex];
+    if (++transmitterNco_hopIndex >= transmitterNco_hopCount)
+      transmitterNco_hopIndex = 0;
+  } else {
+    transmitterNco_phaseIncrement = transmitterNco_nextPhaseIncrement;
+  }
+  transmitterNco_phase = 0;
+  transmitterNco_pulseTickCount = 0;
+}
+
+// Standard tick function.
+void transmitterNco_tick() {
+  // Perform state update first.
+  switch (currentState) {
+  case init_st:
+    transmitterNco_writePin(TRANSMITTER_NCO_LOW_VALUE);
+    currentState = idle_st;
+    break;
+  case idle_st:
+    if (transmitterNco_runFlag || transmitterNco_continuousMode) {
+      transmitterNco_startPulse();
+      currentState = pulse_st;
+    }
+    break;
+  case pulse_st:
+    if (transmitterNco_pulseTickCount == TRANSMITTER_PULSE_WIDTH) {
+      if (transmitterNco_continuousMode) {
+        transmitterNco_startPulse();
+      } else {
+        transmitterNco_output = 0;
+        transmitterNco_writePin(TRANSMITTER_NCO_LOW_VALUE);
+        currentState = idle_st;
+      }
+    }
+    break;
+  default:
+    printf("transmitterNco_tick state update: hit default\n\r");
+    break;
+  }
+
+  // Perform state action next.
+  switch (currentState) {
+  case init_st:
+  case idle_st:
+    break;
+  case pulse_st: {
+    transmitterNco_pulseTickCount++;
+    transmitterNco_phase += transmitterNco_phaseIncrement;
+    uint32_t output = transmitterNco_phase & TRANSMITTER_NCO_OUTPUT_MASK;
+    if (output != transmitterNco_output) { // Only touch the pin on an edge.
+      transmitterNco_output = output;
+      transmitterNco_writePin(output ? TRANSMITTER_NCO_HIGH_VALUE
+                                     : TRANSMITTER_NCO_LOW_VALUE);
+    }
+  } break;
+  default:
+    printf("transmitterNco_tick state action: hit default\n\r");
+    break;
+  }
+}
+
+// Edges may be late by up to one tick, plus a little for the rounding of the
+// phase increment.
+#define TRANSMITTER_NCO_TEST_EDGE_TOLERANCE 0.01
+#define TRANSMITTER_NCO_TEST_FRACTIONAL_COUNT 3
+#define TRANSMITTER_NCO_TEST_HOP_COUNT 4
+
+// Runs one pulse (the transmitter must be idle and set up) and checks every
+// edge against the ideal square wave of the given frequency. The ideal wave
+// starts low at the start of the pulse and has its m-th edge at
+// m * TICK_RATE / (2 * frequency) ticks.
+static bool transmitterNco_testPulse(double frequencyHz) {
+  transmitterNco_run();
+  transmitterNco_tick(); // Leaves idle and produces the first tick.
+  uint32_t tick = 1;
+  uint32_t edgeCount = 0;
+  bool previousOutput = false;
+  double halfPeriodInTicks = TRANSMITTER_NCO_TICK_RATE_HZ / (2 * frequencyHz);
+  bool success = true;
+  while (true) {
+    bool output = transmitterNco_getOutput();
+    if (output != previousOutput && transmitterNco_running()) {
+      previousOutput = output;
+      edgeCount++;
+      double lateness = tick - edgeCount * halfPeriodInTicks;
+      if (lateness < -TRANSMITTER_NCO_TEST_EDGE_TOLERANCE ||
+          lateness >= 1.0 + TRANSMITTER_NCO_TEST_EDGE_TOLERANCE) {
+        if (success) // Only report the first bad edge.
+          printf("%.4f Hz: edge %ld at tick %ld is %.4f ticks off.\n\r",
+                 frequencyHz, (long)edgeCount, (long)tick, lateness);
+        success = false;
+      }
+    }
+    if (!transmitterNco_running())
+      break;
+    transmitterNco_tick();
+    tick++;
+  }
+  // The pulse must be exactly TRANSMITTER_PULSE_WIDTH ticks and contain
+  // every ideal edge that falls inside it.
+  uint32_t idealEdgeCount =
+      (uint32_t)(TRANSMITTER_PULSE_WIDTH / halfPeriodInTicks);
+  if (tick != TRANSMITTER_PULSE_WIDTH + 1 ||
+      (edgeCount != idealEdgeCount && edgeCount + 1 != idealEdgeCount)) {
+    printf("%.4f Hz: pulse of %ld ticks with %ld edges, expected %ld.\n\r",
+           frequencyHz, (long)tick - 1, (long)edgeCount, (long)idealEdgeCount);
+    success = false;
+  }
+  if (transmitterNco_getOutput()) {
+    printf("%.4f Hz: output left high after the pulse.\n\r", frequencyHz);
+    success = false;
+  }
+  return success;
+}
+
+// Checks every edge of the channel plan, some fractional frequencies and a hop
+// sequence against the ideal waveform.
+bool transmitterNco_runTest() {
+  printf("****************** transmitterNco_runTest() ******************\n\r");
+  transmitterNco_init();
+  transmitterNco_enablePinOutput(false);
+  transmitterNco_tick(); // Leave init_st.
+  bool success = true;   // Be optimistic.
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    transmitterNco_setFrequencyNumber(i);
+    success &= transmitterNco_testPulse(TRANSMITTER_NCO_TICK_RATE_HZ /
+                                        filter_frequencyTickTable[i]);
+  }
+  // Frequencies that are not integer divisors of the tick rate.
+  const double fractionalFrequencies[TRANSMITTER_NCO_TEST_FRACTIONAL_COUNT] = {
+      1234.5678, 2500.25, 4321.0};
+  for (uint16_t i = 0; i < TRANSMITTER_NCO_TEST_FRACTIONAL_COUNT; i++) {
+    transmitterNco_setFrequencyHz(fractionalFrequencies[i]);
+    success &= transmitterNco_testPulse(fractionalFrequencies[i]);
+  }
+  // Each pulse must use the next frequency of the hop sequence.
+  const double hopFrequencies[TRANSMITTER_NCO_TEST_HOP_COUNT] = {
+      1500.0, 3333.3, 2100.7, 1800.0};
+  transmitterNco_setHopSequenceHz(hopFrequencies,
+                                  TRANSMITTER_NCO_TEST_HOP_COUNT);
+  for (uint16_t i = 0; i < 2 * TRANSMITTER_NCO_TEST_HOP_COUNT; i++)
+    success &= transmitterNco_testPulse(
+        hopFrequencies[i % TRANSMITTER_NCO_TEST_HOP_COUNT]);
+  transmitterNco_enablePinOutput(true);
+  printf("transmitterNco_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
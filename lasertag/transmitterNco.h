@@ -0,0 +1,76 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef TRANSMITTERNCO_H_
+#define TRANSMITTERNCO_H_
+
+#include "transmitter.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Numerically-controlled-oscillator (phase accumulator) transmitter.
+// A 32-bit phase is advanced by a fixed increment every tick and the square
+// wave output is the MSB of the phase, so any frequency up to half the tick
+// rate can be generated with a resolution of
+// TRANSMITTER_NCO_TICK_RATE_HZ / 2^32 (about 23 uHz). Each tick costs one add
+// and one compare whatever the frequency; the output pin is only written on
+// an edge. Edges land on the tick after the ideal crossing, so the edge
+// jitter is under one tick while the average frequency is exact.
+//
+// A pulse lasts TRANSMITTER_PULSE_WIDTH ticks. The frequency may only change
+// between pulses; if a hop sequence is set, each pulse uses the next
+// frequency in the sequence.
+
+#define TRANSMITTER_NCO_TICK_RATE_HZ 100000.0
+#define TRANSMITTER_NCO_MAX_HOP_COUNT 16
+
+// Standard init function.
+void transmitterNco_init();
+
+// Sets the frequency (in Hz, 0 to TRANSMITTER_NCO_TICK_RATE_HZ / 2) of the
+// next pulse. Clears any hop sequence.
+void transmitterNco_setFrequencyHz(double frequencyHz);
+
+// Sets the frequency of the next pulse to that of a user frequency number,
+// i.e., TRANSMITTER_NCO_TICK_RATE_HZ / filter_frequencyTickTable[number].
+void transmitterNco_setFrequencyNumber(uint16_t frequencyNumber);
+
+// Sets a sequence of frequencies (in Hz); successive pulses step through it,
+// wrapping at the end. At most TRANSMITTER_NCO_MAX_HOP_COUNT entries.
+void transmitterNco_setHopSequenceHz(const double frequenciesHz[],
+                                     uint16_t count);
+
+// Returns the phase increment used for the given frequency.
+uint32_t transmitterNco_computePhaseIncrement(double frequencyHz);
+
+// Starts a pulse.
+void transmitterNco_run();
+
+// Returns true while a pulse is being sent.
+bool transmitterNco_running();
+
+// When true, pulses are sent back to back.
+void transmitterNco_setContinuousMode(bool continuousModeFlag);
+
+// When false, the output pin is not written (the waveform is still computed
+// and available from transmitterNco_getOutput()).
+void transmitterNco_enablePinOutput(bool enableFlag);
+
+// Returns the current output level.
+bool transmitterNco_getOutput();
+
+// Standard tick function.
+void transmitterNco_tick();
+
+// Runs pulses at the channel-plan frequencies, at fractional frequencies
+// and through a hop sequence without touching the output pin, and checks
+// every edge against the ideal waveform. Returns true if the test passes.
+bool transmitterNco_runTest();
+
+#endif /* TRANSMITTERNCO_H_ */
@@ -0,0 +1,286 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include "transmitterPwm.h"
+#include "filter.h"
+#include <stdio.h>
+#ifdef ZYBO_BOARD
+#include "xil_io.h"
+#else
+#include "axiTimerModel.h"
+#endif
+
+#define OFFSET_TCSR0 0x00
+#define OFFSET_TLR0 0x04
+#define OFFSET_TCSR1 0x10
+#define OFFSET_TLR1 0x14
+
+// TCSR bits.
+#define UDT_MASK (1 << 1)    // Count down.
+#define GENT_MASK (1 << 2)   // Enable the external generate signal.
+#define ARHT_MASK (1 << 4)   // Auto-reload.
+#define LOAD_MASK (1 << 5)   // Load TLR into TCR.
+#define ENT_MASK (1 << 7)    // Enable the counter.
+#define PWMA_MASK (1 << 9)   // PWM mode.
+#define ENALL_MASK (1 << 10) // Enable both counters at once.
+#define PWM_MODE_BITS (UDT_MASK | GENT_MASK | ARHT_MASK | PWMA_MASK)
+#define ALL_OFF 0x00
+
+// In PWM mode the period is TLR0 + 2 clocks and the high time TLR1 + 2.
+#define LOAD_REGISTER_OFFSET 2
+
+// States for the controller state machine.
+enum transmitterPwm_st_t {
+  init_st,  // Start here, transition out of this state on the first tick.
+  idle_st,  // Timer stopped, waiting for transmitterPwm_run().
+  pulse_st, // Timer generating the carrier for TRANSMITTER_PULSE_WIDTH ticks.
+};
+static enum transmitterPwm_st_t currentState;
+
+static uint16_t transmitterPwm_frequencyNumber = 0;
+static uint32_t transmitterPwm_nextPeriodInClocks = 0;
+static uint32_t transmitterPwm_periodInClocks = 0; // Used by the current pulse.
+static uint32_t transmitterPwm_pulseTickCount = 0;
+static volatile bool transmitterPwm_runFlag = false;
+static bool transmitterPwm_continuousMode = false;
+
+// Writes a timer register.
+static void transmitterPwm_writeRegister(uint32_t offset, uint32_t value) {
+#ifdef ZYBO_BOARD
+  Xil_Out32(TRANSMITTER_PWM_TIMER_BASEADDR + offset, value);
+#else
+  axiTimerModel_writeRegister(offset, value);
+#endif
+}
+
+// Reads a timer register.
+static uint32_t transmitterPwm_readRegister(uint32_t offset) {
+#ifdef ZYBO_BOARD
+  return Xil_In32(TRANSMITTER_PWM_TIMER_BASEADDR + offset);
+#else
+  return axiTimerModel_readRegister(offset);
+#endif
+}
+
+// Stops both counters, which drives PWM0 low.
+static void transmitterPwm_stopTimer() {
+  transmitterPwm_writeRegister(OFFSET_TCSR0, ALL_OFF);
+  transmitterPwm_writeRegister(OFFSET_TCSR1, ALL_OFF);
+}
+
+// Programs the period for the next pulse and starts both counters together.
+static void transmitterPwm_startTimer() {
+  transmitterPwm_periodInClocks = transmitterPwm_nextPeriodInClocks;
+  transmitterPwm_stopTimer();
+  transmitterPwm_writeRegister(OFFSET_TLR0, transmitterPwm_periodInClocks -
+                                                LOAD_REGISTER_OFFSET);
+  transmitterPwm_writeRegister(OFFSET_TLR1, transmitterPwm_periodInClocks / 2 -
+                                                LOAD_REGISTER_OFFSET);
+  transmitterPwm_writeRegister(OFFSET_TCSR0, LOAD_MASK);
+  transmitterPwm_writeRegister(OFFSET_TCSR1, LOAD_MASK);
+  transmitterPwm_writeRegister(OFFSET_TCSR1, PWM_MODE_BITS);
+  transmitterPwm_writeRegister(OFFSET_TCSR0, PWM_MODE_BITS | ENALL_MASK);
+}
+
+// Standard init function.
+void transmitterPwm_init() {
+#ifndef ZYBO_BOARD
+  axiTimerModel_reset();
+#endif
+  transmitterPwm_stopTimer();
+  currentState = init_st;
+  transmitterPwm_runFlag = false;
+  transmitterPwm_continuousMode = false;
+  transmitterPwm_setFrequencyNumber(0);
+}
+
+// Starts the transmitter.
+void transmitterPwm_run() { transmitterPwm_runFlag = true; }
+
+// Returns true if the transmitter is still running.
+bool transmitterPwm_running() {
+  return transmitterPwm_runFlag || currentState == pulse_st;
+}
+
+// Returns the carrier period in timer clocks for the given frequency number.
+uint32_t transmitterPwm_getPeriodInClocks(uint16_t frequencyNumber) {
+  return filter_frequencyTickTable[frequencyNumber] *
+         TRANSMITTER_PWM_CLOCKS_PER_TICK;
+}
+
+// Sets the frequency number; takes effect at the next pulse.
+void transmitterPwm_setFrequencyNumber(uint16_t frequencyNumber) {
+  if (frequencyNumber >= FILTER_FREQUENCY_COUNT) {
+    printf("transmitterPwm: frequency number %d is out of range.\n\r",
+           frequencyNumber);
+    return;
+  }
+  transmitterPwm_frequencyNumber = frequencyNumber;
+  transmitterPwm_nextPeriodInClocks =
+      transmitterPwm_getPeriodInClocks(frequencyNumber);
+}
+
+// Returns the current frequency setting.
+uint16_t transmitterPwm_getFrequencyNumber() {
+  return transmitterPwm_frequencyNumber;
+}
+
+// Sets the carrier period in timer clocks; takes effect at the next pulse.
+void transmitterPwm_setPeriodInClocks(uint32_t periodInClocks) {
+  if (periodInClocks < 2 * (LOAD_REGISTER_OFFSET + 1)) {
+    printf("transmitterPwm: period of %ld clocks is too short.\n\r",
+           (long)periodInClocks);
+    return;
+  }
+  transmitterPwm_nextPeriodInClocks = periodInClocks;
+}
+
+// Pulses are sent back to back if continuousModeFlag is true.
+void transmitterPwm_setContinuousMode(bool continuousModeFlag) {
+  transmitterPwm_continuousMode = continuousModeFlag;
+}
+
+// Standard tick function. Outside of the start and end of a pulse this is a
+// single increment and compare.
+void transmitterPwm_tick() {
+  // Perform state update first.
+  switch (currentState) {
+  case init_st:
+    currentState = idle_st;
+    break;
+  case idle_st:
+    if (transmitterPwm_runFlag || transmitterPwm_continuousMode) {
+      transmitterPwm_runFlag = false;
+      transmitterPwm_startTimer();
+      transmitterPwm_pulseTickCount = 0;
+      currentState = pulse_st;
+    }
+    break;
+  case pulse_st:
+    if (transmitterPwm_pulseTickCount == TRANSMITTER_PULSE_WIDTH) {
+      transmitterPwm_pulseTickCount = 0;
+      if (!transmitterPwm_continuousMode) {
+        transmitterPwm_stopTimer();
+        currentState = idle_st;
+      } else if (transmitterPwm_nextPeriodInClocks !=
+                 transmitterPwm_periodInClocks) {
+        transmitterPwm_startTimer(); // Change frequency between pulses.
+      }
+    }
+    break;
+  default:
+    printf("transmitterPwm_tick state update: hit default\n\r");
+    break;
+  }
+
+  // Perform state action next.
+  switch (currentState) {
+  case init_st:
+  case idle_st:
+    break;
+  case pulse_st:
+    transmitterPwm_pulseTickCount++;
+    break;
+  default:
+    printf("transmitterPwm_tick state action: hit default\n\r");
+    break;
+  }
+}
+
+// Starts a pulse and checks the registers that were programmed.
+static bool transmitterPwm_testRegisters(uint16_t frequencyNumber) {
+  uint32_t period = transmitterPwm_getPeriodInClocks(frequencyNumber);
+  transmitterPwm_setFrequencyNumber(frequencyNumber);
+  transmitterPwm_run();
+  transmitterPwm_tick(); // Starts the pulse.
+  uint32_t tlr0 = transmitterPwm_readRegister(OFFSET_TLR0);
+  uint32_t tlr1 = transmitterPwm_readRegister(OFFSET_TLR1);
+  uint32_t tcsr0 = transmitterPwm_readRegister(OFFSET_TCSR0);
+  uint32_t tcsr1 = transmitterPwm_readRegister(OFFSET_TCSR1);
+  if (tlr0 != period - LOAD_REGISTER_OFFSET ||
+      tlr1 != period / 2 - LOAD_REGISTER_OFFSET ||
+      (tcsr0 & (PWM_MODE_BITS | ENT_MASK)) != (PWM_MODE_BITS | ENT_MASK) ||
+      (tcsr1 & (PWM_MODE_BITS | ENT_MASK)) != (PWM_MODE_BITS | ENT_MASK)) {
+    printf("frequency %d: TLR0 %ld TLR1 %ld TCSR0 0x%lx TCSR1 0x%lx.\n\r",
+           frequencyNumber, (long)tlr0, (long)tlr1, (unsigned long)tcsr0,
+           (unsigned long)tcsr1);
+    return false;
+  }
+  return true;
+}
+
+#ifndef ZYBO_BOARD
+// Runs the rest of a pulse started by transmitterPwm_testRegisters() on the
+// timer model, clock by clock, ticking the transmitter every
+// TRANSMITTER_PWM_CLOCKS_PER_TICK clocks. Every full period and high time
+// must be exact and the carrier must be gated to the pulse width.
+static bool transmitterPwm_testWaveform(uint16_t frequencyNumber) {
+  uint32_t period = transmitterPwm_getPeriodInClocks(frequencyNumber);
+  uint32_t clock = 0;
+  uint32_t lastRise = 0, lastFall = 0;
+  bool previousOutput = axiTimerModel_getPwmOutput();
+  bool success = previousOutput; // The carrier starts high.
+  while (transmitterPwm_running()) {
+    for (uint32_t i = 0; i < TRANSMITTER_PWM_CLOCKS_PER_TICK; i++) {
+      axiTimerModel_advance(1);
+      clock++;
+      bool output = axiTimerModel_getPwmOutput();
+      if (output && !previousOutput) {
+        if (clock - lastRise != period) {
+          printf("frequency %d: period of %ld clocks at clock %ld.\n\r",
+                 frequencyNumber, (long)(clock - lastRise), (long)clock);
+          success = false;
+        }
+        lastRise = clock;
+      } else if (!output && previousOutput) {
+        if (clock - lastRise != period / 2) {
+          printf("frequency %d: high for %ld clocks at clock %ld.\n\r",
+                 frequencyNumber, (long)(clock - lastRise), (long)clock);
+          success = false;
+        }
+        lastFall = clock;
+      }
+      previousOutput = output;
+    }
+    transmitterPwm_tick();
+    if (previousOutput && !axiTimerModel_getPwmOutput())
+      lastFall = clock; // Stopped at the end of the pulse.
+    previousOutput = axiTimerModel_getPwmOutput();
+  }
+  uint32_t pulseWidthInClocks =
+      TRANSMITTER_PULSE_WIDTH * TRANSMITTER_PWM_CLOCKS_PER_TICK;
+  if (lastFall > pulseWidthInClocks || lastFall + period < pulseWidthInClocks ||
+      axiTimerModel_getPwmOutput()) {
+    printf("frequency %d: carrier ended at clock %ld, expected %ld.\n\r",
+           frequencyNumber, (long)lastFall, (long)pulseWidthInClocks);
+    success = false;
+  }
+  return success;
+}
+#endif
+
+// Checks the registers, and on the emulator the waveform, for each frequency.
+bool transmitterPwm_runTest() {
+  printf("****************** transmitterPwm_runTest() ******************\n\r");
+  transmitterPwm_init();
+  transmitterPwm_tick(); // Leave init_st.
+  bool success = true;   // Be optimistic.
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    bool registersOk = transmitterPwm_testRegisters(i);
+#ifdef ZYBO_BOARD
+    while (transmitterPwm_running())
+      transmitterPwm_tick(); // Finish the pulse.
+#else
+    registersOk &= transmitterPwm_testWaveform(i);
+#endif
+    success &= registersOk;
+  }
+  printf("transmitterPwm_runTest() %s\n\r", success ? "passed" : "failed");
+  return success;
+}
@@ -0,0 +1,77 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef TRANSMITTERPWM_H_
+#define TRANSMITTERPWM_H_
+
+#include "transmitter.h"
+#include "xparameters.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Transmitter backend that generates the carrier with an AXI timer in PWM mode
+// instead of toggling TRANSMITTER_OUTPUT_PIN from the ISR. Counter 0 sets the
+// period and counter 1 the high time (half the period). The ISR only has to
+// call transmitterPwm_tick(), which counts down the TRANSMITTER_PULSE_WIDTH
+// window and touches the timer registers only to start and stop a pulse.
+// Call transmitterPwm_tick() from isr_function() in place of
+// transmitter_tick().
+//
+// The carrier appears on the PWM0 output of the timer, so the hardware design
+// must route PWM0 of TRANSMITTER_PWM_TIMER_BASEADDR to the transmitter pin.
+// runningModes.c measures run-time with virtual timers, so nothing else uses
+// this timer.
+//
+// Without ZYBO_BOARD, register accesses go to axiTimerModel so the backend
+// can be exercised by the emulator.
+
+#define TRANSMITTER_PWM_TIMER_BASEADDR XPAR_AXI_TIMER_2_BASEADDR
+#define TRANSMITTER_PWM_TIMER_CLOCK_FREQ_HZ XPAR_AXI_TIMER_2_CLOCK_FREQ_HZ
+#define TRANSMITTER_PWM_TICK_RATE_HZ 100000 // Rate of transmitterPwm_tick().
+#define TRANSMITTER_PWM_CLOCKS_PER_TICK                                        \
+  (TRANSMITTER_PWM_TIMER_CLOCK_FREQ_HZ / TRANSMITTER_PWM_TICK_RATE_HZ)
+
+// Standard init function.
+void transmitterPwm_init();
+
+// Starts the transmitter.
+void transmitterPwm_run();
+
+// Returns true if the transmitter is still running.
+bool transmitterPwm_running();
+
+// Sets the frequency number. If this function is called while the
+// transmitter is running, the frequency will not be updated until the
+// current pulse ends.
+void transmitterPwm_setFrequencyNumber(uint16_t frequencyNumber);
+
+// Returns the current frequency setting.
+uint16_t transmitterPwm_getFrequencyNumber();
+
+// Sets the carrier period in timer clocks, for frequencies outside the
+// channel plan. Takes effect at the next pulse, like
+// transmitterPwm_setFrequencyNumber().
+void transmitterPwm_setPeriodInClocks(uint32_t periodInClocks);
+
+// Returns the carrier period in timer clocks for the given frequency number.
+uint32_t transmitterPwm_getPeriodInClocks(uint16_t frequencyNumber);
+
+// If continuousModeFlag is true, pulses are sent back to back; otherwise
+// one pulse-width is sent per call to transmitterPwm_run().
+void transmitterPwm_setContinuousMode(bool continuousModeFlag);
+
+// Standard tick function.
+void transmitterPwm_tick();
+
+// Checks the timer registers programmed for each frequency. Without
+// ZYBO_BOARD it also runs each pulse on axiTimerModel and checks the period,
+// high time and gating of the PWM0 waveform. Returns true if the test passes.
+bool transmitterPwm_runTest();
+
+#endif /* TRANSMITTERPWM_H_ */
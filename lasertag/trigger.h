@@ -34,7 +34,8 @@ void trigger_disable();
 // Returns the number of remaining shots.
 trigger_shotsRemaining_t trigger_getRemainingShotCount();
 
-// Sets the number of remaining shots.
+// Sets the number of remaining shots. When a shot takes the count to 0, call
+// autoReloadTimer_start() so the shots are reloaded.
 void trigger_setRemainingShotCount(trigger_shotsRemaining_t count);
 
 // Standard tick function.
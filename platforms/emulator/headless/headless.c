@@ -0,0 +1,653 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Virtual clock, timer interrupts, registers and the command line of the
+// headless emulator backend. See headless.h.
+
+#include "headless.h"
+#include "interrupts.h"
+#include "leds.h"
+#include "mio.h"
+#include "utils.h"
+#include "xil_io.h"
+#include "xparameters.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// emulator.h renames the program's main() to user_main().
+#undef main
+int user_main();
+
+#define HEADLESS_AXI_TIMER_COUNT 3
+#define HEADLESS_AXI_TIMER_NS_PER_TICK                                         \
+  (HEADLESS_NS_PER_SECOND / XPAR_AXI_TIMER_0_CLOCK_FREQ_HZ)
+#define HEADLESS_AXI_TIMER_TCSR0 0x00
+#define HEADLESS_AXI_TIMER_TLR0 0x04
+#define HEADLESS_AXI_TIMER_TCR0 0x08
+#define HEADLESS_AXI_TIMER_TCSR1 0x10
+#define HEADLESS_AXI_TIMER_TLR1 0x14
+#define HEADLESS_AXI_TIMER_TCR1 0x18
+#define HEADLESS_AXI_TIMER_OFFSET_MASK 0xFF
+#define HEADLESS_AXI_TIMER_LOAD_MASK (1 << 5)
+#define HEADLESS_AXI_TIMER_ENT_MASK (1 << 7)
+#define HEADLESS_LOWER_32_BITS_MASK 0xFFFFFFFFULL
+
+#define HEADLESS_GPIO_DATA_OFFSET 0x00
+#define HEADLESS_GPIO_TRI_OFFSET 0x04
+
+// A cascaded AXI timer. The count is brought up to date (synced) whenever a
+// register is accessed.
+typedef struct {
+  uint32_t baseAddress;
+  uint32_t tcsr0, tcsr1, tlr0, tlr1;
+  uint64_t count;
+  uint64_t syncedNs;
+} headless_axiTimer_t;
+
+headless_config_t headless_config = {
+    .pollNs = HEADLESS_DEFAULT_POLL_NS,
+    .registerNs = HEADLESS_DEFAULT_REGISTER_NS,
+    .displayPixelNs = HEADLESS_DEFAULT_DISPLAY_PIXEL_NS,
+    .isrNs = HEADLESS_DEFAULT_ISR_NS,
+    .adcSource = HEADLESS_ADC_SOURCE_NONE,
+    .adcFrequencyHz = 1471.0, // Player frequency 0.
+    .adcAmplitude = 0.5,
+    .adcShotMs = 200,
+    .adcShotPeriodMs = 1000,
+    .seed = 1,
+    .fieldM = 30.0,
+    .irRangeM = 20.0,
+    .beamDeg = 3.0,
+    .hitGain = 0.25,
+    .fireMs = 100,
+    .firePeriodMs = 1000,
+};
+
+static uint64_t headless_timeNs = 0;
+static headless_axiTimer_t headless_axiTimers[HEADLESS_AXI_TIMER_COUNT] = {
+    {.baseAddress = XPAR_AXI_TIMER_0_BASEADDR},
+    {.baseAddress = XPAR_AXI_TIMER_1_BASEADDR},
+    {.baseAddress = XPAR_AXI_TIMER_2_BASEADDR},
+};
+static uint32_t headless_buttonsTri = 0;
+static uint32_t headless_switchesTri = 0;
+static uint32_t headless_leds = 0;
+
+// Timer interrupt state.
+static bool headless_armIntsEnabled = false;
+static bool headless_timerIntsEnabled = false;
+static bool headless_timerRunning = false;
+static bool headless_inIsr = false;
+static uint64_t headless_isrPeriodNs = HEADLESS_DEFAULT_ISR_PERIOD_NS;
+static uint64_t headless_nextIsrNs = 0;
+static headless_isrStatistics_t headless_isrStatistics;
+volatile int interrupts_isrFlagGlobal = 0;
+
+static struct timespec headless_hostStart;
+static bool headless_finishing = false;
+
+/*********************************** Clock ***********************************/
+
+uint64_t headless_getTimeNs() { return headless_timeNs; }
+
+const headless_isrStatistics_t *headless_getIsrStatistics() {
+  return &headless_isrStatistics;
+}
+
+// Prints a summary, writes the framebuffer and ends the program. In a session
+// the other guns wait for this one at every sync point, so a gun whose
+// program returns early idles, with interrupts off, until the session ends.
+static void headless_finish(const char *reason) {
+  headless_finishing = true;
+  if (headless_sessionGetSyncNs() != HEADLESS_NEVER) {
+    headless_armIntsEnabled = false;
+    if (headless_timeNs < headless_config.runLimitNs)
+      headless_advanceNs(headless_config.runLimitNs - headless_timeNs);
+    headless_sessionEnd();
+    fflush(stdout);
+    exit(EXIT_SUCCESS);
+  }
+  struct timespec hostEnd;
+  clock_gettime(CLOCK_MONOTONIC, &hostEnd);
+  double hostSeconds = (hostEnd.tv_sec - headless_hostStart.tv_sec) +
+                       (hostEnd.tv_nsec - headless_hostStart.tv_nsec) / 1e9;
+  double virtualSeconds = (double)headless_timeNs / HEADLESS_NS_PER_SECOND;
+  fflush(stdout);
+  fprintf(stderr,
+          "headless: %s after %.3f virtual seconds (%.3f host, %.1fx).\n",
+          reason, virtualSeconds, hostSeconds,
+          hostSeconds > 0 ? virtualSeconds / hostSeconds : 0.0);
+  fprintf(stderr,
+          "headless: %lu interrupts, %llu missed, %llu pixels drawn, LEDs "
+          "0x%lx.\n",
+          (unsigned long)headless_isrStatistics.count,
+          (unsigned long long)headless_isrStatistics.missedCount,
+          (unsigned long long)headless_displayGetPixelCount(),
+          (unsigned long)headless_leds);
+  const headless_i2sStatistics_t *i2s = headless_getI2sStatistics();
+  if (i2s->frameCount)
+    fprintf(stderr,
+            "headless: I2S %llu frames played, %llu underruns, %llu "
+            "overflows.\n",
+            (unsigned long long)i2s->frameCount,
+            (unsigned long long)i2s->underrunCount,
+            (unsigned long long)i2s->overflowCount);
+  if (headless_config.framebufferPath &&
+      !headless_displayWriteFramebuffer(headless_config.framebufferPath))
+    exit(EXIT_FAILURE);
+  exit(EXIT_SUCCESS);
+}
+
+// Returns true if the timer interrupt can fire.
+static bool headless_isrEnabled() {
+  return headless_armIntsEnabled && headless_timerIntsEnabled &&
+         headless_timerRunning;
+}
+
+// Runs isr_function() for each interrupt that has fallen due, timing it with
+// AXI timer 0 as libzybo does. As on the board, an interrupt that comes due
+// while another is pending is lost.
+static void headless_runDueInterrupts() {
+  headless_axiTimer_t *isrTimer = &headless_axiTimers[0];
+  while (headless_isrEnabled() && !headless_inIsr &&
+         headless_nextIsrNs <= headless_timeNs) {
+    uint64_t startNs = headless_timeNs;
+    headless_inIsr = true;
+    Xil_Out32(isrTimer->baseAddress + HEADLESS_AXI_TIMER_TCSR0,
+              isrTimer->tcsr0 | HEADLESS_AXI_TIMER_ENT_MASK);
+    headless_isrStatistics.count++;
+    interrupts_isrFlagGlobal = 1;
+    isr_function();
+    headless_advanceNs(headless_config.isrNs);
+    Xil_Out32(isrTimer->baseAddress + HEADLESS_AXI_TIMER_TCSR0,
+              isrTimer->tcsr0 & ~HEADLESS_AXI_TIMER_ENT_MASK);
+    headless_nextIsrNs += headless_isrPeriodNs;
+    if (headless_nextIsrNs + headless_isrPeriodNs <= headless_timeNs) {
+      uint64_t missed =
+          (headless_timeNs - headless_nextIsrNs) / headless_isrPeriodNs;
+      headless_isrStatistics.missedCount += missed;
+      headless_nextIsrNs += missed * headless_isrPeriodNs;
+    }
+    headless_isrStatistics.virtualNs += headless_timeNs - startNs;
+    headless_inIsr = false;
+  }
+}
+
+// Advances the virtual clock, running the timer interrupts that fall due. The
+// clock stops at each interrupt, sync point and the run limit on the way, so
+// that they happen at their own times even during a long delay.
+void headless_advanceNs(uint64_t ns) {
+  uint64_t endNs = headless_timeNs + ns;
+  do {
+    uint64_t stepEndNs = endNs;
+    if (headless_isrEnabled() && !headless_inIsr &&
+        headless_nextIsrNs < stepEndNs)
+      stepEndNs = headless_nextIsrNs;
+    if (headless_sessionGetSyncNs() < stepEndNs)
+      stepEndNs = headless_sessionGetSyncNs();
+    if (headless_config.runLimitNs && headless_config.runLimitNs < stepEndNs)
+      stepEndNs = headless_config.runLimitNs;
+    if (stepEndNs > headless_timeNs)
+      headless_timeNs = stepEndNs;
+    if (headless_timeNs >= headless_sessionGetSyncNs())
+      headless_sessionSync();
+    headless_runDueInterrupts();
+    if (headless_config.runLimitNs &&
+        headless_timeNs >= headless_config.runLimitNs) {
+      if (!headless_finishing)
+        headless_finish("run limit reached");
+      return;
+    }
+  } while (headless_timeNs < endNs);
+}
+
+/********************************* Registers *********************************/
+
+// Returns the modelled AXI timer at the address, or NULL.
+static headless_axiTimer_t *headless_getAxiTimer(uint32_t address) {
+  for (uint16_t i = 0; i < HEADLESS_AXI_TIMER_COUNT; i++)
+    if ((address & ~HEADLESS_AXI_TIMER_OFFSET_MASK) ==
+        headless_axiTimers[i].baseAddress)
+      return &headless_axiTimers[i];
+  return NULL;
+}
+
+// Brings the count up to date. The counter runs while ENT0 is set.
+static void headless_syncAxiTimer(headless_axiTimer_t *timer) {
+  if (timer->tcsr0 & HEADLESS_AXI_TIMER_ENT_MASK)
+    timer->count += headless_timeNs / HEADLESS_AXI_TIMER_NS_PER_TICK -
+                    timer->syncedNs / HEADLESS_AXI_TIMER_NS_PER_TICK;
+  timer->syncedNs = headless_timeNs;
+}
+
+static uint32_t headless_readAxiTimer(headless_axiTimer_t *timer,
+                                      uint32_t offset) {
+  headless_syncAxiTimer(timer);
+  switch (offset) {
+  case HEADLESS_AXI_TIMER_TCSR0:
+    return timer->tcsr0;
+  case HEADLESS_AXI_TIMER_TLR0:
+    return timer->tlr0;
+  case HEADLESS_AXI_TIMER_TCR0:
+    return timer->count & HEADLESS_LOWER_32_BITS_MASK;
+  case HEADLESS_AXI_TIMER_TCSR1:
+    return timer->tcsr1;
+  case HEADLESS_AXI_TIMER_TLR1:
+    return timer->tlr1;
+  case HEADLESS_AXI_TIMER_TCR1:
+    return timer->count >> 32;
+  default:
+    return 0;
+  }
+}
+
+// LOAD copies the load register into its half of the counter.
+static void headless_writeAxiTimer(headless_axiTimer_t *timer, uint32_t offset,
+                                   uint32_t value) {
+  headless_syncAxiTimer(timer);
+  switch (offset) {
+  case HEADLESS_AXI_TIMER_TCSR0:
+    timer->tcsr0 = value;
+    if (value & HEADLESS_AXI_TIMER_LOAD_MASK)
+      timer->count =
+          (timer->count & ~HEADLESS_LOWER_32_BITS_MASK) | timer->tlr0;
+    break;
+  case HEADLESS_AXI_TIMER_TLR0:
+    timer->tlr0 = value;
+    break;
+  case HEADLESS_AXI_TIMER_TCSR1:
+    timer->tcsr1 = value;
+    if (value & HEADLESS_AXI_TIMER_LOAD_MASK)
+      timer->count = (timer->count & HEADLESS_LOWER_32_BITS_MASK) |
+                     ((uint64_t)timer->tlr1 << 32);
+    break;
+  case HEADLESS_AXI_TIMER_TLR1:
+    timer->tlr1 = value;
+    break;
+  }
+}
+
+// Returns the buttons held down by the script at the current time.
+static uint32_t headless_readButtons() {
+  uint32_t mask = 0;
+  for (uint16_t i = 0; i < headless_config.pressCount; i++) {
+    headless_buttonPress_t *press = &headless_config.presses[i];
+    if (headless_timeNs >= press->startNs && headless_timeNs < press->endNs)
+      mask |= press->mask;
+  }
+  return mask;
+}
+
+uint32_t Xil_In32(uint32_t address) {
+  uint32_t value = 0;
+  uint64_t cost = headless_config.registerNs;
+  headless_axiTimer_t *timer = headless_getAxiTimer(address);
+  if (timer) {
+    value = headless_readAxiTimer(timer,
+                                  address & HEADLESS_AXI_TIMER_OFFSET_MASK);
+  } else if (address ==
+             XPAR_PUSH_BUTTONS_BASEADDR + HEADLESS_GPIO_DATA_OFFSET) {
+    value = headless_readButtons();
+    cost = headless_config.pollNs;
+  } else if (address == XPAR_PUSH_BUTTONS_BASEADDR + HEADLESS_GPIO_TRI_OFFSET) {
+    value = headless_buttonsTri;
+  } else if (address ==
+             XPAR_SLIDE_SWITCHES_BASEADDR + HEADLESS_GPIO_DATA_OFFSET) {
+    value = headless_config.switches;
+    cost = headless_config.pollNs;
+  } else if (address ==
+             XPAR_SLIDE_SWITCHES_BASEADDR + HEADLESS_GPIO_TRI_OFFSET) {
+    value = headless_switchesTri;
+  } else if (headless_i2sIsRegister(address)) {
+    value = headless_i2sRead(address);
+  }
+  headless_advanceNs(cost);
+  return value;
+}
+
+void Xil_Out32(uint32_t address, uint32_t value) {
+  headless_axiTimer_t *timer = headless_getAxiTimer(address);
+  if (timer)
+    headless_writeAxiTimer(timer, address & HEADLESS_AXI_TIMER_OFFSET_MASK,
+                           value);
+  else if (address == XPAR_PUSH_BUTTONS_BASEADDR + HEADLESS_GPIO_TRI_OFFSET)
+    headless_buttonsTri = value;
+  else if (address == XPAR_SLIDE_SWITCHES_BASEADDR + HEADLESS_GPIO_TRI_OFFSET)
+    headless_switchesTri = value;
+  else if (headless_i2sIsRegister(address))
+    headless_i2sWrite(address, value);
+  headless_advanceNs(headless_config.registerNs);
+}
+
+/********************************* Interrupts ********************************/
+
+int interrupts_initAll(__attribute__((unused)) bool printFailedStatusFlag) {
+  headless_armIntsEnabled = false;
+  headless_timerIntsEnabled = false;
+  headless_timerRunning = false;
+  return 1;
+}
+
+void interrupts_setPrivateTimerLoadValue(u32 loadValue) {
+  headless_isrPeriodNs =
+      ((uint64_t)loadValue + 1) * HEADLESS_NS_PER_SECOND /
+      HEADLESS_PRIVATE_TIMER_HZ;
+  if (headless_isrPeriodNs == 0)
+    headless_isrPeriodNs = 1;
+}
+
+u32 interrupts_getPrivateTimerTicksPerSecond() {
+  return HEADLESS_PRIVATE_TIMER_HZ;
+}
+
+int interrupts_enableArmInts() {
+  headless_armIntsEnabled = true;
+  headless_runDueInterrupts();
+  return 1;
+}
+
+int interrupts_disableArmInts() {
+  headless_armIntsEnabled = false;
+  return 1;
+}
+
+int interrupts_startArmPrivateTimer() {
+  if (!headless_timerRunning)
+    headless_nextIsrNs = headless_timeNs + headless_isrPeriodNs;
+  headless_timerRunning = true;
+  return 1;
+}
+
+int interrupts_stopArmPrivateTimer() {
+  headless_timerRunning = false;
+  return 1;
+}
+
+u32 interrupts_isrInvocationCount() { return headless_isrStatistics.count; }
+
+void interrupts_enableTimerGlobalInts() { headless_timerIntsEnabled = true; }
+
+void interrupts_disableTimerGlobalInts() { headless_timerIntsEnabled = false; }
+
+bool interrupts_getAdcInputMode() { return INTERRUPTS_ADC_DEFAULT_INPUT_MODE; }
+
+uint32_t interrupts_getAdcData() {
+  return headless_adcRead(headless_timeNs / HEADLESS_ADC_SAMPLE_NS);
+}
+
+/*********************************** Utils ***********************************/
+
+void utils_msDelay(long ms) { headless_advanceNs(ms * HEADLESS_NS_PER_MS); }
+
+// Waits for the next interrupt, as the Qt emulator does.
+void utils_sleep() {
+  if (headless_isrEnabled() && headless_nextIsrNs > headless_timeNs)
+    headless_advanceNs(headless_nextIsrNs - headless_timeNs);
+  else
+    headless_advanceNs(headless_config.pollNs);
+}
+
+/******************************** LEDs and MIO *******************************/
+
+int leds_init(__attribute__((unused)) bool printFailedStatusFlag) { return 1; }
+void leds_write(int ledValue) { headless_leds = ledValue; }
+void leds_writeLd4(__attribute__((unused)) int ledValue) {}
+int leds_runTest() { return 1; }
+
+int mio_init(__attribute__((unused)) bool printFailedStatusFlag) { return 1; }
+u8 mio_readPin(u8 mioPinNumber) {
+  return headless_sessionReadPin(mioPinNumber);
+}
+void mio_writePin(u8 mioPinNumber, u8 value) {
+  headless_sessionWritePin(mioPinNumber, value);
+}
+void mio_WriteBank0(__attribute__((unused)) u32 value) {}
+uint16_t mio_readBank0() { return 0; }
+void mio_setPinAsInput(__attribute__((unused)) u8 mioPinNo) {}
+void mio_setPinAsOutput(__attribute__((unused)) u8 mioPinNo) {}
+
+/******************************** Command line *******************************/
+
+#define HEADLESS_BUTTON_COUNT 4
+#define HEADLESS_DEFAULT_PRESS_MS 100
+
+static void headless_printUsage(const char *program) {
+  printf(
+      "Usage: %s [options]\n"
+      "Runs the program on a virtual clock, without a window.\n"
+      "  --seconds S           stop after S virtual seconds\n"
+      "  --press B@MS[:LEN]    hold button B (0-3) from MS ms for LEN ms "
+      "(%d)\n"
+      "  --switches N          slide-switch setting\n"
+      "  --framebuffer FILE    write the display to FILE (PPM) at the end\n"
+      "  --adc-file FILE       ADC samples (0-4095), one per line\n"
+      "  --adc-loop            restart the ADC file at its end\n"
+      "  --adc-tone HZ         square wave at HZ, in shots\n"
+      "  --adc-amplitude A     tone amplitude, fraction of full scale (%.2f)\n"
+      "  --adc-noise N         noise amplitude, fraction of full scale\n"
+      "  --adc-shot MS/PERIOD  shot length and period in ms (%lu/%lu); 0 "
+      "for a continuous tone\n"
+      "  --seed N              noise seed\n"
+      "  --poll-ns N           cost of a button or switch read (%d)\n"
+      "  --register-ns N       cost of any other register access (%d)\n"
+      "  --pixel-ns N          cost of drawing a pixel (%d)\n"
+      "  --isr-ns N            cost of an ISR, on top of its accesses (%d)\n"
+      "Sessions (--seconds is required):\n"
+      "  --guns N              run N guns, 2-%d, in one session\n"
+      "  --field-m M           guns are placed in an M x M field (%.0f)\n"
+      "  --ir-range-m M        distance at which the path gain starts to "
+      "fall (%.0f)\n"
+      "  --beam-deg D          standard deviation of the beam (%.1f)\n"
+      "  --hit-gain G          channel gain at which a shot should hit "
+      "(%.2f)\n"
+      "  --fire MS/PERIOD      trigger hold and period in ms (%lu/%lu)\n"
+      "  --session-log PREFIX  write each gun's output to PREFIX<gun>.log\n",
+      program, HEADLESS_DEFAULT_PRESS_MS, headless_config.adcAmplitude,
+      (unsigned long)headless_config.adcShotMs,
+      (unsigned long)headless_config.adcShotPeriodMs, HEADLESS_DEFAULT_POLL_NS,
+      HEADLESS_DEFAULT_REGISTER_NS, HEADLESS_DEFAULT_DISPLAY_PIXEL_NS,
+      HEADLESS_DEFAULT_ISR_NS, HEADLESS_SESSION_MAX_GUNS,
+      headless_config.fieldM, headless_config.irRangeM,
+      headless_config.beamDeg, headless_config.hitGain,
+      (unsigned long)headless_config.fireMs,
+      (unsigned long)headless_config.firePeriodMs);
+}
+
+// Parses "B@MS[:LEN]". Returns false if malformed.
+static bool headless_parsePress(const char *text) {
+  unsigned button;
+  double startMs, lengthMs = HEADLESS_DEFAULT_PRESS_MS;
+  if (sscanf(text, "%u@%lf:%lf", &button, &startMs, &lengthMs) < 2 ||
+      button >= HEADLESS_BUTTON_COUNT ||
+      headless_config.pressCount >= HEADLESS_MAX_BUTTON_PRESSES)
+    return false;
+  headless_buttonPress_t *press =
+      &headless_config.presses[headless_config.pressCount++];
+  press->mask = 1 << button;
+  press->startNs = startMs * HEADLESS_NS_PER_MS;
+  press->endNs = press->startNs + lengthMs * HEADLESS_NS_PER_MS;
+  return true;
+}
+
+// Parses the command line into headless_config. Returns false on error.
+static bool headless_parseArguments(int argc, char **argv) {
+  enum {
+    OPTION_SECONDS = 256,
+    OPTION_PRESS,
+    OPTION_SWITCHES,
+    OPTION_FRAMEBUFFER,
+    OPTION_ADC_FILE,
+    OPTION_ADC_LOOP,
+    OPTION_ADC_TONE,
+    OPTION_ADC_AMPLITUDE,
+    OPTION_ADC_NOISE,
+    OPTION_ADC_SHOT,
+    OPTION_SEED,
+    OPTION_POLL_NS,
+    OPTION_REGISTER_NS,
+    OPTION_PIXEL_NS,
+    OPTION_ISR_NS,
+    OPTION_GUNS,
+    OPTION_FIELD_M,
+    OPTION_IR_RANGE_M,
+    OPTION_BEAM_DEG,
+    OPTION_HIT_GAIN,
+    OPTION_FIRE,
+    OPTION_SESSION_LOG,
+  };
+  static const struct option options[] = {
+      {"seconds", required_argument, NULL, OPTION_SECONDS},
+      {"press", required_argument, NULL, OPTION_PRESS},
+      {"switches", required_argument, NULL, OPTION_SWITCHES},
+      {"framebuffer", required_argument, NULL, OPTION_FRAMEBUFFER},
+      {"adc-file", required_argument, NULL, OPTION_ADC_FILE},
+      {"adc-loop", no_argument, NULL, OPTION_ADC_LOOP},
+      {"adc-tone", required_argument, NULL, OPTION_ADC_TONE},
+      {"adc-amplitude", required_argument, NULL, OPTION_ADC_AMPLITUDE},
+      {"adc-noise", required_argument, NULL, OPTION_ADC_NOISE},
+      {"adc-shot", required_argument, NULL, OPTION_ADC_SHOT},
+      {"seed", required_argument, NULL, OPTION_SEED},
+      {"poll-ns", required_argument, NULL, OPTION_POLL_NS},
+      {"register-ns", required_argument, NULL, OPTION_REGISTER_NS},
+      {"pixel-ns", required_argument, NULL, OPTION_PIXEL_NS},
+      {"isr-ns", required_argument, NULL, OPTION_ISR_NS},
+      {"guns", required_argument, NULL, OPTION_GUNS},
+      {"field-m", required_argument, NULL, OPTION_FIELD_M},
+      {"ir-range-m", required_argument, NULL, OPTION_IR_RANGE_M},
+      {"beam-deg", required_argument, NULL, OPTION_BEAM_DEG},
+      {"hit-gain", required_argument, NULL, OPTION_HIT_GAIN},
+      {"fire", required_argument, NULL, OPTION_FIRE},
+      {"session-log", required_argument, NULL, OPTION_SESSION_LOG},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0},
+  };
+  int option;
+  while ((option = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+    switch (option) {
+    case OPTION_SECONDS:
+      headless_config.runLimitNs = atof(optarg) * HEADLESS_NS_PER_SECOND;
+      break;
+    case OPTION_PRESS:
+      if (!headless_parsePress(optarg)) {
+        fprintf(stderr, "headless: bad --press %s\n", optarg);
+        return false;
+      }
+      break;
+    case OPTION_SWITCHES:
+      headless_config.switches = strtoul(optarg, NULL, 0);
+      break;
+    case OPTION_FRAMEBUFFER:
+      headless_config.framebufferPath = optarg;
+      break;
+    case OPTION_ADC_FILE:
+      headless_config.adcSource = HEADLESS_ADC_SOURCE_FILE;
+      headless_config.adcPath = optarg;
+      break;
+    case OPTION_ADC_LOOP:
+      headless_config.adcLoop = true;
+      break;
+    case OPTION_ADC_TONE:
+      headless_config.adcSource = HEADLESS_ADC_SOURCE_GENERATOR;
+      headless_config.adcFrequencyHz = atof(optarg);
+      break;
+    case OPTION_ADC_AMPLITUDE:
+      headless_config.adcAmplitude = atof(optarg);
+      break;
+    case OPTION_ADC_NOISE:
+      headless_config.adcNoise = atof(optarg);
+      break;
+    case OPTION_ADC_SHOT: {
+      unsigned long shotMs, periodMs = headless_config.adcShotPeriodMs;
+      if (sscanf(optarg, "%lu/%lu", &shotMs, &periodMs) < 1) {
+        fprintf(stderr, "headless: bad --adc-shot %s\n", optarg);
+        return false;
+      }
+      headless_config.adcShotMs = shotMs;
+      headless_config.adcShotPeriodMs = periodMs;
+      break;
+    }
+    case OPTION_SEED:
+      headless_config.seed = strtoul(optarg, NULL, 0);
+      break;
+    case OPTION_POLL_NS:
+      headless_config.pollNs = strtoull(optarg, NULL, 0);
+      break;
+    case OPTION_REGISTER_NS:
+      headless_config.registerNs = strtoull(optarg, NULL, 0);
+      break;
+    case OPTION_PIXEL_NS:
+      headless_config.displayPixelNs = strtoull(optarg, NULL, 0);
+      break;
+    case OPTION_ISR_NS:
+      headless_config.isrNs = strtoull(optarg, NULL, 0);
+      break;
+    case OPTION_GUNS:
+      headless_config.gunCount = strtoul(optarg, NULL, 0);
+      if (headless_config.gunCount < 2 ||
+          headless_config.gunCount > HEADLESS_SESSION_MAX_GUNS) {
+        fprintf(stderr, "headless: bad --guns %s\n", optarg);
+        return false;
+      }
+      break;
+    case OPTION_FIELD_M:
+      headless_config.fieldM = atof(optarg);
+      break;
+    case OPTION_IR_RANGE_M:
+      headless_config.irRangeM = atof(optarg);
+      break;
+    case OPTION_BEAM_DEG:
+      headless_config.beamDeg = atof(optarg);
+      break;
+    case OPTION_HIT_GAIN:
+      headless_config.hitGain = atof(optarg);
+      break;
+    case OPTION_FIRE: {
+      unsigned long fireMs, periodMs = headless_config.firePeriodMs;
+      if (sscanf(optarg, "%lu/%lu", &fireMs, &periodMs) < 1 ||
+          fireMs >= periodMs) {
+        fprintf(stderr, "headless: bad --fire %s\n", optarg);
+        return false;
+      }
+      headless_config.fireMs = fireMs;
+      headless_config.firePeriodMs = periodMs;
+      break;
+    }
+    case OPTION_SESSION_LOG:
+      headless_config.sessionLogPrefix = optarg;
+      break;
+    case 'h':
+      headless_printUsage(argv[0]);
+      exit(EXIT_SUCCESS);
+    default:
+      headless_printUsage(argv[0]);
+      return false;
+    }
+  }
+  if (headless_config.gunCount && !headless_config.runLimitNs) {
+    fprintf(stderr, "headless: --guns needs --seconds\n");
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (!headless_parseArguments(argc, argv) ||
+      (headless_config.gunCount && !headless_sessionStart()) ||
+      !headless_adcInit())
+    return EXIT_FAILURE;
+  clock_gettime(CLOCK_MONOTONIC, &headless_hostStart);
+  user_main();
+  headless_finish("program returned");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,201 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef HEADLESS_H_
+#define HEADLESS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Headless emulator backend with a virtual clock. Build with
+//   cmake .. -DEMU=1 -DHEADLESS=1
+// It replaces the Qt emulator library: there is no window and no wall-clock
+// time. Virtual time only advances when the program touches the platform, so a
+// run is deterministic and goes as fast as the host allows:
+//  - Reading the push buttons or slide switches costs pollNs. Main loops poll
+//    these, so pollNs stands in for the work of one main-loop iteration.
+//  - Any other register access costs registerNs.
+//  - Drawing on the display costs displayPixelNs per pixel written.
+//  - utils_msDelay() and utils_sleep() advance the clock as asked.
+// Whenever the clock passes the next timer interrupt (every 10 us, i.e., 100
+// kHz, unless the private-timer load value is changed), isr_function() is run,
+// with AXI timer 0 timing it as on the board. Time spent in the ISR is what its
+// own register accesses cost plus isrNs. The clock stops at every interrupt on
+// the way, so a long advance such as utils_msDelay(1000) runs all 100,000 of
+// them, each at its own time. An interrupt is only counted as missed when the
+// ISR itself runs past the next one, as it would be lost on the board.
+//
+// The three AXI timers are modelled as 64-bit cascaded up-counters at 100 MHz
+// of virtual time, so intervalTimer and the timestamp counter read virtual
+// time too. ADC samples come from a file or a signal generator (see
+// headlessAdc.c), and display calls draw into a framebuffer that is written
+// as a PPM image when the run ends. The I2S transmitter drains its TX FIFO at
+// 48 kHz of virtual time and counts underruns (see headlessI2s.c). Buttons
+// are pressed by a script given on the command line, e.g., to press BTN3 after
+// a 10-minute game. Run the program with --help for the options.
+//
+// With --guns N the program is run as N guns in one session (see
+// headlessSession.c): N copies are forked, each with its own globals and its
+// own virtual clock, and the clocks are kept in lock-step. What each gun
+// transmits reaches the others' ADCs through a model of the IR channel, and
+// a per-gun report of hit accuracy and CPU headroom is printed at the end.
+
+#define HEADLESS_NS_PER_SECOND 1000000000ULL
+#define HEADLESS_NS_PER_MS 1000000ULL
+
+// The Cortex-A9 private timer runs at half the CPU clock.
+#define HEADLESS_PRIVATE_TIMER_HZ 325000000ULL
+#define HEADLESS_DEFAULT_ISR_PERIOD_NS 10000 // 100 kHz.
+
+#define HEADLESS_DEFAULT_POLL_NS 1000
+#define HEADLESS_DEFAULT_REGISTER_NS 50
+#define HEADLESS_DEFAULT_DISPLAY_PIXEL_NS 640 // 16 bits at 25 MHz.
+#define HEADLESS_DEFAULT_ISR_NS 500
+
+#define HEADLESS_MAX_BUTTON_PRESSES 32
+
+// MIO pins the backend watches or drives.
+#define HEADLESS_TRIGGER_PIN 10     // Gun trigger (JF-2), high when pulled.
+#define HEADLESS_HIT_LED_PIN 11     // HIT_LED_TIMER_OUTPUT_PIN.
+#define HEADLESS_TRANSMITTER_PIN 13 // TRANSMITTER_OUTPUT_PIN.
+
+#define HEADLESS_NEVER UINT64_MAX
+
+#define HEADLESS_SESSION_MAX_GUNS 32
+
+#define HEADLESS_ADC_SAMPLE_NS 10000 // The XADC converts at 100 kHz.
+#define HEADLESS_ADC_MID_SCALE 2048
+#define HEADLESS_ADC_HALF_SCALE 2047
+#define HEADLESS_ADC_MAX_VALUE 4095
+
+// ADC input sources.
+#define HEADLESS_ADC_SOURCE_NONE 0      // Mid-scale.
+#define HEADLESS_ADC_SOURCE_FILE 1      // One sample per line.
+#define HEADLESS_ADC_SOURCE_GENERATOR 2 // Square wave, in shots, plus noise.
+#define HEADLESS_ADC_SOURCE_SESSION 3   // The other guns, through the channel.
+
+// The I2S TX FIFO (headlessI2s.c): 8 stereo frames, drained at 48 kHz.
+#define HEADLESS_I2S_FIFO_WORD_COUNT 16
+#define HEADLESS_I2S_SAMPLE_RATE 48000ULL
+
+// One scripted button press.
+typedef struct {
+  uint64_t startNs;
+  uint64_t endNs;
+  uint32_t mask;
+} headless_buttonPress_t;
+
+typedef struct {
+  uint64_t pollNs;
+  uint64_t registerNs;
+  uint64_t displayPixelNs;
+  uint64_t isrNs;
+  uint64_t runLimitNs; // 0 to run until the program returns.
+  uint32_t switches;
+  headless_buttonPress_t presses[HEADLESS_MAX_BUTTON_PRESSES];
+  uint16_t pressCount;
+  const char *framebufferPath; // NULL for none.
+  uint16_t adcSource;
+  const char *adcPath;
+  bool adcLoop;              // Start the file again at its end.
+  double adcFrequencyHz;     // Generator.
+  double adcAmplitude;       // Fraction of full scale, 0.0 - 1.0.
+  double adcNoise;           // Fraction of full scale, 0.0 - 1.0.
+  uint32_t adcShotMs;        // Length of a shot; 0 for a continuous signal.
+  uint32_t adcShotPeriodMs;  // Time from one shot to the next.
+  uint32_t seed;             // For the noise.
+  // Sessions.
+  uint16_t gunCount;         // 0 for a single program.
+  double fieldM;             // Guns are placed in a square this wide.
+  double irRangeM;           // Distance at which the path gain starts to fall.
+  double beamDeg;            // Standard deviation of the beam.
+  double hitGain;            // Channel gain at which a shot should hit.
+  uint32_t fireMs;           // How long the trigger is held...
+  uint32_t firePeriodMs;     // ...every period.
+  // The guns' output goes to <sessionLogPrefix><gun>.log; NULL for none.
+  const char *sessionLogPrefix;
+} headless_config_t;
+
+// Interrupt statistics.
+typedef struct {
+  uint64_t count;
+  uint64_t missedCount;
+  uint64_t virtualNs; // Virtual time spent in the ISR.
+} headless_isrStatistics_t;
+
+// I2S transmitter statistics.
+typedef struct {
+  uint64_t frameCount;    // Stereo frames played.
+  uint64_t underrunCount; // Gaps in a sound.
+  uint64_t overflowCount; // Words written to a full FIFO.
+} headless_i2sStatistics_t;
+
+extern headless_config_t headless_config;
+
+// Returns the virtual time in ns since the program started.
+uint64_t headless_getTimeNs();
+
+// Advances the virtual clock, running the timer interrupts that fall due.
+void headless_advanceNs(uint64_t ns);
+
+// Returns the interrupt statistics so far.
+const headless_isrStatistics_t *headless_getIsrStatistics();
+
+// Returns true if the address is one of the I2S transmitter's registers.
+bool headless_i2sIsRegister(uint32_t address);
+
+// Reads or writes an I2S transmitter register.
+uint32_t headless_i2sRead(uint32_t address);
+void headless_i2sWrite(uint32_t address, uint32_t value);
+
+// Returns the I2S transmitter statistics so far.
+const headless_i2sStatistics_t *headless_getI2sStatistics();
+
+// Opens the ADC trace file or sets up the generator. Returns false on error.
+bool headless_adcInit();
+
+// Returns the 12-bit ADC reading for the given sample (100 kHz) number.
+uint32_t headless_adcRead(uint64_t sampleNumber);
+
+// Returns repeatable noise in [-1.0, 1.0) for the sample and the seed.
+double headless_adcNoise(uint64_t sampleNumber);
+
+// Writes the framebuffer to a binary PPM file. Returns false on error.
+bool headless_displayWriteFramebuffer(const char *path);
+
+// Returns the number of pixels drawn since the program started.
+uint64_t headless_displayGetPixelCount();
+
+// Starts a session of headless_config.gunCount guns. Returns in each gun's
+// process; the first process waits for the guns, prints the report and
+// exits. Returns false on error.
+bool headless_sessionStart();
+
+// Returns the virtual time of the next sync point, or HEADLESS_NEVER outside
+// a session. The clock must not pass it without calling headless_sessionSync().
+uint64_t headless_sessionGetSyncNs();
+
+// Waits for the other guns to reach the sync point.
+void headless_sessionSync();
+
+// Returns the level of an input pin driven by the session.
+bool headless_sessionReadPin(uint8_t pin);
+
+// Watches the transmitter and hit-LED pins.
+void headless_sessionWritePin(uint8_t pin, bool value);
+
+// Returns the ADC reading of this gun's receiver for the sample.
+uint32_t headless_sessionAdcRead(uint64_t sampleNumber);
+
+// Records this gun's results for the report.
+void headless_sessionEnd();
+
+#endif /* HEADLESS_H_ */
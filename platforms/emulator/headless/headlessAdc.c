@@ -0,0 +1,128 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// ADC input for the headless emulator backend. Samples are numbered at the
+// XADC rate (100 kHz) and a reading returns the sample for the current virtual
+// time, so the input does not depend on how often the program reads it. In a
+// session the samples come from headlessSession.c instead.
+//  - File: whitespace-separated 12-bit values, one per sample. The file is
+//    read forward as the samples are needed, so long traces are not loaded
+//    into memory. At its end it starts again (--adc-loop) or reads mid-scale.
+//  - Generator: a square wave (what the transmitter sends) switched on for
+//    adcShotMs of every adcShotPeriodMs, plus uniform noise. The noise is a
+//    hash of the seed and the sample number, so it is repeatable.
+
+#include "headless.h"
+#include <stdio.h>
+
+#define HEADLESS_ADC_SAMPLES_PER_SECOND 100000
+#define HEADLESS_ADC_SAMPLES_PER_MS (HEADLESS_ADC_SAMPLES_PER_SECOND / 1000)
+
+static FILE *headless_adcFile = NULL;
+static uint64_t headless_adcFileSampleNumber = 0; // Of headless_adcFileValue.
+static uint32_t headless_adcFileValue = HEADLESS_ADC_MID_SCALE;
+static bool headless_adcFileStarted = false;
+static bool headless_adcFileEnded = false;
+
+// Opens the ADC trace file or sets up the generator.
+bool headless_adcInit() {
+  if (headless_config.adcSource != HEADLESS_ADC_SOURCE_FILE)
+    return true;
+  headless_adcFile = fopen(headless_config.adcPath, "r");
+  if (!headless_adcFile) {
+    perror(headless_config.adcPath);
+    return false;
+  }
+  return true;
+}
+
+// Reads the next value from the file. Returns false at the end.
+static bool headless_adcReadNextValue() {
+  unsigned value;
+  if (fscanf(headless_adcFile, "%u", &value) != 1) {
+    if (!headless_config.adcLoop)
+      return false;
+    rewind(headless_adcFile);
+    if (fscanf(headless_adcFile, "%u", &value) != 1)
+      return false; // Empty file.
+  }
+  headless_adcFileValue =
+      value > HEADLESS_ADC_MAX_VALUE ? HEADLESS_ADC_MAX_VALUE : value;
+  return true;
+}
+
+// Reads forward to the sample. Samples that were never asked for are skipped.
+static uint32_t headless_adcReadFile(uint64_t sampleNumber) {
+  if (!headless_adcFileStarted) {
+    headless_adcFileStarted = true;
+    headless_adcFileEnded = !headless_adcReadNextValue();
+  }
+  while (!headless_adcFileEnded &&
+         headless_adcFileSampleNumber < sampleNumber) {
+    if (headless_adcReadNextValue()) {
+      headless_adcFileSampleNumber++;
+    } else {
+      headless_adcFileEnded = true;
+      fprintf(stderr, "headless: ADC file ended at sample %llu.\n",
+              (unsigned long long)headless_adcFileSampleNumber);
+    }
+  }
+  return headless_adcFileEnded ? HEADLESS_ADC_MID_SCALE
+                               : headless_adcFileValue;
+}
+
+// Returns a repeatable value in [-1.0, 1.0) for the sample.
+double headless_adcNoise(uint64_t sampleNumber) {
+  uint64_t x = sampleNumber ^ ((uint64_t)headless_config.seed << 32);
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return (double)(x >> 11) / (double)(1ULL << 52) - 1.0;
+}
+
+static uint32_t headless_adcGenerate(uint64_t sampleNumber) {
+  double value = 0.0;
+  bool on = true;
+  if (headless_config.adcShotMs) {
+    uint64_t periodSamples =
+        (uint64_t)headless_config.adcShotPeriodMs * HEADLESS_ADC_SAMPLES_PER_MS;
+    uint64_t shotSamples =
+        (uint64_t)headless_config.adcShotMs * HEADLESS_ADC_SAMPLES_PER_MS;
+    on = periodSamples == 0 || sampleNumber % periodSamples < shotSamples;
+  }
+  if (on) {
+    double cycles = sampleNumber * headless_config.adcFrequencyHz /
+                    HEADLESS_ADC_SAMPLES_PER_SECOND;
+    double phase = cycles - (uint64_t)cycles;
+    value = phase < 0.5 ? headless_config.adcAmplitude
+                        : -headless_config.adcAmplitude;
+  }
+  value += headless_config.adcNoise * headless_adcNoise(sampleNumber);
+  int32_t reading =
+      HEADLESS_ADC_MID_SCALE + (int32_t)(value * HEADLESS_ADC_HALF_SCALE);
+  if (reading < 0)
+    return 0;
+  return reading > HEADLESS_ADC_MAX_VALUE ? HEADLESS_ADC_MAX_VALUE : reading;
+}
+
+// Returns the 12-bit ADC reading for the sample.
+uint32_t headless_adcRead(uint64_t sampleNumber) {
+  switch (headless_config.adcSource) {
+  case HEADLESS_ADC_SOURCE_FILE:
+    return headless_adcReadFile(sampleNumber);
+  case HEADLESS_ADC_SOURCE_GENERATOR:
+    return headless_adcGenerate(sampleNumber);
+  case HEADLESS_ADC_SOURCE_SESSION:
+    return headless_sessionAdcRead(sampleNumber);
+  default:
+    return HEADLESS_ADC_MID_SCALE;
+  }
+}
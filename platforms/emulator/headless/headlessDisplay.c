@@ -0,0 +1,654 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Display for the headless emulator backend: the display.h API draws into a
+// 320x240 RGB565 framebuffer, using the same algorithms and 5x7 font as
+// Adafruit_GFX (BSD license) in libzybo, so the image matches the TFT. Each
+// call costs displayPixelNs of virtual time per pixel written. Touch is never
+// reported and the display test routines do nothing.
+
+#include "display.h"
+#include "headless.h"
+#include <stdio.h>
+#include <string.h>
+
+#define HEADLESS_DISPLAY_FONT_WIDTH 5
+#define HEADLESS_DISPLAY_DEFAULT_ROTATION                                      \
+  DISPLAY_LANDSCAPE_MODE_ORIGIN_UPPER_LEFT
+#define HEADLESS_DISPLAY_MAX_COLOR_VALUE 255
+
+// Adafruit_GFX glcdfont: 5 columns per character, least-significant bit at the
+// top.
+static const uint8_t headless_displayFont[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x3E, 0x5B, 0x4F, 0x5B, 0x3E,
+    0x3E, 0x6B, 0x4F, 0x6B, 0x3E, 0x1C, 0x3E, 0x7C, 0x3E, 0x1C,
+    0x18, 0x3C, 0x7E, 0x3C, 0x18, 0x1C, 0x57, 0x7D, 0x57, 0x1C,
+    0x1C, 0x5E, 0x7F, 0x5E, 0x1C, 0x00, 0x18, 0x3C, 0x18, 0x00,
+    0xFF, 0xE7, 0xC3, 0xE7, 0xFF, 0x00, 0x18, 0x24, 0x18, 0x00,
+    0xFF, 0xE7, 0xDB, 0xE7, 0xFF, 0x30, 0x48, 0x3A, 0x06, 0x0E,
+    0x26, 0x29, 0x79, 0x29, 0x26, 0x40, 0x7F, 0x05, 0x05, 0x07,
+    0x40, 0x7F, 0x05, 0x25, 0x3F, 0x5A, 0x3C, 0xE7, 0x3C, 0x5A,
+    0x7F, 0x3E, 0x1C, 0x1C, 0x08, 0x08, 0x1C, 0x1C, 0x3E, 0x7F,
+    0x14, 0x22, 0x7F, 0x22, 0x14, 0x5F, 0x5F, 0x00, 0x5F, 0x5F,
+    0x06, 0x09, 0x7F, 0x01, 0x7F, 0x00, 0x66, 0x89, 0x95, 0x6A,
+    0x60, 0x60, 0x60, 0x60, 0x60, 0x94, 0xA2, 0xFF, 0xA2, 0x94,
+    0x08, 0x04, 0x7E, 0x04, 0x08, 0x10, 0x20, 0x7E, 0x20, 0x10,
+    0x08, 0x08, 0x2A, 0x1C, 0x08, 0x08, 0x1C, 0x2A, 0x08, 0x08,
+    0x1E, 0x10, 0x10, 0x10, 0x10, 0x0C, 0x1E, 0x0C, 0x1E, 0x0C,
+    0x30, 0x38, 0x3E, 0x38, 0x30, 0x06, 0x0E, 0x3E, 0x0E, 0x06,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x5F, 0x00, 0x00,
+    0x00, 0x07, 0x00, 0x07, 0x00, 0x14, 0x7F, 0x14, 0x7F, 0x14,
+    0x24, 0x2A, 0x7F, 0x2A, 0x12, 0x23, 0x13, 0x08, 0x64, 0x62,
+    0x36, 0x49, 0x56, 0x20, 0x50, 0x00, 0x08, 0x07, 0x03, 0x00,
+    0x00, 0x1C, 0x22, 0x41, 0x00, 0x00, 0x41, 0x22, 0x1C, 0x00,
+    0x2A, 0x1C, 0x7F, 0x1C, 0x2A, 0x08, 0x08, 0x3E, 0x08, 0x08,
+    0x00, 0x80, 0x70, 0x30, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08,
+    0x00, 0x00, 0x60, 0x60, 0x00, 0x20, 0x10, 0x08, 0x04, 0x02,
+    0x3E, 0x51, 0x49, 0x45, 0x3E, 0x00, 0x42, 0x7F, 0x40, 0x00,
+    0x72, 0x49, 0x49, 0x49, 0x46, 0x21, 0x41, 0x49, 0x4D, 0x33,
+    0x18, 0x14, 0x12, 0x7F, 0x10, 0x27, 0x45, 0x45, 0x45, 0x39,
+    0x3C, 0x4A, 0x49, 0x49, 0x31, 0x41, 0x21, 0x11, 0x09, 0x07,
+    0x36, 0x49, 0x49, 0x49, 0x36, 0x46, 0x49, 0x49, 0x29, 0x1E,
+    0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x40, 0x34, 0x00, 0x00,
+    0x00, 0x08, 0x14, 0x22, 0x41, 0x14, 0x14, 0x14, 0x14, 0x14,
+    0x00, 0x41, 0x22, 0x14, 0x08, 0x02, 0x01, 0x59, 0x09, 0x06,
+    0x3E, 0x41, 0x5D, 0x59, 0x4E, 0x7C, 0x12, 0x11, 0x12, 0x7C,
+    0x7F, 0x49, 0x49, 0x49, 0x36, 0x3E, 0x41, 0x41, 0x41, 0x22,
+    0x7F, 0x41, 0x41, 0x41, 0x3E, 0x7F, 0x49, 0x49, 0x49, 0x41,
+    0x7F, 0x09, 0x09, 0x09, 0x01, 0x3E, 0x41, 0x41, 0x51, 0x73,
+    0x7F, 0x08, 0x08, 0x08, 0x7F, 0x00, 0x41, 0x7F, 0x41, 0x00,
+    0x20, 0x40, 0x41, 0x3F, 0x01, 0x7F, 0x08, 0x14, 0x22, 0x41,
+    0x7F, 0x40, 0x40, 0x40, 0x40, 0x7F, 0x02, 0x1C, 0x02, 0x7F,
+    0x7F, 0x04, 0x08, 0x10, 0x7F, 0x3E, 0x41, 0x41, 0x41, 0x3E,
+    0x7F, 0x09, 0x09, 0x09, 0x06, 0x3E, 0x41, 0x51, 0x21, 0x5E,
+    0x7F, 0x09, 0x19, 0x29, 0x46, 0x26, 0x49, 0x49, 0x49, 0x32,
+    0x03, 0x01, 0x7F, 0x01, 0x03, 0x3F, 0x40, 0x40, 0x40, 0x3F,
+    0x1F, 0x20, 0x40, 0x20, 0x1F, 0x3F, 0x40, 0x38, 0x40, 0x3F,
+    0x63, 0x14, 0x08, 0x14, 0x63, 0x03, 0x04, 0x78, 0x04, 0x03,
+    0x61, 0x59, 0x49, 0x4D, 0x43, 0x00, 0x7F, 0x41, 0x41, 0x41,
+    0x02, 0x04, 0x08, 0x10, 0x20, 0x00, 0x41, 0x41, 0x41, 0x7F,
+    0x04, 0x02, 0x01, 0x02, 0x04, 0x40, 0x40, 0x40, 0x40, 0x40,
+    0x00, 0x03, 0x07, 0x08, 0x00, 0x20, 0x54, 0x54, 0x78, 0x40,
+    0x7F, 0x28, 0x44, 0x44, 0x38, 0x38, 0x44, 0x44, 0x44, 0x28,
+    0x38, 0x44, 0x44, 0x28, 0x7F, 0x38, 0x54, 0x54, 0x54, 0x18,
+    0x00, 0x08, 0x7E, 0x09, 0x02, 0x18, 0xA4, 0xA4, 0x9C, 0x78,
+    0x7F, 0x08, 0x04, 0x04, 0x78, 0x00, 0x44, 0x7D, 0x40, 0x00,
+    0x20, 0x40, 0x40, 0x3D, 0x00, 0x7F, 0x10, 0x28, 0x44, 0x00,
+    0x00, 0x41, 0x7F, 0x40, 0x00, 0x7C, 0x04, 0x78, 0x04, 0x78,
+    0x7C, 0x08, 0x04, 0x04, 0x78, 0x38, 0x44, 0x44, 0x44, 0x38,
+    0xFC, 0x18, 0x24, 0x24, 0x18, 0x18, 0x24, 0x24, 0x18, 0xFC,
+    0x7C, 0x08, 0x04, 0x04, 0x08, 0x48, 0x54, 0x54, 0x54, 0x24,
+    0x04, 0x04, 0x3F, 0x44, 0x24, 0x3C, 0x40, 0x40, 0x20, 0x7C,
+    0x1C, 0x20, 0x40, 0x20, 0x1C, 0x3C, 0x40, 0x30, 0x40, 0x3C,
+    0x44, 0x28, 0x10, 0x28, 0x44, 0x4C, 0x90, 0x90, 0x90, 0x7C,
+    0x44, 0x64, 0x54, 0x4C, 0x44, 0x00, 0x08, 0x36, 0x41, 0x00,
+    0x00, 0x00, 0x77, 0x00, 0x00, 0x00, 0x41, 0x36, 0x08, 0x00,
+    0x02, 0x01, 0x02, 0x04, 0x02, 0x3C, 0x26, 0x23, 0x26, 0x3C,
+    0x1E, 0xA1, 0xA1, 0x61, 0x12, 0x3A, 0x40, 0x40, 0x20, 0x7A,
+    0x38, 0x54, 0x54, 0x55, 0x59, 0x21, 0x55, 0x55, 0x79, 0x41,
+    0x21, 0x54, 0x54, 0x78, 0x41, 0x21, 0x55, 0x54, 0x78, 0x40,
+    0x20, 0x54, 0x55, 0x79, 0x40, 0x0C, 0x1E, 0x52, 0x72, 0x12,
+    0x39, 0x55, 0x55, 0x55, 0x59, 0x39, 0x54, 0x54, 0x54, 0x59,
+    0x39, 0x55, 0x54, 0x54, 0x58, 0x00, 0x00, 0x45, 0x7C, 0x41,
+    0x00, 0x02, 0x45, 0x7D, 0x42, 0x00, 0x01, 0x45, 0x7C, 0x40,
+    0xF0, 0x29, 0x24, 0x29, 0xF0, 0xF0, 0x28, 0x25, 0x28, 0xF0,
+    0x7C, 0x54, 0x55, 0x45, 0x00, 0x20, 0x54, 0x54, 0x7C, 0x54,
+    0x7C, 0x0A, 0x09, 0x7F, 0x49, 0x32, 0x49, 0x49, 0x49, 0x32,
+    0x32, 0x48, 0x48, 0x48, 0x32, 0x32, 0x4A, 0x48, 0x48, 0x30,
+    0x3A, 0x41, 0x41, 0x21, 0x7A, 0x3A, 0x42, 0x40, 0x20, 0x78,
+    0x00, 0x9D, 0xA0, 0xA0, 0x7D, 0x39, 0x44, 0x44, 0x44, 0x39,
+    0x3D, 0x40, 0x40, 0x40, 0x3D, 0x3C, 0x24, 0xFF, 0x24, 0x24,
+    0x48, 0x7E, 0x49, 0x43, 0x66, 0x2B, 0x2F, 0xFC, 0x2F, 0x2B,
+    0xFF, 0x09, 0x29, 0xF6, 0x20, 0xC0, 0x88, 0x7E, 0x09, 0x03,
+    0x20, 0x54, 0x54, 0x79, 0x41, 0x00, 0x00, 0x44, 0x7D, 0x41,
+    0x30, 0x48, 0x48, 0x4A, 0x32, 0x38, 0x40, 0x40, 0x22, 0x7A,
+    0x00, 0x7A, 0x0A, 0x0A, 0x72, 0x7D, 0x0D, 0x19, 0x31, 0x7D,
+    0x26, 0x29, 0x29, 0x2F, 0x28, 0x26, 0x29, 0x29, 0x29, 0x26,
+    0x30, 0x48, 0x4D, 0x40, 0x20, 0x38, 0x08, 0x08, 0x08, 0x08,
+    0x08, 0x08, 0x08, 0x08, 0x38, 0x2F, 0x10, 0xC8, 0xAC, 0xBA,
+    0x2F, 0x10, 0x28, 0x34, 0xFA, 0x00, 0x00, 0x7B, 0x00, 0x00,
+    0x08, 0x14, 0x2A, 0x14, 0x22, 0x22, 0x14, 0x2A, 0x14, 0x08,
+    0xAA, 0x00, 0x55, 0x00, 0xAA, 0xAA, 0x55, 0xAA, 0x55, 0xAA,
+    0x00, 0x00, 0x00, 0xFF, 0x00, 0x10, 0x10, 0x10, 0xFF, 0x00,
+    0x14, 0x14, 0x14, 0xFF, 0x00, 0x10, 0x10, 0xFF, 0x00, 0xFF,
+    0x10, 0x10, 0xF0, 0x10, 0xF0, 0x14, 0x14, 0x14, 0xFC, 0x00,
+    0x14, 0x14, 0xF7, 0x00, 0xFF, 0x00, 0x00, 0xFF, 0x00, 0xFF,
+    0x14, 0x14, 0xF4, 0x04, 0xFC, 0x14, 0x14, 0x17, 0x10, 0x1F,
+    0x10, 0x10, 0x1F, 0x10, 0x1F, 0x14, 0x14, 0x14, 0x1F, 0x00,
+    0x10, 0x10, 0x10, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x10,
+    0x10, 0x10, 0x10, 0x1F, 0x10, 0x10, 0x10, 0x10, 0xF0, 0x10,
+    0x00, 0x00, 0x00, 0xFF, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+    0x10, 0x10, 0x10, 0xFF, 0x10, 0x00, 0x00, 0x00, 0xFF, 0x14,
+    0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0x00, 0x1F, 0x10, 0x17,
+    0x00, 0x00, 0xFC, 0x04, 0xF4, 0x14, 0x14, 0x17, 0x10, 0x17,
+    0x14, 0x14, 0xF4, 0x04, 0xF4, 0x00, 0x00, 0xFF, 0x00, 0xF7,
+    0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0x14, 0xF7, 0x00, 0xF7,
+    0x14, 0x14, 0x14, 0x17, 0x14, 0x10, 0x10, 0x1F, 0x10, 0x1F,
+    0x14, 0x14, 0x14, 0xF4, 0x14, 0x10, 0x10, 0xF0, 0x10, 0xF0,
+    0x00, 0x00, 0x1F, 0x10, 0x1F, 0x00, 0x00, 0x00, 0x1F, 0x14,
+    0x00, 0x00, 0x00, 0xFC, 0x14, 0x00, 0x00, 0xF0, 0x10, 0xF0,
+    0x10, 0x10, 0xFF, 0x10, 0xFF, 0x14, 0x14, 0x14, 0xFF, 0x14,
+    0x10, 0x10, 0x10, 0x1F, 0x00, 0x00, 0x00, 0x00, 0xF0, 0x10,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0, 0xF0, 0xF0, 0xF0, 0xF0,
+    0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF,
+    0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x38, 0x44, 0x44, 0x38, 0x44,
+    0x7C, 0x2A, 0x2A, 0x3E, 0x14, 0x7E, 0x02, 0x02, 0x06, 0x06,
+    0x02, 0x7E, 0x02, 0x7E, 0x02, 0x63, 0x55, 0x49, 0x41, 0x63,
+    0x38, 0x44, 0x44, 0x3C, 0x04, 0x40, 0x7E, 0x20, 0x1E, 0x20,
+    0x06, 0x02, 0x7E, 0x02, 0x02, 0x99, 0xA5, 0xE7, 0xA5, 0x99,
+    0x1C, 0x2A, 0x49, 0x2A, 0x1C, 0x4C, 0x72, 0x01, 0x72, 0x4C,
+    0x30, 0x4A, 0x4D, 0x4D, 0x30, 0x30, 0x48, 0x78, 0x48, 0x30,
+    0xBC, 0x62, 0x5A, 0x46, 0x3D, 0x3E, 0x49, 0x49, 0x49, 0x00,
+    0x7E, 0x01, 0x01, 0x01, 0x7E, 0x2A, 0x2A, 0x2A, 0x2A, 0x2A,
+    0x44, 0x44, 0x5F, 0x44, 0x44, 0x40, 0x51, 0x4A, 0x44, 0x40,
+    0x40, 0x44, 0x4A, 0x51, 0x40, 0x00, 0x00, 0xFF, 0x01, 0x03,
+    0xE0, 0x80, 0xFF, 0x00, 0x00, 0x08, 0x08, 0x6B, 0x6B, 0x08,
+    0x36, 0x12, 0x36, 0x24, 0x36, 0x06, 0x0F, 0x09, 0x0F, 0x06,
+    0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x10, 0x10, 0x00,
+    0x30, 0x40, 0xFF, 0x01, 0x01, 0x00, 0x1F, 0x01, 0x01, 0x1E,
+    0x00, 0x19, 0x1D, 0x17, 0x12, 0x00, 0x3C, 0x3C, 0x3C, 0x3C,
+    0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+#define HEADLESS_DISPLAY_FONT_CHAR_COUNT                                       \
+  (sizeof(headless_displayFont) / HEADLESS_DISPLAY_FONT_WIDTH)
+
+static uint16_t headless_displayFramebuffer[DISPLAY_HEIGHT][DISPLAY_WIDTH];
+static uint64_t headless_displayPixelCount = 0;
+static uint8_t headless_displayRotation = HEADLESS_DISPLAY_DEFAULT_ROTATION;
+static bool headless_displayInverted = false;
+
+static int16_t headless_displayCursorX = 0;
+static int16_t headless_displayCursorY = 0;
+static uint8_t headless_displayTextSize = 1;
+static uint16_t headless_displayTextColor = DISPLAY_WHITE;
+static uint16_t headless_displayTextBgColor = DISPLAY_WHITE; // Same: no bg.
+static bool headless_displayTextWrap = true;
+
+/********************************* Pixels ************************************/
+
+// Writes a pixel in the current rotation. The framebuffer is kept in the
+// landscape orientation the lab code uses.
+static void headless_displaySetPixel(int16_t x, int16_t y, uint16_t color) {
+  if (x < 0 || y < 0 || x >= display_width() || y >= display_height())
+    return;
+  int16_t fx = x, fy = y;
+  switch (headless_displayRotation) {
+  case DISPLAY_PORTRAIT_MODE_ORIGIN_LOWER_LEFT:
+    fx = y;
+    fy = DISPLAY_HEIGHT - 1 - x;
+    break;
+  case DISPLAY_PORTRAIT_MODE_ORIGIN_UPPER_RIGHT:
+    fx = DISPLAY_WIDTH - 1 - y;
+    fy = x;
+    break;
+  case DISPLAY_LANDSCAPE_MODE_ORIGIN_LOWER_RIGHT:
+    fx = DISPLAY_WIDTH - 1 - x;
+    fy = DISPLAY_HEIGHT - 1 - y;
+    break;
+  }
+  headless_displayFramebuffer[fy][fx] = color;
+  headless_displayPixelCount++;
+}
+
+// Charges the virtual time for the pixels written since pixelCountBefore.
+static void headless_displayCharge(uint64_t pixelCountBefore) {
+  headless_advanceNs((headless_displayPixelCount - pixelCountBefore) *
+                     headless_config.displayPixelNs);
+}
+
+uint64_t headless_displayGetPixelCount() { return headless_displayPixelCount; }
+
+// Writes the framebuffer as a binary PPM (P6) image.
+bool headless_displayWriteFramebuffer(const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    perror(path);
+    return false;
+  }
+  fprintf(file, "P6\n%d %d\n%d\n", DISPLAY_WIDTH, DISPLAY_HEIGHT,
+          HEADLESS_DISPLAY_MAX_COLOR_VALUE);
+  for (uint16_t y = 0; y < DISPLAY_HEIGHT; y++) {
+    for (uint16_t x = 0; x < DISPLAY_WIDTH; x++) {
+      uint16_t color = headless_displayFramebuffer[y][x];
+      if (headless_displayInverted)
+        color = ~color;
+      uint8_t rgb[3] = {(color >> 11) << 3 | (color >> 13),
+                        ((color >> 5) & 0x3F) << 2 | ((color >> 9) & 0x3),
+                        (color & 0x1F) << 3 | ((color >> 2) & 0x7)};
+      fwrite(rgb, sizeof(rgb), 1, file);
+    }
+  }
+  return fclose(file) == 0;
+}
+
+/******************************* Primitives **********************************/
+
+void display_init() {
+  headless_displayRotation = HEADLESS_DISPLAY_DEFAULT_ROTATION;
+  headless_displayInverted = false;
+  headless_displayCursorX = headless_displayCursorY = 0;
+  headless_displayTextSize = 1;
+  headless_displayTextColor = headless_displayTextBgColor = DISPLAY_WHITE;
+  headless_displayTextWrap = true;
+}
+
+void display_drawPixel(int16_t x0, int16_t y0, uint16_t color) {
+  uint64_t before = headless_displayPixelCount;
+  headless_displaySetPixel(x0, y0, color);
+  headless_displayCharge(before);
+}
+
+static void headless_displayLine(int16_t x0, int16_t y0, int16_t x1,
+                                 int16_t y1, uint16_t color) {
+  bool steep = abs(y1 - y0) > abs(x1 - x0);
+  int16_t t;
+  if (steep) {
+    t = x0, x0 = y0, y0 = t;
+    t = x1, x1 = y1, y1 = t;
+  }
+  if (x0 > x1) {
+    t = x0, x0 = x1, x1 = t;
+    t = y0, y0 = y1, y1 = t;
+  }
+  int16_t dx = x1 - x0, dy = abs(y1 - y0);
+  int16_t err = dx / 2;
+  int16_t ystep = y0 < y1 ? 1 : -1;
+  for (; x0 <= x1; x0++) {
+    if (steep)
+      headless_displaySetPixel(y0, x0, color);
+    else
+      headless_displaySetPixel(x0, y0, color);
+    err -= dy;
+    if (err < 0) {
+      y0 += ystep;
+      err += dx;
+    }
+  }
+}
+
+static void headless_displayFill(int16_t x, int16_t y, int16_t w, int16_t h,
+                                 uint16_t color) {
+  for (int16_t j = y; j < y + h; j++)
+    for (int16_t i = x; i < x + w; i++)
+      headless_displaySetPixel(i, j, color);
+}
+
+void display_drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                      uint16_t color) {
+  uint64_t before = headless_displayPixelCount;
+  headless_displayLine(x0, y0, x1, y1, color);
+  headless_displayCharge(before);
+}
+
+void display_drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  display_fillRect(x, y, 1, h, color);
+}
+
+void display_drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  display_fillRect(x, y, w, 1, color);
+}
+
+void display_drawRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                      uint16_t color) {
+  uint64_t before = headless_displayPixelCount;
+  headless_displayFill(x, y, w, 1, color);
+  headless_displayFill(x, y + h - 1, w, 1, color);
+  headless_displayFill(x, y, 1, h, color);
+  headless_displayFill(x + w - 1, y, 1, h, color);
+  headless_displayCharge(before);
+}
+
+void display_fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                      uint16_t color) {
+  uint64_t before = headless_displayPixelCount;
+  headless_displayFill(x, y, w, h, color);
+  headless_displayCharge(before);
+}
+
+void display_fillScreen(uint16_t color) {
+  display_fillRect(0, 0, display_width(), display_height(), color);
+}
+
+void display_invertDisplay(bool i) { headless_displayInverted = i; }
+
+// Draws the quarters of a circle selected by cornerName (1, 2, 4, 8 clockwise
+// from the upper left).
+static void headless_displayCircleHelper(int16_t x0, int16_t y0, int16_t r,
+                                         uint8_t cornerName, uint16_t color) {
+  int16_t f = 1 - r, ddFx = 1, ddFy = -2 * r, x = 0, y = r;
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddFy += 2;
+      f += ddFy;
+    }
+    x++;
+    ddFx += 2;
+    f += ddFx;
+    if (cornerName & 0x4) {
+      headless_displaySetPixel(x0 + x, y0 + y, color);
+      headless_displaySetPixel(x0 + y, y0 + x, color);
+    }
+    if (cornerName & 0x2) {
+      headless_displaySetPixel(x0 + x, y0 - y, color);
+      headless_displaySetPixel(x0 + y, y0 - x, color);
+    }
+    if (cornerName & 0x8) {
+      headless_displaySetPixel(x0 - y, y0 + x, color);
+      headless_displaySetPixel(x0 - x, y0 + y, color);
+    }
+    if (cornerName & 0x1) {
+      headless_displaySetPixel(x0 - y, y0 - x, color);
+      headless_displaySetPixel(x0 - x, y0 - y, color);
+    }
+  }
+}
+
+// Fills the right (cornerName 1) and/or left (2) halves of a circle, stretched
+// vertically by delta.
+static void headless_displayFillCircleHelper(int16_t x0, int16_t y0, int16_t r,
+                                             uint8_t cornerName, int16_t delta,
+                                             uint16_t color) {
+  int16_t f = 1 - r, ddFx = 1, ddFy = -2 * r, x = 0, y = r;
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddFy += 2;
+      f += ddFy;
+    }
+    x++;
+    ddFx += 2;
+    f += ddFx;
+    if (cornerName & 0x1) {
+      headless_displayFill(x0 + x, y0 - y, 1, 2 * y + 1 + delta, color);
+      headless_displayFill(x0 + y, y0 - x, 1, 2 * x + 1 + delta, color);
+    }
+    if (cornerName & 0x2) {
+      headless_displayFill(x0 - x, y0 - y, 1, 2 * y + 1 + delta, color);
+      headless_displayFill(x0 - y, y0 - x, 1, 2 * x + 1 + delta, color);
+    }
+  }
+}
+
+void display_drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+  uint64_t before = headless_displayPixelCount;
+  headless_displaySetPixel(x0, y0 + r, color);
+  headless_displaySetPixel(x0, y0 - r, color);
+  headless_displaySetPixel(x0 + r, y0, color);
+  headless_displaySetPixel(x0 - r, y0, color);
+  headless_displayCircleHelper(x0, y0, r, 0xF, color);
+  headless_displayCharge(before);
+}
+
+void display_fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+  uint64_t before = headless_displayPixelCount;
+  headless_displayFill(x0, y0 - r, 1, 2 * r + 1, color);
+  headless_displayFillCircleHelper(x0, y0, r, 0x3, 0, color);
+  headless_displayCharge(before);
+}
+
+void display_drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                          int16_t x2, int16_t y2, uint16_t color) {
+  uint64_t before = headless_displayPixelCount;
+  headless_displayLine(x0, y0, x1, y1, color);
+  headless_displayLine(x1, y1, x2, y2, color);
+  headless_displayLine(x2, y2, x0, y0, color);
+  headless_displayCharge(before);
+}
+
+// Fills the triangle one horizontal span at a time.
+void display_fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                          int16_t x2, int16_t y2, uint16_t color) {
+  uint64_t before = headless_displayPixelCount;
+  int16_t t;
+  // Sort the corners by y (y2 >= y1 >= y0).
+  if (y0 > y1) {
+    t = y0, y0 = y1, y1 = t;
+    t = x0, x0 = x1, x1 = t;
+  }
+  if (y1 > y2) {
+    t = y2, y2 = y1, y1 = t;
+    t = x2, x2 = x1, x1 = t;
+  }
+  if (y0 > y1) {
+    t = y0, y0 = y1, y1 = t;
+    t = x0, x0 = x1, x1 = t;
+  }
+  if (y0 == y2) { // All on one line.
+    int16_t a = x0, b = x0;
+    if (x1 < a)
+      a = x1;
+    else if (x1 > b)
+      b = x1;
+    if (x2 < a)
+      a = x2;
+    else if (x2 > b)
+      b = x2;
+    headless_displayFill(a, y0, b - a + 1, 1, color);
+    headless_displayCharge(before);
+    return;
+  }
+  int16_t dx01 = x1 - x0, dy01 = y1 - y0, dx02 = x2 - x0, dy02 = y2 - y0,
+          dx12 = x2 - x1, dy12 = y2 - y1;
+  int32_t sa = 0, sb = 0;
+  // The upper part includes scanline y1 unless the lower part is flat.
+  int16_t last = y1 == y2 ? y1 : y1 - 1;
+  int16_t y;
+  for (y = y0; y <= last; y++) {
+    int16_t a = x0 + sa / dy01, b = x0 + sb / dy02;
+    sa += dx01;
+    sb += dx02;
+    if (a > b)
+      t = a, a = b, b = t;
+    headless_displayFill(a, y, b - a + 1, 1, color);
+  }
+  sa = (int32_t)dx12 * (y - y1);
+  sb = (int32_t)dx02 * (y - y0);
+  for (; y <= y2; y++) {
+    int16_t a = x1 + sa / dy12, b = x0 + sb / dy02;
+    sa += dx12;
+    sb += dx02;
+    if (a > b)
+      t = a, a = b, b = t;
+    headless_displayFill(a, y, b - a + 1, 1, color);
+  }
+  headless_displayCharge(before);
+}
+
+void display_drawRoundRect(int16_t x0, int16_t y0, int16_t w, int16_t h,
+                           int16_t radius, uint16_t color) {
+  uint64_t before = headless_displayPixelCount;
+  int16_t r = radius;
+  headless_displayFill(x0 + r, y0, w - 2 * r, 1, color);
+  headless_displayFill(x0 + r, y0 + h - 1, w - 2 * r, 1, color);
+  headless_displayFill(x0, y0 + r, 1, h - 2 * r, color);
+  headless_displayFill(x0 + w - 1, y0 + r, 1, h - 2 * r, color);
+  headless_displayCircleHelper(x0 + r, y0 + r, r, 1, color);
+  headless_displayCircleHelper(x0 + w - r - 1, y0 + r, r, 2, color);
+  headless_displayCircleHelper(x0 + w - r - 1, y0 + h - r - 1, r, 4, color);
+  headless_displayCircleHelper(x0 + r, y0 + h - r - 1, r, 8, color);
+  headless_displayCharge(before);
+}
+
+void display_fillRoundRect(int16_t x0, int16_t y0, int16_t w, int16_t h,
+                           int16_t radius, uint16_t color) {
+  uint64_t before = headless_displayPixelCount;
+  int16_t r = radius;
+  headless_displayFill(x0 + r, y0, w - 2 * r, h, color);
+  headless_displayFillCircleHelper(x0 + w - r - 1, y0 + r, r, 1,
+                                   h - 2 * r - 1, color);
+  headless_displayFillCircleHelper(x0 + r, y0 + r, r, 2, h - 2 * r - 1,
+                                   color);
+  headless_displayCharge(before);
+}
+
+void display_drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w,
+                        int16_t h, uint16_t color) {
+  uint64_t before = headless_displayPixelCount;
+  int16_t byteWidth = (w + 7) / 8;
+  for (int16_t j = 0; j < h; j++)
+    for (int16_t i = 0; i < w; i++)
+      if (bitmap[j * byteWidth + i / 8] & (0x80 >> (i & 7)))
+        headless_displaySetPixel(x + i, y + j, color);
+  headless_displayCharge(before);
+}
+
+/*********************************** Text ************************************/
+
+// Draws a character. Background pixels are only drawn if bg differs from
+// color.
+static void headless_displayChar(int16_t x, int16_t y, unsigned char c,
+                                 uint16_t color, uint16_t bg, uint8_t size) {
+  if (x >= display_width() || y >= display_height() ||
+      x + DISPLAY_CHAR_WIDTH * size - 1 < 0 ||
+      y + DISPLAY_CHAR_HEIGHT * size - 1 < 0)
+    return;
+  for (int8_t i = 0; i < DISPLAY_CHAR_WIDTH; i++) {
+    uint8_t line = 0; // The last column is the gap between characters.
+    if (i < HEADLESS_DISPLAY_FONT_WIDTH && c < HEADLESS_DISPLAY_FONT_CHAR_COUNT)
+      line = headless_displayFont[c * HEADLESS_DISPLAY_FONT_WIDTH + i];
+    for (int8_t j = 0; j < DISPLAY_CHAR_HEIGHT; j++, line >>= 1) {
+      if (line & 0x1)
+        headless_displayFill(x + i * size, y + j * size, size, size, color);
+      else if (bg != color)
+        headless_displayFill(x + i * size, y + j * size, size, size, bg);
+    }
+  }
+}
+
+void display_drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color,
+                      uint16_t bg, uint8_t size) {
+  uint64_t before = headless_displayPixelCount;
+  headless_displayChar(x, y, c, color, bg, size);
+  headless_displayCharge(before);
+}
+
+void display_setCursor(int16_t x, int16_t y) {
+  headless_displayCursorX = x;
+  headless_displayCursorY = y;
+}
+
+void display_setTextColor(uint16_t c) {
+  headless_displayTextColor = headless_displayTextBgColor = c;
+}
+
+void display_setTextColorBg(uint16_t c, uint16_t bg) {
+  headless_displayTextColor = c;
+  headless_displayTextBgColor = bg;
+}
+
+void display_setTextSize(uint8_t s) { headless_displayTextSize = s ? s : 1; }
+
+void display_setTextWrap(bool w) { headless_displayTextWrap = w; }
+
+void display_setRotation(uint8_t r) { headless_displayRotation = r % 4; }
+
+int16_t display_height() {
+  return headless_displayRotation & 0x1 ? DISPLAY_HEIGHT : DISPLAY_WIDTH;
+}
+
+int16_t display_width() {
+  return headless_displayRotation & 0x1 ? DISPLAY_WIDTH : DISPLAY_HEIGHT;
+}
+
+uint16_t display_color565(uint8_t r, uint8_t g, uint8_t b) {
+  return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+// Prints a character at the cursor and moves it on, as Print::write() does.
+size_t display_printChar(char c) {
+  uint64_t before = headless_displayPixelCount;
+  uint8_t size = headless_displayTextSize;
+  if (c == '\n') {
+    headless_displayCursorY += size * DISPLAY_CHAR_HEIGHT;
+    headless_displayCursorX = 0;
+  } else if (c != '\r') {
+    headless_displayChar(headless_displayCursorX, headless_displayCursorY, c,
+                         headless_displayTextColor,
+                         headless_displayTextBgColor, size);
+    headless_displayCursorX += size * DISPLAY_CHAR_WIDTH;
+    if (headless_displayTextWrap &&
+        headless_displayCursorX > display_width() - size * DISPLAY_CHAR_WIDTH) {
+      headless_displayCursorY += size * DISPLAY_CHAR_HEIGHT;
+      headless_displayCursorX = 0;
+    }
+  }
+  headless_displayCharge(before);
+  return 1;
+}
+
+size_t display_print(const char str[]) {
+  size_t count = 0;
+  while (str[count])
+    display_printChar(str[count++]);
+  return count;
+}
+
+size_t display_println(const char str[]) {
+  return display_print(str) + display_print("\r\n");
+}
+
+size_t display_printlnChar(char c) {
+  return display_printChar(c) + display_print("\r\n");
+}
+
+size_t display_printDecimalInt(int num) {
+  char buffer[DISPLAY_CHAR_WIDTH * 2];
+  snprintf(buffer, sizeof(buffer), "%d", num);
+  return display_print(buffer);
+}
+
+size_t display_printlnDecimalInt(int num) {
+  return display_printDecimalInt(num) + display_print("\r\n");
+}
+
+/************************ Tests and touch (not modelled) *********************/
+
+unsigned long display_testLines(__attribute__((unused)) uint16_t color) {
+  return 0;
+}
+unsigned long display_testFastLines(__attribute__((unused)) uint16_t color1,
+                                    __attribute__((unused)) uint16_t color2) {
+  return 0;
+}
+unsigned long display_testRects(__attribute__((unused)) uint16_t color) {
+  return 0;
+}
+unsigned long display_testFilledRects(__attribute__((unused)) uint16_t color1,
+                                      __attribute__((unused)) uint16_t color2) {
+  return 0;
+}
+unsigned long
+display_testFilledCircles(__attribute__((unused)) uint8_t radius,
+                          __attribute__((unused)) uint16_t color) {
+  return 0;
+}
+unsigned long display_testCircles(__attribute__((unused)) uint8_t radius,
+                                  __attribute__((unused)) uint16_t color) {
+  return 0;
+}
+unsigned long display_testTriangles() { return 0; }
+unsigned long display_testFilledTriangles() { return 0; }
+unsigned long display_testRoundRects() { return 0; }
+unsigned long display_testFilledRoundRects() { return 0; }
+unsigned long display_testFillScreen() { return 0; }
+unsigned long display_testText() { return 0; }
+unsigned long display_test() { return 0; }
+
+bool display_isTouched(void) { return false; }
+
+void display_getTouchedPoint(int16_t *x, int16_t *y, uint8_t *z) {
+  *x = *y = 0;
+  *z = 0;
+}
+
+void display_clearOldTouchData() {}
@@ -0,0 +1,121 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// I2S transmitter for the headless emulator backend: the TX side of the
+// axi_i2s_adi IP (platforms/hw/ip/axi_i2s_adi_1.2), as far as the sound code
+// uses it. The TX FIFO holds HEADLESS_I2S_FIFO_WORD_COUNT words, left and
+// right alternating; while the transmitter is enabled it takes one word per
+// channel every 48 kHz frame of virtual time. The status register reports
+// whether the FIFO is empty or full, as the IP does. The samples themselves
+// are thrown away.
+//
+// A frame that finds the FIFO empty is a gap in the sound. It is counted as an
+// underrun when more data follows, so the FIFO draining at the end of a sound
+// is not. A word written to a full FIFO is lost and counted as an overflow.
+
+#include "headless.h"
+#include "xparameters.h"
+
+#define HEADLESS_I2S_RESET_REG 0x00
+#define HEADLESS_I2S_CTRL_REG 0x04
+#define HEADLESS_I2S_FIFO_STS_REG 0x20
+#define HEADLESS_I2S_TX_FIFO_REG 0x2C
+#define HEADLESS_I2S_REGISTER_SPAN 0x30
+#define HEADLESS_I2S_RESET_TX_MASK 0b010
+#define HEADLESS_I2S_CTRL_TX_ENABLE_MASK 0b001
+#define HEADLESS_I2S_STS_TX_EMPTY_MASK 0b0001
+#define HEADLESS_I2S_STS_TX_FULL_MASK 0b0010
+#define HEADLESS_I2S_CHANNEL_COUNT 2
+
+static uint32_t headless_i2sWordCount = 0; // Words in the TX FIFO.
+static bool headless_i2sEnabled = false;
+static bool headless_i2sPlaying = false;  // Frames played since enabled.
+static bool headless_i2sStarved = false;  // Then a frame found it empty.
+static uint64_t headless_i2sFrameNumber = 0; // Frames played up to.
+static headless_i2sStatistics_t headless_i2sStatistics;
+
+const headless_i2sStatistics_t *headless_getI2sStatistics() {
+  return &headless_i2sStatistics;
+}
+
+// Returns the number of 48 kHz frame periods up to the current virtual time.
+static uint64_t headless_i2sGetFrameNumber() {
+  return headless_getTimeNs() * HEADLESS_I2S_SAMPLE_RATE /
+         HEADLESS_NS_PER_SECOND;
+}
+
+// Plays the frames that have fallen due since the last register access.
+static void headless_i2sSync() {
+  uint64_t frameNumber = headless_i2sGetFrameNumber();
+  uint64_t dueCount = frameNumber - headless_i2sFrameNumber;
+  headless_i2sFrameNumber = frameNumber;
+  if (!headless_i2sEnabled || dueCount == 0)
+    return;
+  uint64_t playedCount = headless_i2sWordCount / HEADLESS_I2S_CHANNEL_COUNT;
+  if (playedCount > dueCount)
+    playedCount = dueCount;
+  headless_i2sWordCount -= playedCount * HEADLESS_I2S_CHANNEL_COUNT;
+  headless_i2sStatistics.frameCount += playedCount;
+  headless_i2sPlaying |= (playedCount > 0);
+  if (playedCount < dueCount) {
+    headless_i2sWordCount = 0; // An odd word is dropped with the frame.
+    headless_i2sStarved = headless_i2sPlaying;
+  }
+}
+
+bool headless_i2sIsRegister(uint32_t address) {
+  return address >= XPAR_AXI_I2S_ADI_1_S_AXI_BASEADDR &&
+         address <
+             XPAR_AXI_I2S_ADI_1_S_AXI_BASEADDR + HEADLESS_I2S_REGISTER_SPAN;
+}
+
+uint32_t headless_i2sRead(uint32_t address) {
+  headless_i2sSync();
+  uint32_t offset = address - XPAR_AXI_I2S_ADI_1_S_AXI_BASEADDR;
+  if (offset == HEADLESS_I2S_CTRL_REG)
+    return headless_i2sEnabled ? HEADLESS_I2S_CTRL_TX_ENABLE_MASK : 0;
+  if (offset != HEADLESS_I2S_FIFO_STS_REG)
+    return 0;
+  uint32_t status = 0;
+  if (headless_i2sWordCount == 0)
+    status |= HEADLESS_I2S_STS_TX_EMPTY_MASK;
+  if (headless_i2sWordCount >= HEADLESS_I2S_FIFO_WORD_COUNT)
+    status |= HEADLESS_I2S_STS_TX_FULL_MASK;
+  return status;
+}
+
+void headless_i2sWrite(uint32_t address, uint32_t value) {
+  headless_i2sSync();
+  switch (address - XPAR_AXI_I2S_ADI_1_S_AXI_BASEADDR) {
+  case HEADLESS_I2S_RESET_REG:
+    if (value & HEADLESS_I2S_RESET_TX_MASK) {
+      headless_i2sWordCount = 0;
+      headless_i2sPlaying = false;
+      headless_i2sStarved = false;
+    }
+    break;
+  case HEADLESS_I2S_CTRL_REG:
+    headless_i2sEnabled = value & HEADLESS_I2S_CTRL_TX_ENABLE_MASK;
+    headless_i2sPlaying = false;
+    headless_i2sStarved = false;
+    break;
+  case HEADLESS_I2S_TX_FIFO_REG:
+    if (headless_i2sWordCount >= HEADLESS_I2S_FIFO_WORD_COUNT) {
+      headless_i2sStatistics.overflowCount++;
+      break;
+    }
+    if (headless_i2sStarved)
+      headless_i2sStatistics.underrunCount++;
+    headless_i2sStarved = false;
+    headless_i2sWordCount++;
+    break;
+  }
+}
@@ -0,0 +1,482 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Multi-gun sessions for the headless emulator backend.
+//
+// headless_sessionStart() places the guns at random in the field, forks one
+// process per gun and waits for them. Each gun runs its own copy of the
+// program, so the lasertag modules keep their file-static state unchanged,
+// and the guns run in parallel on as many cores as the host has. A gun's
+// frequency (slide switches) is its number modulo the frequency count. It
+// fires on a schedule: HEADLESS_TRIGGER_PIN reads high for fireMs of every
+// firePeriodMs, from a random phase, and each pull aims at another gun
+// chosen at random.
+//
+// Lock-step: virtual time is cut into epochs of HEADLESS_SESSION_EPOCH_SAMPLES
+// ADC samples. During an epoch each gun records the level of its transmitter
+// pin at every sample, and its receiver sees what the other guns transmitted
+// in the previous epoch, i.e., the channel has one epoch of delay. At the end
+// of an epoch (a sync point) the guns wait for each other on a barrier, so no
+// gun reads an epoch that is still being written and the results do not
+// depend on how the host schedules the processes.
+//
+// Channel: the light of every gun that is transmitting adds at a receiver.
+// The gain from gun a to gun b is min(1, (irRangeM / d)^2) times
+// exp(-theta^2 / (2 beamDeg^2)), where d is the distance from a to b and
+// theta the angle between a's aim and b. Receivers see all around. The
+// reading is mid-scale plus adcAmplitude times the sum of the gains, plus
+// adcNoise.
+//
+// Report: each gun logs the start of every pulse it transmits (an edge after
+// a quiet gap) and every hit (a rising edge of HEADLESS_HIT_LED_PIN). A pulse
+// should hit each gun on another frequency to which the gain is at least
+// hitGain. A hit within HEADLESS_SESSION_HIT_WINDOW_MS of such a pulse is a
+// true hit, any other hit is false. A pulse that is not detected is a miss,
+// unless the target was hit within the lockout time around it (masked). The
+// CPU headroom is the share of virtual time left to the main loop after the
+// ISR, and missed interrupts show a gun whose ISR cannot keep up. Main-loop
+// code costs no virtual time beyond its register accesses, so its load is not
+// in the headroom; the host CPU time per virtual second is reported instead.
+
+#include "headless.h"
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HEADLESS_SESSION_EPOCH_SAMPLES 1000 // 10 ms.
+#define HEADLESS_SESSION_EPOCH_NS                                              \
+  (HEADLESS_SESSION_EPOCH_SAMPLES * HEADLESS_ADC_SAMPLE_NS)
+#define HEADLESS_SESSION_MAX_EVENTS 4096 // Pulses, and hits, per gun.
+#define HEADLESS_SESSION_PULSE_GAP_NS (5 * HEADLESS_NS_PER_MS)
+#define HEADLESS_SESSION_HIT_WINDOW_MS 300 // A pulse lasts 200 ms.
+#define HEADLESS_SESSION_LOCKOUT_MS 500    // LOCKOUT_TIMER_EXPIRE_VALUE.
+#define HEADLESS_SESSION_FREQUENCY_COUNT 10 // FILTER_FREQUENCY_COUNT.
+#define HEADLESS_SESSION_MIN_SEPARATION_M 1.0
+#define HEADLESS_SESSION_MAX_PLACEMENT_TRIES 1000
+#define HEADLESS_SESSION_LOG_PATH_SIZE 256
+
+typedef struct {
+  double x, y; // Position in m.
+  uint16_t frequency;
+  uint64_t firePhaseNs;
+  // Results, written by the gun.
+  headless_isrStatistics_t isr;
+  uint64_t hostCpuNs;
+  uint32_t pulseCount;
+  uint32_t hitCount;
+  bool eventsLost;
+  uint64_t pulseNs[HEADLESS_SESSION_MAX_EVENTS]; // Pulse starts.
+  uint64_t hitNs[HEADLESS_SESSION_MAX_EVENTS];
+} headless_sessionGun_t;
+
+// Shared by all the processes of a session.
+typedef struct {
+  pthread_barrier_t barrier;
+  headless_sessionGun_t guns[HEADLESS_SESSION_MAX_GUNS];
+  // Transmitter level at each sample, double-buffered by epoch.
+  uint8_t transmitter[2][HEADLESS_SESSION_MAX_GUNS]
+                     [HEADLESS_SESSION_EPOCH_SAMPLES];
+} headless_sessionShared_t;
+
+static headless_sessionShared_t *headless_session = NULL;
+
+// State of this gun's process.
+static uint16_t headless_sessionGun = 0;
+static uint64_t headless_sessionEpoch = 0;
+static uint64_t headless_sessionSyncNs = HEADLESS_NEVER;
+static bool headless_sessionTransmitterLevel = false;
+static uint64_t headless_sessionRecordedSample = 0; // First not recorded.
+static uint64_t headless_sessionLastEdgeNs = 0;
+static bool headless_sessionHitLedLevel = false;
+// Gain from each gun to this one, and the shot it was computed for.
+static uint64_t headless_sessionGainShot[HEADLESS_SESSION_MAX_GUNS];
+static double headless_sessionGain[HEADLESS_SESSION_MAX_GUNS];
+
+/********************************** Channel **********************************/
+
+// Returns a repeatable value in [0.0, 1.0) for the pair of numbers.
+static double headless_sessionRandom(uint64_t a, uint64_t b) {
+  uint64_t x = a * 0x9E3779B97F4A7C15ULL ^ b ^ headless_config.seed;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+  return (double)(x >> 11) / (double)(1ULL << 53);
+}
+
+// Returns the number of the trigger pull the gun is on at the time.
+static uint64_t headless_sessionGetShot(uint16_t gun, uint64_t timeNs) {
+  uint64_t phaseNs = headless_session->guns[gun].firePhaseNs;
+  if (timeNs < phaseNs)
+    return 0;
+  return (timeNs - phaseNs) /
+         (headless_config.firePeriodMs * HEADLESS_NS_PER_MS);
+}
+
+// Returns the gun aimed at on the shot.
+static uint16_t headless_sessionGetTarget(uint16_t gun, uint64_t shot) {
+  uint16_t otherCount = headless_config.gunCount - 1;
+  uint16_t offset = 1 + headless_sessionRandom(gun + 1, shot) * otherCount;
+  return (gun + offset) % headless_config.gunCount;
+}
+
+// Returns the channel gain from one gun to another on the shooter's shot.
+static double headless_sessionGetGain(uint16_t from, uint16_t to,
+                                      uint64_t shot) {
+  if (from == to)
+    return 0.0;
+  const headless_sessionGun_t *shooter = &headless_session->guns[from];
+  const headless_sessionGun_t *target =
+      &headless_session->guns[headless_sessionGetTarget(from, shot)];
+  const headless_sessionGun_t *receiver = &headless_session->guns[to];
+  double aim = atan2(target->y - shooter->y, target->x - shooter->x);
+  double dx = receiver->x - shooter->x;
+  double dy = receiver->y - shooter->y;
+  double distance = hypot(dx, dy);
+  double beam =
+      remainder(atan2(dy, dx) - aim, 2 * M_PI) / (headless_config.beamDeg *
+                                                  M_PI / 180.0);
+  double path = distance <= headless_config.irRangeM
+                    ? 1.0
+                    : pow(headless_config.irRangeM / distance, 2);
+  return path * exp(-0.5 * beam * beam);
+}
+
+// Places the guns at random, at least HEADLESS_SESSION_MIN_SEPARATION_M
+// apart where the field allows it.
+static void headless_sessionPlaceGuns() {
+  for (uint16_t gun = 0; gun < headless_config.gunCount; gun++) {
+    headless_sessionGun_t *placed = &headless_session->guns[gun];
+    for (uint32_t try = 0; try < HEADLESS_SESSION_MAX_PLACEMENT_TRIES; try++) {
+      uint64_t draw =
+          (uint64_t)gun * HEADLESS_SESSION_MAX_PLACEMENT_TRIES + try;
+      placed->x = headless_sessionRandom(draw, 1) * headless_config.fieldM;
+      placed->y = headless_sessionRandom(draw, 2) * headless_config.fieldM;
+      bool clear = true;
+      for (uint16_t other = 0; other < gun; other++)
+        if (hypot(placed->x - headless_session->guns[other].x,
+                  placed->y - headless_session->guns[other].y) <
+            HEADLESS_SESSION_MIN_SEPARATION_M)
+          clear = false;
+      if (clear)
+        break;
+    }
+    placed->frequency = gun % HEADLESS_SESSION_FREQUENCY_COUNT;
+    placed->firePhaseNs = headless_sessionRandom(gun, 3) *
+                          headless_config.firePeriodMs * HEADLESS_NS_PER_MS;
+  }
+}
+
+/********************************* Gun side **********************************/
+
+// Records the transmitter level for this epoch's samples before the sample.
+static void headless_sessionRecordTransmitter(uint64_t endSample) {
+  uint64_t epochStart = headless_sessionEpoch * HEADLESS_SESSION_EPOCH_SAMPLES;
+  uint8_t *levels = headless_session->transmitter[headless_sessionEpoch & 1]
+                                                 [headless_sessionGun];
+  if (endSample > epochStart + HEADLESS_SESSION_EPOCH_SAMPLES)
+    endSample = epochStart + HEADLESS_SESSION_EPOCH_SAMPLES;
+  if (headless_sessionRecordedSample < epochStart)
+    headless_sessionRecordedSample = epochStart;
+  for (; headless_sessionRecordedSample < endSample;
+       headless_sessionRecordedSample++)
+    levels[headless_sessionRecordedSample - epochStart] =
+        headless_sessionTransmitterLevel;
+}
+
+// Adds an event to a gun's log, unless it is full.
+static void headless_sessionLogEvent(uint64_t events[], uint32_t *count,
+                                     uint64_t timeNs) {
+  headless_sessionGun_t *gun = &headless_session->guns[headless_sessionGun];
+  if (*count < HEADLESS_SESSION_MAX_EVENTS)
+    events[(*count)++] = timeNs;
+  else
+    gun->eventsLost = true;
+}
+
+// Sets up this process as the gun.
+static bool headless_sessionStartGun(uint16_t gun) {
+  headless_sessionGun = gun;
+  headless_sessionSyncNs = HEADLESS_SESSION_EPOCH_NS;
+  for (uint16_t i = 0; i < HEADLESS_SESSION_MAX_GUNS; i++)
+    headless_sessionGainShot[i] = HEADLESS_NEVER;
+  headless_config.adcSource = HEADLESS_ADC_SOURCE_SESSION;
+  headless_config.switches = headless_session->guns[gun].frequency;
+  headless_config.seed += gun + 1; // Each receiver has its own noise.
+  char path[HEADLESS_SESSION_LOG_PATH_SIZE] = "/dev/null";
+  if (headless_config.sessionLogPrefix)
+    snprintf(path, sizeof(path), "%s%d.log", headless_config.sessionLogPrefix,
+             gun);
+  if (!freopen(path, "w", stdout)) {
+    perror(path);
+    return false;
+  }
+  return true;
+}
+
+uint64_t headless_sessionGetSyncNs() { return headless_sessionSyncNs; }
+
+void headless_sessionSync() {
+  headless_sessionRecordTransmitter(HEADLESS_NEVER);
+  pthread_barrier_wait(&headless_session->barrier);
+  headless_sessionEpoch++;
+  headless_sessionSyncNs += HEADLESS_SESSION_EPOCH_NS;
+}
+
+bool headless_sessionReadPin(uint8_t pin) {
+  if (headless_sessionSyncNs == HEADLESS_NEVER || pin != HEADLESS_TRIGGER_PIN)
+    return false;
+  uint64_t timeNs = headless_getTimeNs();
+  uint64_t phaseNs = headless_session->guns[headless_sessionGun].firePhaseNs;
+  return timeNs >= phaseNs &&
+         (timeNs - phaseNs) % (headless_config.firePeriodMs *
+                               HEADLESS_NS_PER_MS) <
+             headless_config.fireMs * HEADLESS_NS_PER_MS;
+}
+
+void headless_sessionWritePin(uint8_t pin, bool value) {
+  if (headless_sessionSyncNs == HEADLESS_NEVER)
+    return;
+  headless_sessionGun_t *gun = &headless_session->guns[headless_sessionGun];
+  uint64_t timeNs = headless_getTimeNs();
+  if (pin == HEADLESS_TRANSMITTER_PIN &&
+      value != headless_sessionTransmitterLevel) {
+    headless_sessionRecordTransmitter(timeNs / HEADLESS_ADC_SAMPLE_NS);
+    if (value && (gun->pulseCount == 0 ||
+                  timeNs - headless_sessionLastEdgeNs >=
+                      HEADLESS_SESSION_PULSE_GAP_NS))
+      headless_sessionLogEvent(gun->pulseNs, &gun->pulseCount, timeNs);
+    headless_sessionTransmitterLevel = value;
+    headless_sessionLastEdgeNs = timeNs;
+  } else if (pin == HEADLESS_HIT_LED_PIN) {
+    if (value && !headless_sessionHitLedLevel)
+      headless_sessionLogEvent(gun->hitNs, &gun->hitCount, timeNs);
+    headless_sessionHitLedLevel = value;
+  }
+}
+
+uint32_t headless_sessionAdcRead(uint64_t sampleNumber) {
+  double value = 0.0;
+  uint64_t epochStart = headless_sessionEpoch * HEADLESS_SESSION_EPOCH_SAMPLES;
+  if (headless_sessionEpoch > 0 && sampleNumber >= epochStart) {
+    uint64_t offset = (sampleNumber - epochStart) %
+                      HEADLESS_SESSION_EPOCH_SAMPLES;
+    uint64_t sentNs = (sampleNumber - HEADLESS_SESSION_EPOCH_SAMPLES) *
+                      HEADLESS_ADC_SAMPLE_NS;
+    for (uint16_t from = 0; from < headless_config.gunCount; from++) {
+      if (from == headless_sessionGun ||
+          !headless_session->transmitter[(headless_sessionEpoch - 1) & 1]
+                                        [from][offset])
+        continue;
+      uint64_t shot = headless_sessionGetShot(from, sentNs);
+      if (headless_sessionGainShot[from] != shot) {
+        headless_sessionGainShot[from] = shot;
+        headless_sessionGain[from] =
+            headless_sessionGetGain(from, headless_sessionGun, shot);
+      }
+      value += headless_sessionGain[from];
+    }
+    value *= headless_config.adcAmplitude;
+  }
+  value += headless_config.adcNoise * headless_adcNoise(sampleNumber);
+  int32_t reading =
+      HEADLESS_ADC_MID_SCALE + (int32_t)(value * HEADLESS_ADC_HALF_SCALE);
+  if (reading < 0)
+    return 0;
+  return reading > HEADLESS_ADC_MAX_VALUE ? HEADLESS_ADC_MAX_VALUE : reading;
+}
+
+void headless_sessionEnd() {
+  headless_sessionGun_t *gun = &headless_session->guns[headless_sessionGun];
+  struct timespec hostCpu;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &hostCpu);
+  gun->isr = *headless_getIsrStatistics();
+  gun->hostCpuNs =
+      (uint64_t)hostCpu.tv_sec * HEADLESS_NS_PER_SECOND + hostCpu.tv_nsec;
+}
+
+/********************************** Report ***********************************/
+
+typedef struct {
+  uint32_t expected;
+  uint32_t trueHits;
+  uint32_t falseHits;
+  uint32_t missed;
+  uint32_t masked;
+} headless_sessionScore_t;
+
+static int headless_sessionCompareNs(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+// Scores the hits on a gun against the pulses that should have hit it.
+static headless_sessionScore_t headless_sessionScoreGun(uint16_t target) {
+  headless_sessionScore_t score = {0};
+  const headless_sessionGun_t *hit = &headless_session->guns[target];
+  uint64_t *expectedNs = malloc(sizeof(uint64_t) * HEADLESS_SESSION_MAX_GUNS *
+                                HEADLESS_SESSION_MAX_EVENTS);
+  bool *matched = calloc(HEADLESS_SESSION_MAX_GUNS *
+                             HEADLESS_SESSION_MAX_EVENTS,
+                         sizeof(bool));
+  for (uint16_t from = 0; from < headless_config.gunCount; from++) {
+    const headless_sessionGun_t *shooter = &headless_session->guns[from];
+    if (shooter->frequency == hit->frequency)
+      continue; // Also skips the target itself.
+    for (uint32_t i = 0; i < shooter->pulseCount; i++) {
+      uint64_t shot = headless_sessionGetShot(from, shooter->pulseNs[i]);
+      if (headless_sessionGetGain(from, target, shot) >=
+          headless_config.hitGain)
+        expectedNs[score.expected++] = shooter->pulseNs[i];
+    }
+  }
+  qsort(expectedNs, score.expected, sizeof(uint64_t),
+        headless_sessionCompareNs);
+  uint64_t windowNs = HEADLESS_SESSION_HIT_WINDOW_MS * HEADLESS_NS_PER_MS;
+  uint64_t lockoutNs = HEADLESS_SESSION_LOCKOUT_MS * HEADLESS_NS_PER_MS;
+  // Each hit takes the earliest pulse it can have come from.
+  for (uint32_t h = 0; h < hit->hitCount; h++) {
+    uint32_t e = 0;
+    while (e < score.expected &&
+           (matched[e] || expectedNs[e] + windowNs < hit->hitNs[h]))
+      e++;
+    if (e < score.expected && expectedNs[e] <= hit->hitNs[h]) {
+      matched[e] = true;
+      score.trueHits++;
+    } else {
+      score.falseHits++;
+    }
+  }
+  for (uint32_t e = 0; e < score.expected; e++) {
+    if (matched[e])
+      continue;
+    bool masked = false;
+    for (uint32_t h = 0; h < hit->hitCount; h++)
+      if (hit->hitNs[h] + lockoutNs >= expectedNs[e] &&
+          hit->hitNs[h] <= expectedNs[e] + windowNs)
+        masked = true;
+    if (masked)
+      score.masked++;
+    else
+      score.missed++;
+  }
+  free(expectedNs);
+  free(matched);
+  return score;
+}
+
+// Prints a line of the report per gun and the totals.
+static void headless_sessionPrintReport(double hostSeconds) {
+  double virtualSeconds =
+      (double)headless_config.runLimitNs / HEADLESS_NS_PER_SECOND;
+  printf("Session of %d guns: %.1f virtual seconds in %.1f host seconds.\n",
+         headless_config.gunCount, virtualSeconds, hostSeconds);
+  printf("gun     x     y freq shots expect  hits  true false  miss masked"
+         "  isr%% isr_miss host_ms/s headroom%%\n");
+  headless_sessionScore_t total = {0};
+  uint32_t totalShots = 0, totalHits = 0;
+  double minimumHeadroom = 100.0;
+  for (uint16_t gun = 0; gun < headless_config.gunCount; gun++) {
+    const headless_sessionGun_t *g = &headless_session->guns[gun];
+    headless_sessionScore_t score = headless_sessionScoreGun(gun);
+    double isrPercent = 100.0 * g->isr.virtualNs / headless_config.runLimitNs;
+    double headroom = 100.0 - isrPercent;
+    printf("%3d %5.1f %5.1f %4d %5lu %6lu %5lu %5lu %5lu %5lu %6lu %5.1f "
+           "%8llu %9.1f %9.1f%s\n",
+           gun, g->x, g->y, g->frequency, (unsigned long)g->pulseCount,
+           (unsigned long)score.expected, (unsigned long)g->hitCount,
+           (unsigned long)score.trueHits, (unsigned long)score.falseHits,
+           (unsigned long)score.missed, (unsigned long)score.masked,
+           isrPercent, (unsigned long long)g->isr.missedCount,
+           g->hostCpuNs / 1e6 / virtualSeconds, headroom,
+           g->eventsLost ? " (events lost)" : "");
+    totalShots += g->pulseCount;
+    totalHits += g->hitCount;
+    total.expected += score.expected;
+    total.trueHits += score.trueHits;
+    total.falseHits += score.falseHits;
+    total.missed += score.missed;
+    total.masked += score.masked;
+    minimumHeadroom = fmin(minimumHeadroom, headroom);
+  }
+  uint32_t scored = total.trueHits + total.missed;
+  printf("all             %5lu %6lu %5lu %5lu %5lu %5lu %6lu\n",
+         (unsigned long)totalShots, (unsigned long)total.expected,
+         (unsigned long)totalHits, (unsigned long)total.trueHits,
+         (unsigned long)total.falseHits, (unsigned long)total.missed,
+         (unsigned long)total.masked);
+  printf("Hit accuracy %.1f%% (%lu of %lu), %lu false hits, minimum headroom "
+         "%.1f%%.\n",
+         scored ? 100.0 * total.trueHits / scored : 0.0,
+         (unsigned long)total.trueHits, (unsigned long)scored,
+         (unsigned long)total.falseHits, minimumHeadroom);
+}
+
+/********************************** Session **********************************/
+
+bool headless_sessionStart() {
+  headless_session = mmap(NULL, sizeof(headless_sessionShared_t),
+                          PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                          -1, 0);
+  if (headless_session == MAP_FAILED) {
+    perror("headless: mmap");
+    return false;
+  }
+  pthread_barrierattr_t attributes;
+  pthread_barrierattr_init(&attributes);
+  pthread_barrierattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+  pthread_barrier_init(&headless_session->barrier, &attributes,
+                       headless_config.gunCount);
+  headless_sessionPlaceGuns();
+  // Whole epochs, so that every gun stops at the same sync point.
+  headless_config.runLimitNs =
+      (headless_config.runLimitNs + HEADLESS_SESSION_EPOCH_NS - 1) /
+      HEADLESS_SESSION_EPOCH_NS * HEADLESS_SESSION_EPOCH_NS;
+
+  struct timespec hostStart, hostEnd;
+  clock_gettime(CLOCK_MONOTONIC, &hostStart);
+  pid_t pids[HEADLESS_SESSION_MAX_GUNS];
+  fflush(stdout);
+  for (uint16_t gun = 0; gun < headless_config.gunCount; gun++) {
+    pids[gun] = fork();
+    if (pids[gun] == 0)
+      return headless_sessionStartGun(gun);
+    if (pids[gun] < 0) {
+      perror("headless: fork");
+      for (uint16_t started = 0; started < gun; started++)
+        kill(pids[started], SIGKILL);
+      return false;
+    }
+  }
+  // The others would wait for a failed gun forever, so stop them all.
+  bool failed = false;
+  for (uint16_t done = 0; done < headless_config.gunCount; done++) {
+    int status;
+    wait(&status);
+    if (!failed && !(WIFEXITED(status) && WEXITSTATUS(status) == 0)) {
+      fprintf(stderr, "headless: a gun failed; stopping the session.\n");
+      failed = true;
+      for (uint16_t gun = 0; gun < headless_config.gunCount; gun++)
+        kill(pids[gun], SIGKILL);
+    }
+  }
+  if (failed)
+    exit(EXIT_FAILURE);
+  clock_gettime(CLOCK_MONOTONIC, &hostEnd);
+  headless_sessionPrintReport((hostEnd.tv_sec - hostStart.tv_sec) +
+                              (hostEnd.tv_nsec - hostStart.tv_nsec) / 1e9);
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,191 @@
+#!/usr/bin/python3
+
+""" Encodes a sound effect to the IMA-ADPCM asset format decoded by
+lasertag/adpcm.c, and writes it as a C source and header pair.
+
+The input is either a wav2c array (the .wav.c files in lasertag/sounds, with
+the sample rate taken from the matching .wav.h) or a 16-bit mono .wav file.
+wav2c writes 48 kHz sounds as uint16_t offset binary; signed int16_t arrays
+are understood too. The block layout must match lasertag/adpcm.h.
+
+tools/sound_pack.py uses this module to encode the sounds it packs. Run it
+by hand with --report to see the size saved and the signal-to-noise ratio.
+"""
+
+import argparse
+import math
+import pathlib
+import re
+import struct
+import sys
+import wave
+
+BLOCK_SAMPLE_COUNT = 256
+BLOCK_HEADER_SIZE = 4
+BLOCK_SIZE = BLOCK_HEADER_SIZE + BLOCK_SAMPLE_COUNT // 2
+BYTES_PER_LINE = 16
+
+# wav2c writes the sample rate ten times too large in its headers.
+WAV2C_SAMPLE_RATE_SCALE = 10
+
+STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41,
+    45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209,
+    230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876,
+    963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749,
+    3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
+    9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385,
+    24623, 27086, 29794, 32767]
+INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8]
+
+
+def apply_code(predictor, step_index, code):
+    """ Returns the decoder state after the code, as adpcm.c computes it. """
+    step = STEP_TABLE[step_index]
+    delta = step >> 3
+    if code & 4:
+        delta += step
+    if code & 2:
+        delta += step >> 1
+    if code & 1:
+        delta += step >> 2
+    predictor += -delta if code & 8 else delta
+    predictor = max(-32768, min(32767, predictor))
+    step_index = max(0, min(len(STEP_TABLE) - 1, step_index + INDEX_TABLE[code & 7]))
+    return predictor, step_index
+
+
+def encode_sample(predictor, step_index, sample):
+    """ Returns the code that best moves the predictor towards the sample. """
+    difference = sample - predictor
+    step = STEP_TABLE[step_index]
+    code = 0
+    if difference < 0:
+        code = 8
+        difference = -difference
+    for bit in (4, 2, 1):
+        if difference >= step:
+            code |= bit
+            difference -= step
+        step >>= 1
+    return code
+
+
+def encode(samples):
+    """ Returns the encoded asset for a list of signed 16-bit samples. """
+    data = bytearray()
+    predictor = 0
+    step_index = 0
+    for start in range(0, len(samples), BLOCK_SAMPLE_COUNT):
+        block = samples[start : start + BLOCK_SAMPLE_COUNT]
+        data += struct.pack("<hBB", predictor, step_index, 0)
+        codes = []
+        for sample in block:
+            code = encode_sample(predictor, step_index, sample)
+            predictor, step_index = apply_code(predictor, step_index, code)
+            codes.append(code)
+        if len(codes) % 2:
+            codes.append(0)
+        data += bytes(codes[i] | codes[i + 1] << 4 for i in range(0, len(codes), 2))
+    return bytes(data)
+
+
+def decode(data, sample_count):
+    """ Returns the samples of an encoded asset, as adpcm.c decodes them. """
+    samples = []
+    for start in range(0, sample_count, BLOCK_SAMPLE_COUNT):
+        offset = start // BLOCK_SAMPLE_COUNT * BLOCK_SIZE
+        predictor, step_index, _ = struct.unpack_from("<hBB", data, offset)
+        for i in range(min(BLOCK_SAMPLE_COUNT, sample_count - start)):
+            byte = data[offset + BLOCK_HEADER_SIZE + i // 2]
+            code = (byte >> (4 * (i & 1))) & 0xF
+            predictor, step_index = apply_code(predictor, step_index, code)
+            samples.append(predictor)
+    return samples
+
+
+def read_wav2c(source_path):
+    """ Returns (samples, sample rate) for a wav2c .wav.c array. """
+    text = source_path.read_text()
+    match = re.search(r"\b(u?int16_t)\s+\w+\s*\[\d*\]\s*=\s*\{([^}]*)\}", text)
+    if not match:
+        sys.exit("{}: no 16-bit wav2c array found".format(source_path))
+    samples = [int(value) for value in match.group(2).replace(",", " ").split()]
+    if match.group(1) == "uint16_t":
+        samples = [value - 32768 for value in samples]
+    header_path = source_path.with_suffix(".h")
+    rate = re.search(r"_SAMPLE_RATE\s+(\d+)", header_path.read_text())
+    if not rate:
+        sys.exit("{}: no sample rate found".format(header_path))
+    return samples, int(rate.group(1)) // WAV2C_SAMPLE_RATE_SCALE
+
+
+def read_wav(source_path):
+    """ Returns (samples, sample rate) for a 16-bit mono .wav file. """
+    with wave.open(str(source_path), "rb") as wav:
+        if wav.getsampwidth() != 2 or wav.getnchannels() != 1:
+            sys.exit("{}: only 16-bit mono files are supported".format(source_path))
+        frames = wav.readframes(wav.getnframes())
+        samples = list(struct.unpack("<{}h".format(len(frames) // 2), frames))
+        return samples, wav.getframerate()
+
+
+def write_source(output_dir, name, data, sample_count, sample_rate, source_path):
+    """ Writes <name>.adpcm.c and <name>.adpcm.h. """
+    generated = "// This file was generated from {} by tools/{}.\n".format(
+        source_path.name, pathlib.Path(__file__).name)
+    array = name + "_adpcm"
+    define = name.upper() + "_ADPCM"
+    header = generated
+    header += "#ifndef {}_H_\n#define {}_H_\n\n".format(define, define)
+    header += "#include <stdint.h>\n\n"
+    header += "extern const uint8_t {}[];\n".format(array)
+    header += "#define {}_NUMBER_OF_SAMPLES {}\n".format(define, sample_count)
+    header += "#define {}_SAMPLE_RATE {}\n".format(define, sample_rate)
+    header += "#define {}_SIZE {}\n\n".format(define, len(data))
+    header += "#endif /* {}_H_ */\n".format(define)
+    lines = []
+    for start in range(0, len(data), BYTES_PER_LINE):
+        chunk = data[start : start + BYTES_PER_LINE]
+        lines.append("    " + ", ".join("0x{:02x}".format(b) for b in chunk) + ",")
+    source = generated
+    source += '\n#include "{}.adpcm.h"\n\n'.format(name)
+    source += "const uint8_t {}[{}_SIZE] = {{\n".format(array, define)
+    source += "\n".join(lines) + "\n};\n"
+    (output_dir / (name + ".adpcm.h")).write_text(header)
+    (output_dir / (name + ".adpcm.c")).write_text(source)
+
+
+def snr_db(samples, decoded):
+    """ Returns the signal-to-noise ratio of the decoded samples in dB. """
+    signal = sum(s * s for s in samples)
+    noise = sum((d - s) ** 2 for s, d in zip(samples, decoded))
+    return math.inf if noise == 0 else 10 * math.log10(signal / noise)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", type=pathlib.Path, help="wav2c .wav.c array or .wav file")
+    parser.add_argument("-o", "--output-dir", type=pathlib.Path, default=pathlib.Path("."))
+    parser.add_argument("-n", "--name", help="asset name (default: from the source file name)")
+    parser.add_argument("--report", action="store_true",
+                        help="print the raw and encoded sizes and the signal-to-noise ratio")
+    args = parser.parse_args()
+
+    if args.source.suffix == ".c":
+        samples, sample_rate = read_wav2c(args.source)
+    else:
+        samples, sample_rate = read_wav(args.source)
+    name = args.name or args.source.name.split(".")[0]
+    data = encode(samples)
+    args.output_dir.mkdir(parents=True, exist_ok=True)
+    write_source(args.output_dir, name, data, len(samples), sample_rate, args.source)
+    if args.report:
+        raw_size = 2 * len(samples)
+        print("{}: {} samples at {} Hz, {} bytes raw, {} bytes ADPCM ({:.2f}:1), SNR {:.1f} dB"
+              .format(name, len(samples), sample_rate, raw_size, len(data), raw_size / len(data),
+                      snr_db(samples, decode(data, len(samples)))))
+
+
+if __name__ == "__main__":
+    main()
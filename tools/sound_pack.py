@@ -0,0 +1,209 @@
+#!/usr/bin/python3
+
+""" Builds the sound pack read by lasertag/sounds/soundPack.c: one binary
+blob holding every sound effect, with an index at its start.
+
+Give the sounds in sound_sounds_t order (lasertag/sound.h); entry i of the
+index is the sound with value i. Each sound is a wav2c .wav.c array or a
+16-bit mono .wav file (see sound_encode_adpcm.py), "silence:MS" for MS
+milliseconds of silence, or "synth:NAME" for an effect that the firmware
+generates from a patch (see soundSynth.h); neither takes space in the pack. Sounds at any rate
+other than SOUND_PACK_SAMPLE_RATE are resampled to it (see
+sound_resample.py), so the firmware never converts rates. The layout and
+format codes are read from the SOUND_PACK_ defines in soundPack.h.
+
+Sounds are encoded as IMA-ADPCM, except that a sound whose decoded ADPCM
+falls below --min-snr dB (e.g. ouch48k, whose sharp attack ADPCM smears) is
+stored as 16-bit samples instead, at four times the size.
+
+"stream:SOURCE" puts a sound in the stream pack (--stream-output) instead,
+which is written to the SD card and read as the sound plays (see
+soundStream.h). It has the same layout, with the data of each sound aligned
+to a card sector, and always holds ADPCM. The sound's entry in the pack has
+format SOUND_PACK_FORMAT_STREAM and the offset of its data in the stream pack.
+A streamed sound below --min-snr only gets a warning. Its first
+SOUND_PACK_FALLBACK_MS, faded out, stay in the pack as ADPCM too, and the
+firmware plays them instead when there is no card. Both packs' headers hold
+a CRC-32 of the stream pack (streamPackId), so that the firmware does not read
+a stream pack left on the card by another build.
+"""
+
+import argparse
+import pathlib
+import re
+import struct
+import sys
+import zlib
+
+import sound_encode_adpcm
+import sound_resample
+
+REPO_ROOT_DIR = pathlib.Path(__file__).resolve().parent.parent
+DEFAULT_HEADER = REPO_ROOT_DIR / "lasertag" / "sounds" / "soundPack.h"
+
+HEADER_FORMAT = "<IHHII"
+ENTRY_FORMAT = "<{}sIIIB3xII"
+SILENCE_PREFIX = "silence:"
+SYNTH_PREFIX = "synth:"
+STREAM_PREFIX = "stream:"
+MS_PER_SECOND = 1000
+FALLBACK_FADE_MS = 50  # So that a cut-short fallback does not click.
+NO_FALLBACK = (0, b"")
+DEFAULT_MIN_SNR_DB = 20.0
+
+
+def read_defines(header_path):
+    """ Returns the numeric SOUND_PACK_ defines from the header. """
+    defines = {}
+    pattern = re.compile(r"^#define\s+SOUND_PACK_(\w+)\s+(0x[0-9A-Fa-f]+|\d+)")
+    for line in header_path.read_text().splitlines():
+        match = pattern.match(line)
+        if match:
+            defines[match.group(1)] = int(match.group(2), 0)
+    return defines
+
+
+def align(value, alignment):
+    """ Returns value rounded up to a multiple of alignment. """
+    return (value + alignment - 1) // alignment * alignment
+
+
+def make_fallback(samples, defines):
+    """ Returns (sample count, ADPCM data) of the start of a streamed sound,
+    faded out at the end. """
+    sample_rate = defines["SAMPLE_RATE"]
+    samples = samples[:defines["FALLBACK_MS"] * sample_rate // MS_PER_SECOND]
+    fade_count = min(len(samples), FALLBACK_FADE_MS * sample_rate // MS_PER_SECOND)
+    start = len(samples) - fade_count
+    samples = samples[:start] + [
+        samples[start + i] * (fade_count - i) // fade_count for i in range(fade_count)]
+    return len(samples), sound_encode_adpcm.encode(samples)
+
+
+def read_sound(source, defines, pcm, min_snr_db, streamed=False):
+    """ Returns (name, format, sample count, sample rate, data, fallback) for a
+    sound, where fallback is (sample count, data) from make_fallback() for a
+    streamed sound and NO_FALLBACK otherwise. """
+    sample_rate = defines["SAMPLE_RATE"]
+    if source.startswith(SILENCE_PREFIX):
+        sample_count = int(source[len(SILENCE_PREFIX):]) * sample_rate // MS_PER_SECOND
+        return ("silence", defines["FORMAT_SILENCE"], sample_count, sample_rate, b"",
+                NO_FALLBACK)
+    if source.startswith(SYNTH_PREFIX):
+        # The patch gives the length.
+        return (source[len(SYNTH_PREFIX):], defines["FORMAT_SYNTH"], 0, sample_rate, b"",
+                NO_FALLBACK)
+    if source.startswith(STREAM_PREFIX):
+        # The firmware decodes streamed sounds as they arrive.
+        return read_sound(source[len(STREAM_PREFIX):], defines, False, min_snr_db, True)
+    path = pathlib.Path(source)
+    if path.suffix == ".c":
+        samples, source_rate = sound_encode_adpcm.read_wav2c(path)
+    else:
+        samples, source_rate = sound_encode_adpcm.read_wav(path)
+    samples = sound_resample.resample(samples, source_rate, sample_rate)
+    name = path.name.split(".")[0]
+    fallback = make_fallback(samples, defines) if streamed else NO_FALLBACK
+    if not pcm:
+        data = sound_encode_adpcm.encode(samples)
+        snr = sound_encode_adpcm.snr_db(samples,
+                                        sound_encode_adpcm.decode(data, len(samples)))
+        if snr >= min_snr_db:
+            return name, defines["FORMAT_ADPCM"], len(samples), sample_rate, data, fallback
+        if streamed:
+            print("warning: {} is {:.1f} dB after ADPCM, below {:.1f} dB, but streamed "
+                  "sounds are always ADPCM.".format(name, snr, min_snr_db), file=sys.stderr)
+            return name, defines["FORMAT_ADPCM"], len(samples), sample_rate, data, fallback
+        print("{} is {:.1f} dB after ADPCM, below {:.1f} dB; storing it as PCM.".format(
+            name, snr, min_snr_db), file=sys.stderr)
+    data = struct.pack("<{}h".format(len(samples)), *samples)
+    return name, defines["FORMAT_PCM16"], len(samples), sample_rate, data, NO_FALLBACK
+
+
+def build_pack(sounds, defines, alignment, stream_offsets=(), stream_pack_id=0):
+    """ Returns the pack for a list of sounds from read_sound(), with their
+    data aligned to alignment, and the offset of each sound's data. Streamed
+    sounds take their offsets, in order, from stream_offsets, and keep their
+    fallback in the pack. stream_pack_id goes in the header. """
+    stream_offsets = iter(stream_offsets)
+    entry_format = ENTRY_FORMAT.format(defines["NAME_SIZE"])
+    data_start = struct.calcsize(HEADER_FORMAT) + len(sounds) * struct.calcsize(entry_format)
+    index = b""
+    body = bytearray()
+    offsets = []
+    def add_data(data):
+        """ Appends data to the body and returns its offset in the pack. """
+        nonlocal body
+        offset = align(data_start + len(body), alignment)
+        body += bytes(offset - data_start - len(body)) + data
+        return offset
+
+    for name, sound_format, sample_count, sample_rate, data, fallback in sounds:
+        offset = 0
+        fallback_offset = 0
+        if sound_format == defines["FORMAT_STREAM"]:
+            offset = next(stream_offsets)
+            fallback_offset = add_data(fallback[1])
+        elif data:
+            offset = add_data(data)
+        offsets.append(offset)
+        index += struct.pack(entry_format, name.encode()[:defines["NAME_SIZE"] - 1], offset,
+                             sample_count, sample_rate, sound_format, fallback_offset,
+                             fallback[0])
+    size = align(data_start + len(body), alignment)
+    body += bytes(size - data_start - len(body))
+    header = struct.pack(HEADER_FORMAT, defines["MAGIC"], defines["VERSION"], len(sounds),
+                         size, stream_pack_id)
+    return header + index + bytes(body), offsets
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("sounds", nargs="+", help="sounds in sound_sounds_t order")
+    parser.add_argument("-o", "--output", type=pathlib.Path, required=True,
+                        help="pack file to write")
+    parser.add_argument("--stream-output", type=pathlib.Path,
+                        help="stream pack file to write, for stream: sounds")
+    parser.add_argument("--pcm", action="store_true",
+                        help="store raw 16-bit samples instead of ADPCM")
+    parser.add_argument("--min-snr", type=float, default=DEFAULT_MIN_SNR_DB,
+                        help="store a sound as raw samples if its ADPCM signal-to-noise "
+                             "ratio is below this many dB (default: %(default)s)")
+    parser.add_argument("--header", type=pathlib.Path, default=DEFAULT_HEADER,
+                        help="path to soundPack.h")
+    args = parser.parse_args()
+
+    defines = read_defines(args.header)
+    sounds = [read_sound(source, defines, args.pcm, args.min_snr) for source in args.sounds]
+    streamed = [source.startswith(STREAM_PREFIX) for source in args.sounds]
+    if any(streamed) and args.stream_output is None:
+        parser.error("stream: sounds need --stream-output")
+
+    # Streamed sounds go into the stream pack and leave an entry with only
+    # their fallback. The stream pack has no fallbacks.
+    stream_sounds = [sound[:5] + (NO_FALLBACK,) for sound, stream in zip(sounds, streamed)
+                     if stream]
+    stream_pack, stream_offsets = build_pack(stream_sounds, defines,
+                                             defines["STREAM_ALIGNMENT"])
+    # Both headers identify the stream pack, so the firmware can tell whether
+    # the one on the SD card was built with this pack.
+    stream_pack_id = zlib.crc32(stream_pack)
+    stream_pack, _ = build_pack(stream_sounds, defines, defines["STREAM_ALIGNMENT"],
+                                stream_pack_id=stream_pack_id)
+    sounds = [(sound[0], defines["FORMAT_STREAM"], sound[2], sound[3], b"", sound[5])
+              if stream else sound for sound, stream in zip(sounds, streamed)]
+    pack, _ = build_pack(sounds, defines, defines["ALIGNMENT"], stream_offsets,
+                         stream_pack_id)
+    args.output.parent.mkdir(parents=True, exist_ok=True)
+    args.output.write_bytes(pack)
+    print("Packed {} sounds into {} bytes.".format(len(sounds), len(pack)), file=sys.stderr)
+    if args.stream_output is not None:
+        args.stream_output.parent.mkdir(parents=True, exist_ok=True)
+        args.stream_output.write_bytes(stream_pack)
+        print("Packed {} streamed sounds into {} bytes.".format(len(stream_sounds),
+                                                                len(stream_pack)),
+              file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,112 @@
+#!/usr/bin/python3
+
+""" Resamples a sound effect to another rate with a polyphase FIR filter.
+
+The codec runs at 48 kHz and the firmware plays every sample as it comes, so
+tools/sound_pack.py uses this module to bring each sound to the codec's rate
+before it is encoded. Nothing is converted on the board.
+
+The rates are taken as a ratio up/down in lowest terms. The prototype filter
+is a Kaiser-windowed sinc with TAPS_PER_PHASE taps for each of the up
+phases, cut off just below the lower of the two Nyquist frequencies; each
+output sample uses one phase, so it costs TAPS_PER_PHASE multiplies. The input
+is a wav2c array or a 16-bit mono .wav file (see sound_encode_adpcm.py); run
+this by hand to write the result as a .wav file for listening.
+"""
+
+import argparse
+import math
+import pathlib
+import struct
+import wave
+
+import sound_encode_adpcm
+
+TAPS_PER_PHASE = 32
+KAISER_BETA = 8.6  # About 85 dB of stopband attenuation.
+ROLLOFF = 0.92  # Cutoff, as a fraction of the lower Nyquist frequency.
+BESSEL_TERMS = 30
+SAMPLE_MIN = -32768
+SAMPLE_MAX = 32767
+
+
+def bessel_i0(x):
+    """ Returns the zeroth-order modified Bessel function of the first kind. """
+    total = 1.0
+    term = 1.0
+    for k in range(1, BESSEL_TERMS):
+        term *= (x / (2 * k)) ** 2
+        total += term
+    return total
+
+
+def design_filter(up, down):
+    """ Returns the prototype filter, at up times the input rate, with a gain of up
+    so that the zeros stuffed between input samples are made up for. """
+    half_length = TAPS_PER_PHASE // 2 * up
+    cutoff = ROLLOFF * 0.5 / max(up, down)  # In cycles per filter tap.
+    window_scale = bessel_i0(KAISER_BETA)
+    taps = []
+    for n in range(-half_length, half_length + 1):
+        x = 2 * cutoff * n
+        sinc = 1.0 if n == 0 else math.sin(math.pi * x) / (math.pi * x)
+        ratio = n / half_length
+        window = bessel_i0(KAISER_BETA * math.sqrt(1 - ratio * ratio)) / window_scale
+        taps.append(up * 2 * cutoff * sinc * window)
+    return taps
+
+
+def resample(samples, rate_in, rate_out):
+    """ Returns the samples resampled from rate_in to rate_out, with the filter
+    delay taken out, so that the output lines up with the input. """
+    if rate_in == rate_out:
+        return list(samples)
+    divisor = math.gcd(rate_in, rate_out)
+    up = rate_out // divisor
+    down = rate_in // divisor
+    taps = design_filter(up, down)
+    center = len(taps) // 2
+    # phases[p][i] multiplies input sample (base - i) for phase p.
+    phases = [taps[p::up] for p in range(up)]
+    output = []
+    for m in range((len(samples) * up + down - 1) // down):
+        position = m * down + center  # In the upsampled stream.
+        base = position // up
+        total = 0.0
+        for i, tap in enumerate(phases[position % up]):
+            j = base - i
+            if 0 <= j < len(samples):
+                total += tap * samples[j]
+        output.append(max(SAMPLE_MIN, min(SAMPLE_MAX, round(total))))
+    return output
+
+
+def write_wav(path, samples, sample_rate):
+    """ Writes 16-bit mono samples to a .wav file. """
+    with wave.open(str(path), "wb") as wav:
+        wav.setnchannels(1)
+        wav.setsampwidth(2)
+        wav.setframerate(sample_rate)
+        wav.writeframes(struct.pack("<{}h".format(len(samples)), *samples))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", type=pathlib.Path, help="wav2c .wav.c array or .wav file")
+    parser.add_argument("-o", "--output", type=pathlib.Path, required=True,
+                        help=".wav file to write")
+    parser.add_argument("-r", "--rate", type=int, default=48000, help="output sample rate")
+    args = parser.parse_args()
+
+    if args.source.suffix == ".c":
+        samples, sample_rate = sound_encode_adpcm.read_wav2c(args.source)
+    else:
+        samples, sample_rate = sound_encode_adpcm.read_wav(args.source)
+    output = resample(samples, sample_rate, args.rate)
+    write_wav(args.output, output, args.rate)
+    print("{}: {} samples at {} Hz -> {} samples at {} Hz".format(
+        args.source.name, len(samples), sample_rate, len(output), args.rate))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,149 @@
+#!/usr/bin/python3
+
+""" Converts statistics written by lasertag/statistics.c, captured from the
+console UART or bluetooth, to a plain CSV file that can be graphed.
+
+Both output formats are understood: "STATS," lines (CSV) and binary frames.
+Other console output in the capture is ignored. If the capture holds several
+runs, each new header starts a new table; only the last run is converted
+unless --all is given, in which case a "run" column is added.
+"""
+
+import argparse
+import csv
+import pathlib
+import re
+import struct
+import sys
+
+REPO_ROOT_DIR = pathlib.Path(__file__).resolve().parent.parent
+DEFAULT_HEADER = REPO_ROOT_DIR / "lasertag" / "statistics.h"
+
+CSV_PREFIX = b"STATS,"
+FRAME_OVERHEAD = 6
+MS_PER_SECOND = 1000.0
+
+
+def read_defines(header_path):
+    """ Returns the numeric STATISTICS_ defines from the header. """
+    defines = {}
+    pattern = re.compile(r"^#define\s+STATISTICS_(\w+)\s+(0x[0-9A-Fa-f]+|\d+|'.')")
+    for line in header_path.read_text().splitlines():
+        match = pattern.match(line)
+        if match:
+            value = match.group(2)
+            defines[match.group(1)] = ord(value[1]) if value.startswith("'") else int(value, 0)
+    return defines
+
+
+def parse_header_frame(payload, defines):
+    """ Returns the column names for a binary header frame. """
+    columns = ["time_s"]
+    index = 0
+    while index < len(payload):
+        kind = payload[index]
+        end = payload.index(0, index + 1)
+        name = payload[index + 1 : end].decode(errors="replace")
+        columns.append(name)
+        if kind == defines["KIND_GAUGE"]:
+            columns.append(name + "_max")
+        index = end + 1
+    return columns
+
+
+def parse_snapshot_frame(payload, kinds, defines):
+    """ Returns the row of values for a binary snapshot frame. """
+    row = [struct.unpack_from("<I", payload, 0)[0] / MS_PER_SECOND]
+    index = 4
+    for kind in kinds:
+        if kind == defines["KIND_COUNTER"]:
+            row.append(struct.unpack_from("<I", payload, index)[0])
+            index += 4
+        else:
+            count = 2 if kind == defines["KIND_GAUGE"] else 1
+            row.extend(struct.unpack_from("<%df" % count, payload, index))
+            index += 4 * count
+    return row
+
+
+def header_kinds(payload):
+    """ Returns the kind of each entry in a binary header frame. """
+    kinds = []
+    index = 0
+    while index < len(payload):
+        kinds.append(payload[index])
+        index = payload.index(0, index + 1) + 1
+    return kinds
+
+
+def read_runs(data, defines):
+    """ Returns a list of (columns, rows) tables, one per header found. """
+    sync = bytes([defines["FRAME_SYNC_0"], defines["FRAME_SYNC_1"]])
+    runs = []
+    kinds = None
+    index = 0
+    while index < len(data):
+        if data.startswith(sync, index) and index + FRAME_OVERHEAD <= len(data):
+            frame_type = data[index + 2]
+            size = data[index + 3] | (data[index + 4] << 8)
+            payload = data[index + 5 : index + 5 + size]
+            checksum_index = index + 5 + size
+            if checksum_index < len(data) and sum(payload) & 0xFF == data[checksum_index]:
+                if frame_type == defines["FRAME_TYPE_HEADER"]:
+                    columns = parse_header_frame(payload, defines)
+                    kinds = header_kinds(payload)
+                    runs.append((columns, []))
+                elif frame_type == defines["FRAME_TYPE_SNAPSHOT"] and kinds is not None:
+                    runs[-1][1].append(parse_snapshot_frame(payload, kinds, defines))
+                index = checksum_index + 1
+                continue
+        if data.startswith(CSV_PREFIX, index):
+            end = data.find(b"\n", index)
+            end = len(data) if end < 0 else end
+            fields = data[index + len(CSV_PREFIX) : end].decode(errors="replace").strip().split(",")
+            if fields[0] == "time_s":
+                runs.append((fields, []))
+                kinds = None
+            elif runs:
+                runs[-1][1].append(fields)
+            index = end + 1
+            continue
+        index += 1
+    return runs
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("input", nargs="?", help="Captured output (default: stdin).")
+    parser.add_argument("-o", "--output", help="CSV file to write (default: stdout).")
+    parser.add_argument("--all", action="store_true", help="Convert every run, not just the last.")
+    parser.add_argument("--header", default=str(DEFAULT_HEADER), help="Path to statistics.h.")
+    args = parser.parse_args()
+
+    defines = read_defines(pathlib.Path(args.header))
+    data = pathlib.Path(args.input).read_bytes() if args.input else sys.stdin.buffer.read()
+    runs = read_runs(data, defines)
+    if not runs:
+        sys.exit("No statistics header found in the input.")
+    if not args.all:
+        runs = runs[-1:]
+
+    output = open(args.output, "w", newline="") if args.output else sys.stdout
+    writer = csv.writer(output)
+    columns = runs[-1][0]
+    writer.writerow((["run"] if args.all else []) + columns)
+    row_count = 0
+    for run_number, (run_columns, rows) in enumerate(runs):
+        if run_columns != columns:
+            print("Run %d has different columns; skipped." % run_number, file=sys.stderr)
+            continue
+        for row in rows:
+            writer.writerow(([run_number] if args.all else []) + list(row))
+            row_count += 1
+    if args.output:
+        output.close()
+    print("Converted %d snapshots." % row_count, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,113 @@
+#!/usr/bin/python3
+
+""" Converts a trace dumped by trace_dump() (lasertag/trace.c) over UART to
+Chrome trace-event JSON, which can be opened in Perfetto (ui.perfetto.dev) or
+chrome://tracing.
+
+The UART capture may contain other output; only the lines between
+"TRACE BEGIN" and "TRACE END" are used (the last dump if there are several).
+Event names are read from the TRACE_EVENT_ defines in lasertag/trace.h.
+"""
+
+import argparse
+import json
+import pathlib
+import re
+import sys
+
+REPO_ROOT_DIR = pathlib.Path(__file__).resolve().parent.parent
+DEFAULT_HEADER = REPO_ROOT_DIR / "lasertag" / "trace.h"
+
+ISR_CONTEXT_FLAG = 0x8000
+TIMESTAMP_MODULUS = 1 << 32
+MAIN_LOOP_TID = 0
+ISR_TID = 1
+US_PER_SECOND = 1000000.0
+
+
+def read_event_names(header_path):
+    """ Returns a dict from event number to name, from the trace header. """
+    names = {}
+    pattern = re.compile(r"^#define\s+TRACE_EVENT_(\w+)\s+(\d+)")
+    for line in header_path.read_text().splitlines():
+        match = pattern.match(line)
+        if match:
+            names[int(match.group(2))] = match.group(1)
+    return names
+
+
+def read_dump(lines):
+    """ Returns (ticks_per_second, records) for the last dump in the lines.
+    Each record is a (timestamp, event_id, argument) tuple. """
+    dump = None
+    in_dump = False
+    for line in lines:
+        line = line.strip()
+        if line.startswith("TRACE BEGIN"):
+            fields = line.split()
+            dump = (int(fields[3]), [])
+            in_dump = True
+        elif line.startswith("TRACE END"):
+            in_dump = False
+        elif in_dump and re.fullmatch(r"[0-9a-fA-F]{16}", line):
+            dump[1].append((int(line[0:8], 16), int(line[8:12], 16), int(line[12:16], 16)))
+    if dump is None:
+        sys.exit("No TRACE BEGIN line found in the input.")
+    return dump
+
+
+def to_chrome_events(ticks_per_second, records, names):
+    """ Converts records to a list of Chrome trace events. Timestamps are
+    unwrapped (they are 32 bits) and made relative to the first record. """
+    events = [
+        {"ph": "M", "pid": 0, "tid": MAIN_LOOP_TID, "name": "thread_name", "args": {"name": "main loop"}},
+        {"ph": "M", "pid": 0, "tid": ISR_TID, "name": "thread_name", "args": {"name": "isr"}},
+    ]
+    ticks = 0
+    previous = None
+    for timestamp, event_id, argument in records:
+        if previous is not None:
+            # Records from the ISR may be logged slightly out of order, so the
+            # difference is taken as signed.
+            delta = (timestamp - previous) % TIMESTAMP_MODULUS
+            if delta >= TIMESTAMP_MODULUS // 2:
+                delta -= TIMESTAMP_MODULUS
+            ticks += delta
+        previous = timestamp
+        tid = ISR_TID if event_id & ISR_CONTEXT_FLAG else MAIN_LOOP_TID
+        number = event_id & ~ISR_CONTEXT_FLAG
+        name = names.get(number, "EVENT_%d" % number)
+        event = {"pid": 0, "tid": tid, "ts": ticks * US_PER_SECOND / ticks_per_second}
+        if name.endswith("_BEGIN"):
+            event.update({"ph": "B", "name": name[: -len("_BEGIN")], "args": {"argument": argument}})
+        elif name.endswith("_END"):
+            event.update({"ph": "E", "name": name[: -len("_END")]})
+        else:
+            event.update({"ph": "i", "s": "t", "name": name, "args": {"argument": argument}})
+        events.append(event)
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("input", nargs="?", help="Captured UART output (default: stdin).")
+    parser.add_argument("-o", "--output", help="JSON file to write (default: stdout).")
+    parser.add_argument("--header", default=str(DEFAULT_HEADER), help="Path to trace.h.")
+    args = parser.parse_args()
+
+    names = read_event_names(pathlib.Path(args.header))
+    if args.input:
+        lines = pathlib.Path(args.input).read_text(errors="replace").splitlines()
+    else:
+        lines = sys.stdin.read().splitlines()
+    ticks_per_second, records = read_dump(lines)
+    trace = {"traceEvents": to_chrome_events(ticks_per_second, records, names), "displayTimeUnit": "ns"}
+    if args.output:
+        pathlib.Path(args.output).write_text(json.dumps(trace, indent=1))
+    else:
+        json.dump(trace, sys.stdout, indent=1)
+    print("Converted %d records." % len(records), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()